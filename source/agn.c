@@ -310,7 +310,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
                                    is uniform in frequency space */
      int istart, nphot;         /* Respecitively the starting point in p and the number of photons to generate */
 {
-  double freqmin, freqmax, dfreq, t;
+  double freqmin, freqmax, t;
   int i, iend;
   int n;
   double ftest;
@@ -333,7 +333,6 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
   Log_silent ("photo_gen_agn creates nphot %5d photons from %5d to %5d \n", nphot, istart, iend);
   freqmin = f1;
   freqmax = f2;
-  dfreq = (freqmax - freqmin) / MAXRAND;
 
   /* XXX - this line had been deleted from agn.c in domain, but it still exists in dev, so adding it back
    * as part of test of template_ionloop.pf.  It looks like agn.c in the two places have diverged */
@@ -358,8 +357,10 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
 
 
 
+  qmc_start ();
   for (i = istart; i < iend; i++)
   {
+    qmc_next_photon ();
     p[i].origin = PTYPE_AGN;    // For BL photons this is corrected in photon_gen 
     p[i].w = weight;
     p[i].istat = p[i].nscat = p[i].nrscat = 0;
@@ -375,7 +376,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
     else if (spectype == SPECTYPE_UNIFORM)
     {                           /* Kurucz spectrum */
       /*Produce a uniform distribution of frequencies */
-      p[i].freq = freqmin + rand () * dfreq;
+      p[i].freq = freqmin + launch_rand () * (freqmax - freqmin);
     }
     else if (spectype == SPECTYPE_POW)  /* this is the call to the powerlaw routine 
                                            we are most interested in */
@@ -439,7 +440,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
       p[i].x[0] = p[i].x[1] = 0.0;
 
       /* need to set the z coordinate to the lamp post height, but allow it to be above or below */
-      if (rand () > MAXRAND / 2)
+      if (launch_rand () > 0.5)
       {                         /* Then the photon emerges in the upper hemisphere */
         p[i].x[2] = geo.lamp_post_height;
       }
@@ -452,6 +453,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
     }
 
   }
+  qmc_stop ();
 
   return (0);
 }
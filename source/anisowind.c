@@ -418,11 +418,20 @@ Description:
   reflects the probability of escape along each direction in accordance
   with the sobolev optical depth. 
 
+  Whenever possible the trial directions are drawn from the envelope
+  constructed by tt_get_envelope rather than isotropically, see
+  randwind_tt_envelope.  Otherwise isotropic trial directions are
+  used, and each is accepted with a probability equal to the
+  escape probability divided by that along dvds_max.
+
 Notes:
   
 History:
   1406  Moved code here from photo_gen_matom and scatter to avoid 
         duplication
+  1703  Added the option of drawing trial directions from a tabulated
+	envelope, which avoids the large number of rejections that occurs
+	when the velocity gradient is very anisotropic
 
 
 ****************************************************************/
@@ -462,6 +471,10 @@ randwind_thermal_trapping (p, nnscat)
      by 1/mean escape probability- which is nnscat. this is done in trans_phot.c
      before extract is called. 
    */
+  /* Use the tabulated envelope if it is more efficient than isotropic trials */
+  if (randwind_tt_envelope (p, nnscat, tau_norm * one->dvds_max, p_norm) == 0)
+    return (0);
+
   *nnscat = *nnscat - 1;
 
   /* rejection method loop, which chooses direction and also calculated nnscat */
@@ -483,3 +496,310 @@ randwind_thermal_trapping (p, nnscat)
 
   return (0);
 }
+
+
+
+/***************************************************************
+                      
+                      University of Southampton
+
+Synopsis:   
+  tt_get_envelope returns the envelope that is used to draw trial
+  directions for the thermal trapping scattering mode for 
+  positions which are interpolated between a set of grid cells
+
+Arguments:   
+  ndom		the domain
+  nnn, nelem	the cells (and number of cells) which are interpolated
+		between by coord_fraction
+
+Returns:
+  A pointer to the cumulative distribution of the envelope, which
+  has TT_NBIN elements
+  
+Description:  
+  Along a direction n, dv/ds is obtained from the quadratic form 
+  q(n) = n.G.n, where the velocity gradient tensor G is interpolated 
+  (see dvwind_ds) from the tensors v_grad of the cells nnn.  Since the 
+  interpolation weights are positive and sum to 1, |q(n)| is less than
+  the largest value of |q_k(n)| for the individual cells.
+
+  The unit sphere is divided into TT_NMU bins in mu and TT_NPHI bins
+  in phi, which all have the same solid angle.  For each bin a rigorous 
+  upper limit, qmax, to |q_k(n)| is found from the value, and the
+  gradient, of q_k at the centre of the bin and the largest angular 
+  distance, r, from the centre of the bin to any point in it, namely
+
+  |q(n)| <= |q(n_c)| + |g_t| r + (|q(n_c)| + ||G||) r**2
+
+  where g_t is the component of 2 G n_c perpendicular to n_c and ||G||
+  is the Frobenius norm of the symmetric part of G.
+
+  Since the sobolev escape probability satisfies P(tau) <= 1/tau, 
+  qmax/tau_x_dvds is an upper limit to the escape probability everywhere
+  in the bin, independent of the line or of its optical depth.  The
+  cumulative distribution of qmax times the solid angle of the bins
+  is stored.
+
+Notes:
+  The envelopes are held in a cache of TT_NCACHE entries which is
+  indexed by the first cell in nnn.  An envelope is only recalculated
+  if the cells nnn differ from the ones for which the envelope in this
+  position of the cache was calculated.
+
+  The directions are in the cylindrical frame, in which v_grad is 
+  defined.
+  
+History:
+  1703  Coded
+
+
+****************************************************************/
+
+struct tt_envelope
+{
+  int ndom, nelem, nnn[4];
+  double cdf[TT_NBIN];
+} *tt_cache = NULL;
+
+double *
+tt_get_envelope (ndom, nnn, nelem)
+     int ndom;
+     int nnn[];
+     int nelem;
+{
+  struct tt_envelope *env;
+  double g_s[4][3][3], g_norm[4];
+  double dmu, dphi, mu_lo, mu_hi, mu_c, theta_c, dtheta, smax, r;
+  double n_c[3], gvec[3], q_c, gt, qmax, qtest, domega, sum;
+  int i, j, k, kk, m, n;
+
+  if (tt_cache == NULL)
+  {
+    if ((tt_cache = (struct tt_envelope *) calloc (sizeof (struct tt_envelope), TT_NCACHE)) == NULL)
+    {
+      Error ("tt_get_envelope: Could not allocate memory for %d envelopes\n", TT_NCACHE);
+      exit (0);
+    }
+  }
+
+  env = &tt_cache[nnn[0] % TT_NCACHE];
+
+  /* Check whether this envelope has already been calculated */
+  if (env->ndom == ndom && env->nelem == nelem)
+  {
+    for (k = 0; k < nelem; k++)
+      if (env->nnn[k] != nnn[k])
+        break;
+    if (k == nelem)
+      return (env->cdf);
+  }
+
+  /* Find the symmetric part of the velocity gradient tensor of each cell, and its norm */
+  for (k = 0; k < nelem; k++)
+  {
+    g_norm[k] = 0;
+    for (i = 0; i < 3; i++)
+      for (j = 0; j < 3; j++)
+      {
+        g_s[k][i][j] = 0.5 * (wmain[nnn[k]].v_grad[i][j] + wmain[nnn[k]].v_grad[j][i]);
+        g_norm[k] += g_s[k][i][j] * g_s[k][i][j];
+      }
+    g_norm[k] = sqrt (g_norm[k]);
+  }
+
+  dmu = 2. / TT_NMU;
+  dphi = 2. * PI / TT_NPHI;
+  domega = 4. * PI / TT_NBIN;
+  sum = 0;
+
+  for (m = 0; m < TT_NMU; m++)
+  {
+    mu_lo = -1. + m * dmu;
+    mu_hi = mu_lo + dmu;
+    mu_c = mu_lo + 0.5 * dmu;
+
+    /* The largest angular distance from the centre of the bin to any point in it */
+    theta_c = acos (mu_c);
+    dtheta = acos (mu_lo) - theta_c;
+    if (theta_c - acos (mu_hi) > dtheta)
+      dtheta = theta_c - acos (mu_hi);
+    if (mu_lo < 0 && mu_hi > 0)
+      smax = 1.;
+    else
+      smax = sqrt (1. - (fabs (mu_lo) < fabs (mu_hi) ? mu_lo * mu_lo : mu_hi * mu_hi));
+    r = dtheta + 0.5 * smax * dphi;
+
+    for (n = 0; n < TT_NPHI; n++)
+    {
+      n_c[0] = sin (theta_c) * cos ((n + 0.5) * dphi);
+      n_c[1] = sin (theta_c) * sin ((n + 0.5) * dphi);
+      n_c[2] = mu_c;
+
+      qmax = 0;
+      for (k = 0; k < nelem; k++)
+      {
+        for (i = 0; i < 3; i++)
+        {
+          gvec[i] = 0;
+          for (kk = 0; kk < 3; kk++)
+            gvec[i] += 2. * g_s[k][i][kk] * n_c[kk];
+        }
+        q_c = 0.5 * dot (gvec, n_c);
+        gt = dot (gvec, gvec) - 4. * q_c * q_c;
+        gt = gt > 0 ? sqrt (gt) : 0;
+
+        qtest = fabs (q_c) + gt * r + (fabs (q_c) + g_norm[k]) * r * r;
+        if (qtest > qmax)
+          qmax = qtest;
+      }
+
+      sum += qmax * domega;
+      env->cdf[m * TT_NPHI + n] = sum;
+    }
+  }
+
+  env->ndom = ndom;
+  env->nelem = nelem;
+  for (k = 0; k < nelem; k++)
+    env->nnn[k] = nnn[k];
+
+  return (env->cdf);
+}
+
+
+
+/***************************************************************
+                      
+                      University of Southampton
+
+Synopsis:   
+  randwind_tt_envelope chooses a new direction for a photon
+  in the thermal trapping scattering mode, using trial directions
+  drawn from the envelope found by tt_get_envelope
+
+Arguments:   
+  p		the photon
+  nnscat	the number of scatters, which is incremented as 
+		described below
+  tau_x_dvds	the sobolev optical depth of the line times dv/ds
+  p_norm	the escape probability along dvds_max, which 
+		randwind_thermal_trapping uses to normalise the
+		escape probabilities
+
+Returns:
+  0 if a new direction was chosen, and 1 if the envelope could not
+  be used, or would not be more efficient than isotropic trial 
+  directions.  In the latter case p is unchanged.
+  
+Description:  
+  The distribution of directions is identical to the one produced
+  by the isotropic rejection method in randwind_thermal_trapping, 
+  namely one proportional to the smaller of the escape probability and
+  p_norm.  Trial directions are drawn from the tabulated envelope, 
+  which is an upper limit to the escape probability, and accepted
+  with the probability of escape divided by the envelope, so that 
+  most trials are accepted even if the escape probability is large in
+  only a small range of directions.  
+
+  In the isotropic method the mean number of trials is p_norm divided 
+  by the mean escape probability, and trans_phot uses nnscat/p_norm 
+  to estimate 1/(mean escape probability).  The number of trials with 
+  the envelope is therefore rescaled by the ratio of 4 PI p_norm to the 
+  integral of the envelope, and rounded up or down at random to an 
+  integer, so that the expectation of nnscat is unchanged.
+
+Notes:
+  The envelope is not used in spherical coordinates, in which dvwind_ds
+  does not interpolate the velocity gradient tensor.
+
+  Since tau is inversely proportional to dv/ds, the optical depth 
+  along each trial direction is obtained from tau_x_dvds without calling
+  sobolev.
+  
+History:
+  1703  Coded
+
+
+****************************************************************/
+
+int
+randwind_tt_envelope (p, nnscat, tau_x_dvds, p_norm)
+     PhotPtr p;
+     int *nnscat;
+     double tau_x_dvds, p_norm;
+{
+  double xn[3], lmn_cyl[3], frac[4];
+  double *cdf, x, z, env, mu, phi, s, dvds, tau, xtrials;
+  int nnn[4], nelem, ndom, ntrials, nlo, nhi, nbin;
+
+  ndom = wmain[p->grid].ndom;
+
+  if (zdom[ndom].coord_type == SPHERICAL || tau_x_dvds <= 0 || p_norm <= 0)
+    return (1);
+
+  /* dvwind_ds works in the northern hemisphere */
+  stuff_v (p->x, xn);
+  xn[2] = fabs (xn[2]);
+  if (xn[0] * xn[0] + xn[1] * xn[1] == 0)
+    return (1);
+
+  coord_fraction (ndom, 0, xn, nnn, frac, &nelem);
+  cdf = tt_get_envelope (ndom, nnn, nelem);
+
+  /* Only use the envelope if it is smaller than p_norm on average */
+  if (cdf[TT_NBIN - 1] / tau_x_dvds >= 4. * PI * p_norm)
+    return (1);
+
+  ntrials = 0;
+
+  do
+  {
+    ntrials++;
+
+    /* Locate the bin */
+    x = rand () / MAXRAND * cdf[TT_NBIN - 1];
+    nlo = -1;
+    nhi = TT_NBIN - 1;
+    while (nhi - nlo > 1)
+    {
+      nbin = (nlo + nhi) >> 1;
+      if (cdf[nbin] > x)
+        nhi = nbin;
+      else
+        nlo = nbin;
+    }
+    nbin = nhi;
+    env = (nbin > 0 ? cdf[nbin] - cdf[nbin - 1] : cdf[0]) / (4. * PI / TT_NBIN) / tau_x_dvds;
+
+    /* Choose a direction uniformly within the bin */
+    mu = -1. + ((nbin / TT_NPHI) + rand () / MAXRAND) * 2. / TT_NMU;
+    phi = ((nbin % TT_NPHI) + rand () / MAXRAND) * 2. * PI / TT_NPHI;
+    s = sqrt (1. - mu * mu);
+    lmn_cyl[0] = s * cos (phi);
+    lmn_cyl[1] = s * sin (phi);
+    lmn_cyl[2] = mu;
+
+    project_from_cyl_xyz (xn, lmn_cyl, p->lmn);
+    if (p->x[2] < 0)
+      p->lmn[2] = -p->lmn[2];
+
+    dvds = fabs (dvwind_ds (p));
+    tau = (dvds > 0) ? tau_x_dvds / dvds : VERY_BIG;
+
+    z = p_escape_from_tau (tau);
+    if (z > p_norm)
+      z = p_norm;
+  }
+  while (rand () / MAXRAND * env > z);
+
+  /* Rescale the number of trials to the number expected for isotropic trial directions */
+  xtrials = ntrials * 4. * PI * p_norm * tau_x_dvds / cdf[TT_NBIN - 1];
+  ntrials = xtrials;
+  if (rand () / MAXRAND < xtrials - ntrials)
+    ntrials++;
+
+  *nnscat = *nnscat + ntrials - 1;
+
+  return (0);
+}
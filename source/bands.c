@@ -79,6 +79,7 @@ History:
 	1208    nsh     73 - Several new bands
 	1306	ksl	Minor modifications as tried to understand how
 			we should handle banding more generally
+	1703	Clear the fractions set by bands_adapt
 **************************************************************/
 
 
@@ -91,6 +92,7 @@ struct xbands
 	double min_fraction[NBANDS];
 	double nat_fraction[NBANDS];          // The fraction of the accepted luminosity in this band
 	double used_fraction[NBANDS];
+	double adapt_fraction[NBANDS];        // The fraction requested by bands_adapt for the next cycle
 	double flux[NBANDS];                  //The "luminosity" within a band
 	double weight[NBANDS];
 	int nphot[NBANDS];
@@ -520,6 +522,11 @@ bands_init (imode, band)
          band->f1[nband] * H / (BOLTZMANN * tmax), band->f2[nband] * H / (BOLTZMANN * tmax), band->min_fraction[nband]);
   }
 
+  /* No adaptive fractions exist until bands_adapt has seen a cycle */
+
+  for (nband = 0; nband < NBANDS; nband++)
+    band->adapt_fraction[nband] = 0.0;
+
   /* Finally called the routine freqs_init which initializes the the spectral bands that are used to establish the coarse
    * spectra in each cell for ionization calculations
    */
@@ -675,3 +682,142 @@ freqs_init (freqmin, freqmax)
   return (0);
 
 }
+
+
+
+/***********************************************************
+                Space Telescope Science Institute
+
+Synopsis:
+
+	bands_adapt chooses the fraction of photons in each band
+	for the next ionization cycle from the noise in the
+	banded radiation estimators of the cycle just completed
+
+Arguments:		
+	band		the bands used to generate photons
+
+Returns:
+	0 always.  The fractions are stored in band->adapt_fraction
+	and used by populate_bands
+
+Description:	
+
+	The relative variance of the banded mean intensity xj in a
+	cell is estimated as 1/nxtot, the inverse of the number of
+	photon passages in the band.  The variances of the coarse
+	bands geo.xfreq are summed over all plasma cells and shared
+	among the photon bands in proportion to their overlap in 
+	log frequency, which gives V for each photon band.
+
+	Since V falls as 1/nphot, the summed variance in the next
+	cycle is least when the number of photons in each band is
+	proportional to sqrt (V * nphot), as in Neyman allocation.
+	The fractions are kept within BAND_ADAPT_MIN and BAND_ADAPT_MAX
+	times the fractions of the last cycle, and above half the 
+	minimum fraction of the band or BAND_ADAPT_FLOOR, so a band 
+	which has flux always gets some photons.  A band which had no
+	photons in the last cycle is given this minimum fraction, and 
+	populate_bands then drops it again if it has no flux.
+
+Notes:
+	The photon weights are set from nat_fraction/used_fraction in
+	define_phot, so the estimators are unbiased whatever fractions
+	are chosen here; only their variance changes.
+
+	This is called after wind_update, when the estimators have been
+	summed over all threads, so every thread makes the same choice.
+
+History:
+	1703	Coded
+
+**************************************************************/
+
+int
+bands_adapt (band)
+     struct xbands *band;
+{
+  int n, nn, j, iter;
+  double var[NBANDS], frac[NBANDS], xfloor[NBANDS];
+  double xvar, lo, hi, dlog, ftot;
+
+  if (modes.adapt_bands == 0 || band->nbands < 2)
+    return (0);
+
+  for (n = 0; n < band->nbands; n++)
+    var[n] = 0.0;
+
+  for (nn = 0; nn < NPLASMA; nn++)
+  {
+    for (j = 0; j < geo.nxfreq; j++)
+    {
+      xvar = 1. / (plasmamain[nn].est->nxtot[j] > 1 ? plasmamain[nn].est->nxtot[j] : 1);
+      dlog = log (geo.xfreq[j + 1] / geo.xfreq[j]);
+      for (n = 0; n < band->nbands; n++)
+      {
+        if (band->nphot[n] == 0)
+          continue;
+        lo = band->f1[n] > geo.xfreq[j] ? band->f1[n] : geo.xfreq[j];
+        hi = band->f2[n] < geo.xfreq[j + 1] ? band->f2[n] : geo.xfreq[j + 1];
+        if (hi > lo)
+          var[n] += xvar * log (hi / lo) / dlog;
+      }
+    }
+  }
+
+  /* Neyman allocation, followed by the limits on the change from the last cycle */
+
+  ftot = 0;
+  for (n = 0; n < band->nbands; n++)
+  {
+    frac[n] = sqrt (var[n] * band->nphot[n]);
+    ftot += frac[n];
+  }
+
+  if (ftot == 0)
+    return (0);
+
+  for (n = 0; n < band->nbands; n++)
+  {
+    frac[n] /= ftot;
+    xfloor[n] = 0.5 * band->min_fraction[n];
+    if (xfloor[n] < BAND_ADAPT_FLOOR)
+      xfloor[n] = BAND_ADAPT_FLOOR;
+  }
+
+  /* Clipping and renormalizing interact, so repeat a few times */
+
+  for (iter = 0; iter < 4; iter++)
+  {
+    ftot = 0;
+    for (n = 0; n < band->nbands; n++)
+    {
+      if (band->nphot[n] == 0)
+      {
+        /* There are no estimates for a band which had no photons, and the limits relative to the 
+           last cycle would keep it at zero, so it is given the minimum */
+        frac[n] = xfloor[n];
+        ftot += frac[n];
+        continue;
+      }
+      if (frac[n] < BAND_ADAPT_MIN * band->used_fraction[n])
+        frac[n] = BAND_ADAPT_MIN * band->used_fraction[n];
+      if (frac[n] > BAND_ADAPT_MAX * band->used_fraction[n])
+        frac[n] = BAND_ADAPT_MAX * band->used_fraction[n];
+      if (frac[n] < xfloor[n])
+        frac[n] = xfloor[n];
+      ftot += frac[n];
+    }
+    for (n = 0; n < band->nbands; n++)
+      frac[n] /= ftot;
+  }
+
+  for (n = 0; n < band->nbands; n++)
+  {
+    band->adapt_fraction[n] = frac[n];
+    Log ("bands_adapt: band %2d %10.3e %10.3e  var %10.3e  frac %.4f -> %.4f\n", n, band->f1[n], band->f2[n],
+         var[n], band->used_fraction[n], frac[n]);
+  }
+
+  return (0);
+}
@@ -0,0 +1,697 @@
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	bench times some of the kernels that dominate the run time of python
+	in isolation, using a saved wind and the atomic data with which it
+	was made.  This is the main routine.
+
+Arguments:
+
+	bench [-h] [-t tmin] [-f fmin fmax] root
+
+	where
+		-h 	prints out a short help message and exits
+		-t tmin	the minimum time in seconds for which each kernel
+			is run (default 1 s)
+		-f fmin fmax
+			the frequency range of the photons, and of the
+			emission kernels (default 1e14 to 1e17 Hz)
+	 	root	the root name of the wind_save file
+
+
+Returns:
+
+	The results are written to root.bench.txt
+
+Description:
+
+	wind_read reads root.wind_save and then the atomic data file that
+	was used to make it, so the atomic data is chosen by choosing the
+	windsave file.
+
+	A fixed set of NBENCH inputs, photons at the centers of cells that
+	are entirely in the wind with random directions and frequencies,
+	random lines, random photoionization edges, is made with a fixed
+	seed.  Each kernel is then called repeatedly, cycling through these
+	inputs, doubling the number of calls until the calls take at least
+	tmin seconds.  The number of operations per second is the number of
+	calls divided by the time.
+
+	The output is an astropy ascii table with the columns kernel, nops,
+	time, and ops_per_sec.  Kernels which cannot be run with the
+	current wind and atomic data, matom and kpkt if there are no
+	macro atoms for example, are listed as comments.
+
+Notes:
+
+	The emission kernels use the frequency range given with -f, and
+	the code behaves as it would in the spectral cycles, which is
+	where these kernels are called most often.
+
+	matrix_ion_populations and calc_te change the plasma, so they
+	are run last.  calc_te restores t_e after each call, so that
+	every call starts from the same point.
+
+	The velocity interpolation coefficients are calculated with
+	wind_interp_init after the wind is read, as in python, so that
+	vwind_xyz and calculate_ds are timed as they are in a real run.
+
+	one_line is timed in two ways.  one_line_cell recalculates the
+	cumulative line luminosity of the cell on every call.  one_line
+	generates NBENCH_CELL photons in a cell before moving to the next,
+	as photo_gen_wind does, and so mostly times the sampling of a line.
+
+	The kernels are timed with timer, which has a resolution of
+	1 microsecond, and so tmin should not be much less than 0.01 s
+
+
+History:
+	1703		Coded
+	1703		Added wind_interp_init, and separated the per cell setup
+			of one_line from the sampling of lines
+
+**************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "atomic.h"
+#include "python.h"
+#include "version.h"
+
+
+#define NBENCH 1000             /* The number of inputs that each kernel cycles through */
+#define NBENCH_CELL 100         /* The number of consecutive photons generated in each cell by one_line */
+
+struct photon bench_phot[NBENCH];       /* Photons at the centers of cells in the wind */
+double bench_smax[NBENCH];      /* The distance each photon can travel in its cell */
+double bench_tau_scat[NBENCH];  /* The optical depth to the next scatter of each photon */
+int bench_line[NBENCH];         /* Random lines, indices into lin_ptr */
+int bench_macro_line[NBENCH];   /* Random macro atom lines, indices into lin_ptr */
+int bench_xphot[NBENCH];        /* Random photoionization edges, indices into phot_top_ptr */
+double bench_xfreq[NBENCH];     /* A frequency above each of these edges */
+
+struct Pdf bench_pdf;           /* A dimensionless blackbody, for pdf_get_rand */
+
+double bench_tmin = 1.0;        /* The minimum time for which each kernel is run */
+double bench_fmin = 1.e14;      /* The frequency range of photons and emission */
+double bench_fmax = 1.e17;
+
+
+
+int
+main (argc, argv)
+     int argc;
+     char *argv[];
+{
+  char root[LINELENGTH];
+  char windsavefile[LINELENGTH];
+  char outputfile[LINELENGTH];
+  char curtime[LINELENGTH];
+  int i, ok_macro;
+  FILE *fopen (), *fptr;
+  int bench_help (), bench_init (), bench_run ();
+  int bench_calculate_ds (), bench_kappa_bf (), bench_sigma_phot (), bench_sobolev ();
+  int bench_matom (), bench_kpkt (), bench_pdf_get_rand (), bench_vwind_xyz (), bench_where_in_grid ();
+  int bench_one_line_cell (), bench_one_line (), bench_one_fb (), bench_one_ff (), bench_matrix_ion (), bench_calc_te ();
+
+  /* Next command stops Debug statements printing out */
+  Log_set_verbosity (3);
+
+  if (argc == 1)
+    bench_help ();
+
+  for (i = 1; i < argc - 1; i++)
+  {
+    if (strcmp (argv[i], "-h") == 0)
+    {
+      bench_help ();
+    }
+    else if (strcmp (argv[i], "-t") == 0)
+    {
+      if (sscanf (argv[i + 1], "%le", &bench_tmin) != 1 || bench_tmin <= 0)
+      {
+        Error ("bench: Could not read a minimum time from %s\n", argv[i + 1]);
+        exit (0);
+      }
+      i++;
+    }
+    else if (strcmp (argv[i], "-f") == 0)
+    {
+      if (i + 2 >= argc || sscanf (argv[i + 1], "%le", &bench_fmin) != 1 || sscanf (argv[i + 2], "%le", &bench_fmax) != 1
+          || bench_fmin <= 0 || bench_fmax <= bench_fmin)
+      {
+        Error ("bench: Could not read a frequency range after -f\n");
+        exit (0);
+      }
+      i += 2;
+    }
+    else
+    {
+      Error ("bench: Unknown switch %s\n", argv[i]);
+      bench_help ();
+    }
+  }
+
+  if (strcmp (argv[argc - 1], "-h") == 0)
+    bench_help ();
+
+  get_root (root, argv[argc - 1]);
+
+  strcpy (windsavefile, root);
+  strcpy (outputfile, root);
+  strcat (windsavefile, ".wind_save");
+  strcat (outputfile, ".bench.txt");
+
+
+  /* Read in the wind file, which also reads the atomic data */
+
+  if (wind_read (windsavefile) < 0)
+  {
+    Error ("bench: Could not open %s\n", windsavefile);
+    exit (0);
+  }
+
+  printf ("Read wind_file %s and atomic data from %s\n", windsavefile, geo.atomic_filename);
+
+  /* Calculate the coefficients used to interpolate velocities within a cell, as python does */
+  wind_interp_init ();
+
+  /* Set up the things that python would normally set up before the spectral cycles */
+
+  init_advanced_modes ();
+  get_standard_care_factors ();
+  DFUDGE = setup_dfudge ();
+
+  geo.ioniz_or_extract = 0;
+  em_rnge.fmin = bench_fmin;
+  em_rnge.fmax = bench_fmax;
+
+  kbf_need (bench_fmin, bench_fmax);
+
+  bench_init ();
+
+  if ((fptr = fopen (outputfile, "w")) == NULL)
+  {
+    Error ("bench: Could not open %s\n", outputfile);
+    exit (0);
+  }
+
+  get_time (curtime);
+  fprintf (fptr, "# Python Version %s\n", VERSION);
+  fprintf (fptr, "# Git commit hash %s\n", GIT_COMMIT_HASH);
+  fprintf (fptr, "# Date %s\n", curtime);
+  fprintf (fptr, "# Windsave %s\n", windsavefile);
+  fprintf (fptr, "# Atomic data %s\n", geo.atomic_filename);
+  fprintf (fptr, "# Frequencies %.3e %.3e  tmin %.3f\n", bench_fmin, bench_fmax, bench_tmin);
+  fprintf (fptr, "kernel nops time ops_per_sec\n");
+
+  ok_macro = (nlevels_macro > 0 && bench_macro_line[0] >= 0);
+
+  bench_run ("calculate_ds", bench_calculate_ds, nlines > 0, fptr);
+  bench_run ("kappa_bf", bench_kappa_bf, nphot_total > 0, fptr);
+  bench_run ("sigma_phot", bench_sigma_phot, nphot_total > 0, fptr);
+  bench_run ("sobolev", bench_sobolev, nlines > 0, fptr);
+  bench_run ("matom", bench_matom, ok_macro, fptr);
+  bench_run ("kpkt", bench_kpkt, ok_macro, fptr);
+  bench_run ("pdf_get_rand", bench_pdf_get_rand, 1, fptr);
+  bench_run ("vwind_xyz", bench_vwind_xyz, 1, fptr);
+  bench_run ("where_in_grid", bench_where_in_grid, 1, fptr);
+  bench_run ("one_line_cell", bench_one_line_cell, nlines > 0, fptr);
+  bench_run ("one_line", bench_one_line, nlines > 0, fptr);
+  bench_run ("one_fb", bench_one_fb, nphot_total > 0, fptr);
+  bench_run ("one_ff", bench_one_ff, 1, fptr);
+  bench_run ("matrix_ion_populations", bench_matrix_ion, 1, fptr);
+  bench_run ("calc_te", bench_calc_te, 1, fptr);
+
+  fclose (fptr);
+
+  printf ("Wrote results to %s\n", outputfile);
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	bench_help prints a short description of how to run bench and exits
+
+**************************************************************/
+
+int
+bench_help ()
+{
+  printf ("Usage: bench [-h] [-t tmin] [-f fmin fmax] root\n\n");
+  printf ("Time python kernels with root.wind_save and the atomic data used to make it.\n");
+  printf ("  -h            print this message\n");
+  printf ("  -t tmin       the minimum time in seconds each kernel is run (default 1)\n");
+  printf ("  -f fmin fmax  the frequency range of photons and emission (default 1e14 1e17)\n");
+  printf ("The results are written to root.bench.txt\n");
+  exit (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	bench_init creates the fixed set of inputs that the kernels
+	cycle through
+
+ Arguments:
+
+ Returns:
+
+ Description:
+	The photons are placed at the centers of randomly chosen plasma
+	cells which are entirely in the wind.  The distance they can
+	travel is found as in translate_in_wind, but without the check on
+	the distance to the edge of the wind, which is unnecessary
+	for cells entirely in the wind.
+
+ Notes:
+	The random number generator is seeded with a fixed value so that the
+	inputs are the same every time bench is run on a windsave file.
+
+ History:
+	1703		Coded
+
+**************************************************************/
+
+int
+bench_init ()
+{
+  int m, n, nplasma, ndom, nwind, nmacro;
+  int *macro;
+  double jump[1];
+  struct photon *p;
+  WindPtr one;
+
+  srand (1084515760);
+
+  for (n = 0; n < NPLASMA; n++)
+  {
+    if (wmain[plasmamain[n].nwind].inwind == W_ALL_INWIND)
+      break;
+  }
+
+  if (n == NPLASMA)
+  {
+    Error ("bench_init: There are no cells entirely in the wind\n");
+    exit (0);
+  }
+
+  for (m = 0; m < NBENCH; m++)
+  {
+    do
+    {
+      nplasma = rand () % NPLASMA;
+      nwind = plasmamain[nplasma].nwind;
+    }
+    while (wmain[nwind].inwind != W_ALL_INWIND);
+
+    one = &wmain[nwind];
+    ndom = one->ndom;
+
+    p = &bench_phot[m];
+    stuff_v (one->xcen, p->x);
+    randvec (p->lmn, 1.0);
+    p->freq = p->freq_orig = bench_fmin * exp (log (bench_fmax / bench_fmin) * (rand () / MAXRAND));
+    p->w = p->w_orig = 1.0;
+    p->tau = 0.0;
+    p->istat = P_INWIND;
+    p->nscat = p->nrscat = p->nnscat = 0;
+    p->nres = -1;
+    p->grid = nwind;
+    p->origin = p->origin_orig = PTYPE_WIND;
+    p->np = m;
+    p->path = 0.0;
+
+    if (zdom[ndom].coord_type == CYLIND)
+      bench_smax[m] = cylind_ds_in_cell (p);
+    else if (zdom[ndom].coord_type == RTHETA)
+      bench_smax[m] = rtheta_ds_in_cell (p);
+    else if (zdom[ndom].coord_type == SPHERICAL)
+      bench_smax[m] = spherical_ds_in_cell (p);
+    else
+      bench_smax[m] = cylvar_ds_in_cell (p);
+
+    bench_smax[m] += one->dfudge;
+    if (bench_smax[m] > SMAX_FRAC * length (p->x))
+      bench_smax[m] = SMAX_FRAC * length (p->x);
+
+    bench_tau_scat[m] = -log (1. - (rand () + 0.5) / MAXRAND);
+
+    if (nlines > 0)
+      bench_line[m] = rand () % nlines;
+
+    if (nphot_total > 0)
+    {
+      bench_xphot[m] = n = rand () % nphot_total;
+      bench_xfreq[m] = phot_top_ptr[n]->freq[0] * (1. + 9. * (rand () / MAXRAND));
+    }
+  }
+
+  /* Macro atom lines, for matom.  bench_macro_line[0] is -1 if there are none */
+
+  bench_macro_line[0] = -1;
+  if (nlines > 0 && (macro = (int *) calloc (sizeof (int), nlines)) != NULL)
+  {
+    nmacro = 0;
+    for (n = 0; n < nlines; n++)
+    {
+      if (lin_ptr[n]->macro_info == 1)
+        macro[nmacro++] = n;
+    }
+    for (m = 0; nmacro > 0 && m < NBENCH; m++)
+      bench_macro_line[m] = macro[rand () % nmacro];
+    free (macro);
+  }
+
+  if (pdf_gen_from_func (&bench_pdf, &planck_d, 0.4, 30., 0, jump) != 0)
+  {
+    Error ("bench_init: Could not make the pdf for pdf_get_rand\n");
+  }
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	bench_run times one kernel and writes the result to the output
+	file
+
+ Arguments:
+	char name[]	the name of the kernel
+	int (*kernel) ()	a routine which makes n calls to the kernel
+	int ok		if 0 the kernel cannot be run, and is only noted
+	FILE *fptr	the output file
+
+ Returns:
+
+ Description:
+	The number of calls is doubled, starting from 1, until they
+	take at least bench_tmin seconds.
+
+ History:
+	1703		Coded
+
+**************************************************************/
+
+int
+bench_run (name, kernel, ok, fptr)
+     char name[];
+     int (*kernel) ();
+     int ok;
+     FILE *fptr;
+{
+  int n;
+  double t_start, dt;
+
+  if (ok == 0)
+  {
+    fprintf (fptr, "# %s skipped: not possible with this wind and atomic data\n", name);
+    printf ("%-24s skipped\n", name);
+    return (0);
+  }
+
+  n = 1;
+  timer ();
+  while (1)
+  {
+    t_start = timer ();
+    (*kernel) (n);
+    dt = timer () - t_start;
+    if (dt >= bench_tmin || n >= (1 << 30))
+      break;
+    n *= 2;
+  }
+
+  if (dt <= 0)
+    dt = 1.e-6;
+
+  fprintf (fptr, "%-24s %12d %12.4f %14.6e\n", name, n, dt, n / dt);
+  fflush (fptr);
+  printf ("%-24s %12d %12.4f %14.6e\n", name, n, dt, n / dt);
+
+  return (0);
+}
+
+
+
+/* The kernels.  Each makes n calls, cycling through the inputs made by bench_init */
+
+int
+bench_calculate_ds (n)
+     int n;
+{
+  int i, m, nres, istat;
+  double tau;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    tau = 0.0;
+    calculate_ds (wmain, &bench_phot[m], bench_tau_scat[m], &tau, &nres, bench_smax[m], &istat);
+  }
+  return (0);
+}
+
+
+int
+bench_kappa_bf (n)
+     int n;
+{
+  int i, m;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    kappa_bf (&plasmamain[wmain[bench_phot[m].grid].nplasma], bench_phot[m].freq, 0);
+  }
+  return (0);
+}
+
+
+int
+bench_sigma_phot (n)
+     int n;
+{
+  int i, m;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    sigma_phot (phot_top_ptr[bench_xphot[m]], bench_xfreq[m]);
+  }
+  return (0);
+}
+
+
+int
+bench_sobolev (n)
+     int n;
+{
+  int i, m;
+  WindPtr one;
+  struct lines *lptr;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    one = &wmain[bench_phot[m].grid];
+    lptr = lin_ptr[bench_line[m]];
+    sobolev (one, one->xcen, plasmamain[one->nplasma].density[lptr->nion], lptr, one->dvds_ave);
+  }
+  return (0);
+}
+
+
+int
+bench_matom (n)
+     int n;
+{
+  int i, m, nres, escape;
+  struct photon pp;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    stuff_phot (&bench_phot[m], &pp);
+    nres = bench_macro_line[m];
+    escape = 0;
+    matom (&pp, &nres, &escape);
+  }
+  return (0);
+}
+
+
+int
+bench_kpkt (n)
+     int n;
+{
+  int i, m, nres, escape;
+  struct photon pp;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    stuff_phot (&bench_phot[m], &pp);
+    nres = -1;
+    escape = 0;
+    kpkt (&pp, &nres, &escape);
+  }
+  return (0);
+}
+
+
+int
+bench_pdf_get_rand (n)
+     int n;
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    pdf_get_rand (&bench_pdf);
+  }
+  return (0);
+}
+
+
+int
+bench_vwind_xyz (n)
+     int n;
+{
+  int i, m;
+  double v[3];
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    vwind_xyz (wmain[bench_phot[m].grid].ndom, &bench_phot[m], v);
+  }
+  return (0);
+}
+
+
+int
+bench_where_in_grid (n)
+     int n;
+{
+  int i, m;
+
+  for (i = 0; i < n; i++)
+  {
+    m = i % NBENCH;
+    where_in_grid (wmain[bench_phot[m].grid].ndom, bench_phot[m].x);
+  }
+  return (0);
+}
+
+
+/* one_line_cell times the setup of the cumulative line luminosity of a
+   cell, by marking the stored values as out of date before every call */
+
+int
+bench_one_line_cell (n)
+     int n;
+{
+  int i, nres;
+
+  for (i = 0; i < n; i++)
+  {
+    one_line_nplasma = -1;
+    one_line (&wmain[bench_phot[i % NBENCH].grid], bench_fmin, bench_fmax, &nres);
+  }
+  return (0);
+}
+
+
+/* one_line generates NBENCH_CELL photons in each cell in turn, as
+   photo_gen_wind does, so that the setup is shared by the photons of a cell */
+
+int
+bench_one_line (n)
+     int n;
+{
+  int i, nres;
+
+  for (i = 0; i < n; i++)
+  {
+    one_line (&wmain[bench_phot[(i / NBENCH_CELL) % NBENCH].grid], bench_fmin, bench_fmax, &nres);
+  }
+  return (0);
+}
+
+
+int
+bench_one_fb (n)
+     int n;
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    one_fb (&wmain[bench_phot[i % NBENCH].grid], bench_fmin, bench_fmax);
+  }
+  return (0);
+}
+
+
+int
+bench_one_ff (n)
+     int n;
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    one_ff (&wmain[bench_phot[i % NBENCH].grid], bench_fmin, bench_fmax);
+  }
+  return (0);
+}
+
+
+int
+bench_matrix_ion (n)
+     int n;
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    matrix_ion_populations (&plasmamain[wmain[bench_phot[i % NBENCH].grid].nplasma], NEBULARMODE_MATRIX_BB);
+  }
+  return (0);
+}
+
+
+int
+bench_calc_te (n)
+     int n;
+{
+  int i;
+  double t_e;
+  PlasmaPtr xplasma;
+
+  for (i = 0; i < n; i++)
+  {
+    xplasma = &plasmamain[wmain[bench_phot[i % NBENCH].grid].nplasma];
+    t_e = xplasma->t_e;
+    calc_te (xplasma, 0.7 * t_e, 1.3 * t_e);
+    xplasma->t_e = t_e;
+  }
+  return (0);
+}
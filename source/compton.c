@@ -10,6 +10,11 @@
   Description:	There are two routines in here:
 		kappa_compton (xplasma,freq) this calculates the opacity in the cell xplasma due to compton cooling
 
+		In addition the Klein-Nishina total cross section and the inverse cumulative
+		distribution of the energy change in a single scatter are tabulated once by
+		compton_init_tables, so that klein_nishina and compton_dir do not have to
+		evaluate the cross section, or search for a root, for every photon.
+
   Arguments: 		
 
 
@@ -31,6 +36,10 @@
 
 PlasmaPtr xplasma;              // Pointer to current plasma cell
 
+double kn_sigma_tab[KN_NX];     // The total KN cross section, see compton_init_tables
+double kn_u_tab[KN_NX][KN_NZ];  // (f-1)/(2x) as a function of x and the random number z
+int compton_tables_init = 0;    // Set to 1 once the tables have been calculated
+
 /**************************************************************************
                     Space Telescope Science Institute
 
@@ -209,14 +218,14 @@ total_comp (one, t_e)
           if (f1 > 1e18)        //If all the frequencies are lower than 1e18, then the cross section is constant at sigmaT
             x += qromb (comp_cool_integrand, f1, f2, 1e-6);
           else
-            x += THOMPSON * xplasma->xj[j];     //In the case where we are in the thompson limit, we just multiply the band limited frequency integrated mean in tensity by the Thompson cross section
+            x += THOMPSON * xplasma->est->xj[j];     //In the case where we are in the thompson limit, we just multiply the band limited frequency integrated mean in tensity by the Thompson cross section
         }
       }
     }
 
     else                        //If no spectral model - do it the old way
     {
-      x = THOMPSON * xplasma->j;
+      x = THOMPSON * xplasma->est->j;
     }
     xplasma->comp_nujnu = x;
   }
@@ -248,6 +257,9 @@ total_comp (one, t_e)
 
   History:
 2013	nsh	Coded
+1703	Now interpolates in a table of the cross section, which is calculated
+	the first time the routine is called.  The full formula is used outside
+	the range of the table.
 
  ************************************************************************/
 
@@ -255,13 +267,59 @@ double
 klein_nishina (nu)
      double nu;                 //The frequency of the photon packet
 {
-  double x;                     //h nu / kt
+  double x;                     //h nu / mec**2
+  double q;
+  int i;
+
+  x = (H * nu) / (MELEC * C * C);
+  if (x <= 0.0001)
+    return (THOMPSON);
+
+  if (compton_tables_init == 0)
+    compton_init_tables ();
+
+  q = (log10 (x) - KN_LOGXMIN) / KN_DLOGX;
+  if (q < 0 || q >= KN_NX - 1)
+    return (klein_nishina_exact (x));
+
+  i = q;
+  q -= i;
+  return ((1. - q) * kn_sigma_tab[i] + q * kn_sigma_tab[i + 1]);
+}
+
+
+/**************************************************************************
+                    Southampton University
+
+
+  Synopsis:  klein_nishina_exact evaluates the KN cross section for a photon 
+	whose energy is x times the rest mass energy of an electron
+
+  Description:	
+
+  Arguments:   x - h nu / mec**2
+
+
+  Returns:   the KN cross section.
+
+  Notes:   This implements equation 7.5 in Rybicki and Lightman.  It is
+	used to construct the table used by klein_nishina and outside the 
+	range of that table.
+
+  History:
+1703	Split from klein_nishina
+
+ ************************************************************************/
+
+double
+klein_nishina_exact (x)
+     double x;                  //h nu / mec**2
+{
   double x1, x2, x3, x4;        //variables to store intermediate results.
   double kn;                    // the final cross section
 
   kn = THOMPSON;                /* NSH 130605 to remove o3 compile error */
   x1 = x2 = x3 = x4 = 0.0;      /* NSH 130605 to remove o3 compile error */
-  x = (H * nu) / (MELEC * C * C);
   if (x > 0.0001)
   {
     x1 = 1. + x;
@@ -279,6 +337,71 @@ klein_nishina (nu)
 
 double z_rand, sigma_tot, x1;   //External variables to allow zfunc to search for the correct fractional energy change
 
+
+
+/**************************************************************************
+                    Southampton University
+
+
+  Synopsis:  compton_init_tables tabulates the total KN cross section and the
+	inverse cumulative distribution of the fractional energy change of a
+	photon undergoing compton scattering
+
+  Description:	
+
+	The tables cover KN_NX photon energies x = h nu / mec**2 uniformly spaced in 
+	log x.  For each energy, the fractional energy change f at which the normalised 
+	partial cross section sigma_compton_partial (f, x) / sigma_compton_partial (1+2x, x)
+	equals z is found for KN_NZ values of z uniformly spaced between 0 and 1.  The
+	result is stored as u = (f-1)/(2x), which lies between 0 and 1 for all x and
+	varies smoothly with both x and z, so that it can be interpolated bilinearly.
+
+  Arguments:  
+
+  Returns:   
+
+  Notes:   
+	The routine is called the first time either klein_nishina or compton_dir 
+	needs the tables.  The external variables used by compton_func are only
+	set for each call to zbrent, but they are not restored, so callers must 
+	make sure the tables exist before setting them.
+
+  History:
+1703	Coded to avoid calling zbrent for every compton scatter
+
+ ************************************************************************/
+
+int
+compton_init_tables ()
+{
+  int i, j;
+  double f, x, sigma;
+
+  for (i = 0; i < KN_NX; i++)
+  {
+    x = pow (10., KN_LOGXMIN + i * KN_DLOGX);
+    kn_sigma_tab[i] = klein_nishina_exact (x);
+
+    sigma = sigma_compton_partial (1. + 2. * x, x);
+    kn_u_tab[i][0] = 0.0;
+    kn_u_tab[i][KN_NZ - 1] = 1.0;
+    for (j = 1; j < KN_NZ - 1; j++)
+    {
+      x1 = x;
+      sigma_tot = sigma;
+      z_rand = ((double) j) / (KN_NZ - 1);
+      f = zbrent (compton_func, 1., 1. + 2. * x, 1e-10);
+      kn_u_tab[i][j] = (f - 1.) / (2. * x);
+    }
+  }
+
+  compton_tables_init = 1;
+  Log ("compton_init_tables: Tabulated KN cross sections for %.1e < h nu / mec**2 < %.1e\n", pow (10., KN_LOGXMIN),
+       pow (10., KN_LOGXMAX));
+
+  return (0);
+}
+
 /**************************************************************************
                     Southampton University
 
@@ -299,6 +422,10 @@ double z_rand, sigma_tot, x1;   //External variables to allow zfunc to search fo
 
   History:
 2015	NSH coded as part of teh summer 2015 code sprint
+1703	The fractional energy change is now interpolated from the table 
+	made by compton_init_tables.  A root is only searched for if the
+	photon energy, or the random number, is in the outermost intervals 
+	of the table.
 
  ************************************************************************/
 
@@ -316,6 +443,11 @@ compton_dir (p, xplasma)
   double lmn[3];                /* the individual direction cosines in the rotated frame */
   double x[3];                  /*photon direction in the frame of reference of the original photon */
   double dummy[3], c[3];
+  double qx, qz;
+  int ix, iz;
+
+  if (compton_tables_init == 0)
+    compton_init_tables ();     // This must be done before x1 is set, since compton_init_tables uses it
 
   x1 = H * p->freq / MELEC / C / C;     //compute the ratio of photon energy to electron energy. In the electron rest frame this is just the electron rest mass energ 
 
@@ -334,9 +466,26 @@ compton_dir (p, xplasma)
     f_min = 1.;                 //The minimum energy loss - i.e. no energy loss
     f_max = 1. + (2. * x1);     //The maximum energy loss
 
-    sigma_tot = sigma_compton_partial (f_max, x1);      //Communicated externally to the integrand function in the zbrent call below, this is the maximum cross section, used to scale the K_N function to lie between 0 and 1.
+    /* Locate the photon energy and random number in the table */
+    qx = (log10 (x1) - KN_LOGXMIN) / KN_DLOGX;
+    qz = z_rand * (KN_NZ - 1);
+    ix = qx;
+    iz = qz;
+
+    if (qx >= 0 && ix < KN_NX - 1 && iz > 0 && iz < KN_NZ - 2)
+    {
+      qx -= ix;
+      qz -= iz;
+      f = (1. - qx) * ((1. - qz) * kn_u_tab[ix][iz] + qz * kn_u_tab[ix][iz + 1]) +
+        qx * ((1. - qz) * kn_u_tab[ix + 1][iz] + qz * kn_u_tab[ix + 1][iz + 1]);
+      f = 1. + 2. * x1 * f;
+    }
+    else
+    {
+      sigma_tot = sigma_compton_partial (f_max, x1);    //Communicated externally to the integrand function in the zbrent call below, this is the maximum cross section, used to scale the K_N function to lie between 0 and 1.
 
-    f = zbrent (compton_func, f_min, f_max, 1e-8);      //Find the zero point of the function compton_func - this finds the point in the KN function that represents our random energy loss.
+      f = zbrent (compton_func, f_min, f_max, 1e-8);    //Find the zero point of the function compton_func - this finds the point in the KN function that represents our random energy loss.
+    }
     n = (1. - ((f - 1.) / x1)); //This is the angle cosine of the new direction in the frame of reference of the photon
 //              printf ("f=%e n=%e fmin=%e fmax=%e\n",f,n,f_min,f_max);
 
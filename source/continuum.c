@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "atomic.h"
 #include "python.h"
@@ -50,12 +51,17 @@ Notes:
 History:
 	04aug	ksl	created from hub.c usied in all versions
 			of python prior to python_52.  
+	1703	Restored the call to model, so the cdf is generated from
+		the model for t and g, rather than whatever model was last
+		interpolated, and added spectype to the values which
+		determine whether the cdf must be regenerated.
+	1703	The cdf is now obtained from the cache of cdfs maintained
+		by model_pdf
  
 **************************************************************/
 
 
 
-double old_t, old_g, old_freqmin, old_freqmax;
 double jump[] = { 913.8 };
 
 double
@@ -63,33 +69,15 @@ one_continuum (spectype, t, g, freqmin, freqmax)
      int spectype;
      double t, g, freqmin, freqmax;
 {
-  //OLD not used in routine double par[2];              // For python we assume only two parameter models
-  double lambdamin, lambdamax;
+  double par[2];                // For python we assume only two parameter models
   double f;
   double pdf_get_rand ();
-  // int model (), nwav;
-  int model ();
+  PdfPtr model_pdf ();
 
-  if (old_t != t || old_g != g || old_freqmin != freqmin || old_freqmax != freqmax)
-  {                             /* Then we must initialize */
-    //OLD not used in routine par[0] = t;
-    //OLD not used in routine par[1] = g;
-    //OLD nwav not used here ksl.  nwav = model (spectype, par);
-    /*  Get_model returns wavelengths in Ang and flux in ergs/cm**2/Ang */
-    lambdamin = C * 1e8 / freqmax;
-    lambdamax = C * 1e8 / freqmin;
-    if (pdf_gen_from_array
-        (&comp[spectype].xpdf, comp[spectype].xmod.w, comp[spectype].xmod.f, comp[spectype].nwaves, lambdamin, lambdamax, 1, jump) != 0)
-    {
-      Error ("In one_continuum after return from pdf_gen_from_array\n");
-    }
-    old_t = t;
-    old_g = g;
-    old_freqmin = freqmin;
-    old_freqmax = freqmax;
-  }
+  par[0] = t;
+  par[1] = g;
 
-  f = (C * 1.e8 / pdf_get_rand (&comp[spectype].xpdf));
+  f = (C * 1.e8 / pdf_get_rand (model_pdf (spectype, par, freqmin, freqmax)));
   if (f > freqmax)
   {
     Error ("one_continuum: f too large %e\n");
@@ -105,6 +93,188 @@ one_continuum (spectype, t, g, freqmin, freqmax)
 
 
 
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+
+PdfPtr model_pdf(spectype,par,freqmin,freqmax) returns the cdf of a model spectrum
+
+Arguments:
+
+	spectype				An index to the continum grid 
+	par[]					The parameters of the model, usually t and log g
+	freqmin,freqmax;			minimum and maximum frequency of interest
+
+
+Returns:
+
+	A pointer to the cdf of the model spectrum between freqmin and freqmax
+ 
+Description:	
+
+	The cdfs are kept in the model cache (see model_flux in get_models.c),
+	so that a cdf only needs to be created once as long as the parameters and
+	the frequency range recur, e.g. for a star or for the rings of a disk 
+	which does not change from cycle to cycle.
+
+Notes:
+
+	The pointer which is returned is only valid until the next call to
+	model_pdf, since that may cause the cdf to be discarded from the cache
+
+History:
+	1703	Coded, replacing the separate store of cdfs for disk rings
+ 
+**************************************************************/
+
+PdfPtr
+model_pdf (spectype, par, freqmin, freqmax)
+     int spectype;
+     double par[];
+     double freqmin, freqmax;
+{
+  double lambdamin, lambdamax;
+  double *flux, size;
+  ModelCachePtr entry;
+  double *model_flux ();
+  ModelCachePtr model_cache_find (), model_cache_add ();
+  int model_cache_trim ();
+
+  if ((entry = model_cache_find (model_pdf_hash, spectype, par, freqmin, freqmax)) != NULL)
+    return (&entry->pdf);
+
+  flux = model_flux (spectype, par);
+
+  /* The size of the cdf is not known until it has been generated, so space is made for the 
+     smallest cdf first.  Once the cdf exists the memory used is corrected, and other cdfs 
+     are discarded if the cdf has grown so that the cache is now too large */
+  size = (NPDF + 1) * (3 * sizeof (double) + sizeof (int));
+  entry = model_cache_add (model_pdf_hash, &model_pdf_bytes, 0.75 * model_cache_mb * 1.e6, size, spectype, par, freqmin, freqmax);
+
+  /*  The models have wavelengths in Ang and flux in ergs/cm**2/Ang */
+  lambdamin = C * 1e8 / freqmax;
+  lambdamax = C * 1e8 / freqmin;
+  if (pdf_gen_from_array (&entry->pdf, comp[spectype].xmod.w, flux, comp[spectype].nwaves, lambdamin, lambdamax, 1, jump) != 0)
+  {
+    Error ("model_pdf: Error after return from pdf_gen_from_array\n");
+  }
+
+  entry->nbytes = entry->pdf.nalloc * (3 * sizeof (double) + sizeof (int));
+  model_pdf_bytes += entry->nbytes - size;
+  model_cache_trim (model_pdf_hash, &model_pdf_bytes, 0.75 * model_cache_mb * 1.e6, entry);
+
+  return (&entry->pdf);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+
+int ring_continuum_freqs(spectype,nphot,nring,freqmin,freqmax,freq) generates the frequencies 
+of a set of disk photons from model spectra
+
+Arguments:
+
+	spectype				An index to the continum grid 
+	nphot					The number of photons
+	nring[]					The ring from which each photon is emitted
+	freqmin,freqmax;			minimum and maximum frequency of interest
+
+Returns:
+
+	freq[]					The frequency of each photon
+
+	The routine returns the number of photons
+ 
+Description:	
+
+	The photons are grouped by ring, using a counting sort, and the frequencies
+	of all of the photons in a ring are then generated at once from the cached 
+	cdf of the ring (see model_pdf).
+
+Notes:
+
+History:
+	1703	Coded
+ 
+**************************************************************/
+
+int
+ring_continuum_freqs (spectype, nphot, nring, freqmin, freqmax, freq)
+     int spectype, nphot;
+     int nring[];
+     double freqmin, freqmax;
+     double freq[];
+{
+  int n, m;
+  int nstart[NRINGS], ncount[NRINGS];
+  int *order;
+  double *lambda, f;
+  double par[2];
+  PdfPtr model_pdf ();
+
+  if (nphot <= 0)
+    return (0);
+
+  order = calloc (sizeof (int), nphot);
+  lambda = calloc (sizeof (double), nphot);
+  if (order == NULL || lambda == NULL)
+  {
+    Error ("ring_continuum_freqs: Could not allocate memory for %d photons\n", nphot);
+    exit (0);
+  }
+
+  /* Sort the photons by ring */
+  for (n = 0; n < NRINGS; n++)
+    ncount[n] = 0;
+  for (m = 0; m < nphot; m++)
+    ncount[nring[m]]++;
+  nstart[0] = 0;
+  for (n = 1; n < NRINGS; n++)
+    nstart[n] = nstart[n - 1] + ncount[n - 1];
+  for (m = 0; m < nphot; m++)
+    order[nstart[nring[m]]++] = m;
+
+  /* Generate the wavelengths, ring by ring.  nstart now points to the end of each ring */
+  for (n = 0; n < NRINGS; n++)
+  {
+    if (ncount[n] > 0)
+    {
+      par[0] = disk.t[n];
+      par[1] = log10 (disk.g[n]);
+      pdf_get_rand_n (model_pdf (spectype, par, freqmin, freqmax), ncount[n], &lambda[nstart[n] - ncount[n]]);
+    }
+  }
+
+  for (m = 0; m < nphot; m++)
+  {
+    f = C * 1.e8 / lambda[m];
+    if (f > freqmax)
+    {
+      Error ("ring_continuum_freqs: f too large %e\n", f);
+      f = freqmax;
+    }
+    if (f < freqmin)
+    {
+      Error ("ring_continuum_freqs: f too small %e\n", f);
+      f = freqmin;
+    }
+    freq[order[m]] = f;
+  }
+
+  free (order);
+  free (lambda);
+
+  return (nphot);
+}
+
+
+
 double
 emittance_continuum (spectype, freqmin, freqmax, t, g)
      int spectype;
@@ -137,6 +137,7 @@ History:
 			with 03
 	05jun	ksl	56d -- Fixed minor problem with linear grid for 
 			w[n].xcen[2]
+	1703	Optionally refine the grid, see cylind_refine_grid
 
 **************************************************************/
 
@@ -237,6 +238,87 @@ cylind_make_grid (ndom, w)
     }
   }
 
+  if (one_dom->refine > 0)
+    cylind_refine_grid (ndom, w);
+
+  return (0);
+}
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	cylind_refine_grid moves the grid lines of a cylindrical grid
+	made by cylind_make_grid toward regions where the density
+	and velocity change rapidly
+
+Arguments:		
+	int ndom;	The domain
+	WindPtr w;	The structure which defines the wind in Python
+ 
+Returns:
+ 
+Description:
+	The first and last two grid lines in each direction are kept,
+	so the grid covers the same region as before, and the lines
+	between them are placed by grid_refine_axis.  The centers of
+	the cells are then the midpoints of the new vertices.
+
+History:
+	1703	Coded
+
+**************************************************************/
+
+int
+cylind_refine_grid (ndom, w)
+     int ndom;
+     WindPtr w;
+{
+  double *xa, *za, xfudge;
+  int i, j, n, ndim, mdim, ilog;
+
+  ndim = zdom[ndom].ndim;
+  mdim = zdom[ndom].mdim;
+  ilog = (zdom[ndom].log_linear == 0);
+
+  xa = calloc (sizeof (double), ndim);
+  za = calloc (sizeof (double), mdim);
+
+  for (i = 0; i < ndim; i++)
+  {
+    wind_ij_to_n (ndom, i, 0, &n);
+    xa[i] = w[n].x[0];
+  }
+  for (j = 0; j < mdim; j++)
+  {
+    wind_ij_to_n (ndom, 0, j, &n);
+    za[j] = w[n].x[2];
+  }
+
+  grid_refine_axis (ndom, 0, xa, 1, ndim - 2, ilog, za, 1, mdim - 2);
+  grid_refine_axis (ndom, 1, za, 1, mdim - 2, ilog, xa, 1, ndim - 2);
+
+  for (i = 0; i < ndim; i++)
+  {
+    for (j = 0; j < mdim; j++)
+    {
+      wind_ij_to_n (ndom, i, j, &n);
+      w[n].x[0] = xa[i];
+      w[n].x[2] = za[j];
+      if (i > 0 && i < ndim - 1)
+        w[n].xcen[0] = 0.5 * (xa[i] + xa[i + 1]);
+      if (j > 0 && j < mdim - 1)
+        w[n].xcen[2] = 0.5 * (za[j] + za[j + 1]);
+
+      xfudge = fmin ((w[n].xcen[0] - w[n].x[0]), (w[n].xcen[2] - w[n].x[2]));
+      w[n].dfudge = XFUDGE * xfudge;
+    }
+  }
+
+  free (xa);
+  free (za);
+
   return (0);
 }
 
@@ -281,8 +363,8 @@ cylind_wind_complete (ndom, w)
     one_dom->wind_midz[j] = 0.5 * (w[nstart + j].x[2] + w[nstart + j + 1].x[2]);
 
   /* Add something plausible for the edges */
-  one_dom->wind_midx[one_dom->ndim - 1] = 2. * one_dom->wind_x[nstart + ndim - 1] - one_dom->wind_midx[nstart + ndim - 2];
-  one_dom->wind_midz[one_dom->mdim - 1] = 2. * one_dom->wind_z[nstart + mdim - 1] - one_dom->wind_midz[nstart + mdim - 2];
+  one_dom->wind_midx[one_dom->ndim - 1] = 2. * one_dom->wind_x[ndim - 1] - one_dom->wind_midx[ndim - 2];
+  one_dom->wind_midz[one_dom->mdim - 1] = 2. * one_dom->wind_z[mdim - 1] - one_dom->wind_midz[mdim - 2];
 
   return (0);
 }
@@ -75,3 +75,113 @@ in the plasma structure*/
 
   return (dd);
 }
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+Synopsis:
+	ray_interp_init finds the interpolation weights at the two ends of a step of a
+	photon, from x1 to x2, so that the densities at points along the step can be
+	found with ray_interp_ion_density
+
+Arguments:		
+	int ndom		the domain
+	double x1[], x2[]	the positions at the start and end of the step
+	RayInterpPtr ri		the weights, which are returned
+
+Returns:
+	The number of ends which are within the grid
+ 
+Description:	
+	coord_fraction is called once for each end, and the cells it returns are 
+	converted to cells in the plasma structure.
+
+Notes:
+	The density at a fractional position along the step is taken to be the 
+	linear combination of the densities at the two ends.  calculate_ds already 
+	treats dv/ds the same way, and it requires the velocity to be close to 
+	linear along the step.  Within a cell this is the same as what 
+	get_ion_density would give to first order.
+
+History:
+	1703		Coded so that calculate_ds does not search the grid again
+			for each resonance
+**************************************************************/
+
+int
+ray_interp_init (ndom, x1, x2, ri)
+     int ndom;
+     double x1[], x2[];
+     RayInterpPtr ri;
+{
+  int nnn[4];
+  int nend, nn, nin;
+
+  nin = 0;
+  for (nend = 0; nend < 2; nend++)
+  {
+    if ((coord_fraction (ndom, 1, nend == 0 ? x1 : x2, nnn, ri->frac[nend], &ri->nelem[nend])) > 0)
+    {
+      for (nn = 0; nn < ri->nelem[nend]; nn++)
+        ri->nplasma[nend][nn] = wmain[nnn[nn]].nplasma;
+      nin++;
+    }
+    else
+    {
+      ri->nelem[nend] = 0;
+    }
+  }
+
+  return (nin);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+Synopsis:
+	ray_interp_ion_density returns the density of an ion at a fractional 
+	position along a step
+
+Arguments:		
+	RayInterpPtr ri		the weights for the ends of the step, from ray_interp_init
+	double x		the fractional position along the step, 0 at the start and 1 at the end
+	int nion		the ion
+
+Returns:
+	The density
+ 
+Description:	
+
+Notes:
+	As for get_ion_density, an end which is outside the grid contributes 
+	no density.
+
+	There is no equivalent for the level populations used for macro atoms,
+	since sobolev takes these from the cell, without interpolation.
+
+History:
+	1703		Coded
+**************************************************************/
+
+double
+ray_interp_ion_density (ri, x, nion)
+     RayInterpPtr ri;
+     double x;
+     int nion;
+{
+  double dd[2];
+  int nend, nn;
+
+  for (nend = 0; nend < 2; nend++)
+  {
+    dd[nend] = 0;
+    for (nn = 0; nn < ri->nelem[nend]; nn++)
+      dd[nend] += plasmamain[ri->nplasma[nend][nn]].density[nion] * ri->frac[nend][nn];
+  }
+
+  return ((1. - x) * dd[0] + x * dd[1]);
+}
@@ -358,9 +358,15 @@ Returns:
 	program will stop (rather than continue incorrectly or start blasting away memory.)
  
 Description:	
-	Calls photo_gen_wind_one for each cell.
+	The number of photons to be generated in each cell is determined first,
+	and then all of the photons from one cell are generated together.  
 
 Notes:
+	Generating the photons cell by cell means that the cdfs needed for 
+	fb (and line) photons are constructed at most once per cell in each
+	call, instead of having to be regenerated whenever consecutive 
+	photons came from different cells.  The photons are independent, so
+	the order in which they are stored does not matter.
 
 History:
  	98feb	ksl	Coding began
@@ -373,6 +379,9 @@ History:
 			wind array.  Changed call to remove wind since entire
 			grid was tramsmitted.
 	15aug	ksl	Added domain support
+	1703		Locate the cell of each photon with a binary search of the
+			cumulative luminosity, and generate the photons of each
+			cell together
  
 **************************************************************/
 
@@ -391,32 +400,71 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
   int nplasma;
   int nnscat;
   int ndom;
+  double *lum_cum;
+  int *nphot_cell;
+  int nlo, nhi, nlast;
 
 
   photstop = photstart + nphot;
   Log_silent ("photo_gen_wind creates nphot %5d photons from %5d to %5d \n", nphot, photstart, photstop);
 
+  lum_cum = (double *) calloc (sizeof (double), NDIM2);
+  nphot_cell = (int *) calloc (sizeof (int), NDIM2);
+  if (lum_cum == NULL || nphot_cell == NULL)
+  {
+    Error ("photo_gen_wind: Could not allocate memory for %d cells\n", NDIM2);
+    exit (0);
+  }
+
+  /* Construct the cumulative luminosity of the wind cells. Only cells with volume greater 
+     than zero are considered.  Note that due to the way wind_luminosity gets called, lum_rad 
+     is actually the band limited flux not the luminosity. */
+
+  xlumsum = 0;
+  nlast = 0;
+  for (icell = 0; icell < NDIM2; icell++)
+  {
+    if (wmain[icell].vol > 0.0)
+    {
+      nplasma = wmain[icell].nplasma;
+      xlumsum += plasmamain[nplasma].lum_rad;
+      if (plasmamain[nplasma].lum_rad > 0)
+        nlast = icell;
+    }
+    lum_cum[icell] = xlumsum;
+  }
+
+  /* Locate the wind_cell in which each photon bundle originates.
+     Note: In photo_gen, both geo.f_wind and geo.lum_wind will have been determined.
+     geo.f_wind refers to the specific flux between freqmin and freqmax.  Note that
+     we make sure that xlum is not == 0 or to geo.f_wind.  The cell is the first one
+     for which the cumulative luminosity is at least xlum */
+
   for (n = photstart; n < photstop; n++)
   {
-    /* locate the wind_cell in which the photon bundle originates.
-       Note: In photo_gen, both geo.f_wind and geo.lum_wind will have been determined.
-       geo.f_wind refers to the specific flux between freqmin and freqmax.  Note that
-       we make sure that xlum is not == 0 or to geo.f_wind. */
     xlum = (rand () + 0.5) / (MAXRAND) * geo.f_wind;
 
-    xlumsum = 0;
-    icell = 0;
-    while (xlumsum < xlum)
+    nlo = -1;
+    nhi = nlast;
+    while (nhi - nlo > 1)
     {
-//?? 57+ This is not the best way to do this.  We should be able to sum over the plasma structure
-      if (wmain[icell].vol > 0.0)       //only consider cells with volume greater than zero
-      {
-        nplasma = wmain[icell].nplasma; //get the plasma cell in this wind cell
-        xlumsum += plasmamain[nplasma].lum_rad; /*increment the xlumsum by the lum_rad in this plasma cell - note that due to the way wind_luminosity gets called, this is actually the band limited flux not the luminosity. */
-      }
-      icell++;                  /*If we are not yet up to xlum, go to the next cell */
+      icell = (nlo + nhi) >> 1;
+      if (lum_cum[icell] < xlum)
+        nlo = icell;
+      else
+        nhi = icell;
     }
-    icell--;                    /* We have got up to xlum, so this is the cell in which the photon must be generated */
+    nphot_cell[nhi]++;
+  }
+
+  /* Now generate the photons, cell by cell */
+
+  icell = 0;
+  for (n = photstart; n < photstop; n++)
+  {
+    while (nphot_cell[icell] == 0)
+      icell++;
+    nphot_cell[icell]--;
 
     nplasma = wmain[icell].nplasma;
     ndom = wmain[icell].ndom;
@@ -511,6 +559,8 @@ was a resonant scatter but we want isotropic scattering anyway.  */
     }
   }
 
+  free (lum_cum);
+  free (nphot_cell);
 
   return (nphot);               /* Return the number of photons generated */
 
@@ -529,8 +579,19 @@ Arguments:
 Returns:
  
 Description:	
+	The cumulative luminosity of all of the lines between freqmin and freqmax
+	is calculated for the cell the first time a photon is requested, and the
+	line is then located with a binary search.  The cumulative luminosity
+	is retained, so that subsequent photons from the same cell, which 
+	photo_gen_wind generates consecutively, do not require the line
+	luminosities to be recalculated.
 
 Notes:
+	The line luminosities stored in lin_ptr[]->pow are overwritten whenever
+	lum_lines is called for another cell, which is why the cumulative 
+	luminosity has to be stored separately.  total_line_emission, which is 
+	called for every cell before photons are generated, marks the stored values
+	as out of date by setting one_line_nplasma to -1.
 
 History:
 	01nov	ksl	Modified to use line pdfs
@@ -538,6 +599,9 @@ History:
 	06may	ksl	57+ -- Modified to partially account for plasma structue
 			but a further change will be needed when move volume to
 			plasma
+	1703		Replaced the coarse pdf and the linear search through the 
+			lines with a binary search of the cumulative luminosity,
+			which is retained for the cell
  
 **************************************************************/
 
@@ -550,46 +614,64 @@ one_line (one, freqmin, freqmax, nres)
 {
   double xlum, xlumsum;
   int m, n;
-  int lnmin, lnmax;
+  int nlo, nhi;
   int nplasma;
-  PlasmaPtr xplasma;
 
   nplasma = one->nplasma;
-  xplasma = &plasmamain[nplasma];
-
-  xlum = xplasma->lum_lines * (rand () / (MAXRAND - 0.5));
 
+  if (one_line_cum == NULL)
+  {
+    if ((one_line_cum = (double *) calloc (sizeof (double), nlines + 1)) == NULL)
+    {
+      Error ("one_line: Could not allocate memory for %d lines\n", nlines);
+      exit (0);
+    }
+    one_line_nplasma = -1;
+  }
 
-// Using the pre-calculated line luminosity pdf's locate the portion of the lin_ptr array 
-// from which the photon will will be drawn
+  /* Calculate the cumulative luminosity of the lines in this cell, unless this has already been done */
 
-  n = 1;
-  while (xlum > xplasma->pdf_y[n] && n < LPDF)
-    n++;
-  lnmin = xplasma->pdf_x[n - 1];
-  lnmax = xplasma->pdf_x[n];
-  xlumsum = xplasma->pdf_y[n - 1];
+  if (nplasma != one_line_nplasma || freqmin != one_line_f1 || freqmax != one_line_f2)
+  {
+    limit_lines (freqmin, freqmax);
+    lum_lines (one, nline_min, nline_max);
 
-/* At this point we know from the line pdf roughly where the line will be located in
-frequency space but we need to recalculate the line luminosities within this frequency
-space because the line luminosities contained in the line ptr arrays are not current */
+    xlumsum = 0;
+    for (n = nline_min; n < nline_max; n++)
+      one_line_cum[n - nline_min] = xlumsum += lin_ptr[n]->pow;
+
+    one_line_nmin = nline_min;
+    one_line_nmax = nline_max;
+    one_line_nplasma = nplasma;
+    one_line_f1 = freqmin;
+    one_line_f2 = freqmax;
+  }
 
-  if ((xlumsum + lum_lines (one, lnmin, lnmax)) < xlum)
+  if (one_line_nmax <= one_line_nmin || one_line_cum[one_line_nmax - one_line_nmin - 1] <= 0)
   {
-    Error ("one_line: lumin from lum_lines insufficient\n");
+    Error ("one_line: No line luminosity between %g and %g in cell %d\n", freqmin, freqmax, nplasma);
+    *nres = -1;
+    return (freqmin);
   }
 
+  /* Find the first line for which the cumulative luminosity exceeds xlum */
+
+  xlum = one_line_cum[one_line_nmax - one_line_nmin - 1] * (rand () / (MAXRAND - 0.5));
 
-  m = lnmin;
-  while (xlumsum <= xlum)
+  nlo = -1;
+  nhi = one_line_nmax - one_line_nmin - 1;
+  while (nhi - nlo > 1)
   {
-    xlumsum += lin_ptr[m]->pow;
-    m++;
+    m = (nlo + nhi) >> 1;
+    if (one_line_cum[m] > xlum)
+      nhi = m;
+    else
+      nlo = m;
   }
 
-  *nres = m - 1;
+  *nres = one_line_nmin + nhi;
 
-  return (lin_ptr[m - 1]->freq);
+  return (lin_ptr[*nres]->freq);
 }
 
 /* Next section deals with bremsstrahlung radiation */
@@ -809,28 +891,29 @@ Notes:
 	only for the temperature.  ?? The code would be simplified
 	if simply the temperature were transmitted.
 
+	The gaunt factors used in ff are averaged over frequency, so the
+	emissivity is simply proportional to exp(-h nu/kT) between f1 and f2, 
+	and the cumulative distribution can be inverted analytically.
+
 History:
    98           ksl     coded as part of python effort
    98oct        ksl     Removed the internal frequency limits to assure 
 			that total ff and one_ff were using
    			the same limits
+   1703		Replaced the pdf, which had to be regenerated whenever 
+			t_e changed, i.e. for nearly every cell, with
+			the analytic inverse of the cumulative distribution
  
 **************************************************************/
 
-struct Pdf pdf_ff;
-double ff_x[200], ff_y[200];
-double one_ff_f1, one_ff_f2, one_ff_te; /* Old values */
-
 double
 one_ff (one, f1, f2)
      WindPtr one;               /* a single cell */
      double f1, f2;             /* freqmin and freqmax */
 {
-  double dummy, freq, dfreq;
-  int n;
+  double freq, kt_over_h, x;
   int nplasma;
   PlasmaPtr xplasma;
-  int echeck;
 
   nplasma = one->nplasma;
   xplasma = &plasmamain[nplasma];
@@ -841,32 +924,22 @@ one_ff (one, f1, f2)
     return (-1.0);
   }
 
-  /* Check to see if we have already generated a pdf */
+  if (xplasma->t_e <= 0)
+  {
+    Error ("one_ff: t_e %g in cell %d is not positive\n", xplasma->t_e, nplasma);
+    return (-1.0);
+  }
 
-  if (xplasma->t_e != one_ff_te || f1 != one_ff_f1 || f2 != one_ff_f2)
-  {                             /* Generate a new pdf */
+  /* Invert  F(nu) = (1 - exp(-h(nu-f1)/kT)) / (1 - exp(-h(f2-f1)/kT)).  expm1 and log1p 
+     preserve the accuracy when h(f2-f1) << kT */
 
-    dfreq = (f2 - f1) / 199;
-    for (n = 0; n < 200; n++)
-    {
-      ff_x[n] = f1 + dfreq * n;
-      ff_y[n] = ff (one, xplasma->t_e, ff_x[n]);
-    }
+  kt_over_h = BOLTZMANN * xplasma->t_e / H;
+  x = (rand () + 0.5) / MAXRAND * expm1 (-(f2 - f1) / kt_over_h);
+  freq = f1 - kt_over_h * log1p (x);
 
+  if (freq > f2)                /* Guard against round off */
+    freq = f2;
 
-
-    if ((echeck = pdf_gen_from_array (&pdf_ff, ff_x, ff_y, 200, f1, f2, 0, &dummy)) != 0)
-    {
-      Error
-        ("one_ff: pdf_gen_from_array error %d : f1 %g f2 %g te %g ne %g nh %g vol %g\n",
-         echeck, f1, f2, xplasma->t_e, xplasma->ne, xplasma->density[1], one->vol);
-      exit (0);
-    }
-    one_ff_te = xplasma->t_e;
-    one_ff_f1 = f1;
-    one_ff_f2 = f2;             /* Note that this may not be the best way to check for a previous pdf */
-  }
-  freq = pdf_get_rand (&pdf_ff);
   return (freq);
 }
 
@@ -79,8 +79,8 @@ bf_estimators_increment (one, p, ds)
   // the continuum neglect variation of frequency along path and
   // take as a single "average" value.  
 
-  if (p->freq > xplasma->max_freq)      // check if photon frequency exceeds maximum frequency
-    xplasma->max_freq = p->freq;
+  if (p->freq > xplasma->est->max_freq)      // check if photon frequency exceeds maximum frequency
+    xplasma->est->max_freq = p->freq;
 
 
   /* JM -- 1310 -- check if the user requires extra diagnostics and
@@ -99,9 +99,9 @@ bf_estimators_increment (one, p, ds)
   update_banded_estimators (xplasma, p, ds, p->w);
 
   /* check that j and ave freq give sensible numbers */
-  if (sane_check (xplasma->j) || sane_check (xplasma->ave_freq))
+  if (sane_check (xplasma->est->j) || sane_check (xplasma->est->ave_freq))
   {
-    Error ("radiation:sane_check Problem with j %g or ave_freq %g\n", xplasma->j, xplasma->ave_freq);
+    Error ("radiation:sane_check Problem with j %g or ave_freq %g\n", xplasma->est->j, xplasma->est->ave_freq);
   }
 
 
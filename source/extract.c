@@ -65,9 +65,14 @@ History:
 	09feb	ksl	68b - Added hooks to track energy deposition of extracted photons
 			in the wind 
 	15aug	ksl	Modifications to allow multiple domains.
+	1703		Records the time spent extracting into each spectrum, when
+			the performance timers are on
 
 **************************************************************/
 
+double extract_time[NSPEC + MSPEC];     /* The time spent in extract_one for each spectrum, if modes.perf_timers is set */
+long extract_nphot[NSPEC + MSPEC];      /* The number of photons extracted into each spectrum */
+long extract_nkill[NSPEC + MSPEC];      /* The number of those which were ended by Russian roulette */
 
 int
 extract (w, p, itype)
@@ -83,7 +88,10 @@ extract (w, p, itype)
   int yep;
   double xdiff[3];
   int ndom;
+  double t_start;
+  double t_perf;
 
+  t_perf = perf_start ();
 
   /* 68b -09021 - ksl - The next line selects the middle inclination angle for recording the absorbed enery */
   phot_history_spectrum = 0.5 * (MSPEC + nspectra);
@@ -176,7 +184,11 @@ one is odd. We do frequency here but weighting is carried out in  extract */
 
       /* Now extract the photon */
 
+      t_start = perf_start ();
       extract_one (w, &pp, itype, n);
+      extract_time[n] += perf_start () - t_start;       /* perf_start returns 0 unless the timers are on */
+      extract_nphot[n]++;
+      perf_count[PERF_EXTRACTIONS]++;
 
       /* Make sure phot_hist is on, for just one extraction */
 
@@ -185,6 +197,7 @@ one is odd. We do frequency here but weighting is carried out in  extract */
     }
 
   }
+  perf_stop (PERF_EXTRACT, t_perf);
   return (0);
 }
 
@@ -226,6 +239,13 @@ with scattering processes, and the weight contains the effect of dimunition of t
 the photon bundle due to pure absorption processes.  So, in extract, we add pp->w * exp(-tau)
 to the spectrum.
 
+Rays which have become so optically thick that they will add almost nothing to the
+spectrum play Russian roulette, rather than being followed all the way out of the 
+wind or until tau reaches TAU_MAX.  Once pp->w*exp(-tau) is less than EXTRACT_ROULETTE
+of the starting weight, the photon survives with probability EXTRACT_SURVIVE, and if
+it does its weight is divided by EXTRACT_SURVIVE.  The expected contribution to the
+spectrum is unchanged.  A survivor will play again if it falls below the limit again.
+
 History:
  	97march ksl	Coded and debugged as part of Python effort.  
  	97july	ksl	Included the possibility that the photon was absorbed by the secondary.
@@ -233,6 +253,8 @@ History:
 			Eddington approximation
 	02jan2	ksl	Adapted extract to use photon types
 	16jun22 NSH Added lines to produce a logarithmically binned spectrum
+	1703	The spectrum is incremented through spectrum_add
+	1703	Added Russian roulette for optically thick rays
 
 **************************************************************/
 
@@ -247,14 +269,12 @@ extract_one (w, pp, itype, nspec)
 {
   int istat, nres;
   struct photon pstart;
-  double weight_min;
+  double weight_min, weight_roulette;
   int icell;
-  int k, k1;
   double x[3];
   double tau;
   double zz;
   double dvds;
-  double lfreqmin, lfreqmax, ldfreq;
   int ishell;
 
 
@@ -342,6 +362,8 @@ the same resonance again */
 
 /* Now we can actually extract the reweighted photon */
 
+  weight_roulette = EXTRACT_ROULETTE * pp->w;
+
   while (istat == P_INWIND)
   {
     istat = translate (w, pp, 20., &tau, &nres);
@@ -372,6 +394,19 @@ the same resonance again */
     {                           /* Cause the photon to scatter and reinitilize */
       break;
     }
+
+    /* If what is left of the photon would add almost nothing to the spectrum, play 
+       Russian roulette rather than following it out of the wind */
+    if (pp->w * exp (-tau) < weight_roulette)
+    {
+      if (rand () / MAXRAND > EXTRACT_SURVIVE)
+      {
+        istat = P_ABSORB;
+        extract_nkill[nspec]++;
+        break;
+      }
+      pp->w /= EXTRACT_SURVIVE;
+    }
   }
 
   if (istat == P_ESCAPE)
@@ -381,50 +416,14 @@ the same resonance again */
       Error_silent ("Warning: extract_one: ignoring very high tau  %8.2e at %g\n", tau, pp->freq);
     else
     {
-      k = (pp->freq - xxspec[nspec].freqmin) / xxspec[nspec].dfreq;
-
-      /* Force the frequency to be in range of that recorded in the spectrum */
-
-      if (k < 0)
-        k = 0;
-      else if (k > NWAVE - 1)
-        k = NWAVE - 1;
-
-
-      lfreqmin = log10 (xxspec[nspec].freqmin);
-      lfreqmax = log10 (xxspec[nspec].freqmax);
-      ldfreq = (lfreqmax - lfreqmin) / NWAVE;
-
-
-
-      /* find out where we are in log space */
-      k1 = (log10 (pp->freq) - log10 (xxspec[nspec].freqmin)) / ldfreq;
-      if (k1 < 0)
-      {
-        k1 = 0;
-      }
-      if (k1 > NWAVE - 1)
-      {
-        k1 = NWAVE - 1;
-      }
-
       /* Increment the spectrum.  Note that the photon weight has not been diminished
        * by its passage through th wind, even though it may have encounterd a number
-       * of resonance, and so the weight must be reduced by tau
+       * of resonance, and so the weight must be reduced by tau.  If this photon was 
+       * a wind photon, then also increment the "reflected" spectrum
        */
 
-      xxspec[nspec].f[k] += pp->w * exp (-(tau));       //OK increment the spectrum in question
-      xxspec[nspec].lf[k1] += pp->w * exp (-(tau));     //And increment the log spectrum
-
-
-      /* If this photon was a wind photon, then also increment the "reflected" spectrum */
-      if (pp->origin == PTYPE_WIND || pp->origin == PTYPE_WIND_MATOM || pp->nscat > 0)
-      {
-
-        xxspec[nspec].f_wind[k] += pp->w * exp (-(tau));        //OK increment the spectrum in question
-        xxspec[nspec].lf_wind[k1] += pp->w * exp (-(tau));      //OK increment the spectrum in question
-
-      }
+      spectrum_add (&xxspec[nspec], pp->freq, log10 (pp->freq), pp->w * exp (-(tau)),
+                    pp->origin == PTYPE_WIND || pp->origin == PTYPE_WIND_MATOM || pp->nscat > 0);
 
 
       // SWM - Records total distance travelled by extract photon
@@ -465,3 +464,57 @@ the same resonance again */
 
   return (istat);
 }
+
+
+
+/***********************************************************
+                                       University of Southampton
+
+ Synopsis:
+
+	extract_summary() logs the time spent extracting photons into
+	each of the spectra seen by the observers
+
+Arguments:		
+
+Returns:
+ 
+Description:	
+
+	Writes, for each inclination, the number of photons extracted, 
+	the time spent on them, and the fraction which were ended by 
+	Russian roulette, and then zeros the counters.  It is called
+	after each spectral cycle.
+		
+Notes:
+	The times are only recorded if modes.perf_timers is set, and are
+	otherwise zero.
+
+History:
+	1703		Coded
+
+**************************************************************/
+
+int
+extract_summary ()
+{
+  int n;
+  double t_total;
+
+  t_total = 0.0;
+  for (n = MSPEC; n < nspectra; n++)
+    t_total += extract_time[n];
+
+  Log ("extract_summary: %.1f s spent extracting photons\n", t_total);
+  Log ("Spectrum                    Nphot    Time(s)  us/phot  Roulette\n");
+  for (n = MSPEC; n < nspectra; n++)
+  {
+    if (extract_nphot[n] > 0)
+      Log ("%-24s %10ld %10.2f %8.2f %8.4f\n", xxspec[n].name, extract_nphot[n], extract_time[n],
+           1e6 * extract_time[n] / extract_nphot[n], (double) extract_nkill[n] / extract_nphot[n]);
+    extract_time[n] = 0.0;
+    extract_nphot[n] = extract_nkill[n] = 0;
+  }
+
+  return (0);
+}
@@ -113,6 +113,21 @@
 #define    	BIG 1e32
 
 
+/* Comparison function used to sort the models of a component by their first parameter */
+int
+compare_model_par0 (const void *a, const void *b)
+{
+  double x1, x2;
+
+  x1 = mods[*(int *) a].par[0];
+  x2 = mods[*(int *) b].par[0];
+  if (x1 < x2)
+    return (-1);
+  if (x1 > x2)
+    return (1);
+  return (0);
+}
+
 /* Get all the models of one type and regrid them onto the wavelength grid of the data */
 int get_models_init = 0;        // needed so can initialize nmods_tot the first time this routine is called
 
@@ -241,6 +256,17 @@ get_models (modellist, npars, spectype)
     exit (0);
   }
 
+  /* Index the models by their first parameter, so that model can find the models which
+     bracket it by bisection */
+  if ((comp[ncomps].isort = calloc (sizeof (int), comp[ncomps].nmods)) == NULL)
+  {
+    Error ("get_models: Could not allocate memory for the index of %s\n", comp[ncomps].name);
+    exit (0);
+  }
+  for (n = 0; n < comp[ncomps].nmods; n++)
+    comp[ncomps].isort[n] = comp[ncomps].modstart + n;
+  qsort (comp[ncomps].isort, comp[ncomps].nmods, sizeof (int), compare_model_par0);
+
   /* The next 3 lines set a normalization that is used by kslfit.  They are mostly
    * not relevant to python, where comp[ncomp[.min[0] refers to a normalization for 
    * a model.  I've kept this initialization for now */
@@ -364,16 +390,18 @@ model (spectype, par)
 
 
 {
-  int j, n;
-  int good_models[NMODS];       // Used to establish which models are to be included in creating output model
+  int j, n, m, lo_m, hi_m, mid;
+  int nlist, list[NMODS];       // The models which are to be included in creating output model
+  int good_models[NMODS];       // Whether each model in list is still included
   double xmin[NPARS], xmax[NPARS];      // The vertices of a completely filled grid
-  double weight[NMODS];         // The weights assigned to the models
+  double weight[NMODS];         // The weights assigned to the models in list
   double hi, lo, delta, wtot;
   int ngood;
   double f;
   int nwaves;
   double flux[NWAVES];
   double q1, q2, lambda, tscale, xxx;   // Used for rescaleing according to a bb
+  int *isort;
 
 
 
@@ -387,76 +415,96 @@ exact model previously */
   }
   if (n == comp[spectype].npars)
   {
-    return (0);                 // This was the model stored in comp already
+    return (comp[spectype].nwaves);     // This was the model stored in comp already
   }
 
 
-  /* First identify the models of interest */
-  n = 0;
-  while (n < comp[spectype].modstart)
-  {
-    weight[n] = good_models[n] = 0;
-    n++;
-  }
-  while (n < comp[spectype].modstop)
+  /* First identify the models of interest.  The models which bracket the first parameter
+     are found by bisection in isort, which lists the models sorted by their first parameter. 
+     These models are contiguous in isort, and only they need to be considered for the 
+     remaining parameters */
+
+  isort = comp[spectype].isort;
+  lo_m = 0;
+  hi_m = comp[spectype].nmods;
+  while (lo_m < hi_m)
   {
-    weight[n] = good_models[n] = 1;
-    n++;
+    mid = (lo_m + hi_m) / 2;
+    if (mods[isort[mid]].par[0] > par[0])
+      hi_m = mid;
+    else
+      lo_m = mid + 1;
   }
-  while (n < nmods_tot)
+  /* So isort[lo_m] is the first model with a first parameter greater than par[0] */
+
+  xmax[0] = (lo_m < comp[spectype].nmods) ? mods[isort[lo_m]].par[0] : comp[spectype].max[0];
+  xmin[0] = (lo_m > 0) ? mods[isort[lo_m - 1]].par[0] : comp[spectype].min[0];
+
+  m = lo_m;
+  while (m > 0 && mods[isort[m - 1]].par[0] >= xmin[0])
+    m--;
+  nlist = 0;
+  while (m < comp[spectype].nmods && mods[isort[m]].par[0] <= xmax[0])
   {
-    weight[n] = good_models[n] = 0;
-    n++;
+    list[nlist] = isort[m];
+    weight[nlist] = good_models[nlist] = 1;
+    nlist++;
+    m++;
   }
 
   for (j = 0; j < comp[spectype].npars; j++)
   {
-    xmax[j] = comp[spectype].max[j];
-    xmin[j] = comp[spectype].min[j];
-    hi = BIG;
-    lo = -BIG;
-    for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+    if (j > 0)
     {
-      if (good_models[n])
+      xmax[j] = comp[spectype].max[j];
+      xmin[j] = comp[spectype].min[j];
+      hi = BIG;
+      lo = -BIG;
+      for (m = 0; m < nlist; m++)
       {
-        delta = mods[n].par[j] - par[j];
-        if (delta > 0.0 && delta < hi)
+        if (good_models[m])
         {
-          xmax[j] = mods[n].par[j];
-          hi = delta;
-        }
-        if (delta <= 0.0 && delta >= lo)
-        {
-          xmin[j] = mods[n].par[j];
-          lo = delta;
+          n = list[m];
+          delta = mods[n].par[j] - par[j];
+          if (delta > 0.0 && delta < hi)
+          {
+            xmax[j] = mods[n].par[j];
+            hi = delta;
+          }
+          if (delta <= 0.0 && delta >= lo)
+          {
+            xmin[j] = mods[n].par[j];
+            lo = delta;
+          }
         }
       }
     }
     // So at this point we know what xmin[j] and xmax[j] and we 
     // need to prune good_models
-    for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+    for (m = 0; m < nlist; m++)
     {
+      n = list[m];
       // Next lines excludes the models which are out of range.
       if (mods[n].par[j] > xmax[j] || mods[n].par[j] < xmin[j])
-        good_models[n] = 0;
+        good_models[m] = 0;
       // Next line modifies the weight of this model assuming a regular grid
       // If xmax==xmin, then par[j] was outside of the range of the models and
       // so we need to weight the remaining models fully.
-      if (good_models[n] && xmax[j] > xmin[j])
+      if (good_models[m] && xmax[j] > xmin[j])
       {
         f = (par[j] - xmin[j]) / (xmax[j] - xmin[j]);
         if (mods[n].par[j] == xmax[j])
         {
           // Then the model is at the maximum for this parameter
-          weight[n] *= f;
+          weight[m] *= f;
         }
         else
-          weight[n] *= (1. - f);
+          weight[m] *= (1. - f);
 
 /* 57g -- If the weight given to a model is going to be zero, it needs to be
 excluded from furthur consideration -- 07jul ksl */
-        if (weight[n] == 0.0)
-          good_models[n] = 0;
+        if (weight[m] == 0.0)
+          good_models[m] = 0;
 
       }
     }
@@ -467,11 +515,11 @@ excluded from furthur consideration -- 07jul ksl */
 
   wtot = 0;
   ngood = 0;
-  for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+  for (m = 0; m < nlist; m++)
   {
-    if (good_models[n])
+    if (good_models[m])
     {
-      wtot += weight[n];
+      wtot += weight[m];
       ngood++;
     }
   }
@@ -480,10 +528,10 @@ excluded from furthur consideration -- 07jul ksl */
     Error ("model: Wtot must be greater than 0 or something is badly wrong\n");
     exit (0);
   }
-  for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+  for (m = 0; m < nlist; m++)
   {
-    if (good_models[n])
-      weight[n] /= wtot;
+    if (good_models[m])
+      weight[m] /= wtot;
   }
 
 // So now we know the absolute weighting.
@@ -496,11 +544,11 @@ excluded from furthur consideration -- 07jul ksl */
   else if (ngood == 1 && nmodel_error < 20)
   {
     Error ("model: Only one model after pruning for parameters, consider larger model grid\n");
-    for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+    for (m = 0; m < nlist; m++)
     {
-      if (good_models[n])
+      if (good_models[m])
       {
-        Error ("model: %s %8.2f %8.2f\n", mods[n].name, par[0], par[1]);
+        Error ("model: %s %8.2f %8.2f\n", mods[list[m]].name, par[0], par[1]);
       }
     }
     nmodel_error++;
@@ -515,13 +563,14 @@ excluded from furthur consideration -- 07jul ksl */
   }
 
 
-  for (n = comp[spectype].modstart; n < comp[spectype].modstop; n++)
+  for (m = 0; m < nlist; m++)
   {
-    if (good_models[n])
+    if (good_models[m])
     {
+      n = list[m];
       for (j = 0; j < nwaves; j++)
       {
-        flux[j] += weight[n] * mods[n].f[j];
+        flux[j] += weight[m] * mods[n].f[j];
       }
     }
   }
@@ -604,3 +653,205 @@ even, and so for those cases we want to make sure to calculate the ratio of qs d
 
   return (nwaves);
 }
+
+
+
+/**************************************************************************
+                    Space Telescope Science Institute
+
+
+  Synopsis:
+	The next group of routines maintain the cache of interpolated model
+	spectra and of the cdfs which are generated from them.  
+
+		model_flux (spectype, par)
+
+	returns the interpolated spectrum for the parameters par, and model_pdf
+	(in continuum.c) returns the cdf of that spectrum for a frequency range.
+
+  Description:	
+	There are two sets of entries, one for spectra and one for cdfs, each of 
+	which is a hash table.  An entry is identified by spectype, the parameters 
+	of the model and, for a cdf, the frequency range.  The spectra may use a 
+	quarter of model_cache_mb and the cdfs the remainder.  When adding an entry 
+	would exceed this, the least recently used entries of that type are freed.
+
+  Notes:
+	Unlike model, model_flux does not alter comp[spectype].xmod unless the 
+	spectrum has to be interpolated.  Routines which use model_flux should 
+	therefore use the pointer it returns.  
+
+	The parameters must match exactly for an entry to be used.
+
+  History:
+	1703	Coded so that stars, boundary layers and disk rings with model 
+		spectra share interpolated spectra and cdfs
+ ************************************************************************/
+
+int
+model_cache_hash (spectype, par, freqmin, freqmax)
+     int spectype;
+     double par[];
+     double freqmin, freqmax;
+{
+  unsigned long h, u;
+  double x;
+  int n;
+
+  h = spectype + 1;
+  for (n = 0; n <= comp[spectype].npars + 1; n++)
+  {
+    if (n < comp[spectype].npars)
+      x = par[n];
+    else if (n == comp[spectype].npars)
+      x = freqmin;
+    else
+      x = freqmax;
+    memcpy (&u, &x, sizeof (u) < sizeof (x) ? sizeof (u) : sizeof (x));
+    h = (h ^ u) * 1099511628211UL;
+    h ^= h >> 29;
+  }
+
+  return ((int) (h % MODEL_NHASH));
+}
+
+
+
+/* Find an entry in one of the hash tables, returning NULL if there is none */
+
+ModelCachePtr
+model_cache_find (table, spectype, par, freqmin, freqmax)
+     ModelCachePtr table[];
+     int spectype;
+     double par[];
+     double freqmin, freqmax;
+{
+  ModelCachePtr entry;
+  int n;
+
+  for (entry = table[model_cache_hash (spectype, par, freqmin, freqmax)]; entry != NULL; entry = entry->next)
+  {
+    if (entry->spectype != spectype || entry->freqmin != freqmin || entry->freqmax != freqmax)
+      continue;
+    n = 0;
+    while (n < comp[spectype].npars && entry->par[n] == par[n])
+      n++;
+    if (n == comp[spectype].npars)
+    {
+      entry->last_used = ++model_cache_clock;
+      return (entry);
+    }
+  }
+
+  return (NULL);
+}
+
+
+
+/* Free the least recently used entries of one of the hash tables, other than keep, 
+   until the memory used, *nbytes, does not exceed maxbytes */
+
+int
+model_cache_trim (table, nbytes, maxbytes, keep)
+     ModelCachePtr table[];
+     double *nbytes, maxbytes;
+     ModelCachePtr keep;
+{
+  ModelCachePtr oldest, *prev, *oldest_prev;
+  int h;
+
+  while (*nbytes > 0 && *nbytes > maxbytes)
+  {
+    oldest = NULL;
+    oldest_prev = NULL;
+    for (h = 0; h < MODEL_NHASH; h++)
+    {
+      for (prev = &table[h]; *prev != NULL; prev = &(*prev)->next)
+      {
+        if (*prev != keep && (oldest == NULL || (*prev)->last_used < oldest->last_used))
+        {
+          oldest = *prev;
+          oldest_prev = prev;
+        }
+      }
+    }
+    if (oldest == NULL)
+      break;
+    *oldest_prev = oldest->next;
+    *nbytes -= oldest->nbytes;
+    free (oldest->f);
+    pdf_free (&oldest->pdf);
+    free (oldest);
+  }
+
+  return (0);
+}
+
+
+
+/* Create an entry in one of the hash tables.  The least recently used entries are
+   freed first, if necessary, so that the memory used, *nbytes, plus that needed by
+   the new entry, size, does not exceed maxbytes.  The returned entry has f=NULL and 
+   an empty pdf, and the caller must fill one or the other */
+
+ModelCachePtr
+model_cache_add (table, nbytes, maxbytes, size, spectype, par, freqmin, freqmax)
+     ModelCachePtr table[];
+     double *nbytes, maxbytes, size;
+     int spectype;
+     double par[];
+     double freqmin, freqmax;
+{
+  ModelCachePtr entry;
+  int n, h;
+
+  model_cache_trim (table, nbytes, maxbytes - size, NULL);
+
+  if ((entry = (ModelCachePtr) calloc (sizeof (model_cache_dummy), 1)) == NULL)
+  {
+    Error ("model_cache_add: Could not allocate memory for a new entry\n");
+    exit (0);
+  }
+  entry->spectype = spectype;
+  for (n = 0; n < comp[spectype].npars; n++)
+    entry->par[n] = par[n];
+  entry->freqmin = freqmin;
+  entry->freqmax = freqmax;
+  entry->nbytes = size;
+  entry->last_used = ++model_cache_clock;
+
+  h = model_cache_hash (spectype, par, freqmin, freqmax);
+  entry->next = table[h];
+  table[h] = entry;
+  *nbytes += size;
+
+  return (entry);
+}
+
+
+
+/* Return the interpolated spectrum of a model, on the wavelengths comp[spectype].xmod.w */
+
+double *
+model_flux (spectype, par)
+     int spectype;
+     double par[];
+{
+  ModelCachePtr entry;
+  int nwaves;
+
+  if ((entry = model_cache_find (model_spec_hash, spectype, par, 0.0, 0.0)) != NULL)
+    return (entry->f);
+
+  nwaves = model (spectype, par);
+  entry = model_cache_add (model_spec_hash, &model_spec_bytes, 0.25 * model_cache_mb * 1.e6,
+                           (double) (nwaves * sizeof (double)), spectype, par, 0.0, 0.0);
+  if ((entry->f = calloc (sizeof (double), nwaves)) == NULL)
+  {
+    Error ("model_flux: Could not allocate memory for the spectrum\n");
+    exit (0);
+  }
+  memcpy (entry->f, comp[spectype].xmod.f, nwaves * sizeof (double));
+
+  return (entry->f);
+}
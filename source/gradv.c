@@ -47,6 +47,8 @@ History:
     1411    JM -- use on the fly method for spherical coordinates
             to avoid problems. This should be improved. See notes
             below and #118 
+	1703	Use the coefficients from wind_interp_init when the
+		photon is still in the cell given by p->grid
 
 **************************************************************/
 
@@ -117,19 +119,24 @@ dvwind_ds (p)
   else                          // for non spherical coords we interpolate on v_grad
   {
 
-    coord_fraction (ndom, 0, pp.x, nnn, frac, &nelem);
+    /* Use the coefficients for the cell if the photon is still in it, see wind_interp_init */
 
-
-    for (j = 0; j < 3; j++)
+    if (wind_interp == NULL || wind_interp_g (pp.grid, pp.x, v_grad))
     {
-      for (k = 0; k < 3; k++)
+      coord_fraction (ndom, 0, pp.x, nnn, frac, &nelem);
+
+
+      for (j = 0; j < 3; j++)
       {
-        x = 0;
-        for (nn = 0; nn < nelem; nn++)
-          x += wmain[nnn[nn]].v_grad[j][k] * frac[nn];
+        for (k = 0; k < 3; k++)
+        {
+          x = 0;
+          for (nn = 0; nn < nelem; nn++)
+            x += wmain[nnn[nn]].v_grad[j][k] * frac[nn];
 
-        v_grad[j][k] = x;
+          v_grad[j][k] = x;
 
+        }
       }
     }
 
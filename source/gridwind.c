@@ -8,6 +8,14 @@
 
 #include "python.h"
 
+/* A wind cell and its position on the curve used to order the plasma cells, see create_maps */
+
+struct cell_key
+{
+  unsigned long key;
+  int nwind;
+};
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -56,6 +64,8 @@ Notes:
 History:
 	06may	ksl	Created as part of the attempt to reduce the
 			overall size of the structures
+	1703		If geo.plasma_order is 1, number the plasma cells along
+			a Morton curve through each domain
 
 **************************************************************/
 
@@ -64,31 +74,54 @@ int
 create_maps (ichoice)
      int ichoice;
 {
-  int i, j;
+  int i, j, ii, jj;
+  struct cell_key *cells;
+
   j = 0;
   if (ichoice)
   {
     //map to reduce space
+    if ((cells = (struct cell_key *) calloc (sizeof (struct cell_key), NDIM2)) == NULL)
+    {
+      Error ("create_maps: Could not allocate memory for %d cells\n", NDIM2);
+      exit (0);
+    }
+
     for (i = 0; i < NDIM2; i++)
     {
       wmain[i].nwind = i;
+      wmain[i].nplasma = NPLASMA;
       if (wmain[i].vol > 0)
       {
-        wmain[i].nplasma = j;
-        plasmamain[j].nplasma = j;
-        plasmamain[j].nwind = i;
+        wind_n_to_ij (wmain[i].ndom, i, &ii, &jj);
+        cells[j].key = morton_key (wmain[i].ndom, ii, jj);
+        cells[j].nwind = i;
         j++;
       }
-      else
-      {
-        wmain[i].nplasma = NPLASMA;
-      }
     }
     if (j != NPLASMA)
     {
       Error ("create_maps: Problems with matching cells -- Expected %d Got %d\n", NPLASMA, j);
       exit (0);
     }
+
+    /* Otherwise the plasma cells are in the order of the wind cells, in which cells that are neighbours 
+       in the r or theta direction are far apart */
+
+    if (geo.plasma_order == 1)
+    {
+      qsort (cells, NPLASMA, sizeof (struct cell_key), compare_cell_key);
+    }
+
+    for (j = 0; j < NPLASMA; j++)
+    {
+      i = cells[j].nwind;
+      wmain[i].nplasma = j;
+      plasmamain[j].nplasma = j;
+      plasmamain[j].nwind = i;
+    }
+
+    free (cells);
   }
   else
     //one plama cell for each wind cell
@@ -111,6 +144,67 @@ create_maps (ichoice)
 
 
 
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis: morton_key (ndom, i, j)
+
+ Arguments:
+	int ndom	the domain of the cell
+	int i, j	the indices of the cell in the domain
+
+ Returns:
+	The position of the cell on a Morton (or Z-order) curve
+	through the domain, with the domains in turn
+
+ Description:
+	The bits of i and j are interleaved, so that cells which
+	are close to one another in both directions have keys 
+	which are close to one another.
+
+ Notes:
+	Cells are sorted by these keys in create_maps.  A Hilbert
+	curve would keep slightly more of the neighbours together
+	but the Morton curve is much simpler to compute, and is
+	only done once.
+
+ History:
+	1703		Coded
+
+**************************************************************/
+
+
+unsigned long
+morton_key (ndom, i, j)
+     int ndom, i, j;
+{
+  unsigned long key;
+  int nbit;
+
+  key = 0;
+  for (nbit = 0; nbit < 16; nbit++)
+  {
+    key |= ((unsigned long) ((i >> nbit) & 1)) << (2 * nbit + 1);
+    key |= ((unsigned long) ((j >> nbit) & 1)) << (2 * nbit);
+  }
+  key |= ((unsigned long) ndom) << 32;
+
+  return (key);
+}
+
+
+int
+compare_cell_key (const void *a, const void *b)
+{
+  if (((struct cell_key *) a)->key < ((struct cell_key *) b)->key)
+    return (-1);
+  if (((struct cell_key *) a)->key > ((struct cell_key *) b)->key)
+    return (1);
+  return (0);
+}
+
+
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -163,6 +257,102 @@ calloc_wind (nelem)
 
 
 
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis: calloc_domain (ndom)
+
+ Arguments:
+	int ndom	the domain whose coordinate arrays are to
+			be allocated
+
+ Returns:
+
+ Description:
+	Allocate the one-d arrays wind_x, wind_midx (ndim elements)
+	and wind_z, wind_midz (mdim elements) that describe the cell
+	boundaries and midpoints of a domain, and for cylvar 
+	coordinates the two-d arrays wind_z_var and wind_midz_var
+	(ndim x mdim).  Any arrays that already exist are freed
+	first.
+
+ Notes:
+	ndim, mdim and coord_type must be set before this is called.
+	The two-d arrays are allocated as a single block with a
+	vector of row pointers, so that they can be indexed as [i][j]
+	and written or read in one go.
+
+	The pointers in zdom are not meaningful after zdom is read 
+	back from a windsave file, so wind_read sets them to NULL
+	before calling this routine.
+
+ History:
+	1703		Coded, replacing arrays of fixed size NDIM_MAX
+
+**************************************************************/
+
+
+int
+calloc_domain (ndom)
+     int ndom;
+{
+  DomainPtr one_dom;
+  int i, ndim, mdim;
+
+  one_dom = &zdom[ndom];
+  ndim = one_dom->ndim;
+  mdim = one_dom->mdim;
+
+  if (one_dom->wind_x != NULL)
+  {
+    free (one_dom->wind_x);
+    free (one_dom->wind_midx);
+    free (one_dom->wind_z);
+    free (one_dom->wind_midz);
+  }
+  if (one_dom->wind_z_var != NULL)
+  {
+    free (one_dom->wind_z_var[0]);
+    free (one_dom->wind_z_var);
+    free (one_dom->wind_midz_var[0]);
+    free (one_dom->wind_midz_var);
+  }
+  one_dom->wind_z_var = one_dom->wind_midz_var = NULL;
+
+  one_dom->wind_x = calloc (sizeof (double), ndim);
+  one_dom->wind_midx = calloc (sizeof (double), ndim);
+  one_dom->wind_z = calloc (sizeof (double), mdim);
+  one_dom->wind_midz = calloc (sizeof (double), mdim);
+
+  if (one_dom->wind_x == NULL || one_dom->wind_midx == NULL || one_dom->wind_z == NULL || one_dom->wind_midz == NULL)
+  {
+    Error ("calloc_domain: There is a problem in allocating the grid arrays for domain %d\n", ndom);
+    exit (0);
+  }
+
+  if (one_dom->coord_type == CYLVAR)
+  {
+    one_dom->wind_z_var = calloc (sizeof (double *), ndim);
+    one_dom->wind_midz_var = calloc (sizeof (double *), ndim);
+    if (one_dom->wind_z_var == NULL || one_dom->wind_midz_var == NULL
+        || (one_dom->wind_z_var[0] = calloc (sizeof (double), ndim * mdim)) == NULL
+        || (one_dom->wind_midz_var[0] = calloc (sizeof (double), ndim * mdim)) == NULL)
+    {
+      Error ("calloc_domain: There is a problem in allocating the cylvar arrays for domain %d\n", ndom);
+      exit (0);
+    }
+    for (i = 1; i < ndim; i++)
+    {
+      one_dom->wind_z_var[i] = one_dom->wind_z_var[0] + i * mdim;
+      one_dom->wind_midz_var[i] = one_dom->wind_midz_var[0] + i * mdim;
+    }
+  }
+
+  return (0);
+}
+
+
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -184,6 +374,8 @@ Notes:
 History:
 11dec	ksl	71 - Modified so that the memory would be
 		reallocated if necessary
+1703		Allocate fbstoremain in place of photstoremain
+1703		Allocate estmain, the radiation field estimators
 
 **************************************************************/
 
@@ -192,6 +384,7 @@ int
 calloc_plasma (nelem)
      int nelem;
 {
+  int n;
 
   if (plasmamain != NULL)
   {
@@ -215,23 +408,53 @@ calloc_plasma (nelem)
        sizeof (plasma_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (plasma_dummy));
   }
 
-  /* Now allocate space for storing photon frequencies -- 57h */
-  if (photstoremain != NULL)
+  /* The radiation field estimators are held in a separate contiguous array, see plasma_est in python.h.  The
+     pointers from plasmamain to it are set in calloc_dyn_plasma, which is also called after a windsave file is read */
+  if (estmain != NULL)
+  {
+    free (estmain);
+  }
+  estmain = (EstPtr) calloc (sizeof (plasma_est_dummy), (nelem + 1));
+
+  if (estmain == NULL)
+  {
+    Error ("There is a problem in allocating memory for the estimator structure\n");
+    exit (0);
+  }
+  else
+  {
+    Log
+      ("Allocated %10d bytes for each of %5d elements of estimators totaling %10.1f Mb \n",
+       sizeof (plasma_est_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (plasma_est_dummy));
+  }
+
+  /* Now allocate space for storing the free bound cdfs of each cell -- 57h, 1703.  The cdfs
+     themselves are allocated by one_fb when they are needed */
+  if (fbstoremain != NULL)
   {
-    free (photstoremain);
+    for (n = 0; n < fbstore_nelem; n++)
+      if (fbstoremain[n].pdf != NULL)
+      {
+        pdf_free (fbstoremain[n].pdf);
+        free (fbstoremain[n].pdf);
+      }
+    free (fbstoremain);
   }
-  photstoremain = (PhotStorePtr) calloc (sizeof (photon_store_dummy), (nelem + 1));
+  fbstoremain = (FbStorePtr) calloc (sizeof (fb_store_dummy), (nelem + 1));
+  fbstore_nelem = nelem + 1;
+  fbstore_bytes = 0;
+  fbstore_next = 0;
 
-  if (photstoremain == NULL)
+  if (fbstoremain == NULL)
   {
-    Error ("There is a problem in allocating memory for the photonstore structure\n");
+    Error ("There is a problem in allocating memory for the fbstore structure\n");
     exit (0);
   }
   else
   {
     Log
-      ("Allocated %10d bytes for each of %5d elements of photonstore totaling %10.1f Mb \n",
-       sizeof (photon_store_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (photon_store_dummy));
+      ("Allocated %10d bytes for each of %5d elements of fbstore totaling %10.1f Mb \n",
+       sizeof (fb_store_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (fb_store_dummy));
   }
 
   return (0);
@@ -411,8 +634,11 @@ the number of elements
 		cause errors and it is not obvious how to check this until
 		we put a macro model back in
 130625  JM      Commented out free statements due to PYWIND MALLOC MATOM BUG
+1703		Allocate each array as a single block for all the cells, see calloc_arena
  */
 
+#define NDYN_MACRO 17
+void *dyn_macro_arena[NDYN_MACRO];
 
 int
 calloc_estimators (nelem)
@@ -452,197 +678,126 @@ calloc_estimators (nelem)
   Log ("calloc_estimators: size_Jbar_est %d size_gamma_est %d size_alpha_est %d\n", size_Jbar_est, size_gamma_est, size_alpha_est);
 
 
-  for (n = 0; n < nelem; n++)
+  /* JM130625: The arrays used to be freed here cell by cell, but this was commented out due to the PYWIND
+     MALLOC MATOM BUG, since after a windsave file is read the pointers in macromain are those of the program
+     which wrote it.  The blocks allocated by calloc_arena are remembered separately, so can be freed safely */
+
+  for (n = 0; n < NDYN_MACRO; n++)
   {
-    /* JM130625: Commented out free statements due to PYWIND MALLOC MATOM BUG
-       if (macromain[n].jbar != NULL)
-       {
-       free (macromain[n].jbar);
-       } */
-    if ((macromain[n].jbar = calloc (sizeof (double), size_Jbar_est)) == NULL)
+    if (dyn_macro_arena[n] != NULL)
     {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
+      free (dyn_macro_arena[n]);
+      dyn_macro_arena[n] = NULL;
     }
+  }
 
-    /*if (macromain[n].jbar_old != NULL)
-       {
-       free (macromain[n].jbar_old);
-       } */
-    if ((macromain[n].jbar_old = calloc (sizeof (double), size_Jbar_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+  dyn_macro_arena[0] = calloc_arena (sizeof (double), size_Jbar_est, nelem, "jbar");
+  dyn_macro_arena[1] = calloc_arena (sizeof (double), size_Jbar_est, nelem, "jbar_old");
+  dyn_macro_arena[2] = calloc_arena (sizeof (double), size_gamma_est, nelem, "gamma");
+  dyn_macro_arena[3] = calloc_arena (sizeof (double), size_gamma_est, nelem, "gamma_old");
+  dyn_macro_arena[4] = calloc_arena (sizeof (double), size_gamma_est, nelem, "gamma_e");
+  dyn_macro_arena[5] = calloc_arena (sizeof (double), size_gamma_est, nelem, "gamma_e_old");
+  dyn_macro_arena[6] = calloc_arena (sizeof (double), size_gamma_est, nelem, "alpha_st");
+  dyn_macro_arena[7] = calloc_arena (sizeof (double), size_gamma_est, nelem, "alpha_st_old");
+  dyn_macro_arena[8] = calloc_arena (sizeof (double), size_gamma_est, nelem, "alpha_st_e");
+  dyn_macro_arena[9] = calloc_arena (sizeof (double), size_gamma_est, nelem, "alpha_st_e_old");
+  dyn_macro_arena[10] = calloc_arena (sizeof (double), size_alpha_est, nelem, "recomb_sp");
+  dyn_macro_arena[11] = calloc_arena (sizeof (double), size_alpha_est, nelem, "recomb_sp_e");
+  dyn_macro_arena[12] = calloc_arena (sizeof (double), nlevels_macro, nelem, "matom_emiss");
+  dyn_macro_arena[13] = calloc_arena (sizeof (double), nlevels_macro, nelem, "matom_abs");
+  dyn_macro_arena[14] = calloc_arena (sizeof (double), nphot_total, nelem, "cooling_bf");
+  dyn_macro_arena[15] = calloc_arena (sizeof (double), nphot_total, nelem, "cooling_bf_col");
+  dyn_macro_arena[16] = calloc_arena (sizeof (double), nlines, nelem, "cooling_bb");
 
-    /*if (macromain[n].gamma != NULL)
-       {
-       free (macromain[n].gamma);
-       } */
-    if ((macromain[n].gamma = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+  for (n = 0; n < nelem; n++)
+  {
+    macromain[n].jbar = (double *) dyn_macro_arena[0] + n * size_Jbar_est;
+    macromain[n].jbar_old = (double *) dyn_macro_arena[1] + n * size_Jbar_est;
+    macromain[n].gamma = (double *) dyn_macro_arena[2] + n * size_gamma_est;
+    macromain[n].gamma_old = (double *) dyn_macro_arena[3] + n * size_gamma_est;
+    macromain[n].gamma_e = (double *) dyn_macro_arena[4] + n * size_gamma_est;
+    macromain[n].gamma_e_old = (double *) dyn_macro_arena[5] + n * size_gamma_est;
+    macromain[n].alpha_st = (double *) dyn_macro_arena[6] + n * size_gamma_est;
+    macromain[n].alpha_st_old = (double *) dyn_macro_arena[7] + n * size_gamma_est;
+    macromain[n].alpha_st_e = (double *) dyn_macro_arena[8] + n * size_gamma_est;
+    macromain[n].alpha_st_e_old = (double *) dyn_macro_arena[9] + n * size_gamma_est;
+    macromain[n].recomb_sp = (double *) dyn_macro_arena[10] + n * size_alpha_est;
+    macromain[n].recomb_sp_e = (double *) dyn_macro_arena[11] + n * size_alpha_est;
+    macromain[n].matom_emiss = (double *) dyn_macro_arena[12] + n * nlevels_macro;
+    macromain[n].matom_abs = (double *) dyn_macro_arena[13] + n * nlevels_macro;
+    macromain[n].cooling_bf = (double *) dyn_macro_arena[14] + n * nphot_total;
+    macromain[n].cooling_bf_col = (double *) dyn_macro_arena[15] + n * nphot_total;
+    macromain[n].cooling_bb = (double *) dyn_macro_arena[16] + n * nlines;
+  }
 
-    /*if (macromain[n].gamma_old != NULL)
-       {
-       free (macromain[n].gamma_old);
-       } */
-    if ((macromain[n].gamma_old = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
 
-    /*if (macromain[n].gamma_e != NULL)
-       {
-       free (macromain[n].gamma_e);
-       } */
-    if ((macromain[n].gamma_e = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
-
-    /*if (macromain[n].gamma_e_old != NULL)
-       {
-       free (macromain[n].gamma_e_old);
-       } */
-    if ((macromain[n].gamma_e_old = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
 
-    /*if (macromain[n].alpha_st != NULL)
-       {
-       free (macromain[n].alpha_st);
-       } */
-    if ((macromain[n].alpha_st = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+  if (nlevels_macro > 0 || geo.nmacro > 0)
+  {
+    Log_silent
+      ("Allocated %10.1f Mb for MA estimators \n",
+       1.e-6 * (nelem + 1) * (2. * nlevels_macro + 2. * size_alpha_est + 8. * size_gamma_est + 2. * size_Jbar_est) * sizeof (double));
+  }
+  else
+  {
+    Log_silent ("Allocated no space for macro since nlevels_macro==0\n");
+  }
 
-    /*if (macromain[n].alpha_st_old != NULL)
-       {
-       free (macromain[n].alpha_st_old);
-       } */
-    if ((macromain[n].alpha_st_old = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+  return (0);
+}
 
-    /*if (macromain[n].alpha_st_e != NULL)
-       {
-       free (macromain[n].alpha_st_e);
-       } */
-    if ((macromain[n].alpha_st_e = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+/***********************************************************
+                                       Space Telescope Science Institute
 
-    /*if (macromain[n].alpha_st_e_old)
-       {
-       free (macromain[n].alpha_st_e_old);
-       } */
-    if ((macromain[n].alpha_st_e_old = calloc (sizeof (double), size_gamma_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ Synopsis: calloc_arena (size, nper, nelem, name)
 
-    /*if (macromain[n].recomb_sp != NULL)
-       {
-       free (macromain[n].recomb_sp);
-       } */
-    if ((macromain[n].recomb_sp = calloc (sizeof (double), size_alpha_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ Arguments:
+	size_t size	the size of one element of the array
+	int nper	the number of elements in each cell
+	int nelem	the number of cells
+	char name[]	the name of the array, for the error message
 
-    /*if (macromain[n].recomb_sp_e != NULL)
-       {
-       free (macromain[n].recomb_sp_e);
-       } */
-    if ((macromain[n].recomb_sp_e = calloc (sizeof (double), size_alpha_est)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ Returns:
+	A pointer to a block of nelem * nper elements, all zero
 
-    /*if (macromain[n].matom_emiss != NULL)
-       {
-       free (macromain[n].matom_emiss);
-       } */
-    if ((macromain[n].matom_emiss = calloc (sizeof (double), nlevels_macro)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ Description:
+	Allocate the storage for one of the variable length arrays 
+	of the plasma or macro structures as a single block, in the
+	order of the cells.  The array for cell n begins at element
+	n * nper of the block.
 
-    /*if (macromain[n].matom_abs != NULL)
-       {
-       free (macromain[n].matom_abs);
-       } */
-    if ((macromain[n].matom_abs = calloc (sizeof (double), nlevels_macro)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ Notes:
+	Since the cells are in one block, the arrays of neighbouring
+	cells are next to one another in memory, and the whole array 
+	can be written to or read from a windsave file at once.  The
+	block for a given array starts at the pointer of cell 0.
 
-    /* Added ksl 091103 59e */
-    /*if (macromain[n].cooling_bf != NULL)
-       {
-       free (macromain[n].cooling_bf);
-       } */
-    if ((macromain[n].cooling_bf = calloc (sizeof (double), nphot_total)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+ History:
+	1703		Coded
 
-    /*if (macromain[n].cooling_bf_col != NULL)
-       {
-       free (macromain[n].cooling_bf_col);
-       } */
-    if ((macromain[n].cooling_bf_col = calloc (sizeof (double), nphot_total)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
+**************************************************************/
 
-    /*if (macromain[n].cooling_bb != NULL)
-       {
-       free (macromain[n].cooling_bb);
-       } */
-    if ((macromain[n].cooling_bb = calloc (sizeof (double), nlines)) == NULL)
-    {
-      Error ("calloc_estimators: Error in allocating memory for MA estimators\n");
-      exit (0);
-    }
-  }
 
+void *
+calloc_arena (size, nper, nelem, name)
+     size_t size;
+     int nper, nelem;
+     char name[];
+{
+  void *arena;
 
+  /* Always allocate something so that the pointer of cell 0 is not NULL, even when nper is 0 */
 
-  if (nlevels_macro > 0 || geo.nmacro > 0)
-  {
-    Log_silent
-      ("Allocated %10.1f Mb for MA estimators \n",
-       1.e-6 * (nelem + 1) * (2. * nlevels_macro + 2. * size_alpha_est + 8. * size_gamma_est + 2. * size_Jbar_est) * sizeof (double));
-  }
-  else
+  if ((arena = calloc (size, (size_t) nper * nelem + 1)) == NULL)
   {
-    Log_silent ("Allocated no space for macro since nlevels_macro==0\n");
+    Error ("calloc_arena: Error in allocating memory for %s\n", name);
+    exit (0);
   }
 
-  return (0);
+  return (arena);
 }
 
+
 /***********************************************************
                                        West Lulworth
 
@@ -666,110 +821,81 @@ Notes:
 	Arrays sized to the number of ions are largest,
 	and dominate the size of nplasma, so these were first to be dynamically allocated.
 
+	Each array is allocated for all the cells at once by calloc_arena.  The
+	arrays from any previous call are freed first.
+
 History:
 	1407	nsh	Started out allocating arrays that have length nion
+	1703		Point each cell at its element of estmain
+	1703		Allocate each array as a single block for all the cells
 
 **************************************************************/
 
+#define NDYN_PLASMA 17
+void *dyn_plasma_arena[NDYN_PLASMA];
 
 int
 calloc_dyn_plasma (nelem)
      int nelem;
 {
   int n;
+  double *density, *partition, *PWdenom, *PWdtemp, *PWnumer, *PWntemp;
+  double *ioniz, *recomb, *xscatters, *heat_ion, *lum_ion, *inner_recomb, *lum_inner_ion;
+  double *levden, *recomb_simple;
+  int *scatters, *kbf_use;
 
-  for (n = 0; n < nelem + 1; n++)       //We loop over all elements in the plasma array, adding one for an empty cell used for extrapolations.
+  for (n = 0; n < NDYN_PLASMA; n++)
   {
-    if ((plasmamain[n].density = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for density\n");
-      exit (0);
-    }
-    if ((plasmamain[n].partition = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for partition\n");
-      exit (0);
-    }
-    if ((plasmamain[n].PWdenom = calloc (sizeof (double), nions)) == NULL)
+    if (dyn_plasma_arena[n] != NULL)
     {
-      Error ("calloc_dyn_plasma: Error in allocating memory for PWdenom\n");
-      exit (0);
-    }
-    if ((plasmamain[n].PWdtemp = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for PWtemp\n");
-      exit (0);
-    }
-    if ((plasmamain[n].PWnumer = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for PWnumer\n");
-      exit (0);
-    }
-    if ((plasmamain[n].PWntemp = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for PWntemp\n");
-      exit (0);
-    }
-    if ((plasmamain[n].ioniz = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for ioniz\n");
-      exit (0);
-    }
-    if ((plasmamain[n].recomb = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for recomb\n");
-      exit (0);
-    }
-    if ((plasmamain[n].scatters = calloc (sizeof (int), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for scatters\n");
-      exit (0);
-    }
-    if ((plasmamain[n].xscatters = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for xscatters\n");
-      exit (0);
-    }
-    if ((plasmamain[n].heat_ion = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for heat_ion\n");
-      exit (0);
-    }
-    if ((plasmamain[n].lum_ion = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for lum_ion\n");
-      exit (0);
-    }
-    if ((plasmamain[n].inner_recomb = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for inner_recomb\n");
-      exit (0);
-    }
-    if ((plasmamain[n].lum_inner_ion = calloc (sizeof (double), nions)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for lum_inner_recomb\n");
-      exit (0);
+      free (dyn_plasma_arena[n]);
+      dyn_plasma_arena[n] = NULL;
     }
+  }
+
+  //We allocate all elements in the plasma array, adding one for an empty cell used for extrapolations.
+
+  dyn_plasma_arena[0] = density = calloc_arena (sizeof (double), nions, nelem + 1, "density");
+  dyn_plasma_arena[1] = partition = calloc_arena (sizeof (double), nions, nelem + 1, "partition");
+  dyn_plasma_arena[2] = PWdenom = calloc_arena (sizeof (double), nions, nelem + 1, "PWdenom");
+  dyn_plasma_arena[3] = PWdtemp = calloc_arena (sizeof (double), nions, nelem + 1, "PWdtemp");
+  dyn_plasma_arena[4] = PWnumer = calloc_arena (sizeof (double), nions, nelem + 1, "PWnumer");
+  dyn_plasma_arena[5] = PWntemp = calloc_arena (sizeof (double), nions, nelem + 1, "PWntemp");
+  dyn_plasma_arena[6] = ioniz = calloc_arena (sizeof (double), nions, nelem + 1, "ioniz");
+  dyn_plasma_arena[7] = recomb = calloc_arena (sizeof (double), nions, nelem + 1, "recomb");
+  dyn_plasma_arena[8] = scatters = calloc_arena (sizeof (int), nions, nelem + 1, "scatters");
+  dyn_plasma_arena[9] = xscatters = calloc_arena (sizeof (double), nions, nelem + 1, "xscatters");
+  dyn_plasma_arena[10] = heat_ion = calloc_arena (sizeof (double), nions, nelem + 1, "heat_ion");
+  dyn_plasma_arena[11] = lum_ion = calloc_arena (sizeof (double), nions, nelem + 1, "lum_ion");
+  dyn_plasma_arena[12] = inner_recomb = calloc_arena (sizeof (double), nions, nelem + 1, "inner_recomb");
+  dyn_plasma_arena[13] = lum_inner_ion = calloc_arena (sizeof (double), nions, nelem + 1, "lum_inner_ion");
 
 //A few more variable length arrays 
 
-    if ((plasmamain[n].levden = calloc (sizeof (double), nlte_levels)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for levden\n");
-      exit (0);
-    }
+  dyn_plasma_arena[14] = levden = calloc_arena (sizeof (double), nlte_levels, nelem + 1, "levden");
+  dyn_plasma_arena[15] = recomb_simple = calloc_arena (sizeof (double), nphot_total, nelem + 1, "recomb_simple");
+  dyn_plasma_arena[16] = kbf_use = calloc_arena (sizeof (int), nphot_total, nelem + 1, "kbf_use");
 
-    if ((plasmamain[n].recomb_simple = calloc (sizeof (double), nphot_total)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for recomb_simple\n");
-      exit (0);
-    }
-
-    if ((plasmamain[n].kbf_use = calloc (sizeof (double), nphot_total)) == NULL)
-    {
-      Error ("calloc_dyn_plasma: Error in allocating memory for kbf_use\n");
-      exit (0);
-    }
+  for (n = 0; n < nelem + 1; n++)
+  {
+    plasmamain[n].est = &estmain[n];    /* The estimators themselves are allocated in calloc_plasma */
+    plasmamain[n].density = density + n * nions;
+    plasmamain[n].partition = partition + n * nions;
+    plasmamain[n].PWdenom = PWdenom + n * nions;
+    plasmamain[n].PWdtemp = PWdtemp + n * nions;
+    plasmamain[n].PWnumer = PWnumer + n * nions;
+    plasmamain[n].PWntemp = PWntemp + n * nions;
+    plasmamain[n].ioniz = ioniz + n * nions;
+    plasmamain[n].recomb = recomb + n * nions;
+    plasmamain[n].scatters = scatters + n * nions;
+    plasmamain[n].xscatters = xscatters + n * nions;
+    plasmamain[n].heat_ion = heat_ion + n * nions;
+    plasmamain[n].lum_ion = lum_ion + n * nions;
+    plasmamain[n].inner_recomb = inner_recomb + n * nions;
+    plasmamain[n].lum_inner_ion = lum_inner_ion + n * nions;
+    plasmamain[n].levden = levden + n * nlte_levels;
+    plasmamain[n].recomb_simple = recomb_simple + n * nphot_total;
+    plasmamain[n].kbf_use = kbf_use + n * nphot_total;
   }
 
   Log
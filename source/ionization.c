@@ -63,7 +63,9 @@ ion_abundances (xplasma, mode)
      int mode;
 {
   int ireturn;
+  double t_perf;
 
+  t_perf = perf_start ();
 
   if (mode == IONMODE_ML93_FIXTE)
   {
@@ -73,7 +75,7 @@ to match heating and cooling in the wind element! */
     if ((ireturn = nebular_concentrations (xplasma, NEBULARMODE_ML93)))
     {
       Error ("ionization_abundances: nebular_concentrations failed to converge\n");
-      Error ("ionization_abundances: j %8.2e t_e %8.2e t_r %8.2e w %8.2e\n", xplasma->j, xplasma->t_e, xplasma->w);
+      Error ("ionization_abundances: j %8.2e t_e %8.2e t_r %8.2e w %8.2e\n", xplasma->est->j, xplasma->t_e, xplasma->w);
     }
   }
   else if (mode == IONMODE_LTE)
@@ -100,6 +102,10 @@ to match heating and cooling in the wind element! */
 
     ireturn = one_shot (xplasma, mode);
 
+/* Extrapolate t_e if the cell is crawling or oscillating towards its solution */
+    if (modes.ioniz_acceleration)
+      ng_accelerate (xplasma, mode);
+
 /* Convergence check */
     convergence (xplasma);
   }
@@ -124,6 +130,10 @@ to match heating and cooling in the wind element! */
 
     ireturn = one_shot (xplasma, mode);
 
+/* Extrapolate t_e if the cell is crawling or oscillating towards its solution */
+    if (modes.ioniz_acceleration)
+      ng_accelerate (xplasma, mode);
+
 /* Convergence check */
     convergence (xplasma);
   }
@@ -143,6 +153,10 @@ to match heating and cooling in the wind element! */
     ireturn = one_shot (xplasma, mode);
 
 
+/* Extrapolate t_e if the cell is crawling or oscillating towards its solution */
+    if (modes.ioniz_acceleration)
+      ng_accelerate (xplasma, mode);
+
 /* Convergence check */
     convergence (xplasma);
   }
@@ -164,6 +178,7 @@ to match heating and cooling in the wind element! */
     auger_ionization (xplasma);
   }
 
+  perf_stop (PERF_ION_ABUNDANCES, t_perf);
 
   return (ireturn);
 
@@ -350,7 +365,269 @@ check_convergence ()
   Log
     ("Summary  convergence %4d %.3f  %4d  %.3f  %d  #  n_converged fraction_converged  converging fraction_converging total cells\n",
      nconverge, xconverge, nconverging, xconverging, ntot);
-  Log_flush ();                 /*NSH June 13 Added call to flush logfile */
+  if (modes.ioniz_acceleration)
+    ng_summary ();
+  return (0);
+}
+
+
+
+/***********************************************************
+              University of Southampton
+
+ Synopsis:
+   ng_accelerate applies Ng acceleration to the fixed point iteration
+   for the electron temperature of a single cell
+
+ Arguments:
+	PlasmaPtr xplasma;	The cell being updated
+	int mode;		The ionization mode being used in ion_abundances
+
+Returns:
+	1 if the extrapolated temperature was used, 0 otherwise
+
+Description:
+
+	Each ionization cycle moves t_e a fraction gain of the way towards the
+	temperature which balances heating and cooling.  Many cells either crawl
+	or oscillate towards the final solution for many cycles.  This routine
+	keeps a short history of t_e, t_r and ne for each cell, and once NG_NHIST
+	iterates are available it uses the scheme of Ng (1974, J. Chem. Phys.
+	61, 2680) to extrapolate to the fixed point.  The coefficients are found
+	from all three quantities, scaled to relative changes, but only t_e is
+	replaced since t_r is measured directly from the estimators and ne follows
+	from the ionization calculation, which is repeated with the new t_e.
+
+	The extrapolation is only used when the most recent change in t_e is well
+	above the Monte Carlo noise, which is estimated from the number of photon
+	passages through the cell.  Otherwise one would simply amplify the noise.
+	After an accepted step the history is restarted from the new point.
+
+Notes:
+	The history is held only by the thread which updates the cell and is not
+	saved in the windsave file, so it simply starts again on a restart.
+
+	The number of cycles saved is estimated from the rate at which the 
+	damped iteration was approaching the solution; it is the number of
+	cycles the geometric tail of the damped steps would have needed to
+	cover the extrapolated jump, or to decay to the noise level.
+
+History:
+	1703	Coded as part of the effort to reduce the number of ionization cycles
+
+**************************************************************/
+
+#define NG_NHIST	4       /* The number of iterates needed for an Ng step */
+#define NG_NVAR		3       /* t_e, t_r, ne */
+#define NG_NOISE	3.0     /* Only extrapolate if the change in t_e exceeds this many times the noise */
+#define NG_MAX_JUMP	5.0     /* Maximum extrapolated change in units of the last change */
+#define NG_MAX_SAVED	50.0    /* Ceiling on the estimated number of cycles saved by one step */
+
+double *ng_hist = NULL;         /* History of the iterates, NG_NHIST x NG_NVAR for each plasma cell */
+int *ng_nhist = NULL;           /* The number of iterates currently stored for each cell */
+int ng_naccel, ng_naccel_tot;   /* The number of accelerated steps in this cycle and in total */
+double ng_saved, ng_saved_tot;  /* The estimated number of cell cycles saved */
+
+int
+ng_accelerate (xplasma, mode)
+     PlasmaPtr xplasma;
+     int mode;
+{
+  double *h, *x0, *x1, *x2, *x3;
+  double d0[NG_NVAR], d01[NG_NVAR], d02[NG_NVAR];
+  double a11, a12, a22, b1, b2, det, a, b;
+  double t_new, step, noise, rho, remain, nsaved, z;
+  int n, nvar, nmode;
+
+  if (modes.zeus_connect == 1 || modes.fixed_temp == 1)
+    return (0);
+
+  if (ng_hist == NULL)
+  {
+    ng_hist = calloc (sizeof (double), NPLASMA * NG_NHIST * NG_NVAR);
+    ng_nhist = calloc (sizeof (int), NPLASMA);
+    if (ng_hist == NULL || ng_nhist == NULL)
+    {
+      Error ("ng_accelerate: Could not allocate memory for the iteration history\n");
+      exit (0);
+    }
+  }
+
+  n = xplasma->nplasma;
+  h = &ng_hist[n * NG_NHIST * NG_NVAR];
+
+  /* A cell without photons, or one which has hit the temperature limits, has no useful history */
+
+  if (xplasma->est->ntot == 0 || xplasma->t_e >= TMAX || xplasma->t_e <= TMIN || xplasma->ne <= 0)
+  {
+    ng_nhist[n] = 0;
+    return (0);
+  }
+
+  /* Shift the history down and add the current iterate, stored so the fastest varying
+     quantities are all relative */
+
+  for (nvar = (NG_NHIST - 1) * NG_NVAR - 1; nvar >= 0; nvar--)
+    h[nvar + NG_NVAR] = h[nvar];
+  h[0] = xplasma->t_e;
+  h[1] = xplasma->t_r;
+  h[2] = xplasma->ne;
+  if (ng_nhist[n] < NG_NHIST)
+    ng_nhist[n]++;
+
+  if (ng_nhist[n] < NG_NHIST)
+    return (0);
+
+  x0 = &h[0];
+  x1 = &h[NG_NVAR];
+  x2 = &h[2 * NG_NVAR];
+  x3 = &h[3 * NG_NVAR];
+
+  /* Check that the last change is significant compared to the Monte Carlo noise */
+
+  noise = 1. / sqrt ((double) xplasma->est->ntot);
+  step = (x0[0] - x1[0]) / x0[0];
+  if (fabs (step) < NG_NOISE * noise)
+    return (0);
+
+  /* Set up the least squares problem for the two Ng coefficients, with each
+     quantity weighted by its current value */
+
+  a11 = a12 = a22 = b1 = b2 = 0;
+  for (nvar = 0; nvar < NG_NVAR; nvar++)
+  {
+    d0[nvar] = (x0[nvar] - x1[nvar]) / x0[nvar];
+    d01[nvar] = d0[nvar] - (x1[nvar] - x2[nvar]) / x0[nvar];
+    d02[nvar] = d0[nvar] - (x2[nvar] - x3[nvar]) / x0[nvar];
+    a11 += d01[nvar] * d01[nvar];
+    a12 += d01[nvar] * d02[nvar];
+    a22 += d02[nvar] * d02[nvar];
+    b1 += d0[nvar] * d01[nvar];
+    b2 += d0[nvar] * d02[nvar];
+  }
+
+  det = a11 * a22 - a12 * a12;
+  if (fabs (det) > EPSILON * a11 * a22)
+  {
+    a = (b1 * a22 - b2 * a12) / det;
+    b = (b2 * a11 - b1 * a12) / det;
+  }
+  else if (a11 > 0)
+  {
+    /* The history is effectively one dimensional, so fall back to an Aitken step */
+    a = b1 / a11;
+    b = 0;
+  }
+  else
+    return (0);
+
+  t_new = (1. - a - b) * x0[0] + a * x1[0] + b * x2[0];
+
+  /* Reject steps which are not sensible */
+
+  if (sane_check (t_new) || t_new <= TMIN || t_new >= TMAX || fabs (t_new - x0[0]) > NG_MAX_JUMP * fabs (x0[0] - x1[0]))
+    return (0);
+
+  /* Estimate how many damped cycles this step replaces */
+
+  rho = fabs ((x0[0] - x1[0]) / (x1[0] - x2[0]));
+  nsaved = 0;
+  if (rho < 1 && rho > 0)
+  {
+    remain = fabs (t_new - x0[0]) / fabs (x0[0] - x1[0]);
+    z = 1. - remain * (1. - rho) / rho;
+    if (z > 0)
+      nsaved = log (z) / log (rho);
+    else
+      nsaved = log (noise / fabs (step)) / log (rho);
+  }
+  if (nsaved > NG_MAX_SAVED)
+    nsaved = NG_MAX_SAVED;
+  if (nsaved < 0)
+    nsaved = 0;
+
+  /* Recalculate the ionization state with the new temperature */
+
+  xplasma->t_e = t_new;
+  nmode = mode;
+  if (mode == IONMODE_ML93)
+    nmode = NEBULARMODE_ML93;
+  if (nebular_concentrations (xplasma, nmode))
+  {
+    Error ("ng_accelerate: nebular_concentrations failed to converge for cell %d t_e %8.2e\n", n, t_new);
+  }
+
+  /* Restart the history from the extrapolated point */
+
+  h[0] = xplasma->t_e;
+  h[1] = xplasma->t_r;
+  h[2] = xplasma->ne;
+  ng_nhist[n] = 1;
+
+  ng_naccel++;
+  ng_saved += nsaved;
+
+  return (1);
+}
+
+
+
+/***********************************************************
+              University of Southampton
+
+ Synopsis:
+   ng_summary reports how often Ng acceleration was used in the
+   last ionization cycle and how many cycles it is estimated to
+   have saved
+
+ Arguments:
+
+Returns:
+ 
+Description:
+	This is called from check_convergence.  The counters are
+	summed over all threads, since each thread only updates
+	some of the cells, and then reset for the next cycle.
+
+Notes:
+
+History:
+	1703	Coded to report the effect of ng_accelerate
+
+**************************************************************/
+
+int
+ng_summary ()
+{
+  int naccel;
+  double saved;
+#ifdef MPI_ON
+  int inaccel;
+  double isaved;
+#endif
+
+  naccel = ng_naccel;
+  saved = ng_saved;
+
+#ifdef MPI_ON
+  inaccel = naccel;
+  isaved = saved;
+  MPI_Allreduce (&inaccel, &naccel, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+  MPI_Allreduce (&isaved, &saved, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+
+  ng_naccel_tot += naccel;
+  ng_saved_tot += saved;
+
+  Log ("!!Check_convergence_acceleration: %4d cells extrapolated this cycle saving ~%.1f cell cycles (%d cells %.1f cell cycles in total)\n",
+       naccel, saved, ng_naccel_tot, ng_saved_tot);
+  Log
+    ("Summary  acceleration %4d %8.1f %8.1f %8.2f  #  n_extrapolated cell_cycles_saved total_saved equivalent_full_cycles_saved\n",
+     naccel, saved, ng_saved_tot, ng_saved_tot / NPLASMA);
+
+  ng_naccel = 0;
+  ng_saved = 0;
+
   return (0);
 }
 
@@ -447,7 +724,7 @@ meaning in nebular concentrations.
     if (nebular_concentrations (xplasma, mode))
     {
       Error ("ionization_on_the_spot: nebular_concentrations failed to converge\n");
-      Error ("ionization_on_the_spot: j %8.2e t_e %8.2e t_r %8.2e w %8.2e nphot %i\n", xplasma->j, xplasma->t_e, xplasma->w, xplasma->ntot);
+      Error ("ionization_on_the_spot: j %8.2e t_e %8.2e t_r %8.2e w %8.2e nphot %i\n", xplasma->est->j, xplasma->t_e, xplasma->w, xplasma->est->ntot);
     }
     if (xplasma->ne < 0 || VERY_BIG < xplasma->ne)
     {
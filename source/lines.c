@@ -61,6 +61,7 @@ History:
 	99jan	ksl	Added limits to avoid calculation of extremely weak lines in
 			attempt to speed up program.  Note that this is fairly dangerous
 	06may	ksl	57+ -- Mods for change to  plasma.  Downsream programs need volume
+	1703		Removed the coarse luminosity pdf, which one_line no longer uses
  */
 
 double
@@ -74,6 +75,10 @@ total_line_emission (one, f1, f2)
 
   t_e = plasmamain[one->nplasma].t_e;
 
+  /* The line luminosities are being recalculated, so any cumulative luminosity
+     retained by one_line may be out of date */
+  one_line_nplasma = -1;
+
   if (t_e <= 0 || f2 < f1)
     return (0);
 
@@ -82,13 +87,6 @@ total_line_emission (one, f1, f2)
 //  lum = lum_lines (ww, t_e, nline_min, nline_max);
   lum = lum_lines (one, nline_min, nline_max);
 
-//Now populate the crude pdf for this wind element
-
-
-  if (xxxpdfwind == 1)
-    lum_pdf (&plasmamain[one->nplasma], lum);
-
-
   return (lum);
 
 }
@@ -161,41 +159,6 @@ lum_lines (one, nmin, nmax)
   return (lum);
 }
 
-/* This routine creates a luminosty pdf */
-int
-lum_pdf (xplasma, lumlines)
-     PlasmaPtr xplasma;
-     double lumlines;
-{
-  int n, m;
-  double xsum, vsum;
-
-  xplasma->pdf_x[0] = nline_min;
-  xplasma->pdf_y[0] = 0;
-
-  n = nline_min;
-  vsum = 0.0;
-  for (m = 1; m < LPDF; m++)
-  {
-    xsum = m * lumlines / (LPDF - 1);   /* This is the target */
-    while ((vsum += lin_ptr[n]->pow) < xsum && n < nline_max)
-      n++;
-    n++;                        // otherwise one will add lin_ptr[n]->pow twice
-/* Why this is done this way is tricky.  The important point is that
-
-xplasma->pdf_y[m]= sum lin_ptr[mm]->pow  where mm runs from pdf_x[m-1] to
-pdf_x[m]-1
-
-*/
-    xplasma->pdf_x[m] = n;
-    xplasma->pdf_y[m] = vsum;
-
-
-  }
-
-  return (0);
-}
-
 
 
 #define ECS_CONSTANT 4.773691e16        //(8*PI)/(sqrt(3) *nu_1Rydberg
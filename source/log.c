@@ -24,6 +24,8 @@
 
 		int error_summary(char *format)			Summarize all of the erors that have been
 								logged to this point in time
+		int error_summary_cycle(char *format)		Summarize the errors logged since it was last
+								called, summed over all the processes in parallel mode
 		int Log_set_verbosity(vlevel)			Set the verbosity of the what is printed to
 								the cren and the log file
 
@@ -114,6 +116,9 @@ History:
   1407 JM removed warning - we would like to throw errors
   1411 JM debug statements are controlled by verbosity now, 
           so no need for Log_Debug
+	1703		Errors are looked up by the address of their format in a hash 
+			table before the descriptions are compared, the logfile is 
+			given a large buffer, and error_summary_cycle was added
 
  
 **************************************************************/
@@ -124,8 +129,14 @@ History:
 #include <math.h>
 #include "log.h"
 
+#ifdef MPI_ON
+#include "mpi.h"
+#endif
+
 #define LINELENGTH 132
 #define NERROR_MAX 500          // Number of different errors that are recorded
+#define NERROR_HASH 2048        // Size of the table of the formats of errors, a power of 2 
+#define LOG_BUFFER 1048576      // Size of the buffer for the logfile, which is flushed by Log_flush
 
 /* definitions of what is logged at what verboisty level */
 
@@ -147,6 +158,7 @@ typedef struct error_log
 {
   char description[LINELENGTH];
   int n;
+  int n_cycle;                  // the number of times since error_summary_cycle was last called
 } error_dummy, *ErrorPtr;
 
 ErrorPtr errorlog;
@@ -154,6 +166,19 @@ ErrorPtr errorlog;
 
 int nerrors;
 
+/* Errors are almost always issued with a constant format, so each place an error is issued from can 
+   be recognized by the address of its format.  error_count looks this up in a hash table, which 
+   points to the error in errorlog, and only compares the description once a match is found */
+
+typedef struct error_site
+{
+  char *format;
+  int nerror;                   // the element of errorlog
+} error_site_dummy, *ErrorSitePtr;
+
+error_site_dummy error_site[NERROR_HASH];
+int nerror_sites;
+
 FILE *diagptr;
 int init_log = 0;
 int log_verbosity = 5;          // A parameter which can be used to suppress what would normally be logged or printed
@@ -172,10 +197,13 @@ Log_init (filename)
     printf ("Yikes: could not even open log file %s\n", filename);
     exit (0);
   }
+  setvbuf (diagptr, NULL, _IOFBF, LOG_BUFFER);
   init_log = 1;
 
   nerrors = 0;
   errorlog = (ErrorPtr) calloc (sizeof (error_dummy), NERROR_MAX);
+  memset (error_site, 0, sizeof (error_site));
+  nerror_sites = 0;
 
   if (errorlog == NULL)
   {
@@ -198,10 +226,13 @@ Log_append (filename)
     printf ("Yikes: could not even open log file %s\n", filename);
     exit (0);
   }
+  setvbuf (diagptr, NULL, _IOFBF, LOG_BUFFER);
   init_log = 1;
 
   nerrors = 0;
   errorlog = (ErrorPtr) calloc (sizeof (error_dummy), NERROR_MAX);
+  memset (error_site, 0, sizeof (error_site));
+  nerror_sites = 0;
 
   if (errorlog == NULL)
   {
@@ -389,42 +420,71 @@ sane_check (x)
 int
 error_count (char *format)
 {
-  int n;
-  n = 0;
-  while (n < nerrors)
+  int n, nsite, count;
+  unsigned long hash;
+
+  /* Look for this format in the table of places errors have been issued from.  The description
+     is still compared, since the same address may be used for different formats */
+
+  hash = ((unsigned long) format >> 3) * 2654435761UL;
+  nsite = hash & (NERROR_HASH - 1);
+  while (error_site[nsite].format != NULL)
   {
-    if (strcmp (errorlog[n].description, (format)) == 0)
+    if (error_site[nsite].format == format && strncmp (errorlog[error_site[nsite].nerror].description, format, LINELENGTH - 1) == 0)
       break;
-    n++;
+    nsite = (nsite + 1) & (NERROR_HASH - 1);
   }
 
-  if (n == nerrors)
+  if (error_site[nsite].format != NULL)
   {
-    strcpy (errorlog[nerrors].description, format);
-    errorlog[n].n = 1;
-    if (nerrors < NERROR_MAX)
+    n = error_site[nsite].nerror;
+  }
+  else
+  {
+    /* This is the first time for this address, so the error may be new or may have come from 
+       somewhere else */
+
+    n = 0;
+    while (n < nerrors)
+    {
+      if (strncmp (errorlog[n].description, format, LINELENGTH - 1) == 0)
+        break;
+      n++;
+    }
+
+    if (n == nerrors)
     {
+      if (nerrors == NERROR_MAX)
+      {
+        printf ("Exceeded number of different errors that can be stored\n");
+        error_summary ("Quitting because there are too many differnt types of errors\n");
+        exit (0);
+      }
+      strncpy (errorlog[n].description, format, LINELENGTH - 1);
+      errorlog[n].n = errorlog[n].n_cycle = 0;
       nerrors++;
     }
-    else
+
+    /* Keep the table at most half full, after which new addresses are always searched for */
+
+    if (nerror_sites < NERROR_HASH / 2)
     {
-      printf ("Exceeded number of different errors that can be stored\n");
-      error_summary ("Quitting because there are too many differnt types of errors\n");
-      exit (0);
+      error_site[nsite].format = format;
+      error_site[nsite].nerror = n;
+      nerror_sites++;
     }
   }
-  else
+
+  errorlog[n].n_cycle++;
+  count = ++errorlog[n].n;
+  if (count == log_print_max + 1)
+    Error ("error_count: This error will no longer be logged: %s\n", format);
+  if (count == max_errors + 1)
   {
-    n = errorlog[n].n++;
-    if (n == log_print_max)
-      Error ("error_count: This error will no longer be logged: %s\n", format);
-    if (n == max_errors)
-    {
-      error_summary ("Something is drastically wrong for any error to occur so much!\n");
-      exit (0);
-    }
+    error_summary ("Something is drastically wrong for any error to occur so much!\n");
+    exit (0);
   }
-  return (n + 1);
+  return (count);
 }
 
 
@@ -445,6 +505,99 @@ error_summary (message)
 }
 
 
+/* error_summary_cycle logs the number of times each error has occurred since it was last called,
+ * which is normally at the end of each cycle, and resets the counts.  In parallel mode the
+ * counts of all the processes are sent to the master thread, which logs their sum.  It must 
+ * then be called by all of the processes.
+ */
+
+int
+error_summary_cycle (message)
+     char *message;
+{
+  int n, m, nsum;
+  ErrorPtr sum;
+#ifdef MPI_ON
+  int np_mpi, mpi_i, nbytes;
+  int *nbytes_all, *displs;
+  ErrorPtr mine, all;
+#endif
+
+  if (init_log == 0)
+    Log_init ("logfile");
+
+  sum = (ErrorPtr) calloc (sizeof (error_dummy), NERROR_MAX + 1);
+  nsum = 0;
+  for (n = 0; n < nerrors; n++)
+  {
+    if (errorlog[n].n_cycle > 0)
+    {
+      sum[nsum] = errorlog[n];
+      sum[nsum].n = errorlog[n].n_cycle;
+      nsum++;
+    }
+    errorlog[n].n_cycle = 0;
+  }
+
+#ifdef MPI_ON
+  MPI_Comm_size (MPI_COMM_WORLD, &np_mpi);
+  nbytes = nsum * sizeof (error_dummy);
+  nbytes_all = calloc (sizeof (int), np_mpi);
+  displs = calloc (sizeof (int), np_mpi);
+  MPI_Gather (&nbytes, 1, MPI_INT, nbytes_all, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  m = 0;
+  for (mpi_i = 0; mpi_i < np_mpi; mpi_i++)
+  {
+    displs[mpi_i] = m;
+    m += nbytes_all[mpi_i];
+  }
+
+  mine = sum;
+  all = (ErrorPtr) calloc (1, m + 1);
+  MPI_Gatherv (mine, nbytes, MPI_BYTE, all, nbytes_all, displs, MPI_BYTE, 0, MPI_COMM_WORLD);
+
+  /* On the master thread, add up the errors from all the threads by description */
+
+  if (my_rank == 0)
+  {
+    sum = (ErrorPtr) calloc (sizeof (error_dummy), m / sizeof (error_dummy) + 1);
+    nsum = 0;
+    for (n = 0; n < m / (int) sizeof (error_dummy); n++)
+    {
+      for (mpi_i = 0; mpi_i < nsum; mpi_i++)
+        if (strncmp (sum[mpi_i].description, all[n].description, LINELENGTH) == 0)
+          break;
+      if (mpi_i == nsum)
+      {
+        sum[nsum] = all[n];
+        nsum++;
+      }
+      else
+        sum[mpi_i].n += all[n].n;
+    }
+    free (mine);
+  }
+  free (all);
+  free (nbytes_all);
+  free (displs);
+#endif
+
+  if (nsum > 0)
+  {
+    Log ("\nErrors since last summary: %s\n", message);
+    Log ("Recurrences --  Description\n");
+    for (m = 0; m < nsum; m++)
+    {
+      Log ("%9d -- %s", sum[m].n, sum[m].description);
+    }
+  }
+
+  free (sum);
+  return (0);
+}
+
+
 /*NSH 121107 added a routine to flush the diagfile*/
 
 int
@@ -37,6 +37,7 @@ int Shout(char *format, ...);
 int sane_check(double x);
 int error_count(char *format);
 int error_summary(char *message);
+int error_summary_cycle(char *message);
 int Log_flush(void);
 int Log_set_mpi_rank(int rank, int n_mpi);
 int Log_parallel(char *format, ...);
@@ -82,6 +82,7 @@ macro_gov (p, nres, matom_or_kpkt, which_out)
 
 {
   int escape;                   //this tells us when the r-packet is escaping 
+  double t_perf;
 
   escape = 0;                   //start with it not being ready to escape as an r-packet
 
@@ -178,7 +179,9 @@ macro_gov (p, nres, matom_or_kpkt, which_out)
       }
       else
       {
+        t_perf = perf_start ();
         kpkt (p, nres, &escape);
+        perf_stop (PERF_KPKT, t_perf);
 
       }
 
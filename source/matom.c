@@ -122,7 +122,9 @@ matom (p, nres, escape)
   double jprbs_known[NLEVELS_MACRO][2 * (NBBJUMPS + NBFJUMPS)], eprbs_known[NLEVELS_MACRO][2 * (NBBJUMPS + NBFJUMPS)];
   double pjnorm_known[NLEVELS_MACRO], penorm_known[NLEVELS_MACRO];
   int prbs_known[NLEVELS_MACRO];
+  double t_perf;
 
+  t_perf = perf_start ();
 
   for (n = 0; n < NLEVELS_MACRO; n++)
   {
@@ -492,6 +494,8 @@ matom (p, nres, escape)
     exit (0);
   }
 
+  perf_stop (PERF_MATOM, t_perf);
+
   return (0);
 }
 
@@ -53,9 +53,37 @@ struct ModSum
   int nwaves;                   //All models in each comp should have same wavelengths;
   struct Model xmod;            //The current intepolated model of this type 
   struct Pdf xpdf;              //The current cumulative distribution function for this component
+  int *isort;                   //The models of this type sorted by their first parameter
 }
 comp[NCOMPS];
 
 
 /* In modsum, current[0] often refers to a normalization.  Therefore for parallism, a set of
 models which really only have one parameter, e.g. T, will store that parmeter in .par[1] */
+
+
+/* The cache of interpolated spectra and of the cdfs created from them (see model_flux and
+ * model_pdf).  This allows stars, boundary layers and disk rings with the same parameters to 
+ * share spectra and cdfs, and avoids recreating them every cycle.  The entries are found by 
+ * hashing, and when the memory used by either the spectra or the cdfs exceeds its share of 
+ * model_cache_mb, the least recently used entries are discarded.
+ */
+
+#define MODEL_NHASH	4099    // The number of hash chains for each type of entry
+
+typedef struct ModelCache
+{
+  int spectype;                 // The component from which the entry was created
+  double par[NPARS];            // The parameters of the model
+  double freqmin, freqmax;      // The frequency range of a cdf, 0 for a spectrum
+  double *f;                    // The interpolated spectrum, for a spectrum entry
+  struct Pdf pdf;               // The cdf, for a cdf entry
+  double nbytes;                // The memory used by the entry
+  long last_used;               // The value of model_cache_clock when the entry was last used
+  struct ModelCache *next;      // The next entry in the same hash chain
+} model_cache_dummy, *ModelCachePtr;
+
+ModelCachePtr model_spec_hash[MODEL_NHASH];     // The hash chains for spectra
+ModelCachePtr model_pdf_hash[MODEL_NHASH];      // The hash chains for cdfs
+double model_spec_bytes, model_pdf_bytes;       // The memory used by each type of entry
+long model_cache_clock;
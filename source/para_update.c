@@ -20,12 +20,16 @@ Notes:
 
 History:
     JM Coded as part of fix to #132
+    1703	The estimators in estmain are packed a cell at a time 
+		with memcpy, since each reduction acts on a contiguous
+		part of plasma_est
 
 
 
 **************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 #include "atomic.h"
@@ -38,32 +42,29 @@ communicate_estimators_para ()
 #ifdef MPI_ON                   // these routines should only be called anyway in parallel but we need these to compile
 
   int mpi_i, mpi_j;
-  double *maxfreqhelper, *maxfreqhelper2;
-  /*NSH 131213 the next line introduces new helper arrays for the max and min frequencies in bands */
-  double *maxbandfreqhelper, *maxbandfreqhelper2, *minbandfreqhelper, *minbandfreqhelper2;
+  double *maxhelper, *maxhelper2, *minhelper, *minhelper2;
   double *redhelper, *redhelper2, *qdisk_helper, *qdisk_helper2;
   int *iredhelper, *iredhelper2, *iqdisk_helper, *iqdisk_helper2;
-  // int size_of_helpers;
-  int plasma_double_helpers, plasma_int_helpers;
-
-  /* The size of the helper array for doubles. We transmit 10 numbers 
-     for each cell, plus three arrays, each of length NXBANDS */
-  plasma_double_helpers = (15 + 3 * NXBANDS) * NPLASMA;
-
-  /* The size of the helper array for integers. We transmit 7 numbers 
-     for each cell, plus one array of length NXBANDS */
-  plasma_int_helpers = (7 + NXBANDS) * NPLASMA;
-
-
-  maxfreqhelper = calloc (sizeof (double), NPLASMA);
-  maxfreqhelper2 = calloc (sizeof (double), NPLASMA);
-  /* NSH 131213 - allocate memory for the band limited max and min frequencies */
-  maxbandfreqhelper = calloc (sizeof (double), NPLASMA * NXBANDS);
-  maxbandfreqhelper2 = calloc (sizeof (double), NPLASMA * NXBANDS);
-  minbandfreqhelper = calloc (sizeof (double), NPLASMA * NXBANDS);
-  minbandfreqhelper2 = calloc (sizeof (double), NPLASMA * NXBANDS);
-  redhelper = calloc (sizeof (double), plasma_double_helpers);
-  redhelper2 = calloc (sizeof (double), plasma_double_helpers);
+  int nsum, nmax, nmin, nint, nred;
+  double *x;
+
+  /* The estimators are laid out in plasma_est so that each kind of reduction acts on a contiguous
+     piece of the structure: the doubles that are averaged, those from max_freq on which take a 
+     maximum, those from fmin which take a minimum, and then the integer counters from ntot on. */
+  nsum = offsetof (plasma_est_dummy, max_freq) / sizeof (double);
+  nmax = (offsetof (plasma_est_dummy, fmin) - offsetof (plasma_est_dummy, max_freq)) / sizeof (double);
+  nmin = (offsetof (plasma_est_dummy, ntot) - offsetof (plasma_est_dummy, fmin)) / sizeof (double);
+  nint = (sizeof (plasma_est_dummy) - offsetof (plasma_est_dummy, ntot)) / sizeof (int);
+
+  /* The averaged helper also carries the seven heating terms, which remain in the plasma structure */
+  nred = nsum + 7;
+
+  maxhelper = calloc (sizeof (double), NPLASMA * nmax);
+  maxhelper2 = calloc (sizeof (double), NPLASMA * nmax);
+  minhelper = calloc (sizeof (double), NPLASMA * nmin);
+  minhelper2 = calloc (sizeof (double), NPLASMA * nmin);
+  redhelper = calloc (sizeof (double), NPLASMA * nred);
+  redhelper2 = calloc (sizeof (double), NPLASMA * nred);
 
   /* JM -- added routine to average the qdisk quantities. The 2 is because
      we only have two doubles to worry about (heat and ave_freq) and 
@@ -77,34 +78,20 @@ communicate_estimators_para ()
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
-    maxfreqhelper[mpi_i] = plasmamain[mpi_i].max_freq;
-    redhelper[mpi_i] = plasmamain[mpi_i].j / np_mpi_global;
-    redhelper[mpi_i + NPLASMA] = plasmamain[mpi_i].ave_freq / np_mpi_global;
-    redhelper[mpi_i + 2 * NPLASMA] = plasmamain[mpi_i].lum / np_mpi_global;
-    redhelper[mpi_i + 3 * NPLASMA] = plasmamain[mpi_i].heat_tot / np_mpi_global;
-    redhelper[mpi_i + 4 * NPLASMA] = plasmamain[mpi_i].heat_lines / np_mpi_global;
-    redhelper[mpi_i + 5 * NPLASMA] = plasmamain[mpi_i].heat_ff / np_mpi_global;
-    redhelper[mpi_i + 6 * NPLASMA] = plasmamain[mpi_i].heat_comp / np_mpi_global;
-    redhelper[mpi_i + 7 * NPLASMA] = plasmamain[mpi_i].heat_ind_comp / np_mpi_global;
-    redhelper[mpi_i + 8 * NPLASMA] = plasmamain[mpi_i].heat_photo / np_mpi_global;
-    redhelper[mpi_i + 9 * NPLASMA] = plasmamain[mpi_i].ip / np_mpi_global;
-    redhelper[mpi_i + 10 * NPLASMA] = plasmamain[mpi_i].j_direct / np_mpi_global;
-    redhelper[mpi_i + 11 * NPLASMA] = plasmamain[mpi_i].j_scatt / np_mpi_global;
-    redhelper[mpi_i + 12 * NPLASMA] = plasmamain[mpi_i].ip_direct / np_mpi_global;
-    redhelper[mpi_i + 13 * NPLASMA] = plasmamain[mpi_i].ip_scatt / np_mpi_global;
-    redhelper[mpi_i + 14 * NPLASMA] = plasmamain[mpi_i].heat_auger / np_mpi_global;
-
-    for (mpi_j = 0; mpi_j < NXBANDS; mpi_j++)
-    {
-      redhelper[mpi_i + (15 + mpi_j) * NPLASMA] = plasmamain[mpi_i].xj[mpi_j] / np_mpi_global;
-      redhelper[mpi_i + (15 + NXBANDS + mpi_j) * NPLASMA] = plasmamain[mpi_i].xave_freq[mpi_j] / np_mpi_global;
-      redhelper[mpi_i + (15 + 2 * NXBANDS + mpi_j) * NPLASMA] = plasmamain[mpi_i].xsd_freq[mpi_j] / np_mpi_global;
-
-      /* 131213 NSH populate the band limited min and max frequency arrays */
-      maxbandfreqhelper[mpi_i * NXBANDS + mpi_j] = plasmamain[mpi_i].fmax[mpi_j];
-      minbandfreqhelper[mpi_i * NXBANDS + mpi_j] = plasmamain[mpi_i].fmin[mpi_j];
-
-    }
+    x = &redhelper[mpi_i * nred];
+    memcpy (x, &estmain[mpi_i].j, nsum * sizeof (double));
+    x[nsum] = plasmamain[mpi_i].heat_tot;
+    x[nsum + 1] = plasmamain[mpi_i].heat_lines;
+    x[nsum + 2] = plasmamain[mpi_i].heat_ff;
+    x[nsum + 3] = plasmamain[mpi_i].heat_comp;
+    x[nsum + 4] = plasmamain[mpi_i].heat_ind_comp;
+    x[nsum + 5] = plasmamain[mpi_i].heat_photo;
+    x[nsum + 6] = plasmamain[mpi_i].heat_auger;
+    for (mpi_j = 0; mpi_j < nred; mpi_j++)
+      x[mpi_j] /= np_mpi_global;
+
+    memcpy (&maxhelper[mpi_i * nmax], &estmain[mpi_i].max_freq, nmax * sizeof (double));
+    memcpy (&minhelper[mpi_i * nmin], estmain[mpi_i].fmin, nmin * sizeof (double));
   }
 
   for (mpi_i = 0; mpi_i < NRINGS; mpi_i++)
@@ -116,11 +103,9 @@ communicate_estimators_para ()
 
   /* 131213 NSH communiate the min and max band frequencies these use MPI_MIN or MPI_MAX */
   MPI_Barrier (MPI_COMM_WORLD);
-  MPI_Reduce (minbandfreqhelper, minbandfreqhelper2, NPLASMA * NXBANDS, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
-  MPI_Reduce (maxbandfreqhelper, maxbandfreqhelper2, NPLASMA * NXBANDS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-  MPI_Reduce (maxfreqhelper, maxfreqhelper2, NPLASMA, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
-  MPI_Reduce (redhelper, redhelper2, plasma_double_helpers, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-  MPI_Reduce (redhelper, redhelper2, plasma_double_helpers, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce (minhelper, minhelper2, NPLASMA * nmin, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce (maxhelper, maxhelper2, NPLASMA * nmax, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce (redhelper, redhelper2, NPLASMA * nred, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
   /* JM 1607 -- seum up the qdisk values */
   MPI_Reduce (qdisk_helper, qdisk_helper2, 2 * NRINGS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -132,11 +117,10 @@ communicate_estimators_para ()
   }
 
   MPI_Barrier (MPI_COMM_WORLD);
-  MPI_Bcast (redhelper2, plasma_double_helpers, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Bcast (maxfreqhelper2, NPLASMA, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast (redhelper2, NPLASMA * nred, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   /* 131213 NSH Send out the global min and max band limited frequencies to all threads */
-  MPI_Bcast (minbandfreqhelper2, NPLASMA * NXBANDS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-  MPI_Bcast (maxbandfreqhelper2, NPLASMA * NXBANDS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast (minhelper2, NPLASMA * nmin, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast (maxhelper2, NPLASMA * nmax, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
   /* JM 1607 -- send out the qdisk values to all threads */
   MPI_Bcast (qdisk_helper2, NRINGS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
@@ -144,33 +128,18 @@ communicate_estimators_para ()
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
-    plasmamain[mpi_i].max_freq = maxfreqhelper2[mpi_i];
-    plasmamain[mpi_i].j = redhelper2[mpi_i];
-    plasmamain[mpi_i].ave_freq = redhelper2[mpi_i + NPLASMA];
-    plasmamain[mpi_i].lum = redhelper2[mpi_i + 2 * NPLASMA];
-    plasmamain[mpi_i].heat_tot = redhelper2[mpi_i + 3 * NPLASMA];
-    plasmamain[mpi_i].heat_lines = redhelper2[mpi_i + 4 * NPLASMA];
-    plasmamain[mpi_i].heat_ff = redhelper2[mpi_i + 5 * NPLASMA];
-    plasmamain[mpi_i].heat_comp = redhelper2[mpi_i + 6 * NPLASMA];
-    plasmamain[mpi_i].heat_ind_comp = redhelper2[mpi_i + 7 * NPLASMA];
-    plasmamain[mpi_i].heat_photo = redhelper2[mpi_i + 8 * NPLASMA];
-    plasmamain[mpi_i].ip = redhelper2[mpi_i + 9 * NPLASMA];
-    plasmamain[mpi_i].j_direct = redhelper2[mpi_i + 10 * NPLASMA];
-    plasmamain[mpi_i].j_scatt = redhelper2[mpi_i + 11 * NPLASMA];
-    plasmamain[mpi_i].ip_direct = redhelper2[mpi_i + 12 * NPLASMA];
-    plasmamain[mpi_i].ip_scatt = redhelper2[mpi_i + 13 * NPLASMA];
-    plasmamain[mpi_i].heat_auger = redhelper2[mpi_i + 14 * NPLASMA];
-
-    for (mpi_j = 0; mpi_j < NXBANDS; mpi_j++)
-    {
-      plasmamain[mpi_i].xj[mpi_j] = redhelper2[mpi_i + (15 + mpi_j) * NPLASMA];
-      plasmamain[mpi_i].xave_freq[mpi_j] = redhelper2[mpi_i + (15 + NXBANDS + mpi_j) * NPLASMA];
-      plasmamain[mpi_i].xsd_freq[mpi_j] = redhelper2[mpi_i + (15 + NXBANDS * 2 + mpi_j) * NPLASMA];
-
-      /* 131213 NSH And unpack the min and max banded frequencies to the plasma array */
-      plasmamain[mpi_i].fmax[mpi_j] = maxbandfreqhelper2[mpi_i * NXBANDS + mpi_j];
-      plasmamain[mpi_i].fmin[mpi_j] = minbandfreqhelper2[mpi_i * NXBANDS + mpi_j];
-    }
+    x = &redhelper2[mpi_i * nred];
+    memcpy (&estmain[mpi_i].j, x, nsum * sizeof (double));
+    plasmamain[mpi_i].heat_tot = x[nsum];
+    plasmamain[mpi_i].heat_lines = x[nsum + 1];
+    plasmamain[mpi_i].heat_ff = x[nsum + 2];
+    plasmamain[mpi_i].heat_comp = x[nsum + 3];
+    plasmamain[mpi_i].heat_ind_comp = x[nsum + 4];
+    plasmamain[mpi_i].heat_photo = x[nsum + 5];
+    plasmamain[mpi_i].heat_auger = x[nsum + 6];
+
+    memcpy (&estmain[mpi_i].max_freq, &maxhelper2[mpi_i * nmax], nmax * sizeof (double));
+    memcpy (estmain[mpi_i].fmin, &minhelper2[mpi_i * nmin], nmin * sizeof (double));
   }
 
   for (mpi_i = 0; mpi_i < NRINGS; mpi_i++)
@@ -185,34 +154,21 @@ communicate_estimators_para ()
   free (qdisk_helper2);
   free (redhelper);
   free (redhelper2);
-  free (maxfreqhelper);
-  free (maxfreqhelper2);
-  free (maxbandfreqhelper);
-  free (maxbandfreqhelper2);
-  free (minbandfreqhelper);
-  free (minbandfreqhelper2);
+  free (maxhelper);
+  free (maxhelper2);
+  free (minhelper);
+  free (minhelper2);
 
   /* allocate the integer helper arrays, set a barrier, then do all the integers. */
   iqdisk_helper = calloc (sizeof (int), NRINGS * 2);
   iqdisk_helper2 = calloc (sizeof (int), NRINGS * 2);
-  iredhelper = calloc (sizeof (int), plasma_int_helpers);
-  iredhelper2 = calloc (sizeof (int), plasma_int_helpers);
+  iredhelper = calloc (sizeof (int), NPLASMA * nint);
+  iredhelper2 = calloc (sizeof (int), NPLASMA * nint);
   MPI_Barrier (MPI_COMM_WORLD);
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
-    iredhelper[mpi_i] = plasmamain[mpi_i].ntot;
-    iredhelper[mpi_i + NPLASMA] = plasmamain[mpi_i].ntot_star;
-    iredhelper[mpi_i + 2 * NPLASMA] = plasmamain[mpi_i].ntot_bl;
-    iredhelper[mpi_i + 3 * NPLASMA] = plasmamain[mpi_i].ntot_disk;
-    iredhelper[mpi_i + 4 * NPLASMA] = plasmamain[mpi_i].ntot_wind;
-    iredhelper[mpi_i + 5 * NPLASMA] = plasmamain[mpi_i].ntot_agn;
-    iredhelper[mpi_i + 6 * NPLASMA] = plasmamain[mpi_i].nioniz;
-
-    for (mpi_j = 0; mpi_j < NXBANDS; mpi_j++)
-    {
-      iredhelper[mpi_i + (7 + mpi_j) * NPLASMA] = plasmamain[mpi_i].nxtot[mpi_j];
-    }
+    memcpy (&iredhelper[mpi_i * nint], &estmain[mpi_i].ntot, nint * sizeof (int));
   }
 
   for (mpi_i = 0; mpi_i < NRINGS; mpi_i++)
@@ -222,7 +178,7 @@ communicate_estimators_para ()
   }
 
   MPI_Barrier (MPI_COMM_WORLD);
-  MPI_Reduce (iredhelper, iredhelper2, plasma_int_helpers, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce (iredhelper, iredhelper2, NPLASMA * nint, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
   MPI_Reduce (iqdisk_helper, iqdisk_helper2, 2 * NRINGS, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
 
   if (rank_global == 0)
@@ -231,24 +187,13 @@ communicate_estimators_para ()
   }
 
   MPI_Barrier (MPI_COMM_WORLD);
-  MPI_Bcast (iredhelper2, plasma_int_helpers, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast (iredhelper2, NPLASMA * nint, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast (iqdisk_helper2, NRINGS, MPI_INT, 0, MPI_COMM_WORLD);
 
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
-    plasmamain[mpi_i].ntot = iredhelper2[mpi_i];
-    plasmamain[mpi_i].ntot_star = iredhelper2[mpi_i + NPLASMA];
-    plasmamain[mpi_i].ntot_bl = iredhelper2[mpi_i + 2 * NPLASMA];
-    plasmamain[mpi_i].ntot_disk = iredhelper2[mpi_i + 3 * NPLASMA];
-    plasmamain[mpi_i].ntot_wind = iredhelper2[mpi_i + 4 * NPLASMA];
-    plasmamain[mpi_i].ntot_agn = iredhelper2[mpi_i + 5 * NPLASMA];
-    plasmamain[mpi_i].nioniz = iredhelper2[mpi_i + 6 * NPLASMA];
-
-    for (mpi_j = 0; mpi_j < NXBANDS; mpi_j++)
-    {
-      plasmamain[mpi_i].nxtot[mpi_j] = iredhelper2[mpi_i + (7 + mpi_j) * NPLASMA];
-    }
+    memcpy (&estmain[mpi_i].ntot, &iredhelper2[mpi_i * nint], nint * sizeof (int));
   }
 
   for (mpi_i = 0; mpi_i < NRINGS; mpi_i++)
@@ -273,9 +218,6 @@ communicate_estimators_para ()
 Synopsis: gather_spectra_para
 
 Arguments:	
-  int nspec_helper
-    size of the helper arrays used by the MPI_Reduce and Broadcast routines
-
   int nspecs
     the number of spectra computed. This is longer for the spectral cycles than
     the ionization cycles 	
@@ -283,57 +225,45 @@ Arguments:
 Returns:
  
 Description:	
+  Averages the first nspecs spectra between the tasks, so that every
+  task ends up with the same spectra.
 	
 Notes:
+  The bins of the spectra are one contiguous block, see 
+  spectrum_bins_allocate, so they are reduced in place with
+  a single MPI_Allreduce.
 
 History:
     JM Coded as part of fix to #132
+    1703	The linear, log and wind spectra are all reduced, where
+		before the wind spectra, and the log spectra in the spectral
+		cycles, were left as they were on each task.  The size 
+		of the reduction now follows the number of bins in the 
+		spectra, so nspec_helper has gone.
 
 **************************************************************/
 
 
 int
-gather_spectra_para (nspec_helper, nspecs)
-     int nspec_helper;
+gather_spectra_para (nspecs)
      int nspecs;
 {
 #ifdef MPI_ON                   // these routines should only be called anyway in parallel but we need these to compile
 
-  double *redhelper, *redhelper2;
-  int mpi_i, mpi_j;
+  double *bins;
+  int n, nbins;
 
-  redhelper = calloc (sizeof (double), nspec_helper);
-  redhelper2 = calloc (sizeof (double), nspec_helper);
+  nbins = 0;
+  for (n = 0; n < nspecs; n++)
+    nbins += 4 * xxspec[n].nwave;
 
+  /* Divide by the number of tasks first, so that the sum gives the mean across the tasks */
+  bins = xxspec[0].f;
+  for (n = 0; n < nbins; n++)
+    bins[n] /= np_mpi_global;
 
-  for (mpi_i = 0; mpi_i < NWAVE; mpi_i++)
-  {
-    for (mpi_j = 0; mpi_j < nspecs; mpi_j++)
-    {
-      redhelper[mpi_i * nspecs + mpi_j] = xxspec[mpi_j].f[mpi_i] / np_mpi_global;
-
-      if (geo.ioniz_or_extract) // this is True in ionization cycles only, when we also have a log_spec_tot file
-        redhelper[mpi_i * nspecs + mpi_j + (NWAVE * nspecs)] = xxspec[mpi_j].lf[mpi_i] / np_mpi_global;
-    }
-  }
-
-  MPI_Reduce (redhelper, redhelper2, nspec_helper, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-  MPI_Bcast (redhelper2, nspec_helper, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-
-  for (mpi_i = 0; mpi_i < NWAVE; mpi_i++)
-  {
-    for (mpi_j = 0; mpi_j < nspecs; mpi_j++)
-    {
-      xxspec[mpi_j].f[mpi_i] = redhelper2[mpi_i * nspecs + mpi_j];
-
-      if (geo.ioniz_or_extract) // this is True in ionization cycles only, when we also have a log_spec_tot file
-        xxspec[mpi_j].lf[mpi_i] = redhelper2[mpi_i * nspecs + mpi_j + (NWAVE * nspecs)];
-    }
-  }
+  MPI_Allreduce (MPI_IN_PLACE, bins, nbins, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
   MPI_Barrier (MPI_COMM_WORLD);
-
-  free (redhelper);
-  free (redhelper2);
 #endif
 
   return (0);
@@ -581,3 +511,119 @@ communicate_matom_estimators_para ()
 
   return (0);
 }
+
+
+
+/***********************************************************
+                        University of Southampton
+
+Synopsis: 
+  communicate_wind_paths_para merges the reverberation path 
+  histograms of the wind cells between tasks.
+
+Arguments:		
+
+Returns:
+ 
+Description:	
+  Each task only sends the bins of its histograms that are
+  occupied, as records of (histogram, bin, counts, fluxes).
+  Every task gathers the records from all the others and 
+  rebuilds its histograms from them, with the fluxes averaged
+  over the tasks and the photon counts summed.
+	
+Notes:
+  The histograms are filled during the ionization cycles and
+  this should be called once, after the last of them and 
+  before wind_paths_evaluate.  Calling it twice would count
+  the other tasks' photons twice.
+
+History:
+    1703	Coded, since the path histograms were previously
+		not combined between tasks at all
+
+
+**************************************************************/
+
+#define NREC_PATH (2 + 2 * NPATH_SOURCE)
+
+int
+communicate_wind_paths_para ()
+{
+#ifdef MPI_ON
+  int i, j, k, n, n_hist, n_rec, n_total;
+  int *n_recs, *n_displs;
+  double *rec_helper, *rec_helper2, *rec;
+  Wind_Paths_Ptr paths;
+  Path_Bin_Ptr bin;
+
+  /* Each cell has the wind histogram followed by one for each tracked line */
+  n_hist = geo.ndim2 * (geo.reverb_lines + 1);
+
+  n_rec = 0;
+  for (i = 0; i < n_hist; i++)
+  {
+    n_rec += wind_paths_hist (i)->n_bins;
+  }
+
+  rec_helper = calloc (sizeof (double), NREC_PATH * n_rec + 1);
+  for (i = 0, n = 0; i < n_hist; i++)
+  {
+    paths = wind_paths_hist (i);
+    for (j = 0; j < paths->n_bins; j++, n++)
+    {
+      bin = &paths->bins[j];
+      rec = &rec_helper[NREC_PATH * n];
+      rec[0] = i;
+      rec[1] = bin->i_bin;
+      for (k = 0; k < NPATH_SOURCE; k++)
+      {
+        rec[2 + k] = bin->i_num[k];
+        rec[2 + NPATH_SOURCE + k] = bin->d_flux[k];
+      }
+    }
+  }
+
+  /* Find out how many records every task has, and where they go */
+  n_recs = calloc (sizeof (int), np_mpi_global);
+  n_displs = calloc (sizeof (int), np_mpi_global);
+  n_rec *= NREC_PATH;
+  MPI_Allgather (&n_rec, 1, MPI_INT, n_recs, 1, MPI_INT, MPI_COMM_WORLD);
+
+  n_total = 0;
+  for (i = 0; i < np_mpi_global; i++)
+  {
+    n_displs[i] = n_total;
+    n_total += n_recs[i];
+  }
+
+  rec_helper2 = calloc (sizeof (double), n_total + 1);
+  MPI_Allgatherv (rec_helper, n_rec, MPI_DOUBLE, rec_helper2, n_recs, n_displs, MPI_DOUBLE, MPI_COMM_WORLD);
+
+  /* Empty the local histograms, keeping their allocations, and refill them from every task */
+  for (i = 0; i < n_hist; i++)
+  {
+    wind_paths_hist (i)->n_bins = 0;
+  }
+
+  for (n = 0; n < n_total; n += NREC_PATH)
+  {
+    rec = &rec_helper2[n];
+    bin = wind_paths_bin (wind_paths_hist ((int) rec[0]), (int) rec[1]);
+    for (k = 0; k < NPATH_SOURCE; k++)
+    {
+      bin->i_num[k] += (int) rec[2 + k];
+      bin->d_flux[k] += rec[2 + NPATH_SOURCE + k] / np_mpi_global;
+    }
+  }
+
+  Log_parallel ("communicate_wind_paths_para: Merged %d occupied path bins from %d tasks\n", n_total / NREC_PATH, np_mpi_global);
+
+  free (rec_helper);
+  free (rec_helper2);
+  free (n_recs);
+  free (n_displs);
+#endif
+
+  return (0);
+}
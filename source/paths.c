@@ -32,11 +32,13 @@ double *reverb_path_bin;
  * @param [in,out] wind		Pointer to parent wind cell
  * @return 					Pointer to onstructed histogram
  *
- * Allocates path bins for a passed wind cell and returns a
- * pointer to the allocated space.
+ * Allocates an empty path histogram for a passed wind cell and 
+ * returns a pointer to the allocated space.
  *
  * @notes
  * 9/3/15	-	Written by SWM
+ * 1703	-	Histograms start empty, the occupied bins are added
+ * 			as photons arrive by wind_paths_bin()
 ***********************************************************/
 Wind_Paths_Ptr
 wind_paths_constructor (WindPtr wind)
@@ -49,20 +51,10 @@ wind_paths_constructor (WindPtr wind)
     exit (0);
   }
 
-  paths->ad_path_flux = (double *) calloc (sizeof (double), geo.reverb_path_bins);
-  paths->ai_path_num = (int *) calloc (sizeof (int), geo.reverb_path_bins);
-  paths->ad_path_flux_cent = (double *) calloc (sizeof (double), geo.reverb_path_bins);
-  paths->ai_path_num_cent = (int *) calloc (sizeof (int), geo.reverb_path_bins);
-  paths->ad_path_flux_disk = (double *) calloc (sizeof (double), geo.reverb_path_bins);
-  paths->ai_path_num_disk = (int *) calloc (sizeof (int), geo.reverb_path_bins);
-  paths->ad_path_flux_wind = (double *) calloc (sizeof (double), geo.reverb_path_bins);
-  paths->ai_path_num_wind = (int *) calloc (sizeof (int), geo.reverb_path_bins);
-
-  if (paths->ad_path_flux == NULL || paths->ai_path_num_wind == NULL)
-  {
-    Error ("wind_paths_constructor: Could not allocate memory for cell %d bins\n", wind->nwind);
-    exit (0);
-  }
+  //Bins are only allocated once a photon lands in them, see wind_paths_bin()
+  paths->bins = NULL;
+  paths->n_bins = 0;
+  paths->n_alloc = 0;
   return (paths);
 }
 
@@ -192,6 +184,166 @@ wind_paths_init (WindPtr wind)
   return (0);
 }
 
+/****************************************************************/
+/** @name		wind_paths_find_bin
+ * @brief		Finds the path bin a given path lies in
+ *
+ * @param [in] path		Path length
+ * @return 				Index of the bin, or -1 if outside all bins
+ *
+ * Bisects the (monotonic) reverb_path_bin boundaries. A path 
+ * lying exactly on a boundary goes in the lower bin, as the
+ * linear search this replaced did.
+ *
+ * @notes
+ * 1703	-	Written to replace the linear searches over the bins
+*****************************************************************/
+int
+wind_paths_find_bin (double path)
+{
+  int i_lo, i_hi, i_mid;
+
+  if (path < reverb_path_bin[0] || path > reverb_path_bin[geo.reverb_path_bins])
+    return (-1);
+
+  i_lo = 0;
+  i_hi = geo.reverb_path_bins;
+  while (i_hi - i_lo > 1)
+  {                             //Keep reverb_path_bin[i_lo] <= path <= reverb_path_bin[i_hi]
+    i_mid = (i_lo + i_hi) / 2;
+    if (reverb_path_bin[i_mid] < path)
+      i_lo = i_mid;
+    else
+      i_hi = i_mid;
+  }
+  return (i_lo);
+}
+
+/****************************************************************/
+/** @name		wind_paths_bin
+ * @brief		Finds, or adds, an occupied bin in a path histogram
+ *
+ * @param [in,out] paths	Path histogram
+ * @param [in] i_bin		Index of the path bin wanted
+ * @return 					Pointer to the bin
+ *
+ * The occupied bins are kept sorted by i_bin, so the bin is
+ * found by bisection. If it is not there yet, an empty bin is
+ * inserted in place, doubling the allocation when it is full.
+ *
+ * @notes
+ * 1703	-	Written so that histograms only hold occupied bins
+*****************************************************************/
+Path_Bin_Ptr
+wind_paths_bin (Wind_Paths_Ptr paths, int i_bin)
+{
+  int i_lo, i_hi, i_mid;
+  Path_Bin_Ptr bin;
+
+  i_lo = 0;
+  i_hi = paths->n_bins;
+  while (i_lo < i_hi)
+  {                             //Find the first occupied bin with an index >= i_bin
+    i_mid = (i_lo + i_hi) / 2;
+    if (paths->bins[i_mid].i_bin < i_bin)
+      i_lo = i_mid + 1;
+    else
+      i_hi = i_mid;
+  }
+
+  if (i_lo < paths->n_bins && paths->bins[i_lo].i_bin == i_bin)
+    return (&paths->bins[i_lo]);
+
+  if (paths->n_bins == paths->n_alloc)
+  {                             //If the histogram is full, grow it
+    paths->n_alloc = (paths->n_alloc > 0) ? 2 * paths->n_alloc : 8;
+    paths->bins = (Path_Bin_Ptr) realloc (paths->bins, paths->n_alloc * sizeof (path_bin_dummy));
+    if (paths->bins == NULL)
+    {
+      Error ("wind_paths_bin: Could not allocate memory for %d path bins\n", paths->n_alloc);
+      exit (0);
+    }
+  }
+
+  //Shuffle the later bins up one and put an empty bin in the gap
+  memmove (&paths->bins[i_lo + 1], &paths->bins[i_lo], (paths->n_bins - i_lo) * sizeof (path_bin_dummy));
+  paths->n_bins++;
+  bin = &paths->bins[i_lo];
+  memset (bin, 0, sizeof (path_bin_dummy));
+  bin->i_bin = i_bin;
+  return (bin);
+}
+
+/****************************************************************/
+/** @name		wind_paths_record
+ * @brief		Adds a photon's weight to a path histogram
+ *
+ * @param [in,out] paths	Path histogram
+ * @param [in] pp			Photon to record
+ * @return 					0
+ *
+ * Photons from the star, agn and boundary layer count as
+ * central, those from the disk as disk, and all others as wind.
+ *
+ * @notes
+ * 1703	-	Split out of wind_paths_add_phot and line_paths_add_phot
+*****************************************************************/
+int
+wind_paths_record (Wind_Paths_Ptr paths, PhotPtr pp)
+{
+  int i_bin, i_source;
+  Path_Bin_Ptr bin;
+
+  if ((i_bin = wind_paths_find_bin (pp->path)) < 0)
+    return (0);
+
+  switch (pp->origin)
+  {
+  case PTYPE_STAR:
+  case PTYPE_AGN:
+  case PTYPE_BL:
+    i_source = PATH_CENT;
+    break;
+  case PTYPE_DISK:
+    i_source = PATH_DISK;
+    break;
+  default:
+    i_source = PATH_WIND;
+    break;
+  }
+
+  bin = wind_paths_bin (paths, i_bin);
+  bin->d_flux[i_source] += pp->w;
+  bin->i_num[i_source]++;
+  return (0);
+}
+
+/****************************************************************/
+/** @name		wind_paths_hist
+ * @brief		Returns a path histogram by its overall index
+ *
+ * @param [in] i_hist	Index of the histogram
+ * @return 				Pointer to the histogram
+ *
+ * Numbers every path histogram in the wind, each cell's wind 
+ * histogram followed by those for the tracked lines, so that 
+ * they can be packed up and sent between MPI tasks.
+ *
+ * @notes
+ * 1703	-	Written for communicate_wind_paths_para()
+*****************************************************************/
+Wind_Paths_Ptr
+wind_paths_hist (int i_hist)
+{
+  int n, j;
+
+  n = i_hist / (geo.reverb_lines + 1);
+  j = i_hist % (geo.reverb_lines + 1);
+  if (j == 0)
+    return (wmain[n].paths);
+  return (wmain[n].line_paths[j - 1]);
+}
+
 /****************************************************************/
 /** @name		line_paths_add_phot
  * @brief		Following a line emission, increments cell paths
@@ -207,11 +359,12 @@ wind_paths_init (WindPtr wind)
  *
  * @notes
  * 27/2/15	-	 Written by SWM
+ * 1703	-	Uses wind_paths_record()
 *****************************************************************/
 int
 line_paths_add_phot (WindPtr wind, PhotPtr pp, int *nres)
 {
-  int i, j;
+  int i;
 
   if (geo.reverb_disk == REV_DISK_IGNORE && pp->origin_orig == PTYPE_DISK)
     return (0);
@@ -222,34 +375,9 @@ line_paths_add_phot (WindPtr wind, PhotPtr pp, int *nres)
   {                             //Iterate over each tracked line
     if (lin_ptr[*nres]->where_in_list == geo.reverb_line[i])
     {                           //If the passed line exists within the tracked line array
-      for (j = 0; j < geo.reverb_path_bins; j++)
-      {                         //Iterate over the path bins
-        if (pp->path >= reverb_path_bin[j] && pp->path <= reverb_path_bin[j + 1])
-        {                       //If the photon's path lies in this bin's bounds, record it
-          //printf("DEBUG: Added to line %d in cell %d - path %g weight %g\n",geo.reverb_line[i], wind->nwind, pp->path, pp->w);
-          wind->line_paths[i]->ad_path_flux[j] += pp->w;
-          wind->line_paths[i]->ai_path_num[j]++;
-          switch (pp->origin)
-          {
-          case PTYPE_STAR:
-          case PTYPE_AGN:
-          case PTYPE_BL:
-            wind->line_paths[i]->ad_path_flux_cent[j] += pp->w;
-            wind->line_paths[i]->ai_path_num_cent[j]++;
-            break;
-          case PTYPE_DISK:
-            wind->line_paths[i]->ad_path_flux_disk[j] += pp->w;
-            wind->line_paths[i]->ai_path_num_disk[j]++;
-            break;
-          default:
-            wind->line_paths[i]->ad_path_flux_wind[j] += pp->w;
-            wind->line_paths[i]->ai_path_num_wind[j]++;
-            break;
-          }
-          //Exit out of this loop
-          return (0);
-        }
-      }
+      //printf("DEBUG: Added to line %d in cell %d - path %g weight %g\n",geo.reverb_line[i], wind->nwind, pp->path, pp->w);
+      wind_paths_record (wind->line_paths[i], pp);
+      return (0);
     }
   }
   return (0);
@@ -268,41 +396,15 @@ line_paths_add_phot (WindPtr wind, PhotPtr pp, int *nres)
  *
  * @notes 
  * 27/2/15 	-	Written by SWM 2/15.
+ * 1703	-	Uses wind_paths_record()
 *****************************************************************/
 int
 wind_paths_add_phot (WindPtr wind, PhotPtr pp)
 {
-  int i;
   if (geo.reverb_disk == REV_DISK_IGNORE && pp->origin_orig == PTYPE_DISK)
     return (0);
 
-  for (i = 0; i < geo.reverb_path_bins; i++)
-  {                             //For each bin
-    if (pp->path >= reverb_path_bin[i] && pp->path <= reverb_path_bin[i + 1])
-    {                           //If the path falls within its bounds, add photon weight
-      wind->paths->ad_path_flux[i] += pp->w;
-      wind->paths->ai_path_num[i]++;
-
-      switch (pp->origin)
-      {
-      case PTYPE_STAR:
-      case PTYPE_AGN:
-      case PTYPE_BL:
-        wind->paths->ad_path_flux_cent[i] += pp->w;
-        wind->paths->ai_path_num_cent[i]++;
-        break;
-      case PTYPE_DISK:
-        wind->paths->ad_path_flux_disk[i] += pp->w;
-        wind->paths->ai_path_num_disk[i]++;
-        break;
-      default:
-        wind->paths->ad_path_flux_wind[i] += pp->w;
-        wind->paths->ai_path_num_wind[i]++;
-        break;
-      }
-      return (0);
-    }
-  }
+  wind_paths_record (wind->paths, pp);
   return (0);
 }
 
@@ -341,26 +443,33 @@ simple_paths_gen_phot (PhotPtr pp)
  * @notes
  * 26/2/15	-	Written by SWM
  * 24/7/15	-	Removed frequency
+ * 1703	-	Walks the occupied bins only. The bin bounds were
+ * 			previously taken one bin too low.
 ***********************************************************/
 double
 r_draw_from_path_histogram (Wind_Paths_Ptr PathPtr)
 {
   double r_rand, r_total, r_bin_min, r_bin_rand, r_path, r_bin_max;
-  int i_path = -1;
+  int i_path, i_bin;
+  Path_Bin_Ptr bin;
 
   r_total = 0.0;
   r_rand = PathPtr->d_flux * rand () / MAXRAND;
   i_path = -1;
 
   //printf("DEBUG: r_rand %g out of total %g\n",r_rand, PathPtr->d_flux);
-  while (r_rand > r_total)
+  while (r_rand > r_total && i_path < PathPtr->n_bins - 1)
   {
-    r_total += PathPtr->ad_path_flux[++i_path];
+    bin = &PathPtr->bins[++i_path];
+    r_total += bin->d_flux[PATH_CENT] + bin->d_flux[PATH_DISK] + bin->d_flux[PATH_WIND];
   }
+  if (i_path < 0)
+    i_path = 0;
 
   //Assign photon path to a random position within the bin.
-  r_bin_min = reverb_path_bin[i_path - 1];
-  r_bin_max = reverb_path_bin[i_path];
+  i_bin = PathPtr->bins[i_path].i_bin;
+  r_bin_min = reverb_path_bin[i_bin];
+  r_bin_max = reverb_path_bin[i_bin + 1];
   r_bin_rand = (rand () / MAXRAND) * (r_bin_max - r_bin_min);
   r_path = r_bin_min + r_bin_rand;
   return (r_path);
@@ -488,20 +597,30 @@ line_paths_gen_phot (WindPtr wind, PhotPtr pp, int nres)
  * @notes
  * 26/2/15	-	Written by SWM
  * 24/7/15	-	Removed frequency
+ * 1703	-	Sums over the occupied bins only
 *****************************************************************/
 int
 wind_paths_evaluate_single (Wind_Paths_Ptr paths)
 {
-  int i;
+  int i, k;
+  double r_flux;
+  Path_Bin_Ptr bin;
+
   paths->d_flux = 0.0;
   paths->d_path = 0.0;
   paths->i_num = 0;
 
-  for (i = 0; i < geo.reverb_path_bins; i++)
-  {                             //For each path bin, add its contribution to total flux & avg path
-    paths->d_flux += paths->ad_path_flux[i];
-    paths->i_num += paths->ai_path_num[i];
-    paths->d_path += paths->ad_path_flux[i] * (reverb_path_bin[i] + reverb_path_bin[i + 1]) / 2.0;
+  for (i = 0; i < paths->n_bins; i++)
+  {                             //For each occupied bin, add its contribution to total flux & avg path
+    bin = &paths->bins[i];
+    r_flux = 0.0;
+    for (k = 0; k < NPATH_SOURCE; k++)
+    {
+      r_flux += bin->d_flux[k];
+      paths->i_num += bin->i_num[k];
+    }
+    paths->d_flux += r_flux;
+    paths->d_path += r_flux * (reverb_path_bin[bin->i_bin] + reverb_path_bin[bin->i_bin + 1]) / 2.0;
   }
 
   //If there was any data in this cell, calculate avg. path
@@ -562,6 +681,44 @@ wind_paths_evaluate (WindPtr wind, int i_rank)
 }
 
 
+/****************************************************************/
+/** @name 	wind_paths_dump_bin
+ * @brief	Writes the fluxes in one path bin of a histogram
+ *
+ * @param [in] fptr			File to write to
+ * @param [in] paths		Path histogram
+ * @param [in] i_bin		Path bin being written
+ * @param [in,out] i_next	Next occupied bin of the histogram
+ * @return 					0
+ *
+ * Writes the total, central, disk and wind flux for path bin 
+ * i_bin, which are all zero if the bin is not occupied. The bins
+ * must be asked for in order, as i_next steps along the occupied
+ * bins with them.
+ *
+ * @notes
+ * 1703	-	Written for the sparse path histograms
+*****************************************************************/
+int
+wind_paths_dump_bin (FILE * fptr, Wind_Paths_Ptr paths, int i_bin, int *i_next)
+{
+  Path_Bin_Ptr bin;
+
+  if (*i_next < paths->n_bins && paths->bins[*i_next].i_bin == i_bin)
+  {
+    bin = &paths->bins[(*i_next)++];
+    fprintf (fptr, ", %g, %g, %g, %g",
+             bin->d_flux[PATH_CENT] + bin->d_flux[PATH_DISK] + bin->d_flux[PATH_WIND],
+             bin->d_flux[PATH_CENT], bin->d_flux[PATH_DISK], bin->d_flux[PATH_WIND]);
+  }
+  else
+  {
+    fprintf (fptr, ", 0, 0, 0, 0");
+  }
+  return (0);
+}
+
+
 /****************************************************************/
 /** @name 	wind_paths_dump
  * @brief	Dumps wind path arrays for a wind cell
@@ -575,6 +732,7 @@ wind_paths_evaluate (WindPtr wind, int i_rank)
  *
  * @notes
  * 10/15	-	Written by SWM
+ * 1703	-	Empty bins are written as zeros from the sparse histograms
 *****************************************************************/
 int
 wind_paths_dump (WindPtr wind, int rank_global)
@@ -582,6 +740,7 @@ wind_paths_dump (WindPtr wind, int rank_global)
   FILE *fopen (), *fptr;
   char c_file[LINELENGTH];
   int j, k;
+  int *i_next;
 
   //Setup file name and open the file
   sprintf (c_file, "%s.wind_paths_%d.%d.csv", files.root, wind->nwind, rank_global);
@@ -600,21 +759,20 @@ wind_paths_dump (WindPtr wind, int rank_global)
   }
   fprintf (fptr, "\n");
 
+  //Each histogram only holds its occupied bins, so walk them in step with the full list
+  i_next = calloc (sizeof (int), geo.reverb_lines + 1);
   for (k = 0; k < geo.reverb_path_bins; k++)
   {                             //For each path bin, print the 'wind' weight 
-    fprintf (fptr, "%g, %g, %g, %g, %g", reverb_path_bin[k],
-             wind->paths->ad_path_flux[k],
-             wind->paths->ad_path_flux_cent[k], wind->paths->ad_path_flux_disk[k], wind->paths->ad_path_flux_wind[k]);
+    fprintf (fptr, "%g", reverb_path_bin[k]);
+    wind_paths_dump_bin (fptr, wind->paths, k, &i_next[0]);
 
     for (j = 0; j < geo.reverb_lines; j++)
     {                           //For each tracked line, print the weight in this bin
-      fprintf (fptr, ", %g, %g, %g, %g",
-               wind->line_paths[j]->ad_path_flux[k],
-               wind->line_paths[j]->ad_path_flux_cent[k],
-               wind->line_paths[j]->ad_path_flux_disk[k], wind->line_paths[j]->ad_path_flux_wind[k]);
+      wind_paths_dump_bin (fptr, wind->line_paths[j], k, &i_next[j + 1]);
     }
     fprintf (fptr, "\n");
   }
+  free (i_next);
   fclose (fptr);
   return (0);
 }
@@ -106,16 +106,22 @@ Description:
 	
 	The result of calling either of these routines will be to populate a structure of
 	the form Pdf
-		pdf->x[]  will contain NPDF values of x between xmin and xmax.  The values will be
+		pdf->x[]  will contain npdf+1 values of x between xmin and xmax.  The values will be
 			spaced so that it is almost but not quite true that if you generate a uniform
-			number n between 0 and NPDF you could just read off the value pdf[n].x and
+			number n between 0 and npdf you could just read off the value pdf[n].x and
 			that by doing this multiple times you could regenerate the distribution function
 		pdf->y[]  will contain values between 0 and 1 and is the integral of the cumulative
 			distribution function from xmin to pdf[].x
 			
 	Once a pdf has been generated, one samples the pdf by calls to pdf_get_rand which 
 	creates a random number between 0 and 1, finds the elements in pdf which surround
-	the random number and interpolates to return a value x. 
+	the random number and interpolates to return a value x.  The elements are found
+	from a guide table, pdf->guide, so the cost of a call does not depend on npdf.
+	pdf_get_rand_n returns many values at once.
+
+	The number of intervals npdf starts at NPDF, and is doubled (up to NPDF_MAX) 
+	until the interpolation within intervals reproduces the CDF of the input function
+	or array to within PDF_MAX_ERR/NPDF.
 	
 	It is possible to force specific values of x to appear in the pdf.  This is desirable
 	if there are edges where the probability density changes rapidly, as for example
@@ -130,19 +136,10 @@ Notes:
 	The fact that these routines start with pdf... is historical and represents a poor
 	choice of nomenclature.  We reallly mean comulative distribution functions
 
-	It would probably be desirable to modify this so that the size of the parallel 
-	arrays being generated could be determined from inside the program.  In that case
-	NPDF would have to become the maximum size.
-
-
 	Error??: For Kurucz models, The probability distribution beyond the He edge  
 	is often very peaked at the long wavelength end and rapidly changing.  In this 
-	instance, some bizarre results can be obtained because NPDF is not enough to 
-	properly populate the pdf.  One could increase NPDF, but this would slow 
-	everything down.  This is an another argument that the whole routine pdf_gen_from_array
-	neeeds to be rewritten to avoid using NPDF altogether.  One way to do this
-	would be simply to use the values of x and y in creating an inital pdf.  There
-	is however a question of resampling.
+	instance, some bizarre results could be obtained when the number of intervals
+	was fixed at NPDF.  This is the reason npdf is now chosen adaptively.  
 	
 
 History:
@@ -180,23 +177,32 @@ History:
 			the number of points that are used in the array pdf_array in situations
 			where the binning is too course.  In the process, eliminated pdf_init.  
 			It was only called by one routine.  
+	1703	The arrays in the pdf structure are now allocated, and the number of
+		intervals is increased from NPDF until the CDF is accurately represented.
+		Added a guide table so that sampling does not require a search, and
+		pdf_get_rand_n to generate many values at once.
  
 **************************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 #include "atomic.h"
 #include "python.h"
 
 /*  The structure is defined in python.h.  Here for reference only */
 //#define NPDF 200
+//#define NPDF_MAX 3200
 
 //typedef struct Pdf {
-//      double x[NPDF+1];
-//      double y[NPDF+1];
-//      double d(NPDF + 1];      
+//      int npdf,nalloc;
+//      double *x;             //npdf+1 values
+//      double *y;
+//      double *d;
+//      int *guide;
 //      double limit1,limit2;
+//      double x1,x2;
 //      double norm;           //The scaling factor which would renormalize the pdf
 //} *PdfPtr,pdf_dummy;
 
@@ -205,6 +211,9 @@ History:
 int pdf_steps_current;          // This is the value of pdfsteps at this point in time
 int init_pdf = 0;
 double *pdf_array;
+int pdf_n_current = 0;          // The number of values for which pdf_get_rand_n has workspace
+int *pdf_iwork;
+double *pdf_work;
 
 /* Generate a pdf structure from a function.  
 
@@ -237,11 +246,12 @@ pdf_gen_from_func (pdf, func, xmin, xmax, njumps, jump)
 {
   double xstep;
   double y;
-  int j, m, mm, n;
+  int j, m, mm, n, npdf;
   int njump_min, njump_max;
   int icheck, pdfsteps;
   int pdf_check (), recalc_pdf_from_cdf ();
   double gen_array_from_func (), delta;
+  double x, err;
 
   njump_min = njump_max = 0;
   /* Check the input data before proceeding */
@@ -307,43 +317,76 @@ pdf_gen_from_func (pdf, func, xmin, xmax, njumps, jump)
 
   xstep = (xmax - xmin) / pdfsteps;
 
-/* So at this point pdf_array contains an unnormalized version of the CDF for the function */
-  pdf->x[0] = xmin;
-  pdf->y[0] = 0;
+/* So at this point pdf_array contains an unnormalized version of the CDF for the function.
 
-  n = 0;                        //This is the position in pdf_array
-  mm = 1;                       //This is the index to a desired value of y, with no jumps
-  j = njump_min;                //This refers to the jumps
-  for (m = 1; m < NPDF; m++)
-  {
-    y = (float) mm / (NPDF - njumps);   // Desired value of y ignoring jumps
+   The CDF is first constructed with NPDF intervals.  If the interpolation within
+   intervals does not reproduce pdf_array to within PDF_MAX_ERR, the number of intervals 
+   is doubled and the CDF is reconstructed, until NPDF_MAX is reached.  There is no
+   point in having more intervals than there are points in pdf_array.
+ */
 
-    while (pdf_array[n] < y && n < pdfsteps)    // Work one's way through pdf_array
+  npdf = NPDF;
+  while (TRUE)
+  {
+    pdf_alloc (pdf, npdf);
+    pdf->x[0] = xmin;
+    pdf->y[0] = 0;
+
+    n = 0;                      //This is the position in pdf_array
+    mm = 1;                     //This is the index to a desired value of y, with no jumps
+    j = njump_min;              //This refers to the jumps
+    for (m = 1; m < npdf; m++)
     {
-      if (j < njump_max && jump[j] <= xmin + (n + 1) * xstep)
+      y = (float) mm / (npdf - njumps); // Desired value of y ignoring jumps
+
+      while (pdf_array[n] < y && n < pdfsteps)  // Work one's way through pdf_array
       {
-        pdf->x[m] = xmin + (n + 1) * xstep;     //Not exactly jump but close
-        pdf->y[m] = pdf_array[n];
-        j++;                    //increment the jump number
-        m++;                    //increment the pdf structure number
+        if (j < njump_max && jump[j] <= xmin + (n + 1) * xstep)
+        {
+          pdf->x[m] = xmin + (n + 1) * xstep;   //Not exactly jump but close
+          pdf->y[m] = pdf_array[n];
+          j++;                  //increment the jump number
+          m++;                  //increment the pdf structure number
+        }
+        n++;
       }
-      n++;
+
+      /* So at this point pdf_array[n-1] < x and pdf_array[n]>x */
+      pdf->x[m] = xmin + (n + 1) * xstep;
+      pdf->y[m] = pdf_array[n];
+      mm++;                     // increment the number associated with the desired y ignoring jumps
+      /* So pdf->y will contain numbers from 0 to 1 */
+    }
+
+    pdf->x[npdf] = xmax;
+    pdf->y[npdf] = 1.0;
+
+    /* Calculate the gradients */
+    recalc_pdf_from_cdf (pdf);  // 57ib 
+
+    if (npdf >= NPDF_MAX || 4 * npdf > pdfsteps)
+      break;
+
+    /* Find the largest difference between pdf_array and the interpolated CDF */
+    err = 0;
+    m = 0;
+    for (n = 0; n < pdfsteps; n++)
+    {
+      x = xmin + (n + 1) * xstep;
+      while (m < npdf - 1 && pdf->x[m + 1] < x)
+        m++;
+      if ((delta = fabs (pdf_array[n] - pdf_model_cdf (pdf, m, x))) > err)
+        err = delta;
     }
 
-    /* So at this point pdf_array[n-1] < x and pdf_array[n]>x */
-    pdf->x[m] = xmin + (n + 1) * xstep;
-    pdf->y[m] = pdf_array[n];
-    mm++;                       // increment the number associated with the desired y ignoring jumps
-    /* So pdf->y will contain numbers from 0 to 1 */
+    if (err * NPDF < PDF_MAX_ERR)
+      break;
+    npdf *= 2;
   }
 
-  pdf->x[NPDF] = xmax;
-  pdf->y[NPDF] = 1.0;
   pdf->norm = 1.;               /* pdf_gen_from array produces a properly nomalized cdf and so the
                                    normalization is 1.  110629 ksl */
 
-/* Calculate the gradients */
-  recalc_pdf_from_cdf (pdf);    // 57ib 
   /* Check the pdf */
   if ((icheck = pdf_check (pdf)) != 0)
   {
@@ -535,8 +578,8 @@ pdf_gen_from_array (pdf, x, y, n_xy, xmin, xmax, njumps, jump)
      double jump[];
 {
   int allzero;
-  int m, n, nn, j;
-  double sum, q, xx, yy;
+  int m, n, nn, j, npdf;
+  double sum, q, xx, yy, err;
   int njump_min, njump_max;
   double ysum;
   int echeck, pdf_check (), recalc_pdf_from_cdf ();
@@ -602,7 +645,7 @@ pdf_gen_from_array (pdf, x, y, n_xy, xmin, xmax, njumps, jump)
     pdf_x[0] = xmin;
     pdf_z[0] = 0.;
     pdf_x[1] = xmax;
-    pdf_z[0] = 1.;
+    pdf_z[1] = 1.;
     sum = 1.0;
     pdf_n = 2;
     Error ("pdf_gen_from_array: all y's were zero or xmin xmax out of range of array x-- returning uniform distribution %d\n", allzero);
@@ -684,57 +727,85 @@ pdf_gen_from_array (pdf, x, y, n_xy, xmin, xmax, njumps, jump)
 
 
 
-  pdf->x[0] = xmin;
-  pdf->y[0] = 0;
+  /* As in pdf_gen_from_func, the number of intervals is doubled from NPDF until the CDF
+     reproduces pdf_z to within PDF_MAX_ERR or NPDF_MAX is reached */
 
-  j = njump_min;
-  m = 0;
-  nn = 1;
-  for (n = 1; n < NPDF; n++)
+  npdf = NPDF;
+  while (TRUE)
   {
-    ysum = ((double) nn) / (NPDF - njumps);     /* This is the target with no jumps */
+    pdf_alloc (pdf, npdf);
+    pdf->x[0] = xmin;
+    pdf->y[0] = 0;
 
-    while (pdf_z[m] < ysum)
+    j = njump_min;
+    m = 0;
+    nn = 1;
+    for (n = 1; n < npdf; n++)
     {
-      while (j < njump_max && jump[j] <= pdf_x[m])
+      ysum = ((double) nn) / (npdf - njumps);   /* This is the target with no jumps */
+
+      while (pdf_z[m] < ysum)
       {
-        pdf->x[n] = jump[j];
-        q = (jump[j] - pdf_x[m - 1]) / (pdf_x[m] - pdf_x[m - 1]);
-        pdf->y[n] = q * pdf_z[m] + (1. - q) * pdf_z[m - 1];
+        while (j < njump_max && jump[j] <= pdf_x[m])
+        {
+          pdf->x[n] = jump[j];
+          q = (jump[j] - pdf_x[m - 1]) / (pdf_x[m] - pdf_x[m - 1]);
+          pdf->y[n] = q * pdf_z[m] + (1. - q) * pdf_z[m - 1];
 /* Note that pdf_gen_from_array only produces a term close to the desired break */
-        j++;                    // increment the jump number
-
-        if (pdf->x[n] < pdf->x[n - 1])
-        {                       // Then we need to shuffle the pdf
-          xx = pdf->x[n - 1];
-          yy = pdf->y[n - 1];
-          pdf->y[n - 1] = pdf->y[n];
-          pdf->x[n - 1] = pdf->x[n];
-          pdf->x[n] = xx;
-          pdf->y[n] = yy;
+          j++;                  // increment the jump number
+
+          if (pdf->x[n] < pdf->x[n - 1])
+          {                     // Then we need to shuffle the pdf
+            xx = pdf->x[n - 1];
+            yy = pdf->y[n - 1];
+            pdf->y[n - 1] = pdf->y[n];
+            pdf->x[n - 1] = pdf->x[n];
+            pdf->x[n] = xx;
+            pdf->y[n] = yy;
+          }
+
+          n++;                  // now increment n
         }
 
-        n++;                    // now increment n
+        m++;                    //increment m if necessary
+
       }
 
-      m++;                      //increment m if necessary
+      q = (ysum - pdf_z[m - 1]) / (pdf_z[m] - pdf_z[m - 1]);
+      pdf->x[n] = q * pdf_x[m] + (1. - q) * pdf_x[m - 1];
+      pdf->y[n] = ysum;
+
 
+      nn++;
     }
 
-    q = (ysum - pdf_z[m - 1]) / (pdf_z[m] - pdf_z[m - 1]);
-    pdf->x[n] = q * pdf_x[m] + (1. - q) * pdf_x[m - 1];
-    pdf->y[n] = ysum;
+    pdf->x[npdf] = xmax;
+    pdf->y[npdf] = 1.0;
 
+    /* Calculate the gradients */
+    recalc_pdf_from_cdf (pdf);  // 57ib 
 
-    nn++;
+    if (npdf >= NPDF_MAX)
+      break;
+
+    /* Find the largest difference between pdf_z and the interpolated CDF */
+    err = 0;
+    m = 0;
+    for (n = 1; n < pdf_n - 1; n++)
+    {
+      while (m < npdf - 1 && pdf->x[m + 1] < pdf_x[n])
+        m++;
+      if ((q = fabs (pdf_z[n] - pdf_model_cdf (pdf, m, pdf_x[n]))) > err)
+        err = q;
+    }
+
+    if (err * NPDF < PDF_MAX_ERR)
+      break;
+    npdf *= 2;
   }
 
-  pdf->x[NPDF] = xmax;
-  pdf->y[NPDF] = 1.0;
   pdf->norm = sum;              /* The normalizing factor that would convert the function we
                                    have been given into a proper probability density function */
-/* Calculate the gradients */
-  recalc_pdf_from_cdf (pdf);    // 57ib 
 
   if ((echeck = pdf_check (pdf)) != 0)
   {
@@ -749,14 +820,18 @@ pdf_gen_from_array (pdf, x, y, n_xy, xmin, xmax, njumps, jump)
 pdf_get_rand
 
 
-Our searching routine assumes we can predict roughly where in the
-structure the right values will be 
+The interval containing the random number is found from the guide table,
+which gives the interval containing y=k/npdf, so on average less than one
+further step is needed.  The position within the interval is then found
+by inverting the CDF, which is quadratic in the interval 
 
 History:
 
 	06sep	ksl	57i -- Modified to account for the fact
 			that the probability density is not 
 			uniform between intervals.
+	1703	Find the interval from the guide table, and solve
+		the quadratic in closed form rather than calling xquadratic
 */
 
 double
@@ -764,51 +839,328 @@ pdf_get_rand (pdf)
      PdfPtr pdf;
 {
   double x, r;
-  int i, j;
+  int i;
   double q;
-  double a, b, c, s[2];
-  int xquadratic ();
 
 
 /* Find the interval within which x lies */
   r = rand () / MAXRAND;        /* r must be slightly less than 1 */
-  i = r * NPDF;                 /* so i initially lies between 0 and NPDF-1 */
+  i = pdf->guide[(int) (r * pdf->npdf)];
 
-  while (pdf->y[i + 1] < r && i < NPDF - 1)
+  while (pdf->y[i + 1] < r && i < pdf->npdf - 1)
     i++;
-  while (pdf->y[i] > r && i > 0)
-    i--;
 
 /* Now calculate a place within that interval */
 
-  q = rand () / MAXRAND;
+  q = pdf_interval_q (pdf, i, rand () / MAXRAND);
+
+  x = pdf->x[i] * (1. - q) + pdf->x[i + 1] * q;
 
-  a = 0.5 * (pdf->d[i + 1] - pdf->d[i]);
-  b = pdf->d[i];
-  c = (-0.5) * (pdf->d[i + 1] + pdf->d[i]) * q;
 
-  if ((j = xquadratic (a, b, c, s)) < 0)
+  if (!(pdf->x[0] <= x && x <= pdf->x[pdf->npdf]))
   {
-    Error ("pdf_get_rand: %d\n", j);
+    Error ("pdf_get_rand: %g %d %g %g\n", r, i, q, x);
   }
+  return (x);
+
+}
+
+
+
+/* 
+pdf_get_x
+
+Return the value of x at which the cdf equals r.  This is pdf_get_rand for 
+a given random number, except that the position within the interval 
+is also derived from r, so that a single (e.g. quasi-random) number 
+determines x.
+
+History:
+
+	1703	Coded for quasi-random launching of photons, see launch_rand
+*/
+
+double
+pdf_get_x (pdf, r)
+     PdfPtr pdf;
+     double r;
+{
+  int i;
+  double u, q;
+
+  if (r < 0)
+    r = 0;
+  else if (r >= 1)
+    r = 1. - 1.e-15;
+
+  i = pdf->guide[(int) (r * pdf->npdf)];
+  while (pdf->y[i + 1] < r && i < pdf->npdf - 1)
+    i++;
+
+  if (pdf->y[i + 1] > pdf->y[i])
+    u = (r - pdf->y[i]) / (pdf->y[i + 1] - pdf->y[i]);
   else
+    u = 0.5;
+
+  q = pdf_interval_q (pdf, i, u);
+
+  return (pdf->x[i] * (1. - q) + pdf->x[i + 1] * q);
+}
+
+
+
+/* 
+pdf_get_rand_n
+
+Fill the array x with n values sampled from the pdf.  This is equivalent to 
+n calls of pdf_get_rand, but the random numbers are drawn first, and the
+intervals then found, so that the final loop, which does the arithmetic, 
+has no dependencies between iterations and can be vectorized by the compiler.
+
+History:
+
+	1703	Coded
+*/
+
+int
+pdf_get_rand_n (pdf, n, x)
+     PdfPtr pdf;
+     int n;
+     double x[];
+{
+  int i, k;
+  double r, u, q, a, b, c;
+  double *x0, *x1, *d0, *d1;
+
+  if (n > pdf_n_current)
   {
-    q = s[j];
-    if (q < 0 || q > 1)
+    free (pdf_iwork);
+    free (pdf_work);
+    if ((pdf_iwork = calloc (sizeof (int), n)) == NULL || (pdf_work = calloc (sizeof (double), n)) == NULL)
     {
-      Error ("pdf_get_rand: q out of range %d  %f\n", j, q);
+      Error ("pdf_get_rand_n: Could not allocate space for %d values\n", n);
+      exit (0);
     }
+    pdf_n_current = n;
   }
 
-  x = pdf->x[i] * (1. - q) + pdf->x[i + 1] * q;
+  /* Draw the random numbers and find the intervals */
+  for (k = 0; k < n; k++)
+  {
+    r = rand () / MAXRAND;
+    i = pdf->guide[(int) (r * pdf->npdf)];
+    while (pdf->y[i + 1] < r && i < pdf->npdf - 1)
+      i++;
+    pdf_iwork[k] = i;
+    pdf_work[k] = rand () / MAXRAND;
+  }
 
+  /* Now invert the CDF within each interval, as in pdf_interval_q */
+  x0 = pdf->x;
+  x1 = pdf->x + 1;
+  d0 = pdf->d;
+  d1 = pdf->d + 1;
+  for (k = 0; k < n; k++)
+  {
+    i = pdf_iwork[k];
+    u = pdf_work[k];
+    a = 0.5 * (d1[i] - d0[i]);
+    b = d0[i];
+    c = 0.5 * (d1[i] + d0[i]) * u;
+    q = b + sqrt (fmax (b * b + 4. * a * c, 0.));
+    q = (q > 0) ? 2. * c / q : u;
+    q = fmin (fmax (q, 0.), 1.);
+    x[k] = x0[i] * (1. - q) + x1[i] * q;
+  }
 
-  if (!(pdf->x[0] <= x && x <= pdf->x[NPDF]))
+  return (n);
+}
+
+
+
+/* 
+pdf_interval_q
+
+Return the fractional position q within interval i of a pdf which 
+corresponds to a fraction u of the probability in that interval.  The 
+probability density is taken to vary linearly within the interval, so 
+this is the root in [0,1] of a q**2 + b q + c = 0.  It is written as
+2c/(-b -sqrt(b**2-4ac)) which is correct for both signs of a and does not
+lose precision when a is small.  If the density is zero at both ends,
+the distribution is taken to be uniform.
+
+History:
+
+	1703	Coded to replace the calls to xquadratic in pdf_get_rand 
+		and pdf_get_rand_limit
+*/
+
+double
+pdf_interval_q (pdf, i, u)
+     PdfPtr pdf;
+     int i;
+     double u;
+{
+  double a, b, c, q;
+
+  a = 0.5 * (pdf->d[i + 1] - pdf->d[i]);
+  b = pdf->d[i];
+  c = 0.5 * (pdf->d[i + 1] + pdf->d[i]) * u;
+
+  if ((q = b + sqrt (fmax (b * b + 4. * a * c, 0.))) > 0)
+    q = 2. * c / q;
+  else
+    q = u;
+
+  if (q < 0)
+    q = 0;
+  else if (q > 1)
+    q = 1;
+
+  return (q);
+}
+
+
+
+/* 
+pdf_model_cdf
+
+Return the value of the CDF at x, which is assumed to lie in interval i, 
+as it is implied by the linear variation of the probability density 
+within the interval that pdf_get_rand assumes.  This is used to decide 
+whether a pdf has enough intervals.
+
+History:
+
+	1703	Coded
+*/
+
+double
+pdf_model_cdf (pdf, i, x)
+     PdfPtr pdf;
+     int i;
+     double x;
+{
+  double q, d0, d1, f;
+
+  if (pdf->x[i + 1] <= pdf->x[i])
+    return (pdf->y[i + 1]);
+
+  q = (x - pdf->x[i]) / (pdf->x[i + 1] - pdf->x[i]);
+  if (q < 0)
+    q = 0;
+  else if (q > 1)
+    q = 1;
+
+  d0 = pdf->d[i];
+  d1 = pdf->d[i + 1];
+  if (d0 + d1 > 0)
+    f = (d0 * q + 0.5 * (d1 - d0) * q * q) / (0.5 * (d0 + d1));
+  else
+    f = q;
+
+  return (pdf->y[i] + (pdf->y[i + 1] - pdf->y[i]) * f);
+}
+
+
+
+/* 
+pdf_alloc
+
+Make sure the arrays in a pdf can hold npdf intervals, and set the
+number of intervals to npdf.  The arrays are only reallocated if they
+are too small.  Pdfs which are declared statically or calloc'd start 
+with no arrays allocated.
+
+History:
+
+	1703	Coded when the size of a pdf became adjustable
+*/
+
+int
+pdf_alloc (pdf, npdf)
+     PdfPtr pdf;
+     int npdf;
+{
+  if (pdf->nalloc < npdf + 1)
   {
-    Error ("pdf_get_rand: %g %d %g %g\n", r, i, q, x);
+    free (pdf->x);
+    free (pdf->y);
+    free (pdf->d);
+    free (pdf->guide);
+    pdf->x = calloc (sizeof (double), npdf + 1);
+    pdf->y = calloc (sizeof (double), npdf + 1);
+    pdf->d = calloc (sizeof (double), npdf + 1);
+    pdf->guide = calloc (sizeof (int), npdf + 1);
+    if (pdf->x == NULL || pdf->y == NULL || pdf->d == NULL || pdf->guide == NULL)
+    {
+      Error ("pdf_alloc: Could not allocate space for %d intervals\n", npdf);
+      exit (0);
+    }
+    pdf->nalloc = npdf + 1;
+  }
+  pdf->npdf = npdf;
+  return (0);
+}
+
+
+
+/* 
+pdf_free
+
+Free the arrays of a pdf which is no longer needed, leaving a pdf with
+no intervals which pdf_alloc can reuse
+
+History:
+
+	1703	Coded
+*/
+
+int
+pdf_free (pdf)
+     PdfPtr pdf;
+{
+  free (pdf->x);
+  free (pdf->y);
+  free (pdf->d);
+  free (pdf->guide);
+  pdf->x = pdf->y = pdf->d = NULL;
+  pdf->guide = NULL;
+  pdf->nalloc = pdf->npdf = 0;
+  return (0);
+}
+
+
+
+/* 
+pdf_make_guide
+
+Construct the guide table for a pdf.  guide[k] is the largest i for which 
+y[i] <= k/npdf, so that the interval containing a random number r is 
+guide[(int) (r*npdf)] or one of the intervals just above it.
+
+History:
+
+	1703	Coded
+*/
+
+int
+pdf_make_guide (pdf)
+     PdfPtr pdf;
+{
+  int i, k;
+  double t;
+
+  i = 0;
+  for (k = 0; k <= pdf->npdf; k++)
+  {
+    t = (double) k / pdf->npdf;
+    while (i < pdf->npdf - 1 && pdf->y[i + 1] <= t)
+      i++;
+    pdf->guide[k] = i;
   }
-  return (x);
 
+  return (0);
 }
 
 
@@ -836,14 +1188,14 @@ pdf_limit (pdf, xmin, xmax)
 {
   int i;
   double q;
-  if (pdf->y[NPDF] != 1.0)
+  if (pdf->y == NULL || pdf->y[pdf->npdf] != 1.0)
   {
     Error ("pdf_limit: pdf not defined!)");
     exit (0);
   }
-  if (xmin >= pdf->x[NPDF])
+  if (xmin >= pdf->x[pdf->npdf])
   {
-    Error ("pdf_limit: xmin %g > pdf->x[NPDF] %g\n", xmin, pdf->x[NPDF]);
+    Error ("pdf_limit: xmin %g > pdf->x[npdf] %g\n", xmin, pdf->x[pdf->npdf]);
 //      exit (0);
   }
   if (xmax <= pdf->x[0])
@@ -873,15 +1225,15 @@ pdf_limit (pdf, xmin, xmax)
 
 /* Now set the limits for the maximum */
 
-  if (xmax >= pdf->x[NPDF])
+  if (xmax >= pdf->x[pdf->npdf])
   {
     pdf->limit2 = 1.0;
-    pdf->x2 = pdf->x[NPDF];
+    pdf->x2 = pdf->x[pdf->npdf];
   }
   else
   {
     pdf->x2 = xmax;
-    i = NPDF;
+    i = pdf->npdf;
     while (xmax <= pdf->x[i])
     {
       i--;
@@ -900,6 +1252,7 @@ History
 	06sep	ksl	57h -- Modified to account for the fact
 			that the probability density is not 
 			uniform between intervals.
+	1703	Use the guide table and pdf_interval_q as in pdf_get_rand
 
 */
 double
@@ -907,41 +1260,20 @@ pdf_get_rand_limit (pdf)
      PdfPtr pdf;
 {
   double x, r;
-  int i, j;
+  int i;
   double q;
-  double a, b, c, s[2];
-  int xquadratic ();
 
   r = rand () / MAXRAND;        /* r must be slightly less than 1 */
   r = r * pdf->limit2 + (1. - r) * pdf->limit1;
 
-  i = r * NPDF;
+  i = pdf->guide[(int) (r * pdf->npdf)];
 
-  while (pdf->y[i + 1] < r && i < NPDF - 1)
+  while (pdf->y[i + 1] < r && i < pdf->npdf - 1)
     i++;
-  while (pdf->y[i] > r && i > 0)
-    i--;
 
   while (TRUE)
   {
-    q = rand () / MAXRAND;
-
-    a = 0.5 * (pdf->d[i + 1] - pdf->d[i]);
-    b = pdf->d[i];
-    c = (-0.5) * (pdf->d[i + 1] + pdf->d[i]) * q;
-
-    if ((j = xquadratic (a, b, c, s)) < 0)
-    {
-      Error ("pdf_get_rand: %d\n", j);
-    }
-    else
-    {
-      q = s[j];
-      if (q < 0 || q > 1)
-      {
-        Error ("pdf_get_rand: q out of range %d  %f\n", j, q);
-      }
-    }
+    q = pdf_interval_q (pdf, i, rand () / MAXRAND);
 
     x = pdf->x[i] * (1. - q) + pdf->x[i + 1] * q;
 
@@ -978,7 +1310,7 @@ pdf_to_file (pdf, filename)
   fprintf (fptr, "# norm   Scale.factor          %10.4g \n", pdf->norm);
 
   fprintf (fptr, "#x y  1-y d\n");
-  for (n = 0; n <= NPDF; n++)
+  for (n = 0; n <= pdf->npdf; n++)
     fprintf (fptr, "%10.4g	%14.8g %14.8e  %10.4g\n", pdf->x[n], pdf->y[n], 1. - pdf->y[n], pdf->d[n]);
 
   fclose (fptr);
@@ -1019,13 +1351,13 @@ pdf_check (pdf)
     Error ("pdf_check: cumulative distribution function should start at 0 not %e\n", y);
     hcheck = 1;
   }
-  if (pdf->y[NPDF] != 1.0)
+  if (pdf->y[pdf->npdf] != 1.0)
   {
-    Error ("pdf_check: cumulative distribution function should end at 1 not %e\n", pdf->y[NPDF - 1]);
+    Error ("pdf_check: cumulative distribution function should end at 1 not %e\n", pdf->y[pdf->npdf - 1]);
     icheck = 1;
   }
 
-  for (n = 1; n < NPDF + 1; n++)
+  for (n = 1; n < pdf->npdf + 1; n++)
   {
     // Note the equal sign here 
     if (x <= pdf->x[n])
@@ -1065,10 +1397,10 @@ pdf_check (pdf)
   if (hcheck != 0)
     pdf->y[0] = 0.0;
   if (icheck != 0)
-    pdf->y[NPDF] = 1.0;
+    pdf->y[pdf->npdf] = 1.0;
   if (jcheck != 0)
   {
-    for (n = 0; n < NPDF; n++)
+    for (n = 0; n < pdf->npdf; n++)
     {
       if (pdf->x[n] >= pdf->x[n + 1])
         pdf->x[n + 1] = pdf->x[n] + 1.e-20;
@@ -1076,7 +1408,7 @@ pdf_check (pdf)
   }
   if (kcheck != 0)
   {
-    for (n = 0; n < NPDF; n++)
+    for (n = 0; n < pdf->npdf; n++)
     {
       if (pdf->y[n] >= pdf->y[n] + 1)
         pdf->y[n + 1] = pdf->y[n] + 1.e-20;
@@ -1116,6 +1448,7 @@ History:
 			within a pdf interval.
 	06nov	ksl	58b: Fixed problem occuring when there
 			were two points in cdf with same x
+	1703	Also construct the guide table used in sampling
                                                                                              
 **************************************************************/
 
@@ -1126,7 +1459,7 @@ recalc_pdf_from_cdf (pdf)
   int n;
   double dx1, dx2, dy1, dy2;
 
-  for (n = 1; n < NPDF; n++)
+  for (n = 1; n < pdf->npdf; n++)
   {
     dy1 = pdf->y[n] - pdf->y[n - 1];
     dx1 = pdf->x[n] - pdf->x[n - 1];
@@ -1155,7 +1488,9 @@ recalc_pdf_from_cdf (pdf)
   }
   /* Fill in the ends */
   pdf->d[0] = pdf->d[1];
-  pdf->d[NPDF] = pdf->d[NPDF - 1];
+  pdf->d[pdf->npdf] = pdf->d[pdf->npdf - 1];
+
+  pdf_make_guide (pdf);
 
   return (0);
 }
@@ -522,6 +522,8 @@ History:
 	06may	ksl	57+ -- Updated to use plasma structure. 
 			and to elimate passing entrie wind structure
 	15aug	ksl	Added domain support
+	1703		Locate the cell with a binary search of the cumulative
+			emissivity instead of a linear search for each photon
 
 ************************************************************/
 int
@@ -539,34 +541,59 @@ photo_gen_kpkt (p, weight, photstart, nphot)
   double v[3];
   double dot ();
   double test;
+  double t_perf;
   int nnscat;
   double dvwind_ds (), sobolev ();
   int nplasma;
   int ndom;
+  double *emiss_cum;
+  int nlo, nhi, nlast;
 
 
 
   photstop = photstart + nphot;
   Log ("photo_gen_kpkt creates nphot %5d photons from %5d to %5d \n", nphot, photstart, photstop);
 
+  /* Construct the cumulative k-packet emissivity of the cells */
+
+  if ((emiss_cum = (double *) calloc (sizeof (double), NDIM2)) == NULL)
+  {
+    Error ("photo_gen_kpkt: Could not allocate memory for %d cells\n", NDIM2);
+    exit (0);
+  }
+
+  xlumsum = 0;
+  nlast = 0;
+  for (icell = 0; icell < NDIM2; icell++)
+  {
+    if (wmain[icell].vol > 0.0)
+    {
+      nplasma = wmain[icell].nplasma;
+      xlumsum += plasmamain[nplasma].kpkt_emiss;
+      if (plasmamain[nplasma].kpkt_emiss > 0)
+        nlast = icell;
+    }
+    emiss_cum[icell] = xlumsum;
+  }
+
   for (n = photstart; n < photstop; n++)
   {
-    /* locate the wind_cell in which the photon bundle originates. */
+    /* locate the wind_cell in which the photon bundle originates, namely the first 
+       cell for which the cumulative emissivity is at least xlum */
 
     xlum = (rand () + 0.5) / (MAXRAND) * geo.f_kpkt;
 
-    xlumsum = 0;
-    icell = 0;
-    while (xlumsum < xlum)
+    nlo = -1;
+    nhi = nlast;
+    while (nhi - nlo > 1)
     {
-      if (wmain[icell].vol > 0.0)
-      {
-        nplasma = wmain[icell].nplasma;
-        xlumsum += plasmamain[nplasma].kpkt_emiss;
-      }
-      icell++;
+      icell = (nlo + nhi) >> 1;
+      if (emiss_cum[icell] < xlum)
+        nlo = icell;
+      else
+        nhi = icell;
     }
-    icell--;                    /* This is the cell in which the photon must be generated */
+    icell = nhi;                /* This is the cell in which the photon must be generated */
 
     /* Now generate a single photon in this cell */
     p[n].w = weight;
@@ -581,7 +608,9 @@ photo_gen_kpkt (p, weight, photstart, nphot)
 
     while (test > em_rnge.fmax || test < em_rnge.fmin)
     {
+      t_perf = perf_start ();
       kpkt (&pp, &nres, &esc_ptr);
+      perf_stop (PERF_KPKT, t_perf);
       if (esc_ptr == 0)
       {
         test = 0.0;
@@ -662,7 +691,7 @@ photo_gen_kpkt (p, weight, photstart, nphot)
 
   }
 
-
+  free (emiss_cum);
 
   return (nphot);               /* Return the number of photons generated */
 
@@ -708,6 +737,9 @@ History:
 			eliminate WindPtr w, since we have access
 			to this through wmain.
 	15aug	ksl	Added domain support
+	1703		Locate the cell with a binary search of the cumulative
+			emissivity of the cells, so that only the levels of 
+			one cell have to be searched for each photon
 
 ************************************************************/
 int
@@ -731,12 +763,37 @@ photo_gen_matom (p, weight, photstart, nphot)
   double dvwind_ds (), sobolev ();
   int nplasma;
   int ndom;
+  double *emiss_cum;
+  int nlo, nhi, nlast;
 
 
 
   photstop = photstart + nphot;
   Log ("photo_gen_matom creates nphot %5d photons from %5d to %5d \n", nphot, photstart, photstop);
 
+  /* Construct the cumulative macro atom emissivity of the cells, summed over levels */
+
+  if ((emiss_cum = (double *) calloc (sizeof (double), NDIM2)) == NULL)
+  {
+    Error ("photo_gen_matom: Could not allocate memory for %d cells\n", NDIM2);
+    exit (0);
+  }
+
+  xlumsum = 0;
+  nlast = 0;
+  for (icell = 0; icell < NDIM2; icell++)
+  {
+    if (wmain[icell].vol > 0.0)
+    {
+      nplasma = wmain[icell].nplasma;
+      for (upper = 0; upper < nlevels_macro; upper++)
+        xlumsum += macromain[nplasma].matom_emiss[upper];
+      if (xlumsum > (icell > 0 ? emiss_cum[icell - 1] : 0))
+        nlast = icell;
+    }
+    emiss_cum[icell] = xlumsum;
+  }
+
   for (n = photstart; n < photstop; n++)
   {
     /* locate the wind_cell in which the photon bundle originates. And also decide which of the macro
@@ -744,39 +801,26 @@ photo_gen_matom (p, weight, photstart, nphot)
 
     xlum = (rand () + 0.5) / (MAXRAND) * geo.f_matom;
 
-    xlumsum = 0;
-    icell = 0;
-    upper = 0;
-    while (xlumsum < xlum)
+    /* The cell is the first one for which the cumulative emissivity is at least xlum */
+    nlo = -1;
+    nhi = nlast;
+    while (nhi - nlo > 1)
     {
-      if (wmain[icell].vol > 0.0)
-      {
-        nplasma = wmain[icell].nplasma;
-        xlumsum += macromain[nplasma].matom_emiss[upper];
-        upper++;
-        if (upper == nlevels_macro)
-        {
-          upper = 0;
-          icell++;
-        }
-      }
+      icell = (nlo + nhi) >> 1;
+      if (emiss_cum[icell] < xlum)
+        nlo = icell;
       else
-      {
-        icell++;
-        upper = 0;
-      }
+        nhi = icell;
     }
+    icell = nhi;
 
-    if (upper == 0)
-    {
-      /* If upper = 0 at this point it means the loop above finished with an increment of
-         icell and setting upper = 0. In such a case the process we want was the LAST process
-         in the previous cell. */
-      icell--;
-      upper = nlevels_macro;
-    }
-
-    upper--;                    /* This leaves the macro atom level that deactivaties. */
+    /* Now find the level within this cell */
+    nplasma = wmain[icell].nplasma;
+    xlumsum = (icell > 0) ? emiss_cum[icell - 1] : 0;
+    upper = 0;
+    while (upper < nlevels_macro - 1 && (xlumsum += macromain[nplasma].matom_emiss[upper]) < xlum)
+      upper++;
+    /* upper is now the macro atom level that deactivaties. */
 
     /* Now generate a single photon in this cell */
     p[n].w = weight;
@@ -872,6 +916,7 @@ photo_gen_matom (p, weight, photstart, nphot)
     }
   }
 
+  free (emiss_cum);
 
   return (nphot);               /* Return the number of photons generated */
 
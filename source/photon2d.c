@@ -55,6 +55,7 @@ translate (w, pp, tau_scat, tau, nres)
 {
   int istat;
   int ndomain;
+  double t_perf;
 
   if (where_in_wind (pp->x, &ndomain) < 0)
   {
@@ -62,7 +63,10 @@ translate (w, pp, tau_scat, tau, nres)
   }
   else if ((pp->grid = where_in_grid (ndomain, pp->x)) >= 0)
   {
+    perf_count[PERF_CELL_CROSSINGS]++;
+    t_perf = perf_start ();
     istat = translate_in_wind (w, pp, tau_scat, tau, nres);
+    perf_stop (PERF_TRANSLATE_IN_WIND, t_perf);
   }
   else
   {
@@ -320,6 +324,8 @@ History:
 			going through a region with negligibe
 			volume.  
 	15aug	ksl	Incorporate multiple domains
+	1703	Locate the cell by stepping from the last cell of the
+		photon, see where_in_grid_from
  
 **************************************************************/
 
@@ -347,6 +353,7 @@ translate_in_wind (w, p, tau_scat, tau, nres)
   int istat;
   int nplasma;
   int ndom;
+  double t_perf;
 
   WindPtr one;
   PlasmaPtr xplasma;
@@ -355,7 +362,7 @@ translate_in_wind (w, p, tau_scat, tau, nres)
 /* First verify that the photon is in the grid, and if not
 return and record an error */
 
-  if ((p->grid = n = where_in_grid (wmain[p->grid].ndom, p->x)) < 0)
+  if ((p->grid = n = where_in_grid_from (wmain[p->grid].ndom, p->x, p->grid)) < 0)
   {
     Error ("translate_in_wind: Photon not in grid when routine entered\n");
     return (n);                 /* Photon was not in grid */
@@ -464,7 +471,9 @@ radiation, which is the single largest contributer to execution time.*/
 
 /* Note that ds_current does not alter p in any way at present 02jan ksl */
 
+  t_perf = perf_start ();
   ds_current = calculate_ds (w, p, tau_scat, tau, nres, smax, &istat);
+  perf_stop (PERF_CALCULATE_DS, t_perf);
 
   if (p->nres < 0)
     xplasma->nscat_es++;
@@ -489,7 +498,7 @@ subroutine radiation can be avoided.
     one = &w[p->grid];          /* So one is the grid cell of interest */
     nplasma = one->nplasma;
     xplasma = &plasmamain[nplasma];
-    xplasma->ntot++;
+    xplasma->est->ntot++;
 
 /*57h -- ksl -- 071506 moved steps not needed in calculation of detailed spectrum inside if statement
 for consistency.  Delete comment when satisfied OK */
@@ -498,18 +507,20 @@ for consistency.  Delete comment when satisfied OK */
     {
       bf_estimators_increment (one, p, ds_current);
 /*photon weight times distance in the shell is proportional to the mean intensity */
-      xplasma->j += p->w * ds_current;
+      xplasma->est->j += p->w * ds_current;
 
 /* frequency weighted by the weights and distance       in the shell .  See eqn 2 ML93 */
 
-      xplasma->ave_freq += p->freq * p->w * ds_current;
+      xplasma->est->ave_freq += p->freq * p->w * ds_current;
 
     }
 
   }
   else
   {
+    t_perf = perf_start ();
     radiation (p, ds_current);
+    perf_stop (PERF_RADIATION, t_perf);
   }
 
 
@@ -179,6 +179,8 @@ Notes:
 
 History:
 	04dec	ksl	54a -- small mod to eliminate -O3 warning.
+	1703	Use the fractions chosen by bands_adapt when adaptive
+		band allocation is on
 
 **************************************************************/
 
@@ -225,8 +227,28 @@ populate_bands (f1, f2, ioniz_or_final, iwind, band)
 
 
   for (n = 0; n < band->nbands; n++)
-  {
     band->used_fraction[n] = band->min_fraction[n] + (1 - frac_used) * band->nat_fraction[n];
+
+/* If bands_adapt has chosen fractions for this cycle, use them instead.  Bands without flux get no photons. 
+The weights in define_phot are set from nat_fraction/used_fraction, so the estimators remain unbiased */
+
+  if (modes.adapt_bands)
+  {
+    z = 0;
+    for (n = 0; n < band->nbands; n++)
+      if (band->flux[n] > 0.0)
+        z += band->adapt_fraction[n];
+
+    if (z > 0)
+    {
+      for (n = 0; n < band->nbands; n++)
+        band->used_fraction[n] = (band->flux[n] > 0.0) ? band->adapt_fraction[n] / z : 0.0;
+    }
+  }
+
+  z = 0;
+  for (n = 0; n < band->nbands; n++)
+  {
     nphot += band->nphot[n] = NPHOT * band->used_fraction[n];
     if (band->used_fraction[n] > z)
     {
@@ -335,9 +357,7 @@ iwind = -1 	Don't generate any wind photons at all
   if (iwind == 1 || (iwind == 0))
   {                             /* Then find the luminosity and flux of the wind */
     geo.lum_wind = wind_luminosity (0.0, VERY_BIG);
-    xxxpdfwind = 1;             // Turn on the portion of the line luminosity routine which creates pdfs
     geo.f_wind = wind_luminosity (f1, f2);
-    xxxpdfwind = 0;             // Turn off the portion of the line luminosity routine which creates pdfs
   }
 
   /* New block follow for dealing with emission via k-packets and macro atoms. SS */
@@ -714,6 +734,7 @@ Notes:
 History:
 	080518	ksl	60a - Modified to use SPECTYPE_BB, SPECTYPE_UNIFORM, and 
 			SPECTYPE_NONE in photon gen instead of hardcoded values
+	1703	Use launch_rand, so photons can be launched with quasi-random numbers
 
 **************************************************************/
 
@@ -726,7 +747,7 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
                                    is uniform in frequency space */
      int istart, nphot;         /* Respecitively the starting point in p and the number of photons to generate */
 {
-  double freqmin, freqmax, dfreq;
+  double freqmin, freqmax;
   int i, iend;
   if ((iend = istart + nphot) > NPHOT)
   {
@@ -740,10 +761,11 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
   Log_silent ("photo_gen_star creates nphot %5d photons from %5d to %5d \n", nphot, istart, iend);
   freqmin = f1;
   freqmax = f2;
-  dfreq = (freqmax - freqmin) / MAXRAND;
   r = (1. + EPSILON) * r;       /* Generate photons just outside the photosphere */
+  qmc_start ();
   for (i = istart; i < iend; i++)
   {
+    qmc_next_photon ();
     p[i].origin = PTYPE_STAR;   // For BL photons this is corrected in photon_gen 
     p[i].w = weight;
     p[i].istat = p[i].nscat = p[i].nrscat = 0;
@@ -759,7 +781,7 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
     else if (spectype == SPECTYPE_UNIFORM)
     {                           /* Kurucz spectrum */
       /*Produce a uniform distribution of frequencies */
-      p[i].freq = freqmin + rand () * dfreq;
+      p[i].freq = freqmin + launch_rand () * (freqmax - freqmin);
     }
     else
     {
@@ -790,6 +812,7 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
 
     randvcos (p[i].lmn, p[i].x);
   }
+  qmc_stop ();
   return (0);
 }
 
@@ -1053,6 +1076,10 @@ History:
 	04dec   ksl     54d -- Minor mod to make more parallel to photo_gen_star,
 	080518	ksl	60a - Modified to use SPECTYPE_BB, SPECTYPE_UNIFORM, and 
 			SPECTYPE_NONE in photon gen instead of hardcoded values
+	1703	For model spectra, generate the frequencies ring by ring from
+			cdfs which are kept for each ring, see ring_continuum_freqs
+	1703	Use launch_rand for the positions and directions of photons, so
+			they can be launched with quasi-random numbers
 
 **************************************************************/
 
@@ -1065,11 +1092,13 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
      int istart, nphot;
 {
 
-  double freqmin, freqmax, dfreq;
+  double freqmin, freqmax;
   int i, iend;
   double planck ();
   double t, r, z, theta, phi;
   int nring;
+  int *ring_of;
+  double *freq;
   double north[3], v[3];
   if ((iend = istart + nphot) > NPHOT)
   {
@@ -1084,9 +1113,20 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
   Log_silent ("photo_gen_disk creates nphot %5d photons from %5d to %5d \n", nphot, istart, iend);
   freqmin = f1;
   freqmax = f2;
-  dfreq = (freqmax - freqmin) / MAXRAND;
+
+  /* For model spectra, the ring of each photon is recorded so that the frequencies 
+     can be generated ring by ring once the positions and directions are known */
+  ring_of = NULL;
+  if (spectype != SPECTYPE_BB && spectype != SPECTYPE_UNIFORM && (ring_of = calloc (sizeof (int), nphot)) == NULL)
+  {
+    Error ("photo_gen_disk: Could not allocate memory for %d photons\n", nphot);
+    exit (0);
+  }
+
+  qmc_start ();
   for (i = istart; i < iend; i++)
   {
+    qmc_next_photon ();
     p[i].origin = PTYPE_DISK;   // identify this as a disk photon
     p[i].w = weight;
     p[i].istat = p[i].nscat = p[i].nrscat = 0;
@@ -1102,7 +1142,7 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
  * generate photon.  04march -- ksl
  */
 
-    nring = ((rand () / MAXRAND) * (NRINGS - 1));
+    nring = (launch_rand () * (NRINGS - 1));
 
     if ((nring < 0) || (nring > NRINGS - 2))
     {
@@ -1116,12 +1156,12 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
  * should account for the area.  But haven't fixed this yet ?? 04Dec
  */
 
-    r = disk.r[nring] + (disk.r[nring + 1] - disk.r[nring]) * rand () / MAXRAND;
+    r = disk.r[nring] + (disk.r[nring + 1] - disk.r[nring]) * launch_rand ();
     /* Generate a photon in the plane of the disk a distance r */
 
 // This is the correct way to generate an azimuthal distribution
 
-    phi = 2. * PI * (rand () / MAXRAND);
+    phi = 2. * PI * launch_rand ();
     p[i].x[0] = r * cos (phi);
     p[i].x[1] = r * sin (phi);
 
@@ -1152,7 +1192,7 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
 
     }
 
-    if (rand () > MAXRAND / 2)
+    if (launch_rand () > 0.5)
     {                           /* Then the photon emerges in the upper hemisphere */
       p[i].x[2] = (z + EPSILON);
     }
@@ -1175,12 +1215,13 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
     else if (spectype == SPECTYPE_UNIFORM)
     {                           //Produce a uniform distribution of frequencies
 
-      p[i].freq = freqmin + rand () * dfreq;
+      p[i].freq = freqmin + launch_rand () * (freqmax - freqmin);
     }
 
     else
-    {                           /* Then we will use a model which was read in */
-      p[i].freq = one_continuum (spectype, disk.t[nring], log10 (disk.g[nring]), freqmin, freqmax);
+    {                           /* Then we will use a model which was read in, see below */
+      ring_of[i - istart] = nring;
+      continue;
     }
 
     if (p[i].freq < freqmin || freqmax < p[i].freq)
@@ -1194,6 +1235,28 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
     p[i].freq /= (1. - dot (v, p[i].lmn) / C);
 
   }
+  qmc_stop ();
+
+  /* Generate the frequencies of photons from model spectra from the cached cdfs of
+     each ring, and then Doppler shift them */
+  if (ring_of != NULL)
+  {
+    if ((freq = calloc (sizeof (double), nphot)) == NULL)
+    {
+      Error ("photo_gen_disk: Could not allocate memory for %d photons\n", nphot);
+      exit (0);
+    }
+    ring_continuum_freqs (spectype, nphot, ring_of, freqmin, freqmax, freq);
+    for (i = istart; i < iend; i++)
+    {
+      p[i].freq = freq[i - istart];
+      vdisk (p[i].x, v);
+      p[i].freq /= (1. - dot (v, p[i].lmn) / C);
+    }
+    free (freq);
+    free (ring_of);
+  }
+
   return (0);
 }
 
@@ -537,6 +537,7 @@ copy_plasma (x1, x2)
   x2->t_r = x1->t_r;
   x2->t_e = x1->t_e;
   x2->w = x1->w;
+  x2->est = x1->est;
 
   if ((x2->density = calloc (sizeof (double), nions)) == NULL)
   {
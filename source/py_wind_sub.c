@@ -930,7 +930,7 @@ freq_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = plasmamain[nplasma].ave_freq;
+      aaa[n] = plasmamain[nplasma].est->ave_freq;
     }
   }
   display ("Average freqency");
@@ -1000,32 +1000,32 @@ nphot_summary (w, rootname, ochoice)
         nplasma = w[n].nplasma;
         if (ichoice == 0)
         {
-          aaa[n] = plasmamain[nplasma].ntot;
+          aaa[n] = plasmamain[nplasma].est->ntot;
           strcpy (string, "Nphot tot per cell");
         }
         else if (ichoice == 1)
         {
-          aaa[n] = plasmamain[nplasma].ntot_star;
+          aaa[n] = plasmamain[nplasma].est->ntot_star;
           strcpy (string, "Nphot star per cell");
         }
         else if (ichoice == 2)
         {
-          aaa[n] = plasmamain[nplasma].ntot_bl;
+          aaa[n] = plasmamain[nplasma].est->ntot_bl;
           strcpy (string, "Nphot bl per cell");
         }
         else if (ichoice == 3)
         {
-          aaa[n] = plasmamain[nplasma].ntot_disk;
+          aaa[n] = plasmamain[nplasma].est->ntot_disk;
           strcpy (string, "Nphot disk per cell");
         }
         else if (ichoice == 4)
         {
-          aaa[n] = plasmamain[nplasma].ntot_wind;
+          aaa[n] = plasmamain[nplasma].est->ntot_wind;
           strcpy (string, "Nphot wind per cell");
         }
         else if (ichoice == 5)
         {
-          aaa[n] = plasmamain[nplasma].ntot_agn;
+          aaa[n] = plasmamain[nplasma].est->ntot_agn;
           strcpy (string, "Nphot agn per cell");
         }
         else
@@ -1505,7 +1505,7 @@ a:printf ("There are %i wind elements in this model\n", NDIM2);
 
   Log
     ("Element %d (%d,%d)  inwind %d plasma cell %d ntot %d nioniz %d nrad %d\n",
-     n, i, j, w[n].inwind, xplasma->nplasma, xplasma->ntot, xplasma->nioniz, xplasma->nrad);
+     n, i, j, w[n].inwind, xplasma->nplasma, xplasma->est->ntot, xplasma->est->nioniz, xplasma->nrad);
   Log ("xyz %8.2e %8.2e %8.2e vel %8.2e %8.2e %8.2e\n", w[n].x[0], w[n].x[1], w[n].x[2], w[n].v[0], w[n].v[1], w[n].v[2]);
   Log ("r theta %12.6e %12.6e \n", w[n].rcen, w[n].thetacen / RADIAN);
 
@@ -1547,8 +1547,8 @@ a:printf ("There are %i wind elements in this model\n", NDIM2);
        xplasma->lum_comp_ioniz / (xplasma->lum_rad + xplasma->lum_adiabatic + xplasma->lum_comp_ioniz + xplasma->lum_dr_ioniz));
   Log ("DR cooling        %8.2e is %8.2g of total cooling\n", xplasma->lum_dr_ioniz,
        xplasma->lum_dr_ioniz / (xplasma->lum_rad + xplasma->lum_adiabatic + xplasma->lum_comp_ioniz + xplasma->lum_dr_ioniz));
-  Log ("Number of ionizing photons in cell nioniz %d\n", xplasma->nioniz);
-  Log ("Log Ionization parameter in this cell U %4.2f xi %4.2f\n", log10 (xplasma->ip), log10 (xplasma->xi));   //70h NSH computed ionizaion parameter
+  Log ("Number of ionizing photons in cell nioniz %d\n", xplasma->est->nioniz);
+  Log ("Log Ionization parameter in this cell U %4.2f xi %4.2f\n", log10 (xplasma->est->ip), log10 (xplasma->est->xi));   //70h NSH computed ionizaion parameter
   Log ("ioniz %8.2e %8.2e %8.2e %8.2e %8.2e\n",
        xplasma->ioniz[0], xplasma->ioniz[1], xplasma->ioniz[2], xplasma->ioniz[3], xplasma->ioniz[4]);
   Log
@@ -1989,7 +1989,7 @@ IP_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = ((plasmamain[nplasma].ip));
+      aaa[n] = ((plasmamain[nplasma].est->ip));
     }
   }
   display ("Ionization parameter");
@@ -2010,7 +2010,7 @@ IP_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = ((plasmamain[nplasma].xi));
+      aaa[n] = ((plasmamain[nplasma].est->xi));
     }
   }
   display ("Xi Ionization parameter");
@@ -2031,7 +2031,7 @@ IP_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = ((plasmamain[nplasma].ip_direct));
+      aaa[n] = ((plasmamain[nplasma].est->ip_direct));
     }
   }
   display ("Log Ionization parameter (direct)");
@@ -2050,7 +2050,7 @@ IP_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = ((plasmamain[nplasma].ip_scatt));
+      aaa[n] = ((plasmamain[nplasma].est->ip_scatt));
     }
   }
   display ("Log Ionization parameter (scattered)");
@@ -2340,7 +2340,7 @@ J_summary (w, rootname, ochoice)
         if (i == 0)
           aaa[n] = macromain[nplasma].jbar_old[config[llvl].bbu_indx_first + njump];
         else
-          aaa[n] = (plasmamain[nplasma].xj[i]);
+          aaa[n] = (plasmamain[nplasma].est->xj[i]);
       }
     }
 
@@ -2394,7 +2394,7 @@ J_scat_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].j);
+      aaa[n] = (plasmamain[nplasma].est->j);
     }
   }
   display ("J in cell");
@@ -2412,7 +2412,7 @@ J_scat_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].j_direct);
+      aaa[n] = (plasmamain[nplasma].est->j_direct);
     }
   }
   display ("J in cell from direct photons");
@@ -2429,7 +2429,7 @@ J_scat_summary (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].j_scatt);
+      aaa[n] = (plasmamain[nplasma].est->j_scatt);
     }
   }
   display ("J in cell from scattered photons");
@@ -2469,7 +2469,7 @@ phot_split (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].ntot_wind);
+      aaa[n] = (plasmamain[nplasma].est->ntot_wind);
     }
   }
   display ("Wind photons in cell");
@@ -2487,7 +2487,7 @@ phot_split (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].ntot_agn);
+      aaa[n] = (plasmamain[nplasma].est->ntot_agn);
     }
   }
   display ("AGN photons in cell");
@@ -2505,7 +2505,7 @@ phot_split (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].ntot_disk);
+      aaa[n] = (plasmamain[nplasma].est->ntot_disk);
     }
   }
   display ("Disk photons in cell");
@@ -2523,7 +2523,7 @@ phot_split (w, rootname, ochoice)
     if (w[n].vol > 0.0)
     {
       nplasma = w[n].nplasma;
-      aaa[n] = (plasmamain[nplasma].ntot_star);
+      aaa[n] = (plasmamain[nplasma].est->ntot_star);
     }
   }
   display ("Stellar photons in cell");
@@ -2777,7 +2777,7 @@ model_bands (w, rootname, ochoice)
       if (w[n].vol > 0.0)
       {
         nplasma = w[n].nplasma;
-        aaa[n] = plasmamain[nplasma].nxtot[m];
+        aaa[n] = plasmamain[nplasma].est->nxtot[m];
       }
     }
 
@@ -2810,7 +2810,7 @@ model_bands (w, rootname, ochoice)
       if (w[n].vol > 0.0)
       {
         nplasma = w[n].nplasma;
-        aaa[n] = plasmamain[nplasma].xj[m];
+        aaa[n] = plasmamain[nplasma].est->xj[m];
       }
     }
 
@@ -2837,7 +2837,7 @@ model_bands (w, rootname, ochoice)
       if (w[n].vol > 0.0)
       {
         nplasma = w[n].nplasma;
-        aaa[n] = plasmamain[nplasma].xave_freq[m];
+        aaa[n] = plasmamain[nplasma].est->xave_freq[m];
       }
     }
 
@@ -2864,7 +2864,7 @@ model_bands (w, rootname, ochoice)
       if (w[n].vol > 0.0)
       {
         nplasma = w[n].nplasma;
-        aaa[n] = plasmamain[nplasma].nxtot[m];
+        aaa[n] = plasmamain[nplasma].est->nxtot[m];
       }
     }
 
@@ -3281,8 +3281,8 @@ ionH1\tionH2\tionHe1\tionHe2\tionHe3\tionC3\tionC4\tionC5\tionN5\tionO6\tionSi4\
          %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e \
          %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e\n",
          n, np, w[n].inwind, ii, jj, w[n].x[0], w[n].x[2], vtot, w[n].v[0], w[n].v[1], w[n].v[2], w[n].dvds_ave, w[n].vol, 
-         plasmamain[np].rho, plasmamain[np].ne, plasmamain[np].t_e, plasmamain[np].t_r, plasmamain[np].ntot,
-         plasmamain[np].w, plasmamain[np].ave_freq, plasmamain[np].ip, plasmamain[np].converge_whole, 
+         plasmamain[np].rho, plasmamain[np].ne, plasmamain[np].t_e, plasmamain[np].t_r, plasmamain[np].est->ntot,
+         plasmamain[np].w, plasmamain[np].est->ave_freq, plasmamain[np].est->ip, plasmamain[np].converge_whole, 
          plasmamain[np].converge_t_r, plasmamain[np].converge_t_e, plasmamain[np].converge_hc, 
          plasmamain[np].lum_ioniz, plasmamain[np].lum_rad, plasmamain[np].lum_fb, 
          plasmamain[np].lum_ff, plasmamain[np].lum_lines, plasmamain[np].lum_adiabatic, 
@@ -3296,7 +3296,7 @@ ionH1\tionH2\tionHe1\tionHe2\tionHe3\tionC3\tionC4\tionC5\tionN5\tionO6\tionSi4\
             %8.4e %8.4e %8.4e %i %8.4e %8.4e %8.4e %8.4e %i %8.4e %8.4e %8.4e %8.4e \
             %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e\
             %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e \
-            %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e\n", n, np, w[n].inwind, ii, jj, w[n].x[0], w[n].x[2], w[n].rcen, w[n].thetacen / RADIAN, vtot, w[n].v[0], w[n].v[1], w[n].v[2], w[n].dvds_ave, w[n].vol, plasmamain[np].rho, plasmamain[np].ne, plasmamain[np].t_e, plasmamain[np].t_r, plasmamain[np].ntot, plasmamain[np].w, plasmamain[np].ave_freq, plasmamain[np].ip, plasmamain[np].xi, plasmamain[np].converge_whole, plasmamain[np].converge_t_r, plasmamain[np].converge_t_e, plasmamain[np].converge_hc, plasmamain[np].lum_rad + plasmamain[np].lum_comp + plasmamain[np].lum_adiabatic + plasmamain[np].lum_dr, plasmamain[np].lum_rad, plasmamain[np].lum_fb, plasmamain[np].lum_ff, plasmamain[np].lum_lines, plasmamain[np].lum_adiabatic, plasmamain[np].lum_comp, plasmamain[np].lum_dr, plasmamain[np].heat_tot, plasmamain[np].heat_photo, plasmamain[np].heat_auger, plasmamain[np].heat_lines, plasmamain[np].heat_ff, plasmamain[np].heat_comp, plasmamain[np].heat_ind_comp, h1den, h2den, he1den, he2den, he3den, c3den, c4den, c5den, n5den, o6den, si4den);
+            %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e %8.4e\n", n, np, w[n].inwind, ii, jj, w[n].x[0], w[n].x[2], w[n].rcen, w[n].thetacen / RADIAN, vtot, w[n].v[0], w[n].v[1], w[n].v[2], w[n].dvds_ave, w[n].vol, plasmamain[np].rho, plasmamain[np].ne, plasmamain[np].t_e, plasmamain[np].t_r, plasmamain[np].est->ntot, plasmamain[np].w, plasmamain[np].est->ave_freq, plasmamain[np].est->ip, plasmamain[np].est->xi, plasmamain[np].converge_whole, plasmamain[np].converge_t_r, plasmamain[np].converge_t_e, plasmamain[np].converge_hc, plasmamain[np].lum_rad + plasmamain[np].lum_comp + plasmamain[np].lum_adiabatic + plasmamain[np].lum_dr, plasmamain[np].lum_rad, plasmamain[np].lum_fb, plasmamain[np].lum_ff, plasmamain[np].lum_lines, plasmamain[np].lum_adiabatic, plasmamain[np].lum_comp, plasmamain[np].lum_dr, plasmamain[np].heat_tot, plasmamain[np].heat_photo, plasmamain[np].heat_auger, plasmamain[np].heat_lines, plasmamain[np].heat_ff, plasmamain[np].heat_comp, plasmamain[np].heat_ind_comp, h1den, h2den, he1den, he2den, he3den, c3den, c4den, c5den, n5den, o6den, si4den);
     }
     else
     {
@@ -210,6 +210,8 @@ History:
 	1502		Major reorganisation of input gathering and setup. See setup.c, #136 and #139
 	1508	ksl	Instroduction of the concept of domains to handle the disk and wind as separate
 			domains
+	1703		Calculate the coefficients used by vwind_xyz and dvwind_ds
+			to interpolate within a cell, see wind_interp_init
  	
  	Look in Readme.c for more text concerning the early history of the program.
 
@@ -742,6 +744,9 @@ main (argc, argv)
   /* this routine checks, somewhat crudely, if the grid is well enough resolved */
   check_grid ();
   w = wmain;
+
+  /* Calculate the coefficients used to interpolate velocities within a cell */
+  wind_interp_init ();
   if (modes.save_cell_stats)
   {
     /* Open a diagnostic file or files (with hardwired names) */
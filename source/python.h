@@ -81,6 +81,10 @@ double DENSITY_PHOT_MIN;        /* This constant is a minimum density for the pu
 #define VMAX                		1.e9
 #define TAU_MAX				20.     /* Sets an upper limit in extract on when
                                                    a photon can be assumed to be completely absorbed */
+#define EXTRACT_ROULETTE		1.e-3   /* In extract, once w*exp(-tau) of a photon falls below this fraction
+                                                   of its starting weight, it plays Russian roulette */
+#define EXTRACT_SURVIVE			0.1     /* The probability of surviving the roulette.  Survivors have their
+                                                   weight divided by this, so the spectrum is unbiased */
 
 #define DANG_LIVE_OR_DIE   2.0  /* If constructing photons from a live or die run of the code, the
                                    angle over which photons will be accepted must be defined */
@@ -88,7 +92,7 @@ double DENSITY_PHOT_MIN;        /* This constant is a minimum density for the pu
 
 int NPHOT;                      /* The number of photon bundles created.  defined in python.c */
 
-#define NWAVE  			       10000    //Increasing from 4000 to 10000 (SS June 04)
+#define NWAVE  			       10000    //Increasing from 4000 to 10000 (SS June 04). Default for geo.nwave
 #define MAXSCAT 			50
 
 /* Define the structures */
@@ -190,7 +194,10 @@ cone_dummy, *ConePtr;
 
 /* End of structures which are used to define boundaries to the emission regions */
 
-#define NDIM_MAX 500            // maximum size of the grid in each dimension
+#define NREFINE 1000            // The number of intervals in which grid_refine_axis samples the model along an axis
+#define NREFINE_PERP 40         // The number of positions across the other axis at which the model is sampled
+#define REFINE_GMAX 10.         // The largest gradient, relative to the mean, that grid_refine_axis responds to
+#define REFINE_RHO_FLOOR 1e-3   // Densities below this fraction of the maximum are treated as this, so wind edges are refined
 
 typedef struct domain
 {
@@ -202,22 +209,24 @@ typedef struct domain
   int log_linear;               /*0 -> the grid spacing will be logarithmic in x and z, 1-> linear */
   double xlog_scale, zlog_scale;        /* Scale factors for setting up a logarithmic grid, the [1,1] cell
                                            will be located at xlog_scale,zlog_scale */
+  double refine;                /* 0 -> grid lines spaced as set by log_linear, > 0 -> the strength with which 
+                                   cylind and rtheta grid lines are concentrated where rho and v change, see grid_refine_axis */
 
   /* The next few structures define the boundaries of an emission region */
   struct cone windcone[2];      /* The cones that define the boundary of winds like SV or kwd */
   struct plane windplane[2];    /* Planes which define the top and bottom of a layer */
   double rho_min, rho_max;      /* These are used for the inneer and outer boundary of a pillbox */
 
-  double wind_x[NDIM_MAX], wind_z[NDIM_MAX];    /* These define the edges of the cells in the x and z directions */
-  double wind_midx[NDIM_MAX], wind_midz[NDIM_MAX];      /* These define the midpoints of the cells in the x and z directions */
+  double *wind_x, *wind_z;      /* These define the edges of the cells in the x and z directions, ndim and mdim long */
+  double *wind_midx, *wind_midz;        /* These define the midpoints of the cells in the x and z directions, see calloc_domain */
 
   ConePtr cones_rtheta;         /*A ptr to the cones that define the theta directions in rtheta coods */
 /* Next two lines are for cyl_var coordinates.  They are used in locating the appropriate 
  * locating the appropriate cell, for example by cylvar_where_in_grid
  */
 
-  double wind_z_var[NDIM_MAX][NDIM_MAX];
-  double wind_midz_var[NDIM_MAX][NDIM_MAX];
+  double **wind_z_var;          /* [ndim][mdim], only allocated for CYLVAR domains */
+  double **wind_midz_var;
 
 
 /* Since in principle we can mix and match arbitrarily the next parameters now have to be part of the domain structure */
@@ -298,6 +307,8 @@ struct geometry
   int ndomain;                  /*The number of domains in a model */
   int ndim2;                    /* The total number of windcells in all domains */
   int nplasma, nmacro;          /*The total number of cells in the plasma and macro structures in all domains */
+  int plasma_order;             /* The order of the cells in the plasma structure, 0 as in wmain, 1 along a Morton 
+                                   curve through each domain, see create_maps */
 
   /* variables which store the domain numbers of the wind, disk atmosphere.
      Other components should be added here.  Right now we need a wind_domain 
@@ -331,6 +342,7 @@ struct geometry
   double rho_select[NSPEC], z_select[NSPEC], az_select[NSPEC], r_select[NSPEC];
   double swavemin, swavemax;
   int select_extract, select_spectype;
+  int nwave;                    /* The number of frequency bins in each spectrum, NWAVE by default */
 
 /* Begin description of the actual geometery */
 
@@ -547,6 +559,8 @@ struct geometry
   double *reverb_dump_cell_x, *reverb_dump_cell_z;
   int *reverb_dump_cell;
   int reverb_lines, *reverb_line;       //SWM - Number of lines to track, and array of line 'nres' values
+  enum reverb_dump_enum
+  { REV_DUMP_TEXT = 0, REV_DUMP_BINARY = 1 } reverb_dump;      //Format of the delay dump file, see reverb.c
 
   int spec_mod;                 //A flag to say that we do hav spectral models
 }
@@ -588,21 +602,33 @@ blmod;
 
 /*
     SWN 6-2-15
-    Wind paths is defined per cell and contains a binned array holding the spectrum of paths. Layers are
+    Wind paths is defined per cell and contains a sparse histogram holding the spectrum of paths. Layers are
     For each frequency:
       For each path bin:
         What's the total fluxback of all these photons entering the cell?
 */
+enum path_source_enum
+{ PATH_CENT = 0,                /* Photons from the star, agn or boundary layer */
+  PATH_DISK = 1,                /* Photons from the disk */
+  PATH_WIND = 2,                /* Photons from the wind */
+  NPATH_SOURCE = 3
+};
+
+/* A single occupied bin of a path histogram.  Only bins that a photon has actually
+   landed in are stored, kept sorted by i_bin, so that cells which only ever see a
+   few path lengths do not carry the full geo.reverb_path_bins array */
+typedef struct path_bin
+{
+  int i_bin;                    //Index into reverb_path_bin of the lower bound of this bin
+  int i_num[NPATH_SOURCE];      //Number of photons in this bin, by source
+  double d_flux[NPATH_SOURCE];  //Total flux of photons in this bin, by source
+} path_bin_dummy, *Path_Bin_Ptr;
+
 typedef struct wind_paths
 {
-  double *ad_path_flux;         //Array[by frequency, then path] of total flux of photons with the given v&p
-  double *ad_path_flux_disk;
-  double *ad_path_flux_wind;
-  double *ad_path_flux_cent;    // As above, by source
-  int *ai_path_num;             //Array [by frequency, then path] of the number of photons in this bin
-  int *ai_path_num_disk;
-  int *ai_path_num_wind;
-  int *ai_path_num_cent;        // As above, by source
+  Path_Bin_Ptr bins;            //Occupied bins, sorted by i_bin
+  int n_bins;                   //Number of occupied bins
+  int n_alloc;                  //Number of bins allocated
   double d_flux, d_path;        //Total flux, average path
   int i_num;                    //Number of photons hitting this cell
 } wind_paths_dummy, *Wind_Paths_Ptr;
@@ -624,9 +650,6 @@ done to make it easier to control the size of the entire structure   06jul-ksl
  */
 #define NIONIZ	5               /*The number of ions (normally H and He) for which one separately tracks ionization 
                                    and recombinations */
-#define LPDF   3                /*The number of bins into which the line luminosity is divided in the course pdf
-                                   created by total_line_emission 
-                                   Reduced from 10 to 3 by SS for testing data with few lines. */
 
 
 /* 061104 -- 58b -- ksl -- Added definitions to characterize whether a cell is in the wind. */
@@ -676,6 +699,25 @@ wind_dummy, *WindPtr;
 
 WindPtr wmain;
 
+#define WIG_MAXSTEP  4          // The number of cells where_in_grid_from will step in each coordinate before searching the grid
+
+/* Coefficients for evaluating the velocity and the velocity gradient tensor anywhere within a cell
+without locating the position in the grid.  Within cell n, a quantity q is 
+q = q[0] + q[1] dr + q[2] dz + q[3] dr dz, where dr and dz are measured from r0 and z0 in the coordinates
+used by coord_fraction, so this is the same bilinear interpolation that coord_fraction gives. 
+See wind_interp_init */
+
+typedef struct wind_interp
+{
+  int ok;                       /* 1 if the coefficients can be used, 0 if coord_fraction must be used */
+  double r0, r1, z0, z1;        /* The limits of the cell, with z in degrees for rtheta coordinates */
+  double v[4][3];               /* Coefficients for the velocity, before rotation out of the xz plane */
+  double v_grad[4][3][3];       /* Coefficients for the velocity gradient tensor */
+}
+wind_interp_dummy, *WindInterpPtr;
+
+WindInterpPtr wind_interp;
+
 /* 57+ - 06jun -- plasma is a new structure that contains information about the properties of the
 plasma in regions of the geometry that are actually included n the wind */
 
@@ -686,11 +728,44 @@ plasma in regions of the geometry that are actually included n the wind */
 /* 78 - 1407 - NSH - changed several elements (initially those of size nions) in the plasma array to by dynamically allocated.
 They are now pointers in the array. */
 
+/* 1703 - The Monte Carlo estimators of the radiation field that are incremented each time a photon
+bundle moves through a cell are kept in a separate array estmain, one element per plasma cell, rather
+than being scattered through the plasma structure.  Photon transport then only touches this short
+block, and the array can be reduced between threads in a few contiguous pieces.  The order of the
+members matters to communicate_estimators_para: first the doubles which are averaged over threads,
+then those reduced with a maximum, then a minimum, and finally the counters which are summed */
+
+typedef struct plasma_est
+{
+  double j, ave_freq;           /* Mean intensity and intensity averaged frequency of the cell */
+  double j_direct, j_scatt;     /* 1309 NSH mean intensity due to direct photons and scattered photons */
+  double ip;                    /*NSH 111004 Ionization parameter calculated as number of photons over the lyman limit entering a cell, divided by the number density of hydrogen for the cell */
+  double ip_direct, ip_scatt;   /* 1309 NSH ionization parameter due to direct photons and scattered photons */
+  double xi;                    /*NSH 151109 Ionization parameter as defined by Tartar et al 1969 and described in Hazy. Its the ionizing flux over the number of hydrogen atoms */
+  double mean_ds, n_ds;         /* NSH 6/9/12 The summed path length and number of path segments in the cell, a check that 
+                                   a thin shell is really optically thin */
+  double xj[NXBANDS], xave_freq[NXBANDS];       /* 1108 NSH frequency limited versions of j and ave_freq */
+  double xsd_freq[NXBANDS];     /* 1208 NSH the standard deviation of the frequency in the band */
+
+  double max_freq;              /* 1208 NSH The maximum frequency photon seen in this cell */
+  double fmax[NXBANDS];         /* the maximum frequency photon seen in a band - this is incremented during photon flight */
+
+  double fmin[NXBANDS];         /* the minimum freqneucy photon seen in a band - this is incremented during photon flight */
+
+  int ntot;                     /* Total number of photon passages */
+  int ntot_star, ntot_bl, ntot_disk, ntot_wind, ntot_agn;       /* Counters of the number of photon passages by origin */
+  int nioniz;                   /* Total number of photons capable of ionizing H */
+  int nxtot[NXBANDS];           /* 1108 NSH the total number of photon passages in frequency bands */
+} plasma_est_dummy, *EstPtr;
+
+EstPtr estmain;
+
 
 typedef struct plasma
 {
   int nwind;                    /*A cross reference to the corresponding cell in the  wind structure */
   int nplasma;                  /*A self reference to this  in the plasma structure */
+  EstPtr est;                   /* The radiation field estimators for this cell, &estmain[nplasma] */
   double ne;                    /* electron density in the shell */
   double rho;                   /*density at the center of the cell. For clumped models, this is rho of the clump */
   double vol;                   /* volume of this cell (more specifically the volume  that is filled with material
@@ -741,24 +816,11 @@ typedef struct plasma
   double heat_auger;            /* photoionization heating due to inner shell ionizations */
   double w;                     /*The dilution factor of the wind */
 
-  int ntot;                     /*Total number of photon passages */
-
-  /*  counters of the number of photon passages by origin */
-
-  int ntot_star;
-  int ntot_bl;
-  int ntot_disk;
-  int ntot_wind;
-  int ntot_agn;
-
 
   int nscat_es;                 /* The number of electrons scatters in the cell */
   int nscat_res;                /* The number of resonant line scatters in the cell */
 
-  double mean_ds;               /* NSH 6/9/12 Added to allow a check that a thin shell is really optcially thin */
-  int n_ds;                     /* NSH 6/9/12 Added to allow the mean dsto be computed */
   int nrad;                     /* Total number of photons radiated within the cell */
-  int nioniz;                   /* Total number of photons capable of ionizing H */
   double *ioniz, *recomb;       /* Number of ionizations and recombinations for each ion.
                                    The sense is ionization from ion[n], and recombinations 
                                    to each ion[n] . 78 - changed to dynamic allocation */
@@ -770,21 +832,12 @@ typedef struct plasma
   double *lum_ion;              /* The amount of energy being released from the electron pool
                                    by this ion via recombination. 78 - changed to dynamic allocation */
   double *lum_inner_ion;
-  double j, ave_freq, lum;      /*Respectively mean intensity, intensity_averaged frequency, 
-                                   luminosity and absorbed luminosity of shell */
-  double xj[NXBANDS], xave_freq[NXBANDS];       /* 1108 NSH frequency limited versions of j and ave_freq */
-  double fmin[NXBANDS];         /* the minimum freqneucy photon seen in a band - this is incremented during photon flight */
-  double fmax[NXBANDS];         /* the maximum frequency photon seen in a band - this is incremented during photon flight */
+  double lum;                   /* luminosity of the shell.  j, ave_freq and their banded versions are in est */
   double fmin_mod[NXBANDS];     /* the minimum freqneucy that the model should be applied for */
   double fmax_mod[NXBANDS];     /* the maximum frequency that the model should be applied for */
 
 
 
-  double j_direct, j_scatt;     /* 1309 NSH mean intensity due to direct photons and scattered photons */
-  double ip_direct, ip_scatt;   /* 1309 NSH mean intensity due to direct photons and scattered photons */
-  double xsd_freq[NXBANDS];     /*1208 NSH the standard deviation of the frequency in the band */
-  int nxtot[NXBANDS];           /* 1108 NSH the total number of photon passages in frequency bands */
-  double max_freq;              /*1208 NSH The maximum frequency photon seen in this cell */
   double lum_lines, lum_ff, lum_adiabatic;
   double comp_nujnu;            /* 1701 NSH The integral of alpha(nu)nuj(nu) used to computecompton cooling-  only needs computing once per cycle */
   double lum_comp;              /* 1108 NSH The compton luminosity of the cell */
@@ -805,9 +858,6 @@ typedef struct plasma
 
 
   double dmo_dt[3];             /*Radiative force of wind */
-  int npdf;                     /* The number of points actually used in the luminosity pdf */
-  int pdf_x[LPDF];              /* The line numbers of *line_ptr which form the boundaries the luminosity pdf */
-  double pdf_y[LPDF];           /* Where the pdf is stored -- values between 0 and 1 */
   double gain;                  /* The gain being used in interations of the structure */
   double converge_t_r, converge_t_e, converge_hc;       /* Three measures of whether the program believes the grid is converged.
                                                            The first wo  are the fraction changes in t_r, t_e between this and the last cycle. The third
@@ -841,27 +891,26 @@ typedef struct plasma
   double exp_w[NXBANDS];        /*NSH 120817 - The prefector of an exponential representation of the radiation field in a cell */
   double sim_ip;                /*Ionisation parameter for the cell as defined in Sim etal 2010 */
   double ferland_ip;            /* IP calculaterd from equation 5.4 in hazy1 - assuming allphotons come from 0,0,0 and the wind is transparent */
-  double ip;                    /*NSH 111004 Ionization parameter calculated as number of photons over the lyman limit entering a cell, divided by the number density of hydrogen for the cell */
-  double xi;                    /*NSH 151109 Ionization parameter as defined by Tartar et al 1969 and described in Hazy. Its the ionizing flux over the number of hydrogen atoms */
 } plasma_dummy, *PlasmaPtr;
 
 PlasmaPtr plasmamain;
 
+/* The interpolation weights at the two ends of a step of a photon through a cell, from which 
+   the density of any ion or level at a point along the step can be found without searching 
+   the grid again, see ray_interp_init */
+
+typedef struct ray_interp
+{
+  int nelem[2];                 /* The number of cells contributing at each end, 0 if the end is outside the grid */
+  int nplasma[2][4];            /* The plasma cells contributing at each end */
+  double frac[2][4];            /* and their weights */
+} ray_interp_dummy, *RayInterpPtr;
+
 /* A storage area for photons.  The idea is that it is sometimes time-consuming to create the
 cumulative distribution function for a process, but trivial to create more than one photon 
 of a particular type once one has the cdf,  This appears to be case for f fb photons.  But 
 the same procedure could be used for line photons */
 
-#define NSTORE 10
-typedef struct photon_store
-{
-  int n;                        /* This is the photon number that was last used */
-  double t, f1, f2, freq[NSTORE];
-
-} photon_store_dummy, *PhotStorePtr;
-
-PhotStorePtr photstoremain;
-
 
 
 typedef struct macro
@@ -929,8 +978,6 @@ typedef struct macro
 
 MacroPtr macromain;
 
-int xxxpdfwind;                 // When 1, line luminosity calculates pdf
-
 int size_Jbar_est, size_gamma_est, size_alpha_est;
 
 #define TMAX_FACTOR			1.5     /*Factor by which t_e can exceed
@@ -1028,6 +1075,24 @@ typedef struct photon
     }
     p_dummy, *PhotPtr;
 
+/* The state a photon carries between steps of its flight through the wind.  In the
+   history transport a photon is flown to completion before the next one is started;
+   in the event transport (trans_phot_event) up to NFLIGHT flights are kept in the
+   window at once and each is advanced one step per sweep. */
+
+#define NFLIGHT 16384
+
+    typedef struct flight
+    {
+      struct photon pp;             /* The photon as it moves, p is left at its last scatter */
+      double tau_scat;              /* The optical depth at which the photon will next scatter */
+      double tau;                   /* The optical depth travelled since the last scatter */
+      double weight_min;            /* Below this weight the photon is taken to be absorbed */
+      int nres;                     /* The resonance at which the photon was last stopped */
+      int istat;                    /* P_INWIND while the flight continues */
+    }
+    flight_dummy, *FlightPtr;
+
     PhotPtr photmain;               /* A pointer to all of the photons that have been created in a subcycle. Added to ease 
                                        breaking the main routine of python into separate rooutines for inputs and running the
                                        program */
@@ -1062,7 +1127,10 @@ typedef struct photon
        to the spectrum as seen from various directions. Note that the space for the spectra 
        are allocated using a calloc statement in spectrum_init.  1409-ksl-A new spectrum
        was added.  This will be the first of the spectra.  It is simply the generated spectrum
-       before passing through the wind.  It has the orginal weights as generated.  */
+       before passing through the wind.  It has the orginal weights as generated.  
+       1703 - The number of frequency bins is set at run time by geo.nwave, and the bins of
+       all the spectra are held in one block so they can be reduced between MPI tasks in 
+       one go.  NWAVE is now only the default.  */
 
 
 
@@ -1078,8 +1146,9 @@ typedef struct photon
     typedef struct spectrum
     {
       char name[40];
-      float freqmin, freqmax, dfreq;
-      float lfreqmin, lfreqmax, ldfreq;     /* NSH 1302 - values for logarithmic spectra */
+      double freqmin, freqmax, dfreq;
+      double lfreqmin, lfreqmax, ldfreq;    /* NSH 1302 - values for logarithmic spectra */
+  int nwave;                    /* The number of frequency bins in each of the arrays below */
   double lmn[3];
   double mmax, mmin;            /* Used only in live or die situations, mmax=cos(angle-DANG_LIVE_OR_DIE)
                                    and mmim=cos(angle+DANG_LIVE_OR_DIE).   In actually defining this
@@ -1097,13 +1166,12 @@ typedef struct photon
                                    >0     -> select only photons whose "last" position is above the disk
                                    <0    -> select only photons whose last position is below the disk */
   double x[3], r;               /* The position and radius of a special region from which to extract spectra  */
-  double f[NWAVE];
-  double lf[NWAVE];             /* a second array to hole the extracted spectrum in log units */
-  double lfreq[NWAVE];          /* We need to hold what freqeuncy intervals our logarithmic spectrum has been taken over */
+  double *f;                    /* The arrays are nwave long and are allocated in spectrum_bins_allocate */
+  double *lf;                   /* a second array to hole the extracted spectrum in log units */
 
-  double f_wind[NWAVE];         /* The spectrum of photons created in the wind or scattered in the wind. Created for 
+  double *f_wind;               /* The spectrum of photons created in the wind or scattered in the wind. Created for 
                                    reflection studies but possible useful for other reasons as well. */
-  double lf_wind[NWAVE];        /* The logarithmic version of this */
+  double *lf_wind;              /* The logarithmic version of this */
 }
 spectrum_dummy, *SpecPtr;
 
@@ -1127,15 +1195,24 @@ generated from a function which is usually only proportional to the probability
 function.  It is sometimes useful, e.g. in calculating the reweighting function to
 have access to the proper normalization.  Since the one needs the normalization to
 properly create the CDF, this was added for python_43.2  */
-#define NPDF 200
+#define NPDF 200                /* The initial number of intervals in a CDF */
+#define NPDF_MAX 3200           /* The maximum number of intervals; the resolution of a CDF is
+                                   doubled from NPDF until it describes the input to within
+                                   PDF_MAX_ERR, or until NPDF_MAX is reached */
+#define PDF_MAX_ERR 0.05        /* The largest error allowed in the interpolated CDF, as a
+                                   fraction of 1/NPDF, the probability in an initial interval */
 
 typedef struct Pdf
 {
-  double x[NPDF + 1];           /* Positions for which the probability density
+  int npdf;                     /* The number of intervals, so x, y and d have npdf+1 elements */
+  int nalloc;                   /* The number of elements that have been allocated for x, y and d */
+  double *x;                    /* Positions for which the probability density
                                    is calculated */
-  double y[NPDF + 1];           /* The value of the CDF at x */
-  double d[NPDF + 1];           /* 57i -- the rate of change of the probability
+  double *y;                    /* The value of the CDF at x */
+  double *d;                    /* 57i -- the rate of change of the probability
                                    density at x */
+  int *guide;                   /* A guide table: guide[k] is the interval which contains
+                                   y=k/npdf, so that sampling is O(1) */
   double limit1, limit2;        /* Limits (running from 0 to 1) that define a portion
                                    of the CDF to sample */
   double x1, x2;                /* limits if they exist on what is returned */
@@ -1144,6 +1221,57 @@ typedef struct Pdf
  *PdfPtr, pdf_dummy;
 
 
+/* The cumulative line luminosity of the cell from which line photons were last 
+generated (see one_line), together with the cell and the range of lines to which it
+applies.  one_line_nplasma is set to -1 when the stored values are out of date */
+double *one_line_cum;
+int one_line_nplasma, one_line_nmin, one_line_nmax;
+double one_line_f1, one_line_f2;
+
+
+/* The free bound cdf of each plasma cell, which is retained until the conditions in 
+the cell change (see one_fb).  This replaces the store of photon frequencies used 
+since 57h.  A cdf can have up to NPDF_MAX intervals, so the total memory is limited
+to FBSTORE_MB, and the cdfs of other cells are discarded in turn if this is exceeded */
+#define FBSTORE_MB  500.
+
+typedef struct fb_store
+{
+  int valid;                    /* 0 if the cdf must be regenerated, e.g. after the ionization state has been updated */
+  double t, f1, f2;             /* The temperature and frequency limits for which the cdf was generated */
+  PdfPtr pdf;                   /* The cdf, which is only allocated when it is first needed */
+  double nbytes;                /* The memory used by the arrays of the cdf */
+} fb_store_dummy, *FbStorePtr;
+
+FbStorePtr fbstoremain;
+int fbstore_nelem;              /* The number of elements allocated for fbstoremain */
+double fbstore_bytes;           /* The memory used by all of the cdfs in fbstoremain */
+int fbstore_next;               /* The next cell whose cdf will be discarded if FBSTORE_MB is exceeded */
+
+
+/* The memory in Mb which may be used to cache interpolated model spectra and the cdfs
+made from them, see model_flux and model_pdf */
+#define MODEL_CACHE_MB 256.
+double model_cache_mb;
+
+
+/* Tables of the Klein-Nishina cross section and of the distribution of the energy
+change of Compton scattered photons, see compton_init_tables */
+#define KN_NX		121     // The number of photon energies in the tables
+#define KN_NZ		101     // The number of points in the inverse cumulative distribution
+#define KN_LOGXMIN	-4.0    // log10 (h nu / mec**2) at the lower end of the tables
+#define KN_LOGXMAX	2.0     // log10 (h nu / mec**2) at the upper end of the tables
+#define KN_DLOGX	((KN_LOGXMAX - KN_LOGXMIN) / (KN_NX - 1))
+
+
+/* The envelope used to choose directions in the thermal trapping scattering mode,
+see tt_get_envelope */
+#define TT_NMU		32      // The number of bins in mu
+#define TT_NPHI		64      // The number of bins in phi
+#define TT_NBIN		(TT_NMU * TT_NPHI)
+#define TT_NCACHE	256     // The number of envelopes which are retained
+
+
 /* Variable used to allow something to be printed out the first few times
    an even occurs */
 int itest, jtest;
@@ -1193,6 +1321,7 @@ struct xbands
   double min_fraction[NBANDS];
   double nat_fraction[NBANDS];  // The fraction of the accepted luminosity in this band
   double used_fraction[NBANDS];
+  double adapt_fraction[NBANDS];        // The fraction requested by bands_adapt for the next cycle, 0 until set
   double flux[NBANDS];          //The "luminosity" within a band
   double weight[NBANDS];
   int nphot[NBANDS];
@@ -1200,6 +1329,10 @@ struct xbands
 }
 xband;
 
+#define BAND_ADAPT_MIN  0.5     // The smallest factor by which bands_adapt may change the fraction in a band in one cycle
+#define BAND_ADAPT_MAX  2.0     // The largest factor by which bands_adapt may change the fraction in a band in one cycle
+#define BAND_ADAPT_FLOOR 1e-3   // The smallest fraction bands_adapt gives to a band which has flux
+
 
 /* The next section contains the freebound structures that can be used for both the
  * specific emissivity of a free-bound transition, and for the recombination coefficient
@@ -1282,9 +1415,54 @@ struct advanced_modes
   int fixed_temp;               // do not alter temperature from that set in the parameter file
   int zeus_connect;             // We are connecting to zeus, do not seek new temp and output a heating and cooling file
   int rand_seed_usetime;        // default random number seed is fixed, not based on time
+  int ioniz_acceleration;       // extrapolate t_e with Ng acceleration in the ionization cycles
+  int qmc_launch;               // launch photons with quasi-random rather than pseudo-random numbers
+  int adapt_bands;              // reallocate photons among bands each ionization cycle, see bands_adapt
+  int event_transport;          // advance a window of photons one step at a time in cell order, see trans_phot_event
+  int perf_timers;              // time the parts of the code where most of the time goes, see perf_report
 }
 modes;
 
+/* Timers and counters for the parts of the code in which most of the time is spent.  A timer is
+   started with t = perf_start () and stopped with perf_stop (PERF_..., t), which only read the 
+   clock if modes.perf_timers is set.  The counters are always incremented.  Both are written to 
+   the .perf file at the end of each cycle by perf_report */
+
+enum perf_timer_enum
+{
+  PERF_DEFINE_PHOT = 0,
+  PERF_TRANS_PHOT,
+  PERF_TRANSLATE_IN_WIND,
+  PERF_CALCULATE_DS,
+  PERF_RADIATION,
+  PERF_MATOM,
+  PERF_KPKT,
+  PERF_EXTRACT,
+  PERF_SPECTRUM_CREATE,
+  PERF_WIND_UPDATE,
+  PERF_ION_ABUNDANCES,
+  PERF_COMMUNICATE_ESTIMATORS,
+  PERF_WIND_SAVE,
+  NPERF_TIMER
+};
+
+enum perf_count_enum
+{
+  PERF_CELL_CROSSINGS = 0,      // steps of photons through a cell
+  PERF_RESONANCES_EXAMINED,     // resonances within the frequency range of a step
+  PERF_RESONANCES_ACCEPTED,     // of which the ion was dense enough to calculate the optical depth
+  PERF_SCATTERS,
+  PERF_EXTRACTIONS,             // photons extracted along one of the directions of the spectra
+  NPERF_COUNT
+};
+
+double perf_time[NPERF_TIMER];  // The time spent in each part of the code during this cycle
+long perf_ncall[NPERF_TIMER];   // and the number of times it was timed
+long perf_count[NPERF_COUNT];
+
+#define QMC_NDIM 8              // The number of quasi-random coordinates available to launch a photon
+int qmc_active;                 // 1 while photons are being launched with quasi-random numbers, see launch_rand
+
 
 FILE *optr;                     //pointer to a diagnostic file that will contain dvds information
 
@@ -1313,6 +1491,7 @@ struct filenames
   char spec_wind[LINELENGTH];   // .spec file for wind photons
   char lspec[LINELENGTH];       // .spec file
   char lspec_wind[LINELENGTH];  // .spec file for wind photons
+  char perf[LINELENGTH];        // .perf file of timers and counters
 }
 files;
 
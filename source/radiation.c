@@ -98,6 +98,7 @@ History:
 	        along ds.
 	1508	NSH slight modification to mean that compton scattering no longer reduces the weight of
 			the photon in this part of the code. It is now done when the photon scatters.
+	1703		The path estimators are now incremented in the separate plasma_est block
 **************************************************************/
 
 #include <stdio.h>
@@ -120,6 +121,7 @@ radiation (p, ds)
 
   WindPtr one;
   PlasmaPtr xplasma;
+  EstPtr xest;
 
   double freq;
   double kappa_tot, frac_tot, frac_ff;
@@ -150,6 +152,7 @@ radiation (p, ds)
 
   ndom = one->ndom;
   xplasma = &plasmamain[one->nplasma];
+  xest = xplasma->est;
   check_plasma (xplasma, "radiation");
 
   /* JM 140321 -- #73 Bugfix
@@ -434,7 +437,7 @@ radiation (p, ds)
 /* Everything after this is only needed for ionization calculations */
 /* Update the radiation parameters used ultimately in calculating t_r */
 
-  xplasma->ntot++;
+  xest->ntot++;
 
 
 
@@ -447,20 +450,20 @@ radiation (p, ds)
  */
 
   if (p->origin == PTYPE_STAR)
-    xplasma->ntot_star++;
+    xest->ntot_star++;
   else if (p->origin == PTYPE_BL)
-    xplasma->ntot_bl++;
+    xest->ntot_bl++;
   else if (p->origin == PTYPE_DISK)
-    xplasma->ntot_disk++;
+    xest->ntot_disk++;
   else if (p->origin == PTYPE_WIND)
-    xplasma->ntot_wind++;
+    xest->ntot_wind++;
   else if (p->origin == PTYPE_AGN)
-    xplasma->ntot_agn++;
+    xest->ntot_agn++;
 
 
 
-  if (p->freq > xplasma->max_freq)      // check if photon frequency exceeds maximum frequency
-    xplasma->max_freq = p->freq;
+  if (p->freq > xest->max_freq)      // check if photon frequency exceeds maximum frequency
+    xest->max_freq = p->freq;
 
   /* JM -- 1310 -- check if the user requires extra diagnostics and
      has provided a file diag_cells.dat to store photons stats for cells they have specified
@@ -477,9 +480,9 @@ radiation (p, ds)
   update_banded_estimators (xplasma, p, ds, w_ave);
 
 
-  if (sane_check (xplasma->j) || sane_check (xplasma->ave_freq))
+  if (sane_check (xest->j) || sane_check (xest->ave_freq))
   {
-    Error ("radiation:sane_check Problem with j %g or ave_freq %g\n", xplasma->j, xplasma->ave_freq);
+    Error ("radiation:sane_check Problem with j %g or ave_freq %g\n", xest->j, xest->ave_freq);
   }
 
 
@@ -509,7 +512,7 @@ radiation (p, ds)
       xplasma->heat_tot += z * frac_auger;      //All the inner shell opacities
       /* Calculate the number of photoionizations per unit volume for H and He 
          JM 1405 changed this to use freq_xs */
-      xplasma->nioniz++;
+      xest->nioniz++;
       q = (z) / (H * freq * xplasma->vol);
       /* So xplasma->ioniz for each species is just 
          (energy_abs)*kappa_h/kappa_tot / H*freq / volume
@@ -895,6 +898,7 @@ Notes:
 
 History:
    1402 JM 		Coding began
+   1703			Write to the plasma_est block of the cell through a local pointer
  
 **************************************************************/
 
@@ -906,25 +910,28 @@ update_banded_estimators (xplasma, p, ds, w_ave)
      double w_ave;
 {
   int i;
+  EstPtr xest;
+
+  xest = xplasma->est;
 
   /*photon weight times distance in the shell is proportional to the mean intensity */
-  xplasma->j += w_ave * ds;
+  xest->j += w_ave * ds;
 
   if (p->nscat == 0)
   {
-    xplasma->j_direct += w_ave * ds;
+    xest->j_direct += w_ave * ds;
   }
   else
   {
-    xplasma->j_scatt += w_ave * ds;
+    xest->j_scatt += w_ave * ds;
   }
 
 
 
 /* frequency weighted by the weights and distance       in the shell .  See eqn 2 ML93 */
-  xplasma->mean_ds += ds;
-  xplasma->n_ds++;
-  xplasma->ave_freq += p->freq * w_ave * ds;
+  xest->mean_ds += ds;
+  xest->n_ds++;
+  xest->ave_freq += p->freq * w_ave * ds;
 
 
 
@@ -943,19 +950,19 @@ update_banded_estimators (xplasma, p, ds, w_ave)
     if (geo.xfreq[i] < p->freq && p->freq <= geo.xfreq[i + 1])
     {
 
-      xplasma->xave_freq[i] += p->freq * w_ave * ds;    /* 1310 JM -- frequency weighted by weight and distance */
-      xplasma->xsd_freq[i] += p->freq * p->freq * w_ave * ds;   /* 1310 JM -- input to allow standard deviation to be calculated */
-      xplasma->xj[i] += w_ave * ds;     /* 1310 JM -- photon weight times distance travelled */
-      xplasma->nxtot[i]++;      /* 1310 JM -- increment the frequency banded photon counter */
+      xest->xave_freq[i] += p->freq * w_ave * ds;    /* 1310 JM -- frequency weighted by weight and distance */
+      xest->xsd_freq[i] += p->freq * p->freq * w_ave * ds;   /* 1310 JM -- input to allow standard deviation to be calculated */
+      xest->xj[i] += w_ave * ds;     /* 1310 JM -- photon weight times distance travelled */
+      xest->nxtot[i]++;      /* 1310 JM -- increment the frequency banded photon counter */
 
       /* 1311 NSH lines added below to work out the range of frequencies within a band where photons have been seen */
-      if (p->freq < xplasma->fmin[i])
+      if (p->freq < xest->fmin[i])
       {
-        xplasma->fmin[i] = p->freq;
+        xest->fmin[i] = p->freq;
       }
-      if (p->freq > xplasma->fmax[i])
+      if (p->freq > xest->fmax[i])
       {
-        xplasma->fmax[i] = p->freq;
+        xest->fmax[i] = p->freq;
       }
 
     }
@@ -979,20 +986,20 @@ update_banded_estimators (xplasma, p, ds, w_ave)
 
     /* IP needs to be radiation density in the cell. We sum wcontributions from
        each photon, then it is normalised in wind_update. */
-    xplasma->ip += ((w_ave * ds) / (H * p->freq));
+    xest->ip += ((w_ave * ds) / (H * p->freq));
 
     if (HEV * p->freq < 13600)  //Tartar et al integrate up to 1000Ryd to define the ionization parameter
     {
-      xplasma->xi += (w_ave * ds);
+      xest->xi += (w_ave * ds);
     }
 
     if (p->nscat == 0)
     {
-      xplasma->ip_direct += ((w_ave * ds) / (H * p->freq));
+      xest->ip_direct += ((w_ave * ds) / (H * p->freq));
     }
     else
     {
-      xplasma->ip_scatt += ((w_ave * ds) / (H * p->freq));
+      xest->ip_scatt += ((w_ave * ds) / (H * p->freq));
     }
   }
 
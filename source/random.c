@@ -5,6 +5,7 @@
 
 #include "atomic.h"
 #include "python.h"
+#include <gsl/gsl_qrng.h>
 
 
 #
@@ -27,6 +28,9 @@
    a random number between 0 and 2 PI representing phi and between
    -1 and 1 representing cos(phi).   
 
+   1703 The random numbers come from launch_rand, so that they are
+   quasi-random when photons are being launched in that mode
+
  */
 
 int
@@ -36,10 +40,10 @@ randvec (a, r)
 
   double costheta, sintheta, phi, sinphi, cosphi;
 
-  phi = 2. * PI * (rand () / MAXRAND);
+  phi = 2. * PI * launch_rand ();
   sinphi = sin (phi);
   cosphi = cos (phi);
-  costheta = 2. * (rand () / MAXRAND) - 1.;
+  costheta = 2. * launch_rand () - 1.;
   sintheta = sqrt (1. - costheta * costheta);
   a[0] = r * cosphi * sintheta;
   a[1] = r * sinphi * sintheta;
@@ -59,6 +63,8 @@ at which the photon originates.
 History:
 	02jan	ksl	Add jumps array and modified call to pdf_gen_from_func so to taylor the
 			pdf_array to include more points near 90 degrees.
+	1703	Use launch_rand, and pdf_get_x so that a single quasi-random number
+		determines the polar angle, when photons are launched in that mode
 */
 
 double zzz[] = { 0.0, 0.0, 1.0 };
@@ -97,7 +103,10 @@ randvcos (lmn, north)
   }
 
 
-  n = pdf_get_rand (&pdf_vcos);
+  if (qmc_active)
+    n = pdf_get_x (&pdf_vcos, launch_rand ());
+  else
+    n = pdf_get_rand (&pdf_vcos);
   q = sqrt (1. - n * n);
 
 //  The next set of lines are all wrong
@@ -109,7 +118,7 @@ randvcos (lmn, north)
 //  m *= q / s;                 /* So at this point we have the direction cosines in the rotated frame */
 // The is the correct approach to generating a uniform azimuthal distribution
 
-  phi = 2. * PI * (rand () / MAXRAND);
+  phi = 2. * PI * launch_rand ();
   l = q * cos (phi);
   m = q * sin (phi);
 
@@ -158,3 +167,119 @@ vcos (x)
   z = x * (a * (1. + b * x));
   return (z);
 }
+
+
+
+/***********************************************************
+                University of Southampton
+
+Synopsis:
+	qmc_start(), qmc_next_photon(), qmc_stop() and launch_rand()
+	provide quasi-random numbers for launching photons
+
+Arguments:		
+
+Returns:
+	launch_rand returns a number between 0 and 1
+ 
+Description:	
+
+	Photons are normally launched using pseudo-random numbers.  If 
+	modes.qmc_launch is set, the positions and directions of photons 
+	from the star, boundary layer, disk and agn are instead generated
+	from a Sobol sequence, which covers the space of launch parameters 
+	more evenly, and so reduces the variance of the launch.
+
+	A routine which generates photons calls qmc_start before it begins
+	and qmc_stop when it finishes, and qmc_next_photon before each photon.
+	Each call to launch_rand then returns the next coordinate of the 
+	current point of the sequence, until the QMC_NDIM coordinates have
+	been used, when it reverts to rand().  Outside qmc_start and qmc_stop, 
+	or if modes.qmc_launch is not set, launch_rand simply returns 
+	rand()/MAXRAND, so replacing rand()/MAXRAND with launch_rand does
+	not change the sequence of pseudo-random numbers.
+
+	The sequence is restarted by each call to qmc_start, and is given
+	a random shift (modulo 1) in each dimension (Cranley-Patterson 
+	rotation), so that the estimates from each set of photons remain
+	unbiased and independent between cycles and between threads. 
+
+Notes:
+	Only the launch uses quasi-random numbers.  The transport of photons
+	continues to use pseudo-random numbers.
+
+	The frequencies of photons are still generated with pseudo-random
+	numbers, except for uniform spectra.
+
+History:
+	1703	Coded
+ 
+**************************************************************/
+
+gsl_qrng *qmc_gen = NULL;
+int qmc_dim;                    // The next coordinate of qmc_point to be used
+double qmc_point[QMC_NDIM], qmc_shift[QMC_NDIM];
+
+int
+qmc_start ()
+{
+  int n;
+
+  if (modes.qmc_launch == 0)
+    return (0);
+
+  if (qmc_gen == NULL)
+    qmc_gen = gsl_qrng_alloc (gsl_qrng_sobol, QMC_NDIM);
+  else
+    gsl_qrng_init (qmc_gen);
+
+  for (n = 0; n < QMC_NDIM; n++)
+    qmc_shift[n] = rand () / MAXRAND;
+
+  /* The first point of a Sobol sequence is the origin, which is skipped */
+  gsl_qrng_get (qmc_gen, qmc_point);
+
+  qmc_dim = QMC_NDIM;
+  qmc_active = 1;
+
+  return (0);
+}
+
+
+int
+qmc_next_photon ()
+{
+  int n;
+
+  if (qmc_active == 0)
+    return (0);
+
+  gsl_qrng_get (qmc_gen, qmc_point);
+  for (n = 0; n < QMC_NDIM; n++)
+  {
+    qmc_point[n] += qmc_shift[n];
+    if (qmc_point[n] >= 1.)
+      qmc_point[n] -= 1.;
+  }
+  qmc_dim = 0;
+
+  return (0);
+}
+
+
+int
+qmc_stop ()
+{
+  qmc_active = 0;
+  return (0);
+}
+
+
+double
+launch_rand ()
+{
+  if (qmc_active && qmc_dim < QMC_NDIM)
+    return (qmc_point[qmc_dim++]);
+
+  return (rand () / MAXRAND);
+}
@@ -465,6 +465,15 @@ total_fb (one, t, f1, f2, mode)
 	most of the problems with the routine, and so I have not pursued that.
 
 	060802 -- ksl
+
+	1703 -- The cdf for each plasma cell is now retained in fbstoremain, so that
+	it only has to be regenerated when the frequency limits, or the conditions in 
+	the cell, change.  fb_store_invalidate marks all of the cdfs as out of date
+	after the ionization state of the wind has been updated.  photo_gen_wind 
+	generates all of the photons from one cell together, so the pdf from a single
+	cell is no longer shared among cells with similar temperatures, and the 
+	photons which used to be stored in photstoremain are no longer needed.
+	The memory used by all the cdfs is limited to FBSTORE_MB, see fb_store_trim.
                                                                                                    
                                                                                                    
   History:
@@ -479,6 +488,8 @@ total_fb (one, t, f1, f2, mode)
 			the same conditions.  This reduces very significantly
 			the number of times one has to construct a pdf, which is
 			the main time sink for the program
+	1703		Retain the cdf of each cell in fbstoremain, replacing
+			both the single pdf and photstoremain
                                                                                                    
  ************************************************************************/
 
@@ -488,24 +499,23 @@ double fb_jumps[NLEVELS];       // There is at most one jump per level
 int fb_njumps = (-1);
 
 WindPtr ww_fb;
-struct Pdf pdf_fb;
-double one_fb_f1, one_fb_f2, one_fb_te; /* Old values */
+double one_fb_f1, one_fb_f2;    /* The frequency limits for which the jumps were found */
 
 double
 one_fb (one, f1, f2)
      WindPtr one;               /* a single cell */
      double f1, f2;             /* freqmin and freqmax */
 {
-  double freq, tt, delta;
+  double freq, tt;
   int n;
   double fthresh, dfreq;
   int nplasma;
   PlasmaPtr xplasma;
-  PhotStorePtr xphot;
+  FbStorePtr xstore;
 
   nplasma = one->nplasma;
   xplasma = &plasmamain[nplasma];
-  xphot = &photstoremain[nplasma];
+  xstore = &fbstoremain[nplasma];
 
   if (f2 < f1)
   {
@@ -513,31 +523,21 @@ one_fb (one, f1, f2)
     exit (0);
   }
 
-/* Check if an apprpriate photon frequency has already been generated, and 
-use that instead if possible --  57h */
+  /* Check to see if we have already generated a pdf for this cell */
   tt = xplasma->t_e;
-  if (xphot->n < NSTORE && xphot->f1 == f1 && xphot->f2 == f2 && xphot->t == tt)
-  {
-    freq = xphot->freq[xphot->n];
-//TEST      Log("one_fb:  Using precalculated fb  %d \n",xphot->n);
-    (xphot->n)++;
-    return (freq);
-  }
-//TEST  else {
-//TEST  Log("one_fb %3d %3d f %8.2e %8.2e %8.2e %8.2e t %6.1f %6.1f\n",nplasma,xphot->n,f1,f2,xphot->f1,xphot->f2,tt,xphot->t);
-//TEST
-//TEST}
-
-
-  delta = 500;                  // Fudge factor to prevent generation a photon if t has changed only slightly
-  /* Check to see if we have already generated a pdf */
-  if (tt > (one_fb_te + delta) || tt < (one_fb_te - delta) || f1 != one_fb_f1 || f2 != one_fb_f2)
+  if (xstore->valid == 0 || xstore->t != tt || f1 != xstore->f1 || f2 != xstore->f2)
   {
 
 /* Then need to generate a new pdf */
 
     ww_fb = one;
 
+    if (xstore->pdf == NULL && (xstore->pdf = (PdfPtr) calloc (sizeof (pdf_dummy), 1)) == NULL)
+    {
+      Error ("one_fb: Could not allocate memory for the cdf of cell %d\n", nplasma);
+      exit (0);
+    }
+
     /* Create the fb_array */
 
     /* Determine how many intervals are between f1 and f2.  These need to be
@@ -555,6 +555,8 @@ use that instead if possible --  57h */
           fb_njumps++;
         }
       }                         //IS THIS CORRECT? (SS, MAY04)
+      one_fb_f1 = f1;
+      one_fb_f2 = f2;
     }
 
 
@@ -573,38 +575,124 @@ use that instead if possible --  57h */
       fb_y[n] = fb (xplasma, xplasma->t_e, fb_x[n], nions, 0);
     }
 
-    if (pdf_gen_from_array (&pdf_fb, fb_x, fb_y, 200, f1, f2, fb_njumps, fb_jumps) != 0)
+    if (pdf_gen_from_array (xstore->pdf, fb_x, fb_y, 200, f1, f2, fb_njumps, fb_jumps) != 0)
     {
       Error ("one_fb after error: f1 %g f2 %g te %g ne %g nh %g vol %g\n",
              f1, f2, xplasma->t_e, xplasma->ne, xplasma->density[1], one->vol);
       Error ("Giving up");
       exit (0);
     }
-    one_fb_te = xplasma->t_e;
-    one_fb_f1 = f1;
-    one_fb_f2 = f2;             /* Note that this may not be the best way to check for a previous pdf */
+    xstore->valid = 1;
+    xstore->t = tt;
+    xstore->f1 = f1;
+    xstore->f2 = f2;
+
+    /* Keep track of the memory used by the cdfs, which may have grown, and discard those 
+       of other cells if there is too much */
+    fbstore_bytes -= xstore->nbytes;
+    xstore->nbytes = xstore->pdf->nalloc * (3 * sizeof (double) + sizeof (int));
+    fbstore_bytes += xstore->nbytes;
+    if (fbstore_bytes > FBSTORE_MB * 1.e6)
+      fb_store_trim (nplasma);
   }
 
-/* OK, we have not created a new pdf, cdf actually.  We are in a position to
+/* OK, we have a pdf, cdf actually, for this cell.  We are in a position to
 generate photons */
 
-  //Debug ("one_fb, got here 2\n");
+  freq = pdf_get_rand (xstore->pdf);
 
-/* First generate the phton we need */
-  freq = pdf_get_rand (&pdf_fb);
+  return (freq);
+}
 
-/* Now create and store for future use a set of additonal photons */
 
-  for (n = 0; n < NSTORE; n++)
-  {
-    xphot->freq[n] = pdf_get_rand (&pdf_fb);
 
+/**************************************************************************
+                    Southampton University
+                                                                                                   
+                                                                                                   
+  Synopsis: fb_store_invalidate marks the free bound cdfs of all of the 
+	plasma cells as out of date
+                                                                                                   
+  Description:
+                                                                                                   
+  Arguments:  
+                                                                                                   
+  Returns:
+	0
+                                                                                                   
+  Notes:
+	The cdf depends on the ion densities as well as on t_e, so this must
+	be called whenever the ionization state of the wind is updated.  The 
+	memory allocated for the cdfs is retained.
+                                                                                                   
+  History:
+	1703	Coded
+                                                                                                   
+ ************************************************************************/
+
+int
+fb_store_invalidate ()
+{
+  int n;
+
+  if (fbstoremain == NULL)
+    return (0);
+
+  for (n = 0; n < fbstore_nelem; n++)
+    fbstoremain[n].valid = 0;
+
+  return (0);
+}
+
+
+
+/**************************************************************************
+                    Southampton University
+                                                                                                   
+                                                                                                   
+  Synopsis: fb_store_trim discards the free bound cdfs of other cells until
+	the memory they use is less than FBSTORE_MB
+                                                                                                   
+  Description:
+	The cells are visited in turn, starting from where the last call 
+	stopped, so that the cdfs which are discarded are those which have 
+	been kept longest, and each call only does as much work as is needed.
+                                                                                                   
+  Arguments:  
+	int nkeep	the cell whose cdf is in use and must be kept
+                                                                                                   
+  Returns:
+	0
+                                                                                                   
+  Notes:
+	The arrays of the cdf are freed, and the cdf is marked invalid, so one_fb
+	will simply regenerate it if it is needed again.
+                                                                                                   
+  History:
+	1703	Coded
+                                                                                                   
+ ************************************************************************/
+
+int
+fb_store_trim (nkeep)
+     int nkeep;
+{
+  int n;
+  FbStorePtr xstore;
+
+  for (n = 0; n < fbstore_nelem && fbstore_bytes > FBSTORE_MB * 1.e6; n++)
+  {
+    fbstore_next = (fbstore_next + 1) % fbstore_nelem;
+    xstore = &fbstoremain[fbstore_next];
+    if (fbstore_next == nkeep || xstore->pdf == NULL || xstore->nbytes == 0)
+      continue;
+    pdf_free (xstore->pdf);
+    fbstore_bytes -= xstore->nbytes;
+    xstore->nbytes = 0;
+    xstore->valid = 0;
   }
-  xphot->n = 0;
-  xphot->t = tt;
-  xphot->f1 = f1;
-  xphot->f2 = f2;
-  return (freq);
+
+  return (0);
 }
 
 
@@ -88,6 +88,9 @@ History:
     1508  nsh	changes to allow compton scattering to replace thomoson scattering.
 
 	1509	ksl	Added domain support
+	1703		Interpolate the ion densities along the step with
+			ray_interp_ion_density, rather than calling
+			get_ion_density for each resonance
 **************************************************************/
 
 struct photon cds_phot_old;
@@ -115,7 +118,8 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
   double v_check[3], vch, vc;
   double dvds1, dvds2;
   struct photon phot, p_now;
-  int init_dvds;
+  int init_dvds, init_interp;
+  struct ray_interp ri;
   double kap_bf_tot, kap_ff, kap_cont;
   double tau_sobolev;
   WindPtr one, two;
@@ -136,7 +140,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
 
   ttau = *tau;
   ds_current = 0;
-  init_dvds = 0;
+  init_dvds = init_interp = 0;
   dvds1 = dvds2 = 0.0;          // To avoid a -03 compile warning
   *nres = -1;
   *istat = P_INWIND;
@@ -296,6 +300,7 @@ method). If the macro atom method is not used just get kap_bf to 0 and move on).
     if (0. < x && x < 1.)
     {                           /* this particular line is in resonance */
       ds = x * smax;
+      perf_count[PERF_RESONANCES_EXAMINED]++;
 
 
 /* Before checking for a resonant scatter, need to check for scattering due to a continuum
@@ -324,24 +329,30 @@ process. */
         kkk = lin_ptr[nn]->nion;
 
 
-        /* The density is calculated in the wind array at the center of a cell.  We use
-           that as the first estimate of the density.  So don't delete the next line.  However, we 
-           can do better except  at the edges of the grid.   01apr07 ksl.  ??? One could still do 
-           better than this since even if we can usually interpolate in one direction if not two ???
-         */
-        stuff_phot (p, &p_now);
-        move_phot (&p_now, ds_current); // So p_now contains the current position of the photon
+        /* The density is interpolated between its values at the two ends of the step, which are
+           themselves interpolated from the cell centers.  The weights at the ends are found once, 
+           the first time a resonance is reached, rather than searching the grid for each of what 
+           may be many resonances, see ray_interp_init */
+
+        if (init_interp == 0)
+        {
+          ray_interp_init (ndom, p->x, phot.x, &ri);
+          init_interp = 1;
+        }
 
 
-        //?? It looks like this if statement could be moved up higher, possibly above the xrho line if willing to accept cruder dd estimate
         //If the density of the ion is very small we shouldn't have to worry about a resonance, but otherwise
         // ?? This seems like an incredibly small number; how can anything this small affect anything ??
 
 
-        dd = get_ion_density (ndom, p_now.x, kkk);
+        dd = ray_interp_ion_density (&ri, x, kkk);
 
         if (dd > LDEN_MIN)
         {
+          perf_count[PERF_RESONANCES_ACCEPTED]++;
+          stuff_phot (p, &p_now);
+          move_phot (&p_now, ds_current);       // So p_now contains the current position of the photon
+
           /* If we have reached this point then we have to initalize dvds1 and dvds2. Otherwise
              there is no need to do this, especially as dvwind_ds is an expensive calculation time wise */
 
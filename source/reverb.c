@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stddef.h>
 #include <errno.h>
 #include "atomic.h"
 #include "python.h"
@@ -18,6 +19,20 @@ char delay_dump_file[LINELENGTH];
 int delay_dump_bank_size = 65535, delay_dump_bank_curr = 0;
 int *delay_dump_spec;
 PhotPtr delay_dump_bank;
+FILE *delay_dump_fptr = NULL;
+char *delay_dump_buf = NULL;
+
+#define DELAY_DUMP_BUFSIZE	(1 << 22)       //Size of the stdio buffer for the dump file
+#define DELAY_DUMP_HEADER	1024    //Length of the text header at the start of a binary dump file
+
+/* One record of a binary delay dump file.  The layout is written into the header of each
+   file by delay_dump_header(), so the files can be read without reference to this code */
+typedef struct delay_rec
+{
+  double freq, w, delay;
+  double x[3];
+  int nscat, nrscat, spec, origin, nres;
+} delay_rec_dummy;
 
 /**********************************************************/
 /** @name 	delay_to_observer
@@ -67,7 +82,6 @@ delay_to_observer (PhotPtr pp)
 int
 delay_dump_prep (int restart_stat)
 {
-  FILE *fptr;
   char s_time[LINELENGTH];
   int i;
 
@@ -84,37 +98,85 @@ delay_dump_prep (int restart_stat)
   //Allocate and zero dump files and set extract status
   delay_dump_bank = (PhotPtr) calloc (sizeof (p_dummy), delay_dump_bank_size);
   delay_dump_spec = (int *) calloc (sizeof (int), delay_dump_bank_size);
+  delay_dump_bank_curr = 0;
   for (i = 0; i < delay_dump_bank_size; i++)
     delay_dump_spec[i] = 0;
 
+  //The file is kept open, with a large buffer, until delay_dump_finish()
+  delay_dump_fptr = fopen (delay_dump_file, restart_stat == 1 ? "a" : "w");
+  if (delay_dump_fptr == NULL)
+  {
+    Error ("delay_dump_prep: Thread %d failed to open file '%s' due to error %d: %s\n", rank_global, delay_dump_file, errno,
+           strerror (errno));
+    exit (0);
+  }
+  delay_dump_buf = (char *) malloc (DELAY_DUMP_BUFSIZE);
+  setvbuf (delay_dump_fptr, delay_dump_buf, _IOFBF, DELAY_DUMP_BUFSIZE);
+
   if (restart_stat == 1)
   {                             //Check whether the output file already has a header
     Log ("delay_dump_prep: Resume run, skipping writeout\n");
     return (0);
   }
 
-
-  if ((fptr = fopen (delay_dump_file, "w")) != NULL)
-  {                             //If this isn't a continue run, prep the output file
-    if (rank_global > 0)
-    {
-      fprintf (fptr, "# Delay dump file for slave process %d\n", rank_global);
-    }
-    else
-    {                           // Construct and write a header string for the output file
-      fprintf (fptr, "# Python Version %s\n", VERSION);
-      get_time (s_time);
-      fprintf (fptr, "# Date	%s\n#  \n", s_time);
-      fprintf (fptr, "# \n#    Freq.     Lambda     Weight      Last X      Last Y      Last Z Scat. RScat      Delay Spec. Orig.  Res.\n");
-    }
-    fclose (fptr);
-    Log ("delay_dump_prep: Thread %d successfully prepared file '%s' for writing\n", rank_global, delay_dump_file);
+  if (geo.reverb_dump == REV_DUMP_BINARY)
+  {                             //Every binary shard carries the same self-describing header
+    delay_dump_header (delay_dump_fptr);
   }
-  else
+  else if (rank_global > 0)
   {
-    Error ("delay_dump_prep: Thread %d failed to open file '%s' due to error %d: %s\n", rank_global, delay_dump_file, errno,
-           strerror (errno));
+    fprintf (delay_dump_fptr, "# Delay dump file for slave process %d\n", rank_global);
   }
+  else
+  {                             // Construct and write a header string for the output file
+    fprintf (delay_dump_fptr, "# Python Version %s\n", VERSION);
+    get_time (s_time);
+    fprintf (delay_dump_fptr, "# Date	%s\n#  \n", s_time);
+    fprintf (delay_dump_fptr,
+             "# \n#    Freq.     Lambda     Weight      Last X      Last Y      Last Z Scat. RScat      Delay Spec. Orig.  Res.\n");
+  }
+  Log ("delay_dump_prep: Thread %d successfully prepared file '%s' for writing\n", rank_global, delay_dump_file);
+  return (0);
+}
+
+/**********************************************************/
+/** @name 	delay_dump_header
+ * @brief	Writes the header of a binary delay dump file
+ *
+ * @param [in] fptr			Open dump file
+ * @return 					0
+ *
+ * The header is DELAY_DUMP_HEADER bytes of text, padded with
+ * spaces and ending in a newline, so that 'head' shows it and
+ * the records start at a fixed offset. It gives the record
+ * length and the name, type and byte offset of each column,
+ * e.g. freq:f8:0, which is enough to build a numpy dtype.
+ *
+ * @notes
+ * 1703	-	Written
+***********************************************************/
+int
+delay_dump_header (FILE * fptr)
+{
+  char header[DELAY_DUMP_HEADER + 1], s_time[LINELENGTH];
+  int n;
+
+  get_time (s_time);
+  n = sprintf (header, "# Python Version %s\n# Date %s\n# Delay dump, rank %d\n", VERSION, s_time, rank_global);
+  n += sprintf (header + n, "# Binary records of %d bytes start at byte %d\n", (int) sizeof (delay_rec_dummy), DELAY_DUMP_HEADER);
+  n += sprintf (header + n, "# Columns freq:f8:%d w:f8:%d delay:f8:%d x:f8:%d y:f8:%d z:f8:%d",
+                (int) offsetof (delay_rec_dummy, freq), (int) offsetof (delay_rec_dummy, w), (int) offsetof (delay_rec_dummy, delay),
+                (int) offsetof (delay_rec_dummy, x), (int) (offsetof (delay_rec_dummy, x) + sizeof (double)),
+                (int) (offsetof (delay_rec_dummy, x) + 2 * sizeof (double)));
+  n += sprintf (header + n, " nscat:i4:%d nrscat:i4:%d spec:i4:%d origin:i4:%d nres:i4:%d\n",
+                (int) offsetof (delay_rec_dummy, nscat), (int) offsetof (delay_rec_dummy, nrscat), (int) offsetof (delay_rec_dummy, spec),
+                (int) offsetof (delay_rec_dummy, origin), (int) offsetof (delay_rec_dummy, nres));
+
+  while (n < DELAY_DUMP_HEADER - 1)
+    header[n++] = ' ';
+  header[n++] = '\n';
+
+  fwrite (header, 1, DELAY_DUMP_HEADER, fptr);
   return (0);
 }
 
@@ -124,19 +186,25 @@ delay_dump_prep (int restart_stat)
  *
  * @return 					0
  *
- * Dumps the remaining tracked photons to file, frees memory.
+ * Dumps the remaining tracked photons to file, closes it and 
+ * frees memory.
  *
  * @notes
  * 6/15	-	Written by SWM
+ * 1703	-	Close the dump file, which is now kept open. Dump the
+ * 			last banked photon, which was previously dropped
 ***********************************************************/
 int
 delay_dump_finish (void)
 {
-  Log ("delay_dump_finish: Dumping %d photons to file\n", delay_dump_bank_curr - 1);
+  Log ("delay_dump_finish: Dumping %d photons to file\n", delay_dump_bank_curr);
   if (delay_dump_bank_curr > 0)
   {
-    delay_dump (delay_dump_bank, delay_dump_bank_curr - 1);
+    delay_dump (delay_dump_bank, delay_dump_bank_curr);
   }
+  fclose (delay_dump_fptr);
+  delay_dump_fptr = NULL;
+  free (delay_dump_buf);
   free (delay_dump_bank);
   free (delay_dump_spec);
   return (0);
@@ -150,44 +218,79 @@ delay_dump_finish (void)
  * @return 					0
  *
  * Collects all the delay dump files together at the end. 
- * Called by the master thread. Uses 'cat' for simplicity.
+ * Called by the master thread, and also at the end of a serial
+ * run with i_ranks of 1. Text files from the other
+ * threads are appended to the master file and removed. Binary
+ * files are left as one shard per thread, and an index file
+ * root.delay_dump.index lists each shard and its number of
+ * records, so that nothing of size has to be copied.
  *
  * @notes
  * 6/15	-	Written by SWM
+ * 1703	-	Copy the files directly rather than through a system
+ * 			call to cat and rm, and add the index of binary shards
+ * 1703	-	Also called in serial runs, so a binary dump always has its index
 ***********************************************************/
 int
 delay_dump_combine (int i_ranks)
 {
-  FILE *fopen ();               //, *f_base, *f_cat;
-  char c_call[LINELENGTH];      //, c_cat[LINELENGTH], c_char;
-  //int i;
-/*
-	f_base = fopen(delay_dump_file, 'a');
-	for(i=1;i<iRanks;i++)
-	{
-		sprintf(c_cat, "%s%d", c_cat, i);
-		if((f_cat = fopen(c_cat, 'r')) == NULL)
-			Error("delay_dump_combine: Missing file %s%d", c_cat,i);
-		else
-			while((c_char = fgetc(f_cat)) != EOF) fputc(c_char, f_base);
-		fclose(f_cat);
-	}
-	fclose(f_base);
-*/
-  //Yes this is done as a system call and won 't work on Windows machines. Lazy solution!
-  sprintf (c_call, "cat %s[0-9]* >> %s", delay_dump_file, delay_dump_file);
-  if (system (c_call) < 0)
+  FILE *f_base, *f_cat;
+  char c_cat[LINELENGTH + 16], *buffer;       //Room for the rank or .index suffix
+  long nrec;
+  size_t n;
+  int i;
+
+  if (geo.reverb_dump == REV_DUMP_BINARY)
   {
-    Error ("delay_dump_combine: Error calling system command '%s'", c_call);
+    sprintf (c_cat, "%s.index", delay_dump_file);
+    if ((f_base = fopen (c_cat, "w")) == NULL)
+    {
+      Error ("delay_dump_combine: Unable to open %s\n", c_cat);
+      return (0);
+    }
+    fprintf (f_base, "# Shard  Records   (records of %d bytes start at byte %d of each shard)\n", (int) sizeof (delay_rec_dummy),
+             DELAY_DUMP_HEADER);
+    for (i = 0; i < i_ranks; i++)
+    {
+      if (i == 0)
+        sprintf (c_cat, "%s", delay_dump_file);
+      else
+        sprintf (c_cat, "%s%d", delay_dump_file, i);
+      if ((f_cat = fopen (c_cat, "r")) == NULL)
+      {
+        Error ("delay_dump_combine: Missing file %s\n", c_cat);
+        continue;
+      }
+      fseek (f_cat, 0, SEEK_END);
+      nrec = (ftell (f_cat) - DELAY_DUMP_HEADER) / (long) sizeof (delay_rec_dummy);
+      fclose (f_cat);
+      fprintf (f_base, "%s %ld\n", c_cat, nrec);
+    }
+    fclose (f_base);
+    return (0);
   }
-  else
+
+  if ((f_base = fopen (delay_dump_file, "a")) == NULL)
+  {
+    Error ("delay_dump_combine: Unable to reopen %s\n", delay_dump_file);
+    return (0);
+  }
+  buffer = (char *) malloc (DELAY_DUMP_BUFSIZE);
+  for (i = 1; i < i_ranks; i++)
   {
-    sprintf (c_call, "rm %s[0-9]*", delay_dump_file);
-    if (system (c_call) < 0)
+    sprintf (c_cat, "%s%d", delay_dump_file, i);
+    if ((f_cat = fopen (c_cat, "r")) == NULL)
     {
-      Error ("delay_dump_combine: Error calling system command '%s'", c_call);
+      Error ("delay_dump_combine: Missing file %s\n", c_cat);
+      continue;
     }
+    while ((n = fread (buffer, 1, DELAY_DUMP_BUFSIZE, f_cat)) > 0)
+      fwrite (buffer, 1, n, f_base);
+    fclose (f_cat);
+    remove (c_cat);
   }
+  free (buffer);
+  fclose (f_base);
   return (0);
 }
 
@@ -204,27 +307,29 @@ delay_dump_combine (int i_ranks)
  * if they've scattered or were generated in the wind and so
  * contribute to the delay map. Uses the same filters as 
  * the spectra_create() function for scatters & angles.
+ * Photons are written as text lines, or as delay_rec 
+ * records if a binary dump was requested.
  *
  * @notes
  * 6/15	-	Written by SWM
+ * 1703	-	Write to the open, buffered file; added binary records
 ***********************************************************/
 int
 delay_dump (PhotPtr p, int np)
 {
-  FILE *fopen (), *fptr;
-  int nphot, mscat, mtopbot, i, subzero;
+  int nphot, mscat, mtopbot, i, subzero, nrec;
   double delay;
+  delay_rec_dummy *rec;
   subzero = 0;
+  nrec = 0;
+  rec = NULL;
 
   Log ("delay_dump: Dumping %d photons\n", np);
-  /*
-   * Open a file for writing the spectrum
-   */
-  if ((fptr = fopen (delay_dump_file, "a")) == NULL)
+  if (geo.reverb_dump == REV_DUMP_BINARY)
   {
-    Error ("delay_dump: Unable to reopen %s for writing\n", delay_dump_file);
-    exit (0);
+    rec = (delay_rec_dummy *) calloc (sizeof (delay_rec_dummy), np);
   }
+
   for (nphot = 0; nphot < np; nphot++)
   {
     /*
@@ -246,19 +351,38 @@ delay_dump (PhotPtr p, int np)
       if (delay < 0)
         subzero++;
 
-      fprintf (fptr,
-               "%10.5g %10.5g %10.5g %+10.5g %+10.5g %+10.5g %5d %5d %10.5g %5d %5d %5d\n",
-               p[nphot].freq, C * 1e8 / p[nphot].freq, p[nphot].w,
-               p[nphot].x[0], p[nphot].x[1], p[nphot].x[2],
-               p[nphot].nscat, p[nphot].nrscat, delay, i - MSPEC, p[nphot].origin_orig, p[nphot].nres);
+      if (geo.reverb_dump == REV_DUMP_BINARY)
+      {
+        rec[nrec].freq = p[nphot].freq;
+        rec[nrec].w = p[nphot].w;
+        rec[nrec].delay = delay;
+        stuff_v (p[nphot].x, rec[nrec].x);
+        rec[nrec].nscat = p[nphot].nscat;
+        rec[nrec].nrscat = p[nphot].nrscat;
+        rec[nrec].spec = i - MSPEC;
+        rec[nrec].origin = p[nphot].origin_orig;
+        rec[nrec].nres = p[nphot].nres;
+        nrec++;
+      }
+      else
+        fprintf (delay_dump_fptr,
+                 "%10.5g %10.5g %10.5g %+10.5g %+10.5g %+10.5g %5d %5d %10.5g %5d %5d %5d\n",
+                 p[nphot].freq, C * 1e8 / p[nphot].freq, p[nphot].w,
+                 p[nphot].x[0], p[nphot].x[1], p[nphot].x[2],
+                 p[nphot].nscat, p[nphot].nrscat, delay, i - MSPEC, p[nphot].origin_orig, p[nphot].nres);
     }
   }
 
+  if (geo.reverb_dump == REV_DUMP_BINARY)
+  {
+    fwrite (rec, sizeof (delay_rec_dummy), nrec, delay_dump_fptr);
+    free (rec);
+  }
+
   if (subzero > 0)
   {
     Error ("delay_dump: %d photons with <0 delay found! Increase path bin resolution to minimise this error.", subzero);
   }
-  fclose (fptr);
   return (0);
 }
 
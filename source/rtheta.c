@@ -138,6 +138,7 @@ History:
 			with the fact that somoe of the dummy cells
 			extended into the -z plane. This change amoutns to changing 
 			the way the boundary contintion are set up.
+	1703	Optionally refine the grid, see rtheta_refine_grid
 
 **************************************************************/
 
@@ -225,11 +226,107 @@ rtheta_make_grid (w, ndom)
 
     }
   }
+
+  if (zdom[ndom].refine > 0)
+    rtheta_refine_grid (ndom, w);
+
   rtheta_make_cones (ndom, w);
   return (0);
 }
 
 
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	rtheta_refine_grid moves the grid lines of an rtheta grid
+	made by rtheta_make_grid toward regions where the density
+	and velocity change rapidly
+
+Arguments:		
+	int ndom;	The domain
+	WindPtr w;	The structure which defines the wind in Python
+ 
+Returns:
+ 
+Description:
+	In r, the first and last grid lines are kept; in theta, the
+	lines at 0 and 90 degrees and those beyond 90 degrees are kept. 
+	The lines between are placed by grid_refine_axis, theta
+	always being refined linearly.  The cell centers are the 
+	midpoints of the new vertices.
+
+History:
+	1703	Coded
+
+**************************************************************/
+
+int
+rtheta_refine_grid (ndom, w)
+     int ndom;
+     WindPtr w;
+{
+  double *ra, *ta;
+  double theta, thetacen;
+  int i, j, n, ndim, mdim;
+
+  ndim = zdom[ndom].ndim;
+  mdim = zdom[ndom].mdim;
+
+  ra = calloc (sizeof (double), ndim);
+  ta = calloc (sizeof (double), mdim);
+
+  for (i = 0; i < ndim; i++)
+  {
+    wind_ij_to_n (ndom, i, 0, &n);
+    ra[i] = w[n].r;
+  }
+  for (j = 0; j < mdim; j++)
+  {
+    wind_ij_to_n (ndom, 0, j, &n);
+    ta[j] = w[n].theta;
+  }
+
+  grid_refine_axis (ndom, 0, ra, 1, ndim - 2, (zdom[ndom].log_linear == 0), ta, 0, mdim - 3);
+  grid_refine_axis (ndom, 1, ta, 0, mdim - 3, 0, ra, 1, ndim - 2);
+
+  for (i = 0; i < ndim; i++)
+  {
+    for (j = 0; j < mdim; j++)
+    {
+      wind_ij_to_n (ndom, i, j, &n);
+      w[n].r = ra[i];
+      w[n].theta = ta[j];
+      if (i < ndim - 1)
+        w[n].rcen = 0.5 * (ra[i] + ra[i + 1]);
+      if (j < mdim - 1)
+        w[n].thetacen = 0.5 * (ta[j] + ta[j + 1]);
+
+      theta = w[n].theta;
+      thetacen = w[n].thetacen;
+      if (theta > 90.)
+        theta = 90.;
+      if (thetacen > 90.)
+        thetacen = 90.;
+
+      theta /= RADIAN;
+      thetacen /= RADIAN;
+
+      w[n].x[0] = w[n].r * sin (theta);
+      w[n].x[2] = w[n].r * cos (theta);
+
+      w[n].xcen[0] = w[n].rcen * sin (thetacen);
+      w[n].xcen[2] = w[n].rcen * cos (thetacen);
+    }
+  }
+
+  free (ra);
+  free (ta);
+
+  return (0);
+}
+
+
 
 
 /***********************************************************
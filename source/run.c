@@ -56,6 +56,8 @@ History:
 
 	15sep 	ksl	Moved calculating the ionization from main 
 			to a separat routine
+	1703	Call bands_adapt after the wind has been updated
+	1703	Optionally time the main steps of each cycle, see perf_report
 
 **************************************************************/
 
@@ -72,11 +74,9 @@ calculate_ionization (restart_stat)
   char dummy[LINELENGTH];
 
   double freqmin, freqmax;
+  double t_perf;
   long nphot_to_define;
   int iwind;
-#ifdef MPI_ON
-  int ioniz_spec_helpers;
-#endif
 
 
 
@@ -90,12 +90,6 @@ calculate_ionization (restart_stat)
   freqmin = xband.f1[0];
   freqmax = xband.f2[xband.nbands - 1];
 
-#ifdef MPI_ON
-  /* the length of the big arrays to help with the MPI reductions of the spectra
-     the variables for the estimator arrays are set up in the subroutines themselves */
-  ioniz_spec_helpers = 2 * MSPEC * NWAVE;       //we need space for log and lin spectra for MSPEC XNWAVE
-#endif
-
 /* XXXX - THE CALCULATION OF THE IONIZATION OF THE WIND */
 
   geo.ioniz_or_extract = 1;     //SS July 04 - want to compute MC estimators during ionization cycles
@@ -175,7 +169,9 @@ calculate_ionization (restart_stat)
 
     nphot_to_define = (long) NPHOT;
 
+    t_perf = perf_start ();
     define_phot (p, freqmin, freqmax, nphot_to_define, 0, iwind, 1);
+    perf_stop (PERF_DEFINE_PHOT, t_perf);
 
     /* Zero the arrays that store the heating of the disk */
 
@@ -207,7 +203,6 @@ calculate_ionization (restart_stat)
     }
 
     Log ("!!python: Total photon luminosity before transphot %18.12e\n", zz);
-    Log_flush ();               /* NSH June 13 Added call to flush logfile */
     ztot += zz;                 /* Total luminosity in all cycles, used for calculating disk heating */
 
     /* kbf_need determines how many & which bf processes one needs to considere.  It was introduced
@@ -223,7 +218,9 @@ calculate_ionization (restart_stat)
       pop_kappa_ff_array ();
 
     /* Transport the photons through the wind */
+    t_perf = perf_start ();
     trans_phot (w, p, 0);
+    perf_stop (PERF_TRANS_PHOT, t_perf);
 
     /*Determine how much energy was absorbed in the wind */
     zze = zzz = zz_adiab = 0.0;
@@ -252,7 +249,9 @@ calculate_ionization (restart_stat)
 
     photon_checks (p, freqmin, freqmax, "Check after transport");
 
-    spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
+    t_perf = perf_start ();
+    spectrum_create ();         /* The spectra were built up during trans_phot, this just reports on them */
+    perf_stop (PERF_SPECTRUM_CREATE, t_perf);
 
 
 
@@ -261,7 +260,9 @@ calculate_ionization (restart_stat)
 
 #ifdef MPI_ON
 
+    t_perf = perf_start ();
     communicate_estimators_para ();
+    perf_stop (PERF_COMMUNICATE_ESTIMATORS, t_perf);
 
     communicate_matom_estimators_para ();       // this will return 0 if nlevels_macro == 0
 #endif
@@ -292,7 +293,13 @@ calculate_ionization (restart_stat)
 
 /* This step should be MPI_parallelised too */
 
+    t_perf = perf_start ();
     wind_update (w);
+    perf_stop (PERF_WIND_UPDATE, t_perf);
+
+    /* Optionally choose how photons are divided among the bands in the next cycle */
+
+    bands_adapt (&xband);
 
 
     Log ("Completed ionization cycle %d :  The elapsed TIME was %f\n", geo.wcycle, timer ());
@@ -303,7 +310,7 @@ calculate_ionization (restart_stat)
 
 #ifdef MPI_ON
 
-    gather_spectra_para (ioniz_spec_helpers, MSPEC);
+    gather_spectra_para (MSPEC);
 
 #endif
 
@@ -341,7 +348,9 @@ calculate_ionization (restart_stat)
     if (rank_global == 0)
     {
 #endif
+      t_perf = perf_start ();
       wind_save (files.windsave);
+      perf_stop (PERF_WIND_SAVE, t_perf);
       Log_silent ("Saved wind structure in %s after cycle %d\n", files.windsave, geo.wcycle);
 
       /* In a diagnostic mode save the wind file for each cycle (from thread 0) */
@@ -350,7 +359,9 @@ calculate_ionization (restart_stat)
       {
         strcpy (dummy, "");
         sprintf (dummy, "python%02d.wind_save", geo.wcycle);
+        t_perf = perf_start ();
         wind_save (dummy);
+        perf_stop (PERF_WIND_SAVE, t_perf);
         Log ("Saved wind structure in %s\n", dummy);
       }
 
@@ -362,6 +373,8 @@ calculate_ionization (restart_stat)
 
 
 
+    error_summary_cycle ("End of ionization cycle");    /* Log how often each error occurred in this cycle */
+    perf_report ("End of ionization cycle");
     check_time (files.root);
     Log_flush ();               /*Flush the logfile */
 
@@ -375,6 +388,9 @@ calculate_ionization (restart_stat)
   /* SWM - Evaluate wind paths for last iteration */
   if (geo.reverb == REV_WIND || geo.reverb == REV_MATOM)
   {
+#ifdef MPI_ON
+    communicate_wind_paths_para ();
+#endif
     wind_paths_evaluate (w, rank_global);
   }
 
@@ -408,12 +424,12 @@ make_spectra (restart_stat)
   PhotPtr p;
 
   double freqmin, freqmax;
+  double t_perf;
   double renorm;
   long nphot_to_define;
   int iwind;
 #ifdef MPI_ON
   char dummy[LINELENGTH];
-  int spec_spec_helpers;
 #endif
 
   /* Next three lines have variables that should be a structure, or possibly we
@@ -432,12 +448,6 @@ make_spectra (restart_stat)
   freqmax = C / (geo.swavemin * 1.e-8);
   freqmin = C / (geo.swavemax * 1.e-8);
 
-#ifdef MPI_ON
-  /* the length of the big arrays to help with the MPI reductions of the spectra
-     the variables for the estimator arrays are set up in the subroutines themselves */
-  spec_spec_helpers = (NWAVE * (MSPEC + geo.nangles));  //We need space for NWAVE wavelengths for nspectra, which will eventually equal nangles + MSPEC
-#endif
-
   /* Perform the initilizations required to handle macro-atoms during the detailed
      calculation of the spectrum.  
 
@@ -535,7 +545,9 @@ make_spectra (restart_stat)
      */
 
     nphot_to_define = (long) NPHOT *(long) geo.pcycles;
+    t_perf = perf_start ();
     define_phot (p, freqmin, freqmax, nphot_to_define, 1, iwind, 0);
+    perf_stop (PERF_DEFINE_PHOT, t_perf);
 
     for (icheck = 0; icheck < NPHOT; icheck++)
     {
@@ -548,20 +560,27 @@ make_spectra (restart_stat)
 
     /* Tranport photons through the wind */
 
+    t_perf = perf_start ();
     trans_phot (w, p, geo.select_extract);
+    perf_stop (PERF_TRANS_PHOT, t_perf);
 
     if (modes.print_windrad_summary)
       wind_rad_summary (w, files.windrad, "a");
 
 
-    spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
+    t_perf = perf_start ();
+    spectrum_create ();
+    perf_stop (PERF_SPECTRUM_CREATE, t_perf);
+
+    if (geo.select_extract)
+      extract_summary ();       /* Log how long the extraction for each inclination took */
 
 /* Write out the detailed spectrum each cycle so that one can see the statistics build up! */
     renorm = ((double) (geo.pcycles)) / (geo.pcycle + 1.0);
 
     /* Do an MPI reduce to get the spectra all gathered to the master thread */
 #ifdef MPI_ON
-    gather_spectra_para (spec_spec_helpers, nspectra);
+    gather_spectra_para (nspectra);
 #endif
 
 
@@ -594,12 +613,17 @@ make_spectra (restart_stat)
     if (rank_global == 0)
     {
 #endif
+      t_perf = perf_start ();
       wind_save (files.windsave);       // This is only needed to update pcycle
+      perf_stop (PERF_WIND_SAVE, t_perf);
       spec_save (files.specsave);
 #ifdef MPI_ON
     }
 #endif
+    error_summary_cycle ("End of spectral cycle");      /* Log how often each error occurred in this cycle */
+    perf_report ("End of spectral cycle");
     check_time (files.root);
+    Log_flush ();               /*Flush the logfile */
   }
 
 
@@ -620,6 +644,9 @@ make_spectra (restart_stat)
   MPI_Barrier (MPI_COMM_WORLD); // Once all done
   if (rank_global == 0 && geo.reverb != REV_NONE)
     delay_dump_combine (np_mpi_global); // Combine results if necessary
+#else
+  if (geo.reverb != REV_NONE)
+    delay_dump_combine (1);     // Writes the index of a binary dump
 #endif
 
 
@@ -274,6 +274,7 @@ Notes:
 History:
   1502  JM  Moved here from main()
   1508	ksl	Updated for domains
+  1703	Added the option to refine cylindrical and rtheta grids
 
 **************************************************************/
 
@@ -334,13 +335,6 @@ get_grid_params (ndom)
     Error ("get_grid_parameters: Houston! Why are we reading the coordinate system if run type is SYSTEM_TYPE_PREVIOUS\n");
   }
 
-/* 130405 ksl - Check that NDIM_MAX is greater than NDIM and MDIM.  */
-
-  if ((zdom[ndom].ndim > NDIM_MAX) || (zdom[ndom].mdim > NDIM_MAX))
-  {
-    Error ("NDIM_MAX %d is less than NDIM %d or MDIM %d. Fix in python.h and recompile\n", NDIM_MAX, zdom[ndom].ndim, zdom[ndom].mdim);
-    exit (0);
-  }
 
 
   /* If we are in advanced then allow the user to modify scale lengths */
@@ -355,6 +349,10 @@ get_grid_params (ndom)
       if (zdom[ndom].coord_type != SPHERICAL)
         rddoub ("@geo.zlog_scale", &zdom[ndom].zlog_scale);
     }
+
+    /* Optionally concentrate the grid lines where the density and velocity change rapidly */
+    if (zdom[ndom].coord_type == CYLIND || zdom[ndom].coord_type == RTHETA)
+      rddoub ("@Grid.refine.strength(0=uniform)", &zdom[ndom].refine);
   }
 
   zdom[ndom].ndim2 = zdom[ndom].ndim * zdom[ndom].mdim;
@@ -1068,6 +1066,7 @@ Description:
 Notes:
 History:
   1504  SWM   Added
+  1703        Added the advanced delay dump format option
 **************************************************************/
 int
 get_meta_params (void)
@@ -1218,6 +1217,26 @@ get_meta_params (void)
     }
   }
 
+  // ========== DEAL WITH DELAY DUMP FORMAT ==========
+  geo.reverb_dump = REV_DUMP_TEXT;
+  if (geo.reverb != REV_NONE && modes.iadvanced)
+  {                             //Binary records are much smaller and faster to write for large runs
+    meta_param = 0;
+    rdint ("@reverb.dump_format(0=text,1=binary)", &meta_param);
+    switch (meta_param)
+    {
+    case 0:
+      geo.reverb_dump = REV_DUMP_TEXT;
+      break;
+    case 1:
+      geo.reverb_dump = REV_DUMP_BINARY;
+      break;
+    default:
+      Error ("reverb.dump_format: Invalid format.\n \
+        Valid formats are 0=Text, 1=Binary.\n");
+    }
+  }
+
   // ========== DEAL WITH LINE CULLING ==========
   if (geo.reverb != REV_NONE)
   {
@@ -1516,6 +1535,9 @@ setup_created_files ()
   strcpy (files.new_pf, files.root);
   strcat (files.new_pf, ".out.pf");
 
+  strcpy (files.perf, files.root);
+  strcat (files.perf, ".perf");
+
 
   strcpy (files.windrad, "python");
   strcpy (files.windsave, files.root);
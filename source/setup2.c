@@ -151,6 +151,8 @@ init_geo ()
                                    be called at all if we are simply continuing a previous
                                    run */
   geo.hydro_domain_number = -1;
+  geo.nwave = NWAVE;            /* The number of frequency bins in the spectra */
+  geo.plasma_order = 0;         /* The plasma cells are in the same order as the wind cells */
 
 /*  The domains have been created but have not been initialized at all */
 
@@ -408,6 +410,8 @@ get_spectype (yesno, question, spectype)
         strcpy (model_list, get_spectype_oldname);
       }
       rdstr ("Model_file", model_list);
+      if (modes.iadvanced && get_spectype_count == 0)
+        rddoub ("@Model_cache_size(Mb)", &model_cache_mb);
       get_models (model_list, 2, spectype);
       strcpy (geo.model_list[get_spectype_count], model_list);  // Copy it to geo 
       strcpy (get_spectype_oldname, model_list);        // Also copy it back to the old name
@@ -617,6 +621,12 @@ init_advanced_modes ()
   modes.quit_after_inputs = 0;  // testing mode which quits after reading in inputs
   modes.fixed_temp = 0;         // do not attempt to change temperature - used for testing
   modes.zeus_connect = 0;       // connect with zeus
+  modes.ioniz_acceleration = 0; // do not extrapolate t_e between ionization cycles
+  modes.qmc_launch = 0;         // launch photons with pseudo-random numbers
+  modes.adapt_bands = 0;        // keep the photon fractions in each band fixed
+  modes.event_transport = 0;    // fly each photon to completion before starting the next
+  modes.perf_timers = 0;        // do not time the parts of the code
+  model_cache_mb = MODEL_CACHE_MB;      // memory for interpolated model spectra and their cdfs
 
   //note write_atomicdata  is defined in atomic.h, rather than the modes structure 
   write_atomicdata = 0;         // print out summary of atomic data 
@@ -647,6 +657,8 @@ Notes:
 History:
     1509	ksl	Code moved from main after puttting the
     			parameters into the goe structure
+    1703		Added the advanced option to set the number
+    			of frequency bins in the spectra
 **************************************************************/
 
 int
@@ -781,6 +793,17 @@ init_observers ()
   else
     Log ("OK, basic Monte Carlo spectrum\n");
 
+  /* The number of frequency bins in the spectra can be changed for diagnostic runs */
+  if (modes.iadvanced)
+  {
+    rdint ("@spectrum.nwave", &geo.nwave);
+    if (geo.nwave < 3)
+    {
+      Error ("init_observers: spectrum.nwave %d must be at least 3, using %d\n", geo.nwave, NWAVE);
+      geo.nwave = NWAVE;
+    }
+  }
+
   return (0);
 }
 
@@ -934,6 +957,37 @@ init_ionization ()
     exit (0);
   }
 
+  /* Optionally extrapolate the electron temperature from the history of each cell, see ng_accelerate */
+
+  if (modes.iadvanced)
+    rdint ("@Ionization.acceleration(0=none,1=ng)", &modes.ioniz_acceleration);
+
+  /* Optionally use quasi-random numbers for the positions and directions of photons at launch, see launch_rand */
+
+  if (modes.iadvanced)
+    rdint ("@Photon.launch.sampling(0=pseudo.random,1=quasi.random)", &modes.qmc_launch);
+
+  /* Optionally move photons between bands according to the noise in the banded estimators, see bands_adapt */
+
+  if (modes.iadvanced)
+    rdint ("@Photon.band.allocation(0=fixed,1=adaptive)", &modes.adapt_bands);
+
+  /* Optionally advance the photons in batches sorted by cell rather than one at a time, see trans_phot_event */
+
+  if (modes.iadvanced)
+    rdint ("@Photon.transport(0=history,1=event)", &modes.event_transport);
+
+  /* Optionally number the plasma cells along a space filling curve, so that cells which are neighbours in the 
+     wind are also close in memory, see create_maps */
+
+  if (modes.iadvanced)
+    rdint ("@Wind.plasma.order(0=wind,1=morton)", &geo.plasma_order);
+
+  /* Optionally time the parts of the code in which most of the time is spent, see perf_report */
+
+  if (modes.iadvanced)
+    rdint ("@Diag.perf.timers(0=off,1=on)", &modes.perf_timers);
+
 
   /* 57h -- Next line prevents bf calculation of macro_estimaters when no macro atoms are present.   */
 
@@ -80,10 +80,15 @@ History:
 	13feb	nsh	74b5 -- Included lines to initialize the log spectrum
 	1409	ksl	Added another spectrum, the spectrum of generated photons. This
 			is the first spectrum in the structure
+	1703		The number of bins in each spectrum is now geo.nwave, and the
+			wind spectra are zeroed as well.  The counters used by 
+			spectrum_create are reset here.
 
 **************************************************************/
 
 int i_spec_start = 0;
+int spec_nphot = 0;             /* The number of photons added to the spectra this cycle by spectrum_add_phot */
+double spec_nlow, spec_nhigh;   /* The number of those with frequencies which were too low or high */
 
 int
 spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select_extract, rho_select, z_select, az_select, r_select)
@@ -103,7 +108,6 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
 
   freqmin = f1;
   freqmax = f2;
-  dfreq = (freqmax - freqmin) / NWAVE;
 
   nspec = nangle + MSPEC;
 
@@ -111,7 +115,6 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
 
   lfreqmin = log10 (freqmin);
   lfreqmax = log10 (freqmax);
-  ldfreq = (lfreqmax - lfreqmin) / NWAVE;
 
   /* Create the spectrum arrays the first time routine is called */
   if (i_spec_start == 0)
@@ -119,13 +122,15 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
     xxspec = calloc (sizeof (spectrum_dummy), nspec);
     if (xxspec == NULL)
     {
-      Error ("spectrum_init: Could not allocate memory for %d spectra with %d wavelengths\n", nspec, NWAVE);
+      Error ("spectrum_init: Could not allocate memory for %d spectra with %d wavelengths\n", nspec, geo.nwave);
       exit (0);
     }
 
     nspectra = nspec;           /* Note that nspectra is a global variable */
+    for (n = 0; n < nspec; n++)
+      xxspec[n].nwave = geo.nwave;
 
-    i_spec_start = 1;           /* This is to prevent reallocation of the same arrays on multiple calls to spectrum_init */
+    spectrum_bins_allocate ();  /* This also prevents reallocation of the same arrays on multiple calls to spectrum_init */
   }
 
 
@@ -138,8 +143,13 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
   for (i = 0; i < NSTAT; i++)
     nstat[i] = 0;
 
+  spec_nphot = 0;
+  spec_nlow = spec_nhigh = 0.0;
+
   for (n = 0; n < nspec; n++)
   {
+    dfreq = (freqmax - freqmin) / xxspec[n].nwave;
+    ldfreq = (lfreqmax - lfreqmin) / xxspec[n].nwave;
     xxspec[n].freqmin = freqmin;
     xxspec[n].freqmax = freqmax;
     xxspec[n].dfreq = dfreq;
@@ -148,10 +158,12 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
     xxspec[n].ldfreq = ldfreq;
     for (i = 0; i < NSTAT; i++)
       xxspec[n].nphot[i] = 0;
-    for (i = 0; i < NWAVE; i++)
+    for (i = 0; i < xxspec[n].nwave; i++)
     {
       xxspec[n].f[i] = 0;
       xxspec[n].lf[i] = 0;      /* NSH 1302 zero the logarithmic spectra */
+      xxspec[n].f_wind[i] = 0;
+      xxspec[n].lf_wind[i] = 0;
     }
   }
 
@@ -264,30 +276,165 @@ disk. The minus sign in the terms associated with phase are to make this happen.
   return (0);
 }
 
+/***********************************************************
+                                       University of Southampton
+
+ Synopsis:
+
+	int spectrum_bins_allocate() allocates the frequency bins of all
+	the spectra in xxspec
+
+Arguments:		
+
+Returns:
+  
+Description:	
+
+	xxspec and nspectra must already be set, along with the number of
+	bins, nwave, of each spectrum.  The f, lf, f_wind and lf_wind arrays 
+	of every spectrum are carved out of a single block, in that order
+	and spectrum by spectrum, so that the first n spectra are always 
+	one contiguous run of doubles starting at xxspec[0].f.  
+	gather_spectra_para and spec_save rely on this.
+
+Notes:
+
+History:
+	1703		Coded when the spectra were given a run time size
+
+**************************************************************/
+
+int
+spectrum_bins_allocate ()
+{
+  int n, ntot;
+  double *bins;
+
+  ntot = 0;
+  for (n = 0; n < nspectra; n++)
+    ntot += 4 * xxspec[n].nwave;
+
+  bins = calloc (sizeof (double), ntot);
+  if (bins == NULL)
+  {
+    Error ("spectrum_bins_allocate: Could not allocate memory for %d spectra with %d wavelengths\n", nspectra, xxspec[0].nwave);
+    exit (0);
+  }
+
+  for (n = 0; n < nspectra; n++)
+  {
+    xxspec[n].f = bins;
+    xxspec[n].lf = bins + xxspec[n].nwave;
+    xxspec[n].f_wind = bins + 2 * xxspec[n].nwave;
+    xxspec[n].lf_wind = bins + 3 * xxspec[n].nwave;
+    bins += 4 * xxspec[n].nwave;
+  }
+
+  Log_silent ("spectrum_bins_allocate: Allocated %.1f Mb for %d spectra\n", ntot * sizeof (double) / 1e6, nspectra);
+
+  i_spec_start = 1;             /* This is to prevent reallocation of the same arrays on multiple calls to spectrum_init */
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       University of Southampton
+
+ Synopsis:
+
+	int spectrum_add(spec,freq,lfreq,w,iwind) adds a weight to one 
+	spectrum
+
+Arguments:		
+	SpecPtr spec;		the spectrum to increment
+	double freq, lfreq;	the frequency, and its log10, of the photon
+	double w;		the weight to add
+	int iwind;		if non-zero, also add the weight to the wind
+				spectra
+Returns:
+  
+Description:	
+
+	This is the single place where the spectra are incremented, both
+	for the photons which leave the wind, see spectrum_add_phot, and
+	for those extracted along particular directions in extract_one.
+	Photons with frequencies outside the range of the spectrum are
+	put in the end bins.
+
+Notes:
+	lfreq is passed in, because the caller usually adds the same
+	photon to several spectra and so only has to take the log once.
+
+History:
+	1703		Coded, from the binning that was in spectrum_create
+			and extract_one
+
+**************************************************************/
+
+int
+spectrum_add (spec, freq, lfreq, w, iwind)
+     SpecPtr spec;
+     double freq, lfreq, w;
+     int iwind;
+{
+  int k, k1;
+  double x;
+
+  /* where we are in a normal spectrum with linear spacing.  The comparisons are done
+     before the conversion to int so that wildly wrong frequencies end up in the end bins */
+  x = (freq - spec->freqmin) / spec->dfreq;
+  if (!(x > 0.))
+    k = 0;
+  else if (x > spec->nwave - 1)
+    k = spec->nwave - 1;
+  else
+    k = x;
+
+  /* find out where we are in log space */
+  x = (lfreq - spec->lfreqmin) / spec->ldfreq;
+  if (!(x > 0.))
+    k1 = 0;
+  else if (x > spec->nwave - 1)
+    k1 = spec->nwave - 1;
+  else
+    k1 = x;
+
+  spec->f[k] += w;
+  spec->lf[k1] += w;
+  if (iwind)
+  {
+    spec->f_wind[k] += w;
+    spec->lf_wind[k1] += w;
+  }
+
+  return (0);
+}
+
+
+
 /***********************************************************
                                        Space Telescope Science Institute
 
  Synopsis:
 
- int spectrum_create(p,f1,f2,nangle,select_extract) increments the spectrum arrays
- 	after each flight of photons is processed.
+ int spectrum_add_phot(p,select_extract) adds a photon to the spectrum arrays
+ 	once its flight through the wind is over
   
 Arguments:		
-	PhotPtr p;
-	double f1,f2;			the minimimum and maximum frequency in the spectrum
-	int nangle;				the number of different angles and phases for which 
-							spectra must be created
+	PhotPtr p;			the photon, after trans_phot_single has finished with it
 	int select_extract;		The integer stating whether the Live or Die option has 
 						been chosen. (0==Live or Die)
 Returns:
   
 Description:	
 
-	This routine increments the total spectrum arrays based on what has happened to each 
+	This routine increments the total spectrum arrays based on what has happened to the
 	photon.  In the Live or Die option, the spectra at specific angles are also created here.
  
-	The routine is called after each batch of photons has been transported through the wind and 
-	prints some intermediate results to assure the user that the program is still running.  
+	It is called from trans_phot_single as each photon finishes, so the spectra are built
+	up during transport rather than by going over the photon array afterwards.
 
 Notes:
 
@@ -307,10 +454,6 @@ History:
 			seemed out of bounds since due to Doppler shifts
 			at the time of photon creation, the frequencies
 			can exceed the range of the formal limits somewhat.
-	05apr	ksl	Removed code which summed up the points where
-			the last scattering occurred, as not sufficiently
-			important to retain given the desire to deal with
-			both 1-d and 2-d grids simulataneouly.  
 	08mar	ksl	Fixed up spectrum types to account for tracking
 			of photons which had been scattered by the wind
 	1212	ksl	Changed the way dealt with photons which had
@@ -326,257 +469,193 @@ History:
 	1604	ksl	Modifications to create a new set of spectra
 			for photons that were created in the wind or
 			modified by scatterin there
+	1703		Split out of spectrum_create so that it works
+			on one photon at a time, as it finishes
 
 **************************************************************/
 
 int
-spectrum_create (p, f1, f2, nangle, select_extract)
+spectrum_add_phot (p, select_extract)
      PhotPtr p;
-     double f1, f2;
-     int nangle;
      int select_extract;
-
 {
-  int nphot, i, j, k, k1, n;
-  int nspec, spectype;
-  double freqmin, freqmax, dfreq;
-  double lfreqmin, lfreqmax, ldfreq;
+  int i, j, n;
+  int spectype;
   double x1;
   int mscat, mtopbot;
-  double delta;
-  double nlow, nhigh;
-  int k_orig, k1_orig;
+  double lfreq, lfreq_orig;
   int iwind;                    // Variable defining whether this is a wind photon
 
-  freqmin = f1;
-  freqmax = f2;
-  dfreq = (freqmax - freqmin) / NWAVE;
-  nspec = nangle + MSPEC;
-  nlow = 0.0;                   // variable to storte the number of photons that have frequencies which are too low
-  nhigh = 0.0;                  // variable to storte the number of photons that have frequencies which are too high
-  delta = 0.0;                  // fractional frequency error allowod
+  spec_nphot++;
 
-/* Lines to set up a logarithmic spectrum */
+  if ((j = p->nscat) < 0 || j > MAXSCAT)
+    nscat[MAXSCAT]++;
+  else
+    nscat[j]++;
 
-  lfreqmin = log10 (freqmin);
-  lfreqmax = log10 (freqmax);
-  ldfreq = (lfreqmax - lfreqmin) / NWAVE;
+  if ((j = p->nrscat) < 0 || j > MAXSCAT)
+    nres[MAXSCAT]++;
+  else
+    nres[j]++;
 
+  /* Determine whether this is a wind photon, that is was it created in the
+   * wind or scattered by the wind 
+   */
 
-  for (nphot = 0; nphot < NPHOT; nphot++)
+  iwind = 0;
+  if (p->origin == PTYPE_WIND || p->origin == PTYPE_WIND_MATOM || p->nscat > 0)
   {
-    if ((j = p[nphot].nscat) < 0 || j > MAXSCAT)
-      nscat[MAXSCAT]++;
-    else
-      nscat[j]++;
+    iwind = 1;
+  }
 
-    if ((j = p[nphot].nrscat) < 0 || j > MAXSCAT)
-      nres[MAXSCAT]++;
-    else
-      nres[j]++;
+  /* Keep track of the photons which fall outside the spectrum */
+  if (geo.rt_mode != 2)
+  {
+    if (p->freq < xxspec[0].freqmin)
+      spec_nlow++;
+    else if (p->freq > xxspec[0].freqmax)
+      spec_nhigh++;
+
+    if (p->freq_orig < xxspec[0].freqmin)
+      spec_nlow++;
+    else if (p->freq_orig > xxspec[0].freqmax)
+      spec_nhigh++;
+  }
 
-    /* Determine whether this is a wind photon, that is was it created in the
-     * wind or scattered by the wind 
-     */
+  lfreq = log10 (p->freq);
+  lfreq_orig = log10 (p->freq_orig);
 
-    iwind = 0;
-    if (p[nphot].origin == PTYPE_WIND || p[nphot].origin == PTYPE_WIND_MATOM || p[nphot].nscat > 0)
-    {
-      iwind = 1;
-    }
+  /* created spectrum with original weights and wavelengths */
+  spectrum_add (&xxspec[0], p->freq_orig, lfreq_orig, p->w_orig, iwind);
 
-    /* find out where we are in log space */
-    k1 = (log10 (p[nphot].freq) - log10 (freqmin)) / ldfreq;
-    if (k1 < 0)
-    {
-      k1 = 0;
-    }
-    if (k1 > NWAVE - 1)
-    {
-      k1 = NWAVE - 1;
-    }
-
-    /* also need to work out where we are for photon's original wavelength */
-    k1_orig = (log10 (p[nphot].freq_orig) - log10 (freqmin)) / ldfreq;
-    if (k1_orig < 0)
-    {
-      k1_orig = 0;
-    }
-    if (k1_orig > NWAVE - 1)
-    {
-      k1_orig = NWAVE - 1;
-    }
+  if ((i = p->istat) == P_ESCAPE)
+  {
+    xxspec[0].nphot[i]++;
+    spectrum_add (&xxspec[1], p->freq, lfreq, p->w, iwind);     /* emitted spectrum */
+    xxspec[1].nphot[i]++;
+    spectype = p->origin;
 
+    if (spectype >= 10)         /* This looks to be an undocumented correction for macroatoms XXX */
+      spectype -= 10;
 
-    /* lines to work out where we are in a normal spectrum with linear spacing */
-    k = (p[nphot].freq - freqmin) / dfreq;
-    if (k < 0)
-    {
-      if (((1. - p[nphot].freq / freqmin) > delta) && (geo.rt_mode != 2))
-        nlow = nlow + 1;
-      k = 0;
-    }
-    else if (k > NWAVE - 1)
+    if (spectype == PTYPE_STAR || spectype == PTYPE_BL || spectype == PTYPE_AGN)        // Then it came from the bl or the star
     {
-      if (((1. - freqmax / p[nphot].freq) > delta) && (geo.rt_mode != 2))
-        nhigh = nhigh + 1;
-      k = NWAVE - 1;
+      spectrum_add (&xxspec[2], p->freq, lfreq, p->w, iwind);   /* emitted star (+bl) spectrum */
+      xxspec[2].nphot[i]++;
     }
-
-    /* also need to work out where we are for photon's original wavelength */
-    k_orig = (p[nphot].freq_orig - freqmin) / dfreq;
-    if (k_orig < 0)
+    else if (spectype == PTYPE_DISK)    // Then it was a disk photon 
     {
-      if (((1. - p[nphot].freq_orig / freqmin) > delta) && (geo.rt_mode != 2))
-        nlow = nlow + 1;
-      k_orig = 0;
+      spectrum_add (&xxspec[3], p->freq, lfreq, p->w, iwind);   /* transmitted disk spectrum */
+      xxspec[3].nphot[i]++;
     }
-    else if (k_orig > NWAVE - 1)
+    else if (spectype == PTYPE_WIND)
     {
-      if (((1. - freqmax / p[nphot].freq_orig) > delta) && (geo.rt_mode != 2))
-        nhigh = nhigh + 1;
-      k_orig = NWAVE - 1;
+      spectrum_add (&xxspec[4], p->freq, lfreq, p->w, iwind);   /* wind spectrum */
+      xxspec[4].nphot[i]++;
     }
-
-
-    xxspec[0].f[k_orig] += p[nphot].w_orig;     /* created spectrum with original weights and wavelengths */
-    xxspec[0].lf[k1_orig] += p[nphot].w_orig;   /* logarithmic created spectrum */
-    if (iwind)
+    else
     {
-      xxspec[0].f_wind[k_orig] += p[nphot].w_orig;
-      xxspec[0].lf_wind[k1_orig] += p[nphot].w_orig;
+      Error ("spectrum_add_phot: Unknown photon type %d\n", spectype);
     }
 
-
-    if ((i = p[nphot].istat) == P_ESCAPE)
+    /* For Live or Die option, increment the spectra here */
+    if (select_extract == 0)
     {
-      xxspec[0].nphot[i]++;
-      xxspec[1].f[k] += p[nphot].w;     /* emitted spectrum */
-      xxspec[1].lf[k1] += p[nphot].w;   /* logarithmic emitted spectrum */
-      if (iwind)
+      x1 = fabs (p->lmn[2]);
+      for (n = MSPEC; n < nspectra; n++)
       {
-        xxspec[1].f_wind[k] += p[nphot].w;      /* emitted spectrum */
-        xxspec[1].lf_wind[k1] += p[nphot].w;    /* logarithmic emitted spectrum */
-      }
-      xxspec[1].nphot[i]++;
-      spectype = p[nphot].origin;
-
-      if (spectype >= 10)       /* This looks to be an undocumented correction for macroatoms XXX */
-        spectype -= 10;
+        /* Complicated if statement to allow one to choose whether to construct the spectrum
+           from all photons or just from photons which have scattered a specific number
+           of times.  01apr13--ksl-Modified if statement to change behavior on negative numbers 
+           to say that a negative number for mscat implies that you accept any photon with 
+           |mscat| or more scatters */
+        if (((mscat = xxspec[n].nscat) > 999 ||
+             p->nscat == mscat ||
+             (mscat < 0 && p->nscat >= (-mscat))) && ((mtopbot = xxspec[n].top_bot) == 0 || (mtopbot * p->x[2]) > 0))
 
-      if (spectype == PTYPE_STAR || spectype == PTYPE_BL || spectype == PTYPE_AGN)      // Then it came from the bl or the star
-      {
-        xxspec[2].f[k] += p[nphot].w;   /* emitted star (+bl) spectrum */
-        xxspec[2].lf[k1] += p[nphot].w; /* logarithmic emitted star (+bl) spectrum */
-        if (iwind)
-        {
-          xxspec[2].f_wind[k] += p[nphot].w;    /* emitted spectrum */
-          xxspec[2].lf_wind[k1] += p[nphot].w;  /* logarithmic emitted spectrum */
-        }
-        xxspec[2].nphot[i]++;
-      }
-      else if (spectype == PTYPE_DISK)  // Then it was a disk photon 
-      {
-        xxspec[3].f[k] += p[nphot].w;   /* transmitted disk spectrum */
-        xxspec[3].lf[k1] += p[nphot].w; /* logarithmic transmitted disk spectrum */
-        if (iwind)
         {
-          xxspec[3].f_wind[k] += p[nphot].w;    /* emitted spectrum */
-          xxspec[3].lf_wind[k1] += p[nphot].w;  /* logarithmic emitted spectrum */
-        }
-        xxspec[3].nphot[i]++;
-      }
-      else if (spectype == PTYPE_WIND)
-      {
-        xxspec[4].f[k] += p[nphot].w;   /* wind spectrum */
-        xxspec[4].lf[k1] += p[nphot].w; /* logarithmic wind spectrum */
-        if (iwind)
-        {
-          xxspec[4].f_wind[k] += p[nphot].w;    /* emitted spectrum */
-          xxspec[4].lf_wind[k1] += p[nphot].w;  /* logarithmic emitted spectrum */
-        }
-        xxspec[4].nphot[i]++;
-      }
-      else
-      {
-        Error ("spectrum_create: Unknown photon type %d\n", spectype);
-      }
-
-      /* For Live or Die option, increment the spectra here */
-      if (select_extract == 0)
-      {
-        x1 = fabs (p[nphot].lmn[2]);
-        for (n = MSPEC; n < nspec; n++)
-        {
-          /* Complicated if statement to allow one to choose whether to construct the spectrum
-             from all photons or just from photons which have scattered a specific number
-             of times.  01apr13--ksl-Modified if statement to change behavior on negative numbers 
-             to say that a negative number for mscat implies that you accept any photon with 
-             |mscat| or more scatters */
-          if (((mscat = xxspec[n].nscat) > 999 ||
-               p[nphot].nscat == mscat ||
-               (mscat < 0 && p[nphot].nscat >= (-mscat))) && ((mtopbot = xxspec[n].top_bot) == 0 || (mtopbot * p[nphot].x[2]) > 0))
-
+          if (xxspec[n].mmin < x1 && x1 < xxspec[n].mmax)
           {
-            if (xxspec[n].mmin < x1 && x1 < xxspec[n].mmax)
-            {
-              xxspec[n].f[k] += p[nphot].w;
-              xxspec[n].lf[k1] += p[nphot].w;   /* logarithmic spectrum */
-              if (iwind)
-              {
-                xxspec[n].f_wind[k] += p[nphot].w;      /* emitted spectrum */
-                xxspec[n].lf_wind[k1] += p[nphot].w;    /* logarithmic emitted spectrum */
-              }
-            }
+            spectrum_add (&xxspec[n], p->freq, lfreq, p->w, iwind);
           }
-
         }
-      }
-    }
-    else if (i == P_HIT_STAR || i == P_HIT_DISK)
-    {
-      xxspec[5].f[k] += p[nphot].w;     /*absorbed spectrum */
-      xxspec[5].lf[k1] += p[nphot].w;   /*logarithmic absorbed spectrum */
-      if (iwind)
-      {
-        xxspec[5].f_wind[k] += p[nphot].w;      /* emitted spectrum */
-        xxspec[5].lf_wind[k1] += p[nphot].w;    /* logarithmic emitted spectrum */
-      }
-      xxspec[5].nphot[i]++;
-    }
 
-    if (p[nphot].nscat > 0 || p[nphot].nrscat > 0)
-
-    {
-      xxspec[6].f[k] += p[nphot].w;     /* j is the number of scatters so this constructs */
-      xxspec[6].lf[k1] += p[nphot].w;   /* logarithmic j is the number of scatters so this constructs */
-      if (iwind)
-      {
-        xxspec[6].f_wind[k] += p[nphot].w;      /* emitted spectrum */
-        xxspec[6].lf_wind[k1] += p[nphot].w;    /* logarithmic emitted spectrum */
       }
-      if (i < 0 || i > NSTAT - 1)
-        xxspec[6].nphot[NSTAT - 1]++;
-      else
-        xxspec[6].nphot[i]++;   /* scattering spectrum */
     }
+  }
+  else if (i == P_HIT_STAR || i == P_HIT_DISK)
+  {
+    spectrum_add (&xxspec[5], p->freq, lfreq, p->w, iwind);     /*absorbed spectrum */
+    xxspec[5].nphot[i]++;
+  }
 
+  if (p->nscat > 0 || p->nrscat > 0)
+
+  {
+    spectrum_add (&xxspec[6], p->freq, lfreq, p->w, iwind);     /* j is the number of scatters so this constructs */
     if (i < 0 || i > NSTAT - 1)
-      nstat[NSTAT - 1]++;
+      xxspec[6].nphot[NSTAT - 1]++;
     else
-      nstat[i]++;
+      xxspec[6].nphot[i]++;     /* scattering spectrum */
+  }
 
+  if (i < 0 || i > NSTAT - 1)
+    nstat[NSTAT - 1]++;
+  else
+    nstat[i]++;
 
-  }
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+
+ int spectrum_create() reports on the spectra after each flight of 
+ 	photons has been processed.
+  
+Arguments:		
+
+Returns:
+  
+Description:	
 
+	The spectra themselves are incremented photon by photon during transport,
+	by spectrum_add_phot and extract_one.  This routine is called after each 
+	batch of photons has been transported through the wind and prints what
+	happened to them, to assure the user that the program is still running.  
 
-  if ((nlow / nphot > 0.05) || (nhigh / nphot > 0.05))
+Notes:
+
+History:
+ 	97jan	ksl	Coded and debugged as part of Python effort.
+	05apr	ksl	Removed code which summed up the points where
+			the last scattering occurred, as not sufficiently
+			important to retain given the desire to deal with
+			both 1-d and 2-d grids simulataneouly.  
+	1703		The loop over the photons which incremented the spectra
+			has become spectrum_add_phot
+
+**************************************************************/
+
+int
+spectrum_create ()
+{
+  int i, n;
+  double nphot;
+
+  nphot = spec_nphot > 0 ? spec_nphot : 1;
+
+  if ((spec_nlow / nphot > 0.05) || (spec_nhigh / nphot > 0.05))
   {
-    Error ("spectrum_create: Fraction of photons lost: %4.2f wi/ freq. low, %4.2f w/freq hi\n", nlow / nphot, nhigh / nphot);
+    Error ("spectrum_create: Fraction of photons lost: %4.2f wi/ freq. low, %4.2f w/freq hi\n", spec_nlow / nphot, spec_nhigh / nphot);
   }
   else
   {
-    Log ("spectrum_create: Fraction of photons lost:  %4.2f wi/ freq. low, %4.2f w/freq hi\n", nlow / nphot, nhigh / nphot);
+    Log ("spectrum_create: Fraction of photons lost:  %4.2f wi/ freq. low, %4.2f w/freq hi\n", spec_nlow / nphot, spec_nhigh / nphot);
   }
 
 
@@ -604,18 +683,6 @@ spectrum_create (p, f1, f2, nangle, select_extract)
   Log ("\n");
 
 
-  /* Now subsample the matrix which contains the positions where photons
-     last scattered and print the results to the screen.  Photons which are never
-     in the grid end up in cell 0,0 
-
-     In this instance subsampling means to actually do sums, such that all of
-     the photons that scattered in the wind are counted in a courser grid.
-
-   */
-
-
-
-
   Log ("Photons contributing to the various spectra\n");
   Log ("Inwind   Scat    Esc     Star    >nscat    err    Absorb   Disk    sec    Adiab(matom)\n");
   for (n = 0; n < nspectra; n++)
@@ -681,6 +748,7 @@ History:
 			same overall "flux" when each incremental spectrum is printed
 			out.
 	10nov   nsh	Added another switch if we are outputting a log or a lin spectrum
+	1703		Uses the number of bins in the spectra, rather than NWAVE
 
 **************************************************************/
 
@@ -697,7 +765,7 @@ spectrum_summary (filename, mode, nspecmin, nspecmax, select_spectype, renorm, l
 
 {
   FILE *fopen (), *fptr;
-  int i, n;
+  int i, n, nwave;
   char string[LINELENGTH];
   double freq, freqmin, dfreq, freq1;
   double lfreqmin, lfreqmax, ldfreq;
@@ -747,12 +815,13 @@ spectrum_summary (filename, mode, nspecmin, nspecmax, select_spectype, renorm, l
   /* Ignore the end bins because they include all photons outside the frequency range and there may be some
      as a result of the fact that the bb function generate some IR photons */
   dd = 4. * PI * (100. * PC) * (100. * PC);
+  nwave = xxspec[nspecmin].nwave;
 
   if (loglin == 0)              /* Then were are writing out the linear version of the spectra */
   {
     freqmin = xxspec[nspecmin].freqmin;
-    dfreq = (xxspec[nspecmin].freqmax - freqmin) / NWAVE;
-    for (i = 1; i < NWAVE - 1; i++)
+    dfreq = (xxspec[nspecmin].freqmax - freqmin) / nwave;
+    for (i = 1; i < nwave - 1; i++)
     {
       freq = freqmin + i * dfreq;
       fprintf (fptr, "%-8e %.3f ", freq, C * 1e8 / freq);
@@ -789,9 +858,9 @@ spectrum_summary (filename, mode, nspecmin, nspecmax, select_spectype, renorm, l
     lfreqmin = log10 (xxspec[nspecmin].freqmin);
     freq1 = lfreqmin;
     lfreqmax = log10 (xxspec[nspecmin].freqmax);
-    ldfreq = (lfreqmax - lfreqmin) / NWAVE;
+    ldfreq = (lfreqmax - lfreqmin) / nwave;
 
-    for (i = 1; i < NWAVE - 1; i++)
+    for (i = 1; i < nwave - 1; i++)
     {
       freq = pow (10., (lfreqmin + i * ldfreq));
       dfreq = freq - freq1;
@@ -860,6 +929,8 @@ Notes:
 
 History:
  	15jan JM	Coded
+	1703		Uses the number of bins in each spectrum, and 
+			renormalises the wind spectra too
 
 **************************************************************/
 
@@ -876,10 +947,12 @@ spectrum_restart_renormalise (nangle)
   /* loop over each spectrum column and each wavelength bin */
   for (n = MSPEC; n < nspec; n++)
   {
-    for (m = 0; m < NWAVE; m++)
+    for (m = 0; m < xxspec[n].nwave; m++)
     {
       xxspec[n].f[m] *= renorm_factor;
       xxspec[n].lf[m] *= renorm_factor;
+      xxspec[n].f_wind[m] *= renorm_factor;
+      xxspec[n].lf_wind[m] *= renorm_factor;
     }
   }
 
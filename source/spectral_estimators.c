@@ -137,11 +137,11 @@ spectral_estimators (xplasma)
   {
     Log_silent
       ("Starting out band %i in cell %i. mean=%e, sd=%e, minfreq=%e, maxfreq=%e, nphot=%i\n",
-       n, xplasma->nplasma, xplasma->xave_freq[n], xplasma->xsd_freq[n], xplasma->fmin[n], xplasma->fmax[n], xplasma->nxtot[n]);
+       n, xplasma->nplasma, xplasma->est->xave_freq[n], xplasma->est->xsd_freq[n], xplasma->est->fmin[n], xplasma->est->fmax[n], xplasma->est->nxtot[n]);
 
     plflag = expflag = 1;       //Both potential models are in the running
 
-    if (xplasma->nxtot[n] <= 1) /* Catch the situation where there are only 1 or 0 photons in a band - 
+    if (xplasma->est->nxtot[n] <= 1) /* Catch the situation where there are only 1 or 0 photons in a band - 
                                    we cannot reasonably try to model this situation */
     {
       if (geo.xfreq[n] >= genmax || geo.xfreq[n + 1] <= genmin)
@@ -173,7 +173,7 @@ spectral_estimators (xplasma)
     /*  If all the photons in the cell are concentrated in a tiny range then we will also not 
        expect to make a sensible model - this check could be reviewed later if lots of warning are produced */
 
-    else if (xplasma->fmax[n] == xplasma->fmin[n])
+    else if (xplasma->est->fmax[n] == xplasma->est->fmin[n])
     {
       Error ("spectral_estimators: multiple photons but only one frequency seen in %d band %d\n", xplasma->nplasma, n); /* Flag as a warning, so one can see if it is an issue */
 
@@ -194,12 +194,12 @@ spectral_estimators (xplasma)
       /* spec_numin = geo.xfreq[n]; */
       /*   1108 NSH n is defined in python.c, and says which band of radiation estimators 
          we are interested in using the for power law ionisation calculation */
-      /* if (xplasma->max_freq < geo.xfreq[n + 1])
+      /* if (xplasma->est->max_freq < geo.xfreq[n + 1])
          {
          Log_silent
          ("NSH resetting max frequency of band %i from %e to %e due to lack of photons\n",
-         n, geo.xfreq[n + 1], xplasma->max_freq);
-         spec_numax = xplasma->max_freq;
+         n, geo.xfreq[n + 1], xplasma->est->max_freq);
+         spec_numax = xplasma->est->max_freq;
          }
          else
          {
@@ -213,37 +213,37 @@ spectral_estimators (xplasma)
          a band, we say that the photons fill the band to that end - i.e. the fact we didnt 
          see the minimum frequency is just because of photon numbers. */
 
-      dfreq = (geo.xfreq[n + 1] - geo.xfreq[n]) / sqrt (xplasma->nxtot[n]);     //This is a measure of the spacing between photons on average
-      if ((xplasma->fmin[n] - geo.xfreq[n]) < dfreq)
+      dfreq = (geo.xfreq[n + 1] - geo.xfreq[n]) / sqrt (xplasma->est->nxtot[n]);     //This is a measure of the spacing between photons on average
+      if ((xplasma->est->fmin[n] - geo.xfreq[n]) < dfreq)
       {
         spec_numin = geo.xfreq[n];
       }
       else
       {
-        spec_numin = xplasma->fmin[n];
+        spec_numin = xplasma->est->fmin[n];
       }
-      if ((geo.xfreq[n + 1] - xplasma->fmax[n]) < dfreq)
+      if ((geo.xfreq[n + 1] - xplasma->est->fmax[n]) < dfreq)
       {
         spec_numax = geo.xfreq[n + 1];
       }
       else
       {
-        spec_numax = xplasma->fmax[n];
+        spec_numax = xplasma->est->fmax[n];
       }
 
       xplasma->fmin_mod[n] = spec_numin;        //This is the low frequency limit of any model we might make
       xplasma->fmax_mod[n] = spec_numax;        //This is the high frequency limit of any model we might make
       lspec_numax = log10 (spec_numax);
       lspec_numin = log10 (spec_numin);
-      spec_numean = xplasma->xave_freq[n];
-      j = xplasma->xj[n];
+      spec_numean = xplasma->est->xave_freq[n];
+      j = xplasma->est->xj[n];
 
 
       //Log
       //("NSH We are about to calculate w and alpha, band %i cell %i j=%10.2e, mean_freq=%10.2e, numin=%10.2e(%8.2fev), 
       //numax=%10.2e(%8.2fev), //number of photons in band=%i\n",
       //n, xplasma->nplasma, j, spec_numean, spec_numin, spec_numin * HEV, spec_numax,
-      //spec_numax * HEV, xplasma->nxtot[n]);
+      //spec_numax * HEV, xplasma->est->nxtot[n]);
       //Log_flush();
 
 
@@ -282,7 +282,7 @@ spectral_estimators (xplasma)
         //if (pl_alpha_temp < -1. * ALPHAMAX)
         //pl_alpha_temp = -1. * ALPHAMAX;
 
-        /* This next line computes the PL weight using an external function. Note that xplasma->j already 
+        /* This next line computes the PL weight using an external function. Note that xplasma->est->j already 
          * contains the volume of the cell and a factor of 4pi, so the volume sent to sim_w is set to 1 
          * and j has a factor of 4PI reapplied to it. This means that the equation still works in balance. 
          * It may be better to just implement the factor here, rather than bother with an external call.... */
@@ -385,13 +385,13 @@ spectral_estimators (xplasma)
       pl_sd = pl_log_stddev (xplasma->pl_alpha[n], lspec_numin, lspec_numax);
 
       Log_silent ("NSH in this cell %i band %i PL estimators are log(w)=%10.2e, alpha=%5.3f giving sd=%e compared to %e\n",
-                  xplasma->nplasma, n, xplasma->pl_log_w[n], xplasma->pl_alpha[n], pl_sd, xplasma->xsd_freq[n]);
+                  xplasma->nplasma, n, xplasma->pl_log_w[n], xplasma->pl_alpha[n], pl_sd, xplasma->est->xsd_freq[n]);
 
       Log_silent ("NSH in this cell %i band %i exp estimators are w=%10.2e, temp=%10.2e giving sd=%e compared to %e\n",
-                  xplasma->nplasma, n, xplasma->exp_w[n], xplasma->exp_temp[n], exp_sd, xplasma->xsd_freq[n]);
+                  xplasma->nplasma, n, xplasma->exp_w[n], xplasma->exp_temp[n], exp_sd, xplasma->est->xsd_freq[n]);
 
-      exp_sd = fabs ((exp_sd - xplasma->xsd_freq[n]) / xplasma->xsd_freq[n]);
-      pl_sd = fabs ((pl_sd - xplasma->xsd_freq[n]) / xplasma->xsd_freq[n]);
+      exp_sd = fabs ((exp_sd - xplasma->est->xsd_freq[n]) / xplasma->est->xsd_freq[n]);
+      pl_sd = fabs ((pl_sd - xplasma->est->xsd_freq[n]) / xplasma->est->xsd_freq[n]);
 
       /* NSH 120817 These commands decide upon the best model, 
          based upon how well the models predict the standard deviation */
@@ -418,7 +418,7 @@ spectral_estimators (xplasma)
         xplasma->spec_mod_type[n] = SPEC_MOD_FAIL;      //Oh dear, there is no suitable model - this should be an error
 
         Error ("No suitable model in band %i cell %i (nphot=%i fmin=%e fmax=%e)\n",
-               n, xplasma->nplasma, xplasma->nxtot[n], xplasma->fmin[n], xplasma->fmax[n]);
+               n, xplasma->nplasma, xplasma->est->nxtot[n], xplasma->est->fmin[n], xplasma->est->fmax[n]);
 
         /* We will set the applicable frequency bands for the model to values that will cause errors if the model is used */
         xplasma->fmin_mod[n] = spec_numax;
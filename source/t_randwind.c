@@ -0,0 +1,147 @@
+
+
+
+/**************************************************************************
+                    Space Telescope Science Institute
+
+
+  Synopsis:  t_randwind compares the directions of thermal trapping scatters
+	drawn with randwind_tt_envelope with those drawn by isotropic trials,
+	as in randwind_thermal_trapping
+
+  Description:
+
+	A small cylindrical grid is set up with velocity gradient tensors
+	which are anisotropic, have off-diagonal terms, and vary by 30 percent
+	from cell to cell.  For a photon in this grid nphot directions are
+	drawn with each method.  The directions are binned in 10 bins of
+	cos(theta) and 10 of phi, and chi**2 of the difference between the
+	two histograms is reported, together with the mean number of trials
+	nnscat from each method, which should agree.
+
+  Arguments:
+
+	t_randwind [tau_x_dvds [nphot]]
+
+	tau_x_dvds	the Sobolev optical depth times dv/ds (default 100)
+	nphot		the number of directions drawn with each method (default 200000)
+
+  Returns:
+
+  Notes:
+
+	make t_randwind.  The grid does not need any atomic data.
+
+  History:
+1703	Coded to check randwind_tt_envelope
+
+ ************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "atomic.h"
+#include "python.h"
+
+#define NHIST 10
+
+int
+main (argc, argv)
+     int argc;
+     char *argv[];
+{
+  int i, j, k, n, nphot, nnscat, ia, ib, dof;
+  int hist_iso[NHIST * NHIST], hist_env[NHIST * NHIST];
+  double tau_x_dvds, p_norm, dvds, z, ztest, chi2;
+  double sum_iso, sum_env;
+  double b[3][3] = { {5, 0.3, 0}, {0.1, 0.05, -1.0}, {0, -0.8, 0.02} };
+  struct photon p;
+
+  tau_x_dvds = 100.;
+  nphot = 200000;
+  if (argc > 1)
+    tau_x_dvds = atof (argv[1]);
+  if (argc > 2)
+    nphot = atoi (argv[2]);
+
+  /* A 4 x 4 cylindrical grid */
+  zdom = calloc (sizeof (domain_dummy), 1);
+  zdom[0].coord_type = CYLIND;
+  zdom[0].ndim = zdom[0].mdim = 4;
+  calloc_domain (0);
+  for (i = 0; i < 4; i++)
+  {
+    zdom[0].wind_x[i] = zdom[0].wind_z[i] = i * 1e10;
+    zdom[0].wind_midx[i] = zdom[0].wind_midz[i] = (i + 0.5) * 1e10;
+  }
+
+  wmain = calloc (sizeof (wind_dummy), 16);
+  srand (7);
+  for (n = 0; n < 16; n++)
+  {
+    wmain[n].ndom = 0;
+    for (i = 0; i < 3; i++)
+      for (j = 0; j < 3; j++)
+        wmain[n].v_grad[i][j] = b[i][j] * (1. + 0.3 * (2. * rand () / MAXRAND - 1.));
+  }
+
+  /* 6 is roughly the maximum of dv/ds for these tensors */
+  p_norm = p_escape_from_tau (tau_x_dvds / 6.0);
+
+  p.x[0] = 1.3e10;
+  p.x[1] = 0.7e10;
+  p.x[2] = -1.6e10;
+  p.grid = 5;
+
+  for (i = 0; i < NHIST * NHIST; i++)
+    hist_iso[i] = hist_env[i] = 0;
+  sum_iso = sum_env = 0;
+
+  for (k = 0; k < nphot; k++)
+  {
+    /* The envelope */
+    nnscat = 1;
+    if (randwind_tt_envelope (&p, &nnscat, tau_x_dvds, p_norm) != 0)
+    {
+      printf ("t_randwind: The envelope was not used for tau_x_dvds %g\n", tau_x_dvds);
+      exit (0);
+    }
+    sum_env += nnscat;
+    ia = (p.lmn[2] + 1) / 2 * NHIST;
+    ib = (atan2 (p.lmn[1], p.lmn[0]) + PI) / (2 * PI) * NHIST;
+    hist_env[(ia < NHIST ? ia : NHIST - 1) * NHIST + (ib < NHIST ? ib : NHIST - 1)]++;
+
+    /* Isotropic trials, as in randwind_thermal_trapping */
+    nnscat = 0;
+    z = 0;
+    ztest = 1;
+    while (ztest > z)
+    {
+      nnscat++;
+      randvec (p.lmn, 1.0);
+      ztest = (rand () + 0.5) / MAXRAND * p_norm;
+      dvds = fabs (dvwind_ds (&p));
+      z = p_escape_from_tau (tau_x_dvds / dvds);
+    }
+    sum_iso += nnscat;
+    ia = (p.lmn[2] + 1) / 2 * NHIST;
+    ib = (atan2 (p.lmn[1], p.lmn[0]) + PI) / (2 * PI) * NHIST;
+    hist_iso[(ia < NHIST ? ia : NHIST - 1) * NHIST + (ib < NHIST ? ib : NHIST - 1)]++;
+  }
+
+  chi2 = 0;
+  dof = -1;
+  for (i = 0; i < NHIST * NHIST; i++)
+  {
+    if (hist_iso[i] + hist_env[i] > 0)
+    {
+      chi2 += (double) (hist_iso[i] - hist_env[i]) * (hist_iso[i] - hist_env[i]) / (hist_iso[i] + hist_env[i]);
+      dof++;
+    }
+  }
+
+  printf ("tau_x_dvds %g  <nnscat> isotropic %.4f envelope %.4f  chi2 %.1f for %d dof\n", tau_x_dvds, sum_iso / nphot,
+          sum_env / nphot, chi2, dof);
+
+  return (0);
+}
@@ -45,13 +45,22 @@ int fix_concentrations(PlasmaPtr xplasma, int mode);
 double get_ne(double density[]);
 /* spectra.c */
 int spectrum_init(double f1, double f2, int nangle, double angle[], double phase[], int scat_select[], int top_bot_select[], int select_extract, double rho_select[], double z_select[], double az_select[], double r_select[]);
-int spectrum_create(PhotPtr p, double f1, double f2, int nangle, int select_extract);
+int spectrum_bins_allocate(void);
+int spectrum_add(SpecPtr spec, double freq, double lfreq, double w, int iwind);
+int spectrum_add_phot(PhotPtr p, int select_extract);
+int spectrum_create(void);
 int spectrum_summary(char filename[], char mode[], int nspecmin, int nspecmax, int select_spectype, double renorm, int loglin, int iwind);
 int spectrum_restart_renormalise(int nangle);
 /* wind2d.c */
 int define_wind(void);
+int grid_refine_axis(int ndom, int iaxis, double xx[], int ilo, int ihi, int ilog, double yy[], int jlo, int jhi);
 int where_in_grid(int ndom, double x[]);
+int where_in_grid_from(int ndom, double x[], int nhint);
 int vwind_xyz(int ndom, PhotPtr p, double v[]);
+int wind_interp_init(void);
+int wind_interp_where(int n, double x[], double *dr, double *dz);
+int wind_interp_v(int n, double x[], double v[]);
+int wind_interp_g(int n, double x[], double v_grad[][3]);
 int wind_div_v(WindPtr w);
 double rho(WindPtr w, double x[]);
 int mdot_wind(WindPtr w, double z, double rmax);
@@ -97,7 +106,11 @@ double rtsafe(void (*funcd)(double, double *, double *), double x1, double x2, d
 double golden(double ax, double bx, double cx, double (*f)(double), double tol, double *xmin);
 /* trans_phot.c */
 int trans_phot(WindPtr w, PhotPtr p, int iextract);
+int trans_phot_launch(WindPtr w, PhotPtr p, int iextract);
+int trans_phot_event(WindPtr w, PhotPtr p, int iextract);
 int trans_phot_single(WindPtr w, PhotPtr p, int iextract);
+int trans_phot_flight_init(PhotPtr p, FlightPtr f);
+int trans_phot_step(WindPtr w, PhotPtr p, FlightPtr f, int iextract);
 /* phot_util.c */
 int stuff_phot(PhotPtr pin, PhotPtr pout);
 int move_phot(PhotPtr pp, double ds);
@@ -141,11 +154,19 @@ int spec_read(char filename[]);
 /* extract.c */
 int extract(WindPtr w, PhotPtr p, int itype);
 int extract_one(WindPtr w, PhotPtr pp, int itype, int nspec);
+int extract_summary(void);
 /* pdf.c */
 int pdf_gen_from_func(PdfPtr pdf, double (*func)(double), double xmin, double xmax, int njumps, double jump[]);
 double gen_array_from_func(double (*func)(double), double xmin, double xmax, int pdfsteps);
 int pdf_gen_from_array(PdfPtr pdf, double x[], double y[], int n_xy, double xmin, double xmax, int njumps, double jump[]);
 double pdf_get_rand(PdfPtr pdf);
+double pdf_get_x(PdfPtr pdf, double r);
+int pdf_get_rand_n(PdfPtr pdf, int n, double x[]);
+double pdf_interval_q(PdfPtr pdf, int i, double u);
+double pdf_model_cdf(PdfPtr pdf, int i, double x);
+int pdf_alloc(PdfPtr pdf, int npdf);
+int pdf_free(PdfPtr pdf);
+int pdf_make_guide(PdfPtr pdf);
 int pdf_limit(PdfPtr pdf, double xmin, double xmax);
 double pdf_get_rand_limit(PdfPtr pdf);
 int pdf_to_file(PdfPtr pdf, char filename[]);
@@ -167,6 +188,10 @@ void roche_deriv(double s, double *value, double *derivative);
 int randvec(double a[], double r);
 int randvcos(double lmn[], double north[]);
 double vcos(double x);
+int qmc_start(void);
+int qmc_next_photon(void);
+int qmc_stop(void);
+double launch_rand(void);
 /* stellar_wind.c */
 int get_stellar_wind_params(int ndom);
 double stellar_velocity(int ndom, double x[], double v[]);
@@ -209,7 +234,6 @@ void disk_deriv(double s, double *value, double *derivative);
 /* lines.c */
 double total_line_emission(WindPtr one, double f1, double f2);
 double lum_lines(WindPtr one, int nmin, int nmax);
-int lum_pdf(PlasmaPtr xplasma, double lumlines);
 double q21(struct lines *line_ptr, double t);
 double q12(struct lines *line_ptr, double t);
 double a21(struct lines *line_ptr);
@@ -222,6 +246,8 @@ int line_heat(PlasmaPtr xplasma, PhotPtr pp, int nres);
 double upsilon(int n_coll, double u0);
 /* continuum.c */
 double one_continuum(int spectype, double t, double g, double freqmin, double freqmax);
+PdfPtr model_pdf(int spectype, double par[], double freqmin, double freqmax);
+int ring_continuum_freqs(int spectype, int nphot, int nring[], double freqmin, double freqmax, double freq[]);
 double emittance_continuum(int spectype, double freqmin, double freqmax, double t, double g);
 /* emission.c */
 double wind_luminosity(double f1, double f2);
@@ -238,6 +264,8 @@ double fb_topbase_partial(double freq);
 double integ_fb(double t, double f1, double f2, int nion, int fb_choice, int mode);
 double total_fb(WindPtr one, double t, double f1, double f2, int mode);
 double one_fb(WindPtr one, double f1, double f2);
+int fb_store_invalidate(void);
+int fb_store_trim(int nkeep);
 int num_recomb(PlasmaPtr xplasma, double t_e, int mode);
 double fb(PlasmaPtr xplasma, double t, double freq, int ion_choice, int fb_choice);
 int init_freebound(double t1, double t2, double f1, double f2);
@@ -264,6 +292,8 @@ double sv_wind_mdot_integral(double r);
 int ion_abundances(PlasmaPtr xplasma, int mode);
 int convergence(PlasmaPtr xplasma);
 int check_convergence(void);
+int ng_accelerate(PlasmaPtr xplasma, int mode);
+int ng_summary(void);
 int one_shot(PlasmaPtr xplasma, int mode);
 double calc_te(PlasmaPtr xplasma, double tmin, double tmax);
 double zero_emit(double t);
@@ -284,6 +314,8 @@ double vrandwind(double x);
 double reweightwind(PhotPtr p);
 int make_pdf_randwind(double tau);
 int randwind_thermal_trapping(PhotPtr p, int *nnscat);
+double *tt_get_envelope(int ndom, int nnn[], int nelem);
+int randwind_tt_envelope(PhotPtr p, int *nnscat, double tau_x_dvds, double p_norm);
 /* util.c */
 int fraction(double value, double array[], int npts, int *ival, double *f, int mode);
 int linterp(double x, double xarray[], double yarray[], int xdim, double *y, int mode);
@@ -294,6 +326,8 @@ int wind_ij_to_n(int ndom, int i, int j, int *n);
 int wind_x_to_n(double x[], int *n);
 /* density.c */
 double get_ion_density(int ndom, double x[], int nion);
+int ray_interp_init(int ndom, double x1[], double x2[], RayInterpPtr ri);
+double ray_interp_ion_density(RayInterpPtr ri, double x, int nion);
 /* detail.c */
 int detailed_balance(PlasmaPtr xplasma, int nelem, double newden[]);
 int rebalance(double rates_up[], double rates_down[], double fraction[], int ntot);
@@ -301,9 +335,13 @@ int wind_update_after_detailed_balance(PlasmaPtr xplasma, int nelem, double newd
 /* bands.c */
 int bands_init(int imode, struct xbands *band);
 int freqs_init(double freqmin, double freqmax);
+int bands_adapt(struct xbands *band);
 /* time.c */
 double timer(void);
 int get_time(char curtime[]);
+double perf_start(void);
+int perf_stop(int n, double t);
+int perf_report(char label[]);
 /* matom.c */
 int matom(PhotPtr p, int *nres, int *escape);
 double b12(struct lines *line_ptr);
@@ -352,6 +390,7 @@ double ds_to_pillbox(PhotPtr pp, double rmin, double rmax, double height);
 /* cylindrical.c */
 double cylind_ds_in_cell(PhotPtr p);
 int cylind_make_grid(int ndom, WindPtr w);
+int cylind_refine_grid(int ndom, WindPtr w);
 int cylind_wind_complete(int ndom, WindPtr w);
 int cylind_volumes(int ndom, WindPtr w);
 int cylind_where_in_grid(int ndom, double x[]);
@@ -361,6 +400,7 @@ int cylind_is_cell_in_wind(int n);
 /* rtheta.c */
 double rtheta_ds_in_cell(PhotPtr p);
 int rtheta_make_grid(WindPtr w, int ndom);
+int rtheta_refine_grid(int ndom, WindPtr w);
 int rtheta_make_cones(int ndom, WindPtr w);
 int rtheta_wind_complete(int ndom, WindPtr w);
 int rtheta_volumes(int ndom, WindPtr w);
@@ -391,11 +431,15 @@ int bilin(double x[], double x00[], double x01[], double x10[], double x11[], do
 int xquadratic(double a, double b, double c, double r[]);
 /* gridwind.c */
 int create_maps(int ichoice);
+unsigned long morton_key(int ndom, int i, int j);
+int compare_cell_key(const void *a, const void *b);
 int calloc_wind(int nelem);
+int calloc_domain(int ndom);
 int calloc_plasma(int nelem);
 int check_plasma(PlasmaPtr xplasma, char message[]);
 int calloc_macro(int nelem);
 int calloc_estimators(int nelem);
+void *calloc_arena(size_t size, int nper, int nelem, char name[]);
 int calloc_dyn_plasma(int nelem);
 /* partition.c */
 int partition_functions(PlasmaPtr xplasma, int mode);
@@ -419,6 +463,8 @@ double kappa_comp(PlasmaPtr xplasma, double freq);
 double kappa_ind_comp(PlasmaPtr xplasma, double freq);
 double total_comp(WindPtr one, double t_e);
 double klein_nishina(double nu);
+double klein_nishina_exact(double x);
+int compton_init_tables(void);
 int compton_dir(PhotPtr p, PlasmaPtr xplasma);
 double compton_func(double f);
 double sigma_compton_partial(double f, double x);
@@ -467,8 +513,9 @@ int populate_ion_rate_matrix(PlasmaPtr xplasma, double rate_matrix[nions][nions]
 int solve_matrix(double *a_data, double *b_data, int nrows, double *x, int nplasma);
 /* para_update.c */
 int communicate_estimators_para(void);
-int gather_spectra_para(int nspec_helper, int nspecs);
+int gather_spectra_para(int nspecs);
 int communicate_matom_estimators_para(void);
+int communicate_wind_paths_para(void);
 /* setup.c */
 int parse_command_line(int argc, char *argv[]);
 int init_log_and_windsave(int restart_stat);
@@ -495,6 +542,7 @@ int macro_pops(PlasmaPtr xplasma, double xne);
 /* reverb.c */
 double delay_to_observer(PhotPtr pp);
 int delay_dump_prep(int restart_stat);
+int delay_dump_header(FILE *fptr);
 int delay_dump_finish(void);
 int delay_dump_combine(int i_ranks);
 int delay_dump(PhotPtr p, int np);
@@ -503,6 +551,10 @@ int delay_dump_single(PhotPtr pp, int i_spec);
 Wind_Paths_Ptr wind_paths_constructor(WindPtr wind);
 int reverb_init(WindPtr wind);
 int wind_paths_init(WindPtr wind);
+int wind_paths_find_bin(double path);
+Path_Bin_Ptr wind_paths_bin(Wind_Paths_Ptr paths, int i_bin);
+int wind_paths_record(Wind_Paths_Ptr paths, PhotPtr pp);
+Wind_Paths_Ptr wind_paths_hist(int i_hist);
 int line_paths_add_phot(WindPtr wind, PhotPtr pp, int *nres);
 int wind_paths_add_phot(WindPtr wind, PhotPtr pp);
 int simple_paths_gen_phot(PhotPtr pp);
@@ -511,6 +563,7 @@ int wind_paths_gen_phot(WindPtr wind, PhotPtr pp);
 int line_paths_gen_phot(WindPtr wind, PhotPtr pp, int nres);
 int wind_paths_evaluate_single(Wind_Paths_Ptr paths);
 int wind_paths_evaluate(WindPtr wind, int i_rank);
+int wind_paths_dump_bin(FILE *fptr, Wind_Paths_Ptr paths, int i_bin, int *i_next);
 int wind_paths_dump(WindPtr wind, int rank_global);
 int wind_paths_output_dump(WindPtr wind, int i_rank);
 int wind_paths_point_index(int i, int j, int k, int i_top, DomainPtr dom);
@@ -7,6 +7,9 @@
 #include <sys/time.h>
 #include <time.h>
 
+#include "atomic.h"
+#include "python.h"
+
 
 /*
 Return the time in seconds since the timer was initiated
@@ -61,3 +64,175 @@ get_time (curtime)
   curtime[24] = '\0';           // We need to end the string properly
   return (0);
 }
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	perf_start and perf_stop time one of the parts of the code listed in
+	perf_timer_enum
+
+ Arguments:
+	int n		the timer
+	double t	the time returned by perf_start
+
+ Returns:
+	perf_start returns the current time in seconds, or 0 if the timers 
+	are off
+
+ Description:
+	The time between the two calls is added to perf_time[n].
+
+ Notes:
+	These are called millions of times a cycle, so when modes.perf_timers
+	is not set they do nothing but check it.  clock_gettime is used as 
+	it is much cheaper than gettimeofday.
+
+ History:
+	1703		Coded
+
+**************************************************************/
+
+double
+perf_start ()
+{
+  struct timespec ts;
+
+  if (modes.perf_timers == 0)
+    return (0.0);
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (ts.tv_sec + 1.e-9 * ts.tv_nsec);
+}
+
+
+int
+perf_stop (n, t)
+     int n;
+     double t;
+{
+  struct timespec ts;
+
+  if (modes.perf_timers == 0)
+    return (0);
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  perf_time[n] += ts.tv_sec + 1.e-9 * ts.tv_nsec - t;
+  perf_ncall[n]++;
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	perf_report writes the timers and counters for the cycle that has 
+	just finished to the .perf file, and resets them
+
+ Arguments:
+	char label[]	a description of the cycle
+
+ Returns:
+
+ Description:
+	Each thread logs its own timers and counters.  In parallel mode the 
+	minimum, mean and maximum over all the threads are then found on the 
+	master thread, which appends them to files.perf.  The timers are 
+	inclusive, so for example the time in calculate_ds is also part of
+	that in translate_in_wind.
+
+ Notes:
+	This must be called by all of the threads.  Nothing is done unless
+	modes.perf_timers is set.
+
+ History:
+	1703		Coded
+
+**************************************************************/
+
+char *perf_timer_name[NPERF_TIMER] = { "define_phot", "trans_phot", "translate_in_wind", "calculate_ds", "radiation",
+  "matom", "kpkt", "extract", "spectrum_create", "wind_update", "ion_abundances", "communicate_estimators", "wind_save"
+};
+
+char *perf_count_name[NPERF_COUNT] = { "cell_crossings", "resonances_examined", "resonances_accepted", "scatters",
+  "extractions"
+};
+
+int perf_init = 0;
+
+int
+perf_report (label)
+     char label[];
+{
+  FILE *fptr;
+  double x[2 * NPERF_TIMER + NPERF_COUNT];
+  double xmin[2 * NPERF_TIMER + NPERF_COUNT], xmax[2 * NPERF_TIMER + NPERF_COUNT], xmean[2 * NPERF_TIMER + NPERF_COUNT];
+  int n, nx, np_mpi, my_rank;
+
+  if (modes.perf_timers == 0)
+    return (0);
+
+  nx = 2 * NPERF_TIMER + NPERF_COUNT;
+  for (n = 0; n < NPERF_TIMER; n++)
+  {
+    x[n] = perf_time[n];
+    x[NPERF_TIMER + n] = perf_ncall[n];
+    Log_silent ("perf_report: %-24s %8.3f s %12ld calls\n", perf_timer_name[n], perf_time[n], perf_ncall[n]);
+    perf_time[n] = 0;
+    perf_ncall[n] = 0;
+  }
+  for (n = 0; n < NPERF_COUNT; n++)
+  {
+    x[2 * NPERF_TIMER + n] = perf_count[n];
+    Log_silent ("perf_report: %-24s %12ld\n", perf_count_name[n], perf_count[n]);
+    perf_count[n] = 0;
+  }
+
+  np_mpi = 1;
+  my_rank = 0;
+#ifdef MPI_ON
+  MPI_Comm_size (MPI_COMM_WORLD, &np_mpi);
+  MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  MPI_Reduce (x, xmin, nx, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce (x, xmax, nx, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  MPI_Reduce (x, xmean, nx, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+#else
+  for (n = 0; n < nx; n++)
+    xmin[n] = xmax[n] = xmean[n] = x[n];
+#endif
+
+  if (my_rank != 0)
+    return (0);
+
+  for (n = 0; n < nx; n++)
+    xmean[n] /= np_mpi;
+
+  if ((fptr = fopen (files.perf, perf_init ? "a" : "w")) == NULL)
+  {
+    Error ("perf_report: Unable to open %s\n", files.perf);
+    return (0);
+  }
+  perf_init = 1;
+
+  fprintf (fptr, "# %s  threads %d  elapsed %.3f s\n", label, np_mpi, timer ());
+  fprintf (fptr, "# %-24s %10s %10s %10s %12s %12s %12s\n", "timer", "t_min", "t_mean", "t_max", "calls_min", "calls_mean", "calls_max");
+  for (n = 0; n < NPERF_TIMER; n++)
+  {
+    fprintf (fptr, "%-26s %10.3f %10.3f %10.3f %12.0f %12.0f %12.0f\n", perf_timer_name[n], xmin[n], xmean[n], xmax[n],
+             xmin[NPERF_TIMER + n], xmean[NPERF_TIMER + n], xmax[NPERF_TIMER + n]);
+  }
+  fprintf (fptr, "# %-24s %12s %12s %12s\n", "counter", "min", "mean", "max");
+  for (n = 0; n < NPERF_COUNT; n++)
+  {
+    nx = 2 * NPERF_TIMER + n;
+    fprintf (fptr, "%-26s %12.0f %12.0f %12.0f\n", perf_count_name[n], xmin[nx], xmean[nx], xmax[nx]);
+  }
+  fprintf (fptr, "\n");
+  fclose (fptr);
+
+  return (0);
+}
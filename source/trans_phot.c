@@ -52,6 +52,9 @@ History:
 	1112	ksl	Made some changes in the logic to try to trap photons that
 			had somehow escaped the wind to correct a segmenation fault
 			that cropped up in spherical wind models
+	1703	Split the per photon work into trans_phot_launch and 
+			trans_phot_step so the photons can be advanced either
+			one at a time or as a sorted batch, see trans_phot_event
 **************************************************************/
 
 FILE *pltptr;
@@ -62,11 +65,6 @@ int trans_phot (WindPtr w, PhotPtr p, int iextract      /* 0 means do not extrac
   )
 {
   int nphot;
-  struct photon pp, pextract;
-  int nnscat;
-  int disk_illum;               /* this is a variable used to store geo.disk_illum during exxtract */
-  int nerr;
-  double p_norm, tau_norm;
 
 
 
@@ -89,137 +87,339 @@ int trans_phot (WindPtr w, PhotPtr p, int iextract      /* 0 means do not extrac
 
   Log ("\n");
 
-  for (nphot = 0; nphot < NPHOT; nphot++)
+  if (modes.event_transport)
   {
+    trans_phot_event (w, p, iextract);
+  }
+  else
+  {
+    for (nphot = 0; nphot < NPHOT; nphot++)
+    {
 
-    // This is just a watchdog method to tell the user the program is still running
-    // 130306 - ksl since we don't really care what the frequencies are any more
-    if (nphot % 50000 == 0)
-      // OLD 130718 fprintf (stderr, "\rPhoton %7d of %7d or %6.3f per cent ", nphot, NPHOT,
-      Log ("Photon %7d of %7d or %6.3f per cent \n", nphot, NPHOT, nphot * 100. / NPHOT);
-
-    Log_flush ();               /* NSH June 13 Added call to flush logfile */
+      // This is just a watchdog method to tell the user the program is still running
+      // 130306 - ksl since we don't really care what the frequencies are any more
+      if (nphot % 50000 == 0)
+      {
+        // OLD 130718 fprintf (stderr, "\rPhoton %7d of %7d or %6.3f per cent ", nphot, NPHOT,
+        Log ("Photon %7d of %7d or %6.3f per cent \n", nphot, NPHOT, nphot * 100. / NPHOT);
+        Log_flush ();           /* NSH June 13 Added call to flush logfile, now only with the watchdog */
+      }
 
-    /* 74a_ksl Check that the weights are real */
+      p[nphot].np = nphot;
+      trans_phot_launch (w, &p[nphot], iextract);
+      trans_phot_single (w, &p[nphot], iextract);
 
-    if (sane_check (p[nphot].w))
-    {
-      Error ("trans_phot:sane_check photon %d has weight %e\n", nphot, p[nphot].w);
     }
-    /* Next block added by SS Jan 05 - for anisotropic scattering with extract we want to be sure that everything is
-       initialised (by scatter?) before calling extract for macro atom photons. Insert this call to scatter which should do
-       this. */
+  }
+
+  /* This is the end of the loop over all of the photons; after this the routine returns */
+  // 130624 ksl Line added to complete watchdog timer,
+  Log ("\n\n");
+
+  /* sometimes photons scatter near the edge of the wind and get pushed out by DFUDGE. We record these */
+  if (n_lost_to_dfudge > 0)
+    Error ("%ld photons were lost due to DFUDGE (=%8.4e) pushing them outside of the wind after scatter\n", n_lost_to_dfudge, DFUDGE);
+
+  n_lost_to_dfudge = 0;         // reset the counter
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+ Synopsis:
+   trans_phot_launch carries out the work that is needed on a photon before its
+   flight through the wind begins.
+
+ Arguments:		
+	WindPtr w;
+	PhotPtr p;		The photon, whose np must already be set
+	int iextract	0  -> the live or die option and therefore no need to call extract 
+                    !0  -> the normal option for python and hence the need to call "extract"
+ 
+Returns:
+	Always 0
+  
+Description:	
+	For macro atom photons with anisotropic scattering the photon is first 
+	scattered so that everything extract needs has been initialised, and
+	then, if the detailed spectra are being calculated, the original photon
+	is extracted no matter where it was generated.
+		
+Notes:
+	This was the beginning of the loop over photons in trans_phot. It is 
+	separate so that trans_phot_event can launch photons into its window
+	as room becomes available.
+
+History:
+	1703	Moved out of trans_phot
+**************************************************************/
+
+int
+trans_phot_launch (WindPtr w, PhotPtr p, int iextract)
+{
+  struct photon pextract;
+  int nnscat;
+  int disk_illum;               /* this is a variable used to store geo.disk_illum during exxtract */
+  int nerr;
+  double p_norm, tau_norm;
+
+  /* 74a_ksl Check that the weights are real */
+
+  if (sane_check (p->w))
+  {
+    Error ("trans_phot:sane_check photon %d has weight %e\n", p->np, p->w);
+  }
+  /* Next block added by SS Jan 05 - for anisotropic scattering with extract we want to be sure that everything is
+     initialised (by scatter?) before calling extract for macro atom photons. Insert this call to scatter which should do
+     this. */
 
 
-    if (geo.rt_mode == 2 && geo.scatter_mode == 1)
+  if (geo.rt_mode == 2 && geo.scatter_mode == 1)
+  {
+    if (p->origin == PTYPE_WIND)
     {
-      if (p[nphot].origin == PTYPE_WIND)
+      if (p->nres > -1 && p->nres < NLINES)
       {
-        if (p[nphot].nres > -1 && p[nphot].nres < NLINES)
+        geo.rt_mode = 1;
+        /* 74a_ksl Check to see when a photon weight is becoming unreal */
+        if (sane_check (p->w))
+        {
+          Error ("trans_phot:sane_check photon %d has weight %e before scatter\n", p->np, p->w);
+        }
+        if ((nerr = scatter (p, &p->nres, &nnscat)) != 0)
+        {
+          Error ("trans_phot: Bad return from scatter %d at point 1", nerr);
+        }
+        /* 74a_ksl Check to see when a photon weight is becoming unreal */
+        if (sane_check (p->w))
         {
-          geo.rt_mode = 1;
-          /* 74a_ksl Check to see when a photon weight is becoming unreal */
-          if (sane_check (p[nphot].w))
-          {
-            Error ("trans_phot:sane_check photon %d has weight %e before scatter\n", nphot, p[nphot].w);
-          }
-          if ((nerr = scatter (&p[nphot], &p[nphot].nres, &nnscat)) != 0)
-          {
-            Error ("trans_phot: Bad return from scatter %d at point 1", nerr);
-          }
-          /* 74a_ksl Check to see when a photon weight is becoming unreal */
-          if (sane_check (p[nphot].w))
-          {
-            Error ("trans_phot:sane_check photon %d has weight %e aftger scatter\n", nphot, p[nphot].w);
-          }
-          geo.rt_mode = 2;
+          Error ("trans_phot:sane_check photon %d has weight %e aftger scatter\n", p->np, p->w);
         }
+        geo.rt_mode = 2;
       }
     }
+  }
 
 
 
 
 
-    stuff_phot (&p[nphot], &pp);
-    disk_illum = geo.disk_illum;
+  disk_illum = geo.disk_illum;
 
-    /* The next if statement is executed if we are calculating the detailed spectrum and makes sure we always run extract on
-       the original photon no matter where it was generated */
+  /* The next if statement is executed if we are calculating the detailed spectrum and makes sure we always run extract on
+     the original photon no matter where it was generated */
 
-    if (iextract)
+  if (iextract)
+  {
+    // SS - for reflecting disk have to make sure disk photons are only extracted once.  Note we restore the
+    // correct geo.disk_illum value as soon as the photons are extracted!
+
+    if (disk_illum == DISK_ILLUM_SCATTER && p->origin == PTYPE_DISK)
     {
-      // SS - for reflecting disk have to make sure disk photons are only extracted once.  Note we restore the
-      // correct geo.disk_illum value as soon as the photons are extracted!
+      geo.disk_illum = DISK_ILLUM_ABSORB_AND_DESTROY;
+    }
 
-      if (disk_illum == DISK_ILLUM_SCATTER && p[nphot].origin == PTYPE_DISK)
-      {
-        geo.disk_illum = DISK_ILLUM_ABSORB_AND_DESTROY;
-      }
 
+    stuff_phot (p, &pextract);
 
-      stuff_phot (&p[nphot], &pextract);
 
+    /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the escape
+       probability along a given direction, but we also need to divide the weight by the mean escape probability, which is
+       equal to 1/nnscat */
+    if (geo.scatter_mode == 2 && pextract.nres <= NLINES && pextract.nres > 0)
+    {
+      /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
+         First find the sobolev optical depth along that vector */
+      tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
 
-      /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the escape
-         probability along a given direction, but we also need to divide the weight by the mean escape probability, which is
-         equal to 1/nnscat */
-      if (geo.scatter_mode == 2 && pextract.nres <= NLINES && pextract.nres > 0)
-      {
-        /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
-           First find the sobolev optical depth along that vector */
-        tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
+      /* then turn into a probability */
+      p_norm = p_escape_from_tau (tau_norm);
 
-        /* then turn into a probability */
-        p_norm = p_escape_from_tau (tau_norm);
+    }
+    else
+    {
+      p_norm = 1.0;
 
-      }
-      else
-      {
-        p_norm = 1.0;
+      /* throw an error if nnscat does not equal 1 */
+      if (pextract.nnscat != 1)
+        Error
+          ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
+           pextract.nnscat, p->np, geo.scatter_mode, pextract.nres, NLINES);
+    }
 
-        /* throw an error if nnscat does not equal 1 */
-        if (pextract.nnscat != 1)
-          Error
-            ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
-             pextract.nnscat, nphot, geo.scatter_mode, pextract.nres, NLINES);
-      }
 
 
+    /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the escape
+       probability along a given direction, but we also need to divide the weight by the mean escape probability, which is
+       equal to 1/nnscat */
+    pextract.w *= p->nnscat / p_norm;
 
-      /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the escape
-         probability along a given direction, but we also need to divide the weight by the mean escape probability, which is
-         equal to 1/nnscat */
-      pextract.w *= p[nphot].nnscat / p_norm;
+    if (sane_check (pextract.w))
+    {
+      Error ("trans_phot: sane_check photon %d has weight %e before extract\n", p->np, pextract.w);
+    }
+    extract (w, &pextract, pextract.origin);
 
-      if (sane_check (pextract.w))
-      {
-        Error ("trans_phot: sane_check photon %d has weight %e before extract\n", nphot, pextract.w);
-      }
-      extract (w, &pextract, pextract.origin);
 
+    // Restore the correct disk illumination
+    if (disk_illum == DISK_ILLUM_SCATTER && p->origin == PTYPE_DISK)
+    {
+      geo.disk_illum = DISK_ILLUM_SCATTER;
+    }
+  }
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+ Synopsis:
+   trans_phot_event transports all of the photons by advancing a window of
+   flights one step at a time, with the flights in each sweep taken in the
+   order of the cells they are in.
+
+ Arguments:		
+	WindPtr w;
+	PhotPtr p;
+	int iextract	0  -> the live or die option and therefore no need to call extract 
+                    !0  -> the normal option for python and hence the need to call "extract"
+ 
+Returns:
+	Always 0
+  
+Description:	
+	Up to NFLIGHT photons are in flight at once.  At the start of each sweep
+	the window is topped up with newly launched photons.  The flights are then
+	sorted by the cell they are in, with a counting sort on the grid number,
+	and each is advanced by a single call to trans_phot_step.  Flights which
+	have ended are added to the spectra and removed from the window.
+
+	Since the flights in neighbouring positions of a sweep are mostly in the 
+	same cell, the wind, plasma and ion data that a step touches tend to be 
+	in cache already, which is not so when each photon is flown to 
+	completion before the next is begun.
+		
+Notes:
+	A step is one call to translate together with whatever is then done to
+	the photon (scattering, absorption and so on).  The physics is identical
+	to the history transport; only the order in which random numbers are 
+	drawn, and hence the particular photons, differ.
+
+	The photons must be processed in order of np in the history transport,
+	but nothing here depends on that order.
+
+History:
+	1703	Coded
+**************************************************************/
+
+int
+trans_phot_event (WindPtr w, PhotPtr p, int iextract)
+{
+  FlightPtr flights;
+  int *iphot, *order, *nbucket;
+  int nlaunch, nactive, nstep;
+  int i, j, n;
+
+  flights = (FlightPtr) calloc (sizeof (flight_dummy), NFLIGHT);
+  iphot = (int *) calloc (sizeof (int), NFLIGHT);
+  order = (int *) calloc (sizeof (int), NFLIGHT);
+  nbucket = (int *) calloc (sizeof (int), NDIM2 + 2);
+
+  if (flights == NULL || iphot == NULL || order == NULL || nbucket == NULL)
+  {
+    Error ("trans_phot_event: Could not allocate memory for %d flights\n", NFLIGHT);
+    exit (0);
+  }
+
+  nlaunch = nactive = nstep = 0;
+
+  while (nlaunch < NPHOT || nactive > 0)
+  {
+
+    /* Fill the window with new photons */
 
-      // Restore the correct disk illumination
-      if (disk_illum == DISK_ILLUM_SCATTER && p[nphot].origin == PTYPE_DISK)
+    while (nactive < NFLIGHT && nlaunch < NPHOT)
+    {
+      // This is just a watchdog method to tell the user the program is still running
+      if (nlaunch % 50000 == 0)
       {
-        geo.disk_illum = DISK_ILLUM_SCATTER;
+        Log ("Photon %7d of %7d or %6.3f per cent \n", nlaunch, NPHOT, nlaunch * 100. / NPHOT);
+        Log_flush ();
       }
+
+      p[nlaunch].np = nlaunch;
+      trans_phot_launch (w, &p[nlaunch], iextract);
+      trans_phot_flight_init (&p[nlaunch], &flights[nactive]);
+      iphot[nactive] = nlaunch;
+      nactive++;
+      nlaunch++;
     }
 
-    p[nphot].np = nphot;
-    trans_phot_single (w, &p[nphot], iextract);
+    /* Sort the flights by cell.  Photons which are not in a cell of the grid go last */
 
-  }
+    for (n = 0; n < NDIM2 + 2; n++)
+      nbucket[n] = 0;
 
-  /* This is the end of the loop over all of the photons; after this the routine returns */
-  // 130624 ksl Line added to complete watchdog timer,
-  Log ("\n\n");
+    for (i = 0; i < nactive; i++)
+    {
+      n = flights[i].pp.grid;
+      if (n < 0 || n >= NDIM2)
+        n = NDIM2;
+      nbucket[n + 1]++;
+    }
 
-  /* sometimes photons scatter near the edge of the wind and get pushed out by DFUDGE. We record these */
-  if (n_lost_to_dfudge > 0)
-    Error ("%ld photons were lost due to DFUDGE (=%8.4e) pushing them outside of the wind after scatter\n", n_lost_to_dfudge, DFUDGE);
+    for (n = 0; n < NDIM2 + 1; n++)
+      nbucket[n + 1] += nbucket[n];
 
-  n_lost_to_dfudge = 0;         // reset the counter
+    for (i = 0; i < nactive; i++)
+    {
+      n = flights[i].pp.grid;
+      if (n < 0 || n >= NDIM2)
+        n = NDIM2;
+      order[nbucket[n]++] = i;
+    }
+
+    /* Advance each flight by one step */
+
+    for (i = 0; i < nactive; i++)
+    {
+      j = order[i];
+      trans_phot_step (w, &p[iphot[j]], &flights[j], iextract);
+    }
+    nstep += nactive;
+
+    /* Remove the flights which are over, adding the photons to the spectra */
+
+    for (i = j = 0; i < nactive; i++)
+    {
+      if (flights[i].istat == P_INWIND)
+      {
+        if (j != i)
+        {
+          flights[j] = flights[i];
+          iphot[j] = iphot[i];
+        }
+        j++;
+      }
+      else
+      {
+        spectrum_add_phot (&p[iphot[i]], geo.select_extract);
+      }
+    }
+    nactive = j;
+  }
+
+  Log ("trans_phot_event: %d photons took %d steps\n", NPHOT, nstep);
+
+  free (flights);
+  free (iphot);
+  free (order);
+  free (nbucket);
 
   return (0);
 }
@@ -249,6 +449,8 @@ where, in "translate" or "scatter".
 Notes:
 History:
  	1505 	SWM Coded 
+	1703	Adds the photon to the spectra once it has finished
+	1703	The body of the loop is now trans_phot_step
 **************************************************************/
 
 
@@ -257,348 +459,434 @@ History:
 int
 trans_phot_single (WindPtr w, PhotPtr p, int iextract)
 {
-  double tau_scat, tau;
+  struct flight f;
+
+  /* Initialize parameters that are needed for the flight of the photon through the wind */
+  trans_phot_flight_init (p, &f);
+
+  /* This is the beginning of the loop for each photon and executes until the photon leaves the wind */
+
+  while (f.istat == P_INWIND)
+  {
+    trans_phot_step (w, p, &f, iextract);
+  }
+
+  /* This is the end of the loop over individual photons */
+
+  /* The flight of the photon is over, so add it to the spectra now rather than in a
+     separate pass over all the photons */
+  spectrum_add_phot (p, geo.select_extract);
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+ Synopsis:
+   trans_phot_flight_init sets up the state needed for the flight of a photon
+   through the wind
+
+ Arguments:		
+	PhotPtr p;		The photon
+	FlightPtr f;	The flight to initialise
+ 
+Returns:
+	Always 0
+  
+Description:	
+	The photon is copied to the flight and the optical depth it can travel
+	before it scatters is drawn.
+		
+Notes:
+
+History:
+	1703	Coded
+**************************************************************/
+
+int
+trans_phot_flight_init (PhotPtr p, FlightPtr f)
+{
+  stuff_phot (p, &f->pp);
+  f->tau_scat = -log (1. - (rand () + 0.5) / MAXRAND);
+  f->weight_min = EPSILON * p->w;
+  f->istat = P_INWIND;
+  f->tau = 0;
+  f->nres = -1;
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+ Synopsis:
+   trans_phot_step advances a photon through a single step of its flight
+
+ Arguments:		
+	WindPtr w;
+	PhotPtr p;		The photon, left at its last scatter
+	FlightPtr f;	The state of the flight, including the photon as it moves
+	int iextract	0  -> the live or die option and therefore no need to call extract 
+                    !0  -> the normal option for python and hence the need to call "extract"
+ 
+Returns:
+	The status of the photon, which is also stored in f->istat.  The flight
+	continues only while this is P_INWIND
+  
+Description:	
+	The photon is moved by translate to the next boundary or scattering 
+	point, and then whatever happens there (absorption, hitting the star
+	or disk, scattering and extraction) is carried out.
+		
+Notes:
+	This was the body of the loop in trans_phot_single.
+
+History:
+	1703	Moved out of trans_phot_single
+**************************************************************/
+
+int
+trans_phot_step (WindPtr w, PhotPtr p, FlightPtr f, int iextract)
+{
   int istat;
   double rrr;
-  int icell;
-  int nres, *ptr_nres;
+  int *ptr_nres;
   int kkk, n;
-  double weight_min;
-  struct photon pp, pextract;
+  PhotPtr pp;
+  struct photon pextract;
   int nnscat;
   int nerr;
   double p_norm, tau_norm;
   double x_dfudge_check[3];
   int ndom;
 
-  /* Initialize parameters that are needed for the flight of the photon through the wind */
-  stuff_phot (p, &pp);
-  tau_scat = -log (1. - (rand () + 0.5) / MAXRAND);
-  weight_min = EPSILON * pp.w;
-  istat = P_INWIND;
-  tau = 0;
-  icell = 0;
-
+  pp = &f->pp;
   n = 0;                        // Needed to avoid 03 warning, but it is not clear that it is defined as expected.
 
+  /* translate involves only a single shell (or alternatively a single tranfer in the windless region). istat as returned by
+     should either be 0 in which case the photon hit the other side of the shell without scattering or 1 in which case there 
+     was a scattering event in the shell, 2 in which case the photon reached the outside edge of the grid and escaped, 3 in 
+     which case it reach the inner edge and was reabsorbed. If the photon escapes then we leave the photon at the position
+     of it's last scatter.  In most other cases though we store the final position of the photon. */
 
 
-  /* This is the beginning of the loop for each photon and executes until the photon leaves the wind */
+  istat = translate (w, pp, f->tau_scat, &f->tau, &f->nres);
+  /* nres is the resonance at which the photon was stopped.  At present the same value is also stored in pp->nres, but I have 
+     not yet eliminated it from translate. ?? 02jan ksl */
+
+  istat = walls (pp, p);
+  // pp is where the photon is going, p is where it was
+
+
+  if (modes.ispy)
+    ispy (pp, p->np);
+
+
+  if (istat == -1)
+  {
+    Error_silent ("trans_phot: Abnormal return from translate on photon %d\n", p->np);
+    f->istat = istat;
+    return (istat);
+  }
 
-  while (istat == P_INWIND)
+  if (pp->w < f->weight_min)
   {
+    istat = pp->istat = P_ABSORB;      /* This photon was absorbed by continuum opacity within the wind */
+    pp->tau = VERY_BIG;
+    stuff_phot (pp, p);
+    f->istat = istat;
+    return (istat);
+  }
 
-    /* translate involves only a single shell (or alternatively a single tranfer in the windless region). istat as returned by
-       should either be 0 in which case the photon hit the other side of the shell without scattering or 1 in which case there 
-       was a scattering event in the shell, 2 in which case the photon reached the outside edge of the grid and escaped, 3 in 
-       which case it reach the inner edge and was reabsorbed. If the photon escapes then we leave the photon at the position
-       of it's last scatter.  In most other cases though we store the final position of the photon. */
+  if (istat == P_HIT_STAR)
+  {                           /* It was absorbed by the star */
+    stuff_phot (pp, p);
+    f->istat = istat;
+    return (istat);
+  }
 
 
-    istat = translate (w, &pp, tau_scat, &tau, &nres);
-    /* nres is the resonance at which the photon was stopped.  At present the same value is also stored in pp->nres, but I have 
-       not yet eliminated it from translate. ?? 02jan ksl */
+  if (istat == P_HIT_DISK)
+  {
+    /* It was absorbed by the disk */
+
+    /* Store the energy of the photon bundle into a disk structure so that one can determine later how much and where the
+       disk was heated by photons */
+    /* Note that the disk is defined from 0 to NRINGS-2. NRINGS-1 contains the position of the outer radius of the disk. */
+    stuff_phot (pp, p);
+    rrr = sqrt (dot (pp->x, pp->x));
+    kkk = 0;
+    while (rrr > qdisk.r[kkk] && kkk < NRINGS - 1)
+      kkk++;
+    kkk--;                    // So that the heating refers to the heating between kkk and kkk+1
+    qdisk.nhit[kkk]++;
+    qdisk.heat[kkk] += pp->w;  // 60a - ksl - Added to be able to calculate illum of disk
+    qdisk.ave_freq[kkk] += pp->w * pp->freq;
+    f->istat = istat;
+    return (istat);
+  }
 
-    icell++;
-    istat = walls (&pp, p);
-    // pp is where the photon is going, p is where it was
+  if (istat == P_SCAT)
+  {                           /* Cause the photon to scatter and reinitilize */
 
+    perf_count[PERF_SCATTERS]++;
 
-    if (modes.ispy)
-      ispy (&pp, n);
 
+    /* 71 - 1112 - ksl - placed this line here to try to avoid an error I was seeing in scatter.  I believe the first if
+       statement has a loophole that needs to be plugged, when it comes back with avalue of n = -1 */
 
-    if (istat == -1)
-    {
-      Error_silent ("trans_phot: Abnormal return from translate on photon %d\n", p->np);
-      break;
-    }
+    pp->grid = n = where_in_grid (wmain[pp->grid].ndom, pp->x);
 
-    if (pp.w < weight_min)
+    if (n < 0)
     {
-      istat = pp.istat = P_ABSORB;      /* This photon was absorbed by continuum opacity within the wind */
-      pp.tau = VERY_BIG;
-      stuff_phot (&pp, p);
-      break;
-    }
-
-    if (istat == P_HIT_STAR)
-    {                           /* It was absorbed by the star */
-      stuff_phot (&pp, p);
-      break;
+      Error ("trans_phot: Trying to scatter a photon which is not in the wind\n");
+      Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp->grid, pp->x[0], pp->x[1], pp->x[2]);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      istat = pp->istat = p->istat = P_ERROR;
+      stuff_phot (pp, p);
+      f->istat = istat;
+      return (istat);
     }
 
+    /* 57+ -- ksl -- Add check to see if there is a cell in the plasma structure for this.  This is a problem that needs
+       fixing */
+    /* 1506 JM -- this appeared to happen due to a rather convoluted problem involving DFUDGE
+       and not updating the istat variable properly. See Issue #154 for discussion */
 
-    if (istat == P_HIT_DISK)
+    if (wmain[n].nplasma == NPLASMA)
     {
-      /* It was absorbed by the disk */
-
-      /* Store the energy of the photon bundle into a disk structure so that one can determine later how much and where the
-         disk was heated by photons */
-      /* Note that the disk is defined from 0 to NRINGS-2. NRINGS-1 contains the position of the outer radius of the disk. */
-      stuff_phot (&pp, p);
-      rrr = sqrt (dot (pp.x, pp.x));
-      kkk = 0;
-      while (rrr > qdisk.r[kkk] && kkk < NRINGS - 1)
-        kkk++;
-      kkk--;                    // So that the heating refers to the heating between kkk and kkk+1
-      qdisk.nhit[kkk]++;
-      qdisk.heat[kkk] += pp.w;  // 60a - ksl - Added to be able to calculate illum of disk
-      qdisk.ave_freq[kkk] += pp.w * pp.freq;
-      break;
+      Error ("trans_phot: Trying to scatter a photon which is not in a cell in the plasma structure\n");
+      Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp->grid, pp->x[0], pp->x[1], pp->x[2]);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      istat = pp->istat = p->istat = P_ERROR;
+      stuff_phot (pp, p);
+      f->istat = istat;
+      return (istat);
     }
 
-    if (istat == P_SCAT)
-    {                           /* Cause the photon to scatter and reinitilize */
+    /* 57h -- ksl -- Add check to verify the cell has some volume */
 
+    if (wmain[n].vol <= 0)
+    {
+      Error ("trans_phot: Trying to scatter a photon in a cell with no wind volume\n");
+      Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp->grid, pp->x[0], pp->x[1], pp->x[2]);
+      Log ("istat %d\n", pp->istat);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      istat = pp->istat = p->istat = P_ERROR;
+      stuff_phot (pp, p);
+      f->istat = istat;
+      return (istat);
 
-      /* 71 - 1112 - ksl - placed this line here to try to avoid an error I was seeing in scatter.  I believe the first if
-         statement has a loophole that needs to be plugged, when it comes back with avalue of n = -1 */
+    }
 
-      pp.grid = n = where_in_grid (wmain[pp.grid].ndom, pp.x);
+    /* 0215 SWM - Added cell-based reverberation mapping */
+    if ((geo.reverb == REV_WIND || geo.reverb == REV_MATOM) && geo.ioniz_or_extract && geo.wcycle == geo.wcycles - 1)
+    {
+      wind_paths_add_phot (&wmain[n], pp);
+    }
 
-      if (n < 0)
-      {
-        Error ("trans_phot: Trying to scatter a photon which is not in the wind\n");
-        Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
-      }
 
-      /* 57+ -- ksl -- Add check to see if there is a cell in the plasma structure for this.  This is a problem that needs
-         fixing */
-      /* 1506 JM -- this appeared to happen due to a rather convoluted problem involving DFUDGE
-         and not updating the istat variable properly. See Issue #154 for discussion */
+    /* SS July 04 - next lines modified so that the "thermal trapping" model of anisotropic scattering is included in the
+       macro atom method. What happens now is all in scatter - within that routine the "thermal trapping" model is used to
+       decide what the direction of emission is before returning here.  54b-ksl -- To see what the code did previously see
+       py46.  I've confirmed that the current version of scattering really does what the old code did for two-level lines */
 
-      if (wmain[n].nplasma == NPLASMA)
-      {
-        Error ("trans_phot: Trying to scatter a photon which is not in a cell in the plasma structure\n");
-        Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
-      }
 
-      /* 57h -- ksl -- Add check to verify the cell has some volume */
+    nnscat = 0;
+    nnscat++;
+    ptr_nres = &f->nres;
 
-      if (wmain[n].vol <= 0)
-      {
-        Error ("trans_phot: Trying to scatter a photon in a cell with no wind volume\n");
-        Error ("trans_phot: grid %3d x %8.2e %8.2e %8.2e\n", pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Log ("istat %d\n", pp.istat);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
+    /* 74a_ksl - Check added to search for error in weights */
+    if (sane_check (pp->w))
+    {
+      Error ("trans_phot:sane_checl photon %d has weight %e before scatter\n", p->np, pp->w);
+    }
+    if ((nerr = scatter (pp, ptr_nres, &nnscat)) != 0)
+    {
+      Error ("trans_phot: Bad return from scatter %d at point 2", nerr);
+    }
+    pp->nscat++;
+    /* 74a_ksl - Check added to search for error in weights */
 
-      }
+    if (sane_check (pp->w))
+    {
+      Error ("trans_phot:sane_check photon %d has weight %e after scatter\n", p->np, pp->w);
+    }
 
-      /* 0215 SWM - Added cell-based reverberation mapping */
-      if ((geo.reverb == REV_WIND || geo.reverb == REV_MATOM) && geo.ioniz_or_extract && geo.wcycle == geo.wcycles - 1)
-      {
-        wind_paths_add_phot (&wmain[n], &pp);
-      }
+    /* SS June 04: During the spectrum calculation cycles, photons are thrown away when they interact with macro atoms or
+       become k-packets. This is done by setting their weight to zero (effectively they have been absorbed into either
+       excitation energy or thermal energy). Since they now have no weight there is no need to follow them further. */
+    /* 54b-ksl ??? Stuart do you really mean the comment above; it's not obvious to me since if true why does one need to
+       calculate the progression of photons through the wind at all??? Also how is this enforced; where is pp->w set to a
+       low value. */
+    /* JM 1504 -- This is correct. It's one of the odd things about combining the macro-atom approach with our way of doing 
+       'spectral cycles'. If photons activate macro-atoms they are destroyed, but we counter this by generating photons
+       from deactivating macro-atoms with the already calculated emissivities. */
+
+    if (geo.matom_radiation == 1 && geo.rt_mode == 2 && pp->w < f->weight_min)
+      /* Flag for the spectrum calculations in a macro atom calculation SS */
+    {
+      istat = pp->istat = P_ABSORB;
+      pp->tau = VERY_BIG;
+      stuff_phot (pp, p);
+      f->istat = istat;
+      return (istat);
+    }
 
+    // Calculate the line heating and if the photon was absorbed break finish up
+    // ??? Need to modify line_heat for multiple scattering but not yet
+    // Condition that nres < nlines added (SS) 
 
-      /* SS July 04 - next lines modified so that the "thermal trapping" model of anisotropic scattering is included in the
-         macro atom method. What happens now is all in scatter - within that routine the "thermal trapping" model is used to
-         decide what the direction of emission is before returning here.  54b-ksl -- To see what the code did previously see
-         py46.  I've confirmed that the current version of scattering really does what the old code did for two-level lines */
+    if (f->nres > -1 && f->nres < nlines)
+    {
+      pp->nrscat++;
 
+      /* This next statement writes out the position of every resonant scattering event to a file */
+      if (modes.track_resonant_scatters)
+        fprintf (pltptr,
+                 "Photon %i has resonant scatter at %.2e %.2e %.2e in wind cell %i (grid cell=%i). Freq=%e Weight=%e\n",
+                 p->np, pp->x[0], pp->x[1], pp->x[2], wmain[n].nplasma, pp->grid, pp->freq, pp->w);
 
-      nnscat = 0;
-      nnscat++;
-      ptr_nres = &nres;
+      /* 68a - 090124 - ksl - Increment the number of scatters by this ion in this cell */
+      /* 68c - 090408 - ksl - Changed this to the weight of the photon at the time of the scatter */
 
-      /* 74a_ksl - Check added to search for error in weights */
-      if (sane_check (pp.w))
-      {
-        Error ("trans_phot:sane_checl photon %d has weight %e before scatter\n", p->np, pp.w);
-      }
-      if ((nerr = scatter (&pp, ptr_nres, &nnscat)) != 0)
-      {
-        Error ("trans_phot: Bad return from scatter %d at point 2", nerr);
-      }
-      pp.nscat++;
-      /* 74a_ksl - Check added to search for error in weights */
+      plasmamain[wmain[n].nplasma].scatters[line[f->nres].nion] += pp->w;
 
-      if (sane_check (pp.w))
+      if (geo.rt_mode == 1)   // only do next line for non-macro atom case
       {
-        Error ("trans_phot:sane_check photon %d has weight %e after scatter\n", p->np, pp.w);
+        line_heat (&plasmamain[wmain[n].nplasma], pp, f->nres);
       }
 
-      /* SS June 04: During the spectrum calculation cycles, photons are thrown away when they interact with macro atoms or
-         become k-packets. This is done by setting their weight to zero (effectively they have been absorbed into either
-         excitation energy or thermal energy). Since they now have no weight there is no need to follow them further. */
-      /* 54b-ksl ??? Stuart do you really mean the comment above; it's not obvious to me since if true why does one need to
-         calculate the progression of photons through the wind at all??? Also how is this enforced; where is pp.w set to a
-         low value. */
-      /* JM 1504 -- This is correct. It's one of the odd things about combining the macro-atom approach with our way of doing 
-         'spectral cycles'. If photons activate macro-atoms they are destroyed, but we counter this by generating photons
-         from deactivating macro-atoms with the already calculated emissivities. */
-
-      if (geo.matom_radiation == 1 && geo.rt_mode == 2 && pp.w < weight_min)
-        /* Flag for the spectrum calculations in a macro atom calculation SS */
+      if (pp->w < f->weight_min)
       {
-        istat = pp.istat = P_ABSORB;
-        pp.tau = VERY_BIG;
-        stuff_phot (&pp, p);
-        break;
+        istat = pp->istat = P_ABSORB;  /* This photon was absorbed by continuum opacity within the wind */
+        pp->tau = VERY_BIG;
+        stuff_phot (pp, p);
+        f->istat = istat;
+        return (istat);
       }
+    }
 
-      // Calculate the line heating and if the photon was absorbed break finish up
-      // ??? Need to modify line_heat for multiple scattering but not yet
-      // Condition that nres < nlines added (SS) 
-
-      if (nres > -1 && nres < nlines)
-      {
-        pp.nrscat++;
-
-        /* This next statement writes out the position of every resonant scattering event to a file */
-        if (modes.track_resonant_scatters)
-          fprintf (pltptr,
-                   "Photon %i has resonant scatter at %.2e %.2e %.2e in wind cell %i (grid cell=%i). Freq=%e Weight=%e\n",
-                   p->np, pp.x[0], pp.x[1], pp.x[2], wmain[n].nplasma, pp.grid, pp.freq, pp.w);
-
-        /* 68a - 090124 - ksl - Increment the number of scatters by this ion in this cell */
-        /* 68c - 090408 - ksl - Changed this to the weight of the photon at the time of the scatter */
-
-        plasmamain[wmain[n].nplasma].scatters[line[nres].nion] += pp.w;
 
-        if (geo.rt_mode == 1)   // only do next line for non-macro atom case
-        {
-          line_heat (&plasmamain[wmain[n].nplasma], &pp, nres);
-        }
-
-        if (pp.w < weight_min)
-        {
-          istat = pp.istat = P_ABSORB;  /* This photon was absorbed by continuum opacity within the wind */
-          pp.tau = VERY_BIG;
-          stuff_phot (&pp, p);
-          break;
-        }
-      }
+    /* The next if statement causes photons to be extracted during the creation of the detailed spectrum portion of the
+       program */
 
+    /* N.B. To use the anisotropic scattering option, extract needs to follow scatter.  This is because the reweighting
+       which occurs in extract needs the pdf for scattering to have been initialized. 02may ksl.  This seems to be OK at
+       present. */
 
-      /* The next if statement causes photons to be extracted during the creation of the detailed spectrum portion of the
-         program */
+    if (iextract)
+    {
+      stuff_phot (pp, &pextract);
 
-      /* N.B. To use the anisotropic scattering option, extract needs to follow scatter.  This is because the reweighting
-         which occurs in extract needs the pdf for scattering to have been initialized. 02may ksl.  This seems to be OK at
-         present. */
 
-      if (iextract)
+      /* JM 1407 -- This next loop is required because in anisotropic scattering mode 2 we have normalised our rejection 
+         method. This means that we have to adjust nnscat by this factor, since nnscat will be lower by a factor of
+         1/p_norm */
+      if (geo.scatter_mode == 2 && pextract.nres <= NLINES && pextract.nres > 0)
       {
-        stuff_phot (&pp, &pextract);
-
+        /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
+           First find the sobolev optical depth along that vector */
+        tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
 
-        /* JM 1407 -- This next loop is required because in anisotropic scattering mode 2 we have normalised our rejection 
-           method. This means that we have to adjust nnscat by this factor, since nnscat will be lower by a factor of
-           1/p_norm */
-        if (geo.scatter_mode == 2 && pextract.nres <= NLINES && pextract.nres > 0)
-        {
-          /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
-             First find the sobolev optical depth along that vector */
-          tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
+        /* then turn into a probability */
+        p_norm = p_escape_from_tau (tau_norm);
 
-          /* then turn into a probability */
-          p_norm = p_escape_from_tau (tau_norm);
+      }
+      else
+      {
+        p_norm = 1.0;
 
-        }
-        else
-        {
-          p_norm = 1.0;
-
-          /* throw an error if nnscat does not equal 1 */
-          /* JM 1504-- originally I'd used the wrong value of nnscat here. This would throw large amounts of errors which 
-             weren't actually errors */
-          /* nnscat is the quantity associated with this photon being extracted */
-          if (nnscat != 1)
-            Error
-              ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
-               nnscat, p->np, geo.scatter_mode, pextract.nres, NLINES);
-        }
+        /* throw an error if nnscat does not equal 1 */
+        /* JM 1504-- originally I'd used the wrong value of nnscat here. This would throw large amounts of errors which 
+           weren't actually errors */
+        /* nnscat is the quantity associated with this photon being extracted */
+        if (nnscat != 1)
+          Error
+            ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
+             nnscat, p->np, geo.scatter_mode, pextract.nres, NLINES);
+      }
 
-        /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the
-           escape probability along a given direction, but we also need to divide the weight by the mean escape
-           probability, which is equal to 1/nnscat */
-        pextract.w *= nnscat / p_norm;
+      /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the
+         escape probability along a given direction, but we also need to divide the weight by the mean escape
+         probability, which is equal to 1/nnscat */
+      pextract.w *= nnscat / p_norm;
 
-        if (sane_check (pextract.w))
-        {
-          Error ("trans_phot: sane_check photon %d has weight %e before extract\n", p->np, pextract.w);
-        }
-        extract (w, &pextract, PTYPE_WIND);     // Treat as wind photon for purpose of extraction
+      if (sane_check (pextract.w))
+      {
+        Error ("trans_phot: sane_check photon %d has weight %e before extract\n", p->np, pextract.w);
       }
+      extract (w, &pextract, PTYPE_WIND);     // Treat as wind photon for purpose of extraction
+    }
 
 
 
 
-      /* OK we are ready to continue the processing of a photon which has scattered. The next steps reinitialize parameters
-         so that the photon can continue throug the wind */
-
-      tau_scat = -log (1. - (rand () + 0.5) / MAXRAND);
-      istat = pp.istat = P_INWIND;      // if we got here, the photon stays in the wind- make sure istat doesn't say scattered still! 
-      tau = 0;
+    /* OK we are ready to continue the processing of a photon which has scattered. The next steps reinitialize parameters
+       so that the photon can continue throug the wind */
 
-      stuff_v (pp.x, x_dfudge_check);   // this is a vector we use to see if dfudge moved the photon outside the wind cone
-      reposition (&pp);
+    f->tau_scat = -log (1. - (rand () + 0.5) / MAXRAND);
+    istat = pp->istat = P_INWIND;      // if we got here, the photon stays in the wind- make sure istat doesn't say scattered still! 
+    f->tau = 0;
 
-      /* JM 1506 -- call walls again to account for instance where DFUDGE 
-         can take photon outside of the wind and into the disk or star 
-         after scattering. Note that walls updates the istat in pp as well.
-         This may not be necessary but I think to account for every eventuality 
-         it should be done */
-      istat = walls (&pp, p);
+    stuff_v (pp->x, x_dfudge_check);   // this is a vector we use to see if dfudge moved the photon outside the wind cone
+    reposition (pp);
 
-      /* This *does not* update istat if the photon scatters outside of the wind-
-         I guess P_INWIND is really in wind or empty space but not escaped.
-         translate_in_space will take care of this next time round. All a bit
-         convoluted but should work. */
+    /* JM 1506 -- call walls again to account for instance where DFUDGE 
+       can take photon outside of the wind and into the disk or star 
+       after scattering. Note that walls updates the istat in pp as well.
+       This may not be necessary but I think to account for every eventuality 
+       it should be done */
+    istat = walls (pp, p);
 
-      /* JM 1506 -- we don't throw errors here now, but we do keep a track 
-         of how many 4 photons were lost due to DFUDGE pushing them 
-         outside of the wind after scatter */
+    /* This *does not* update istat if the photon scatters outside of the wind-
+       I guess P_INWIND is really in wind or empty space but not escaped.
+       translate_in_space will take care of this next time round. All a bit
+       convoluted but should work. */
 
-      // XXX PLACEHOLDER Check that this is the correct logic here 
-      if (where_in_wind (pp.x, &ndom) != W_ALL_INWIND && where_in_wind (x_dfudge_check, &ndom) == W_ALL_INWIND)
-      {
-        n_lost_to_dfudge++;     // increment the counter (checked at end of trans_phot)
-      }
+    /* JM 1506 -- we don't throw errors here now, but we do keep a track 
+       of how many 4 photons were lost due to DFUDGE pushing them 
+       outside of the wind after scatter */
 
-      stuff_phot (&pp, p);
-      icell = 0;
+    // XXX PLACEHOLDER Check that this is the correct logic here 
+    if (where_in_wind (pp->x, &ndom) != W_ALL_INWIND && where_in_wind (x_dfudge_check, &ndom) == W_ALL_INWIND)
+    {
+      n_lost_to_dfudge++;     // increment the counter (checked at end of trans_phot)
     }
 
+    stuff_phot (pp, p);
+  }
 
 
-    /* This completes the portion of the code that handles the scattering of a photon What follows is a simple check to see if
-       this particular photon has gotten stuck in the wind 54b-ksl */
-
-    if (pp.nscat == MAXSCAT)
-    {
-      istat = pp.istat = P_TOO_MANY_SCATTERS;   /* Scattered too many times */
-      stuff_phot (&pp, p);
-      break;
-    }
 
-    if (pp.istat == P_ADIABATIC)
-    {
-      istat = pp.istat = p->istat = P_ADIABATIC;
-      stuff_phot (&pp, p);
-      break;
-    }
+  /* This completes the portion of the code that handles the scattering of a photon What follows is a simple check to see if
+     this particular photon has gotten stuck in the wind 54b-ksl */
 
-    /* This appears partly to be an insurance policy. It is not obvious that for example nscat and nrscat need to be updated */
-    p->istat = istat;
-    p->nscat = pp.nscat;
-    p->nrscat = pp.nrscat;
-    p->w = pp.w;                // Assure that final weight of photon is returned.
+  if (pp->nscat == MAXSCAT)
+  {
+    istat = pp->istat = P_TOO_MANY_SCATTERS;   /* Scattered too many times */
+    stuff_phot (pp, p);
+    f->istat = istat;
+    return (istat);
+  }
 
+  if (pp->istat == P_ADIABATIC)
+  {
+    istat = pp->istat = p->istat = P_ADIABATIC;
+    stuff_phot (pp, p);
+    f->istat = istat;
+    return (istat);
   }
-  /* This is the end of the loop over individual photons */
-  return (0);
+
+  /* This appears partly to be an insurance policy. It is not obvious that for example nscat and nrscat need to be updated */
+  p->istat = istat;
+  p->nscat = pp->nscat;
+  p->nrscat = pp->nrscat;
+  p->w = pp->w;                // Assure that final weight of photon is returned.
+
+  f->istat = istat;
+  return (istat);
 }
@@ -77,6 +77,7 @@ History:
 	15jul	nsh 	added a mode for fixed temperature, which does not multiply wind temp by 0.9 
 			so you get what you ask for
 	15aug	jm	Adapted for multiple domains
+	1703		Allocate the grid arrays of each domain to its actual size
 
 
 **************************************************************/
@@ -120,6 +121,7 @@ define_wind ()
     /* NDIM2 here is the total dimensions of the grid, summed over all domains
        and is used to allocate the wind pointer */
     geo.ndim2 = NDIM2 += zdom[ndom].ndim * zdom[ndom].mdim;
+    calloc_domain (ndom);
   }
 
 
@@ -530,6 +532,196 @@ be optional which variables beyond here are moved to structures othere than Wind
 }
 
 
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	grid_refine_axis moves the interior grid lines along one axis of
+	a cylindrical or rtheta grid so that they are concentrated where
+	the density and velocity of the model change rapidly
+
+Arguments:		
+	int ndom;		the domain
+	int iaxis;		0 for the x (rho or r) axis, 1 for the z (z or theta) axis
+	double xx[];		the grid lines along the axis, which are modified
+	int ilo, ihi;		xx[ilo] and xx[ihi] are kept fixed, and the lines between are moved
+	int ilog;		1 if the grid lines were spaced logarithmically, 0 if linearly
+	double yy[];		the grid lines along the other axis
+	int jlo, jhi;		the range of yy over which the model is sampled
+ 
+Returns:
+	0 if the grid lines were moved, -1 if the model has no gradients along the axis
+ 
+Description:
+	The axis between xx[ilo] and xx[ihi] is divided into NREFINE intervals, 
+	uniform in log or linear spacing as the original grid.  In each interval
+	the change in ln rho plus the change in speed divided by the largest 
+	speed is averaged over NREFINE_PERP positions across the other axis. 
+	This gives a gradient G per unit length (in log or linear units) along 
+	the axis, from which the monitor function 
+
+		m = 1 + zdom[ndom].refine * min (G/<G>, REFINE_GMAX)
+
+	is formed.  The grid lines are then placed so that the integral of 
+	m between any two adjacent lines is the same.  When refine is 0, or
+	the model has no gradients, this gives back the original spacing.
+
+	Densities are limited below by REFINE_RHO_FLOOR times the largest 
+	density, so that the edges of the wind, where the density drops to
+	zero, are refined along with its interior.
+
+Notes:
+	Only the positions of the grid lines change, so the grid remains
+	a (non-uniform) tensor product grid and where_in_grid, ds_in_cell, 
+	coord_fraction, the volume calculations and windsave need no changes.
+
+	For rtheta grids, yy and xx are in degrees on the theta axis.
+
+History:
+	1703	Coded
+
+**************************************************************/
+
+int
+grid_refine_axis (ndom, iaxis, xx, ilo, ihi, ilog, yy, jlo, jhi)
+     int ndom, iaxis;
+     double xx[];
+     int ilo, ihi, ilog;
+     double yy[];
+     int jlo, jhi;
+{
+  double *lrho, *speed, *g, *cum;
+  double u0, u1, du, a, b, x[3], v[3];
+  double rhomax, vmax, gmean, target, theta;
+  int i, k, l, jj, nperp;
+
+  if (ihi - ilo < 2 || jhi <= jlo)
+    return (-1);
+
+  u0 = ilog ? log (xx[ilo]) : xx[ilo];
+  u1 = ilog ? log (xx[ihi]) : xx[ihi];
+  du = (u1 - u0) / NREFINE;
+
+  nperp = NREFINE_PERP;
+  lrho = calloc (sizeof (double), (NREFINE + 1) * nperp);
+  speed = calloc (sizeof (double), (NREFINE + 1) * nperp);
+  g = calloc (sizeof (double), NREFINE);
+  cum = calloc (sizeof (double), NREFINE + 1);
+
+  /* Sample the model on the fine grid */
+
+  rhomax = vmax = 0;
+  for (k = 0; k <= NREFINE; k++)
+  {
+    a = ilog ? exp (u0 + k * du) : u0 + k * du;
+    for (l = 0; l < nperp; l++)
+    {
+      jj = jlo + (l * (jhi - jlo)) / nperp;
+      b = 0.5 * (yy[jj] + yy[jj + 1]);
+
+      /* a is the coordinate along the axis being refined and b across it */
+
+      if (zdom[ndom].coord_type == RTHETA)
+      {
+        theta = (iaxis == 0 ? b : a);
+        if (theta > 90.)
+          theta = 90.;
+        theta /= RADIAN;
+        x[0] = (iaxis == 0 ? a : b) * sin (theta);
+        x[2] = (iaxis == 0 ? a : b) * cos (theta);
+      }
+      else
+      {
+        x[0] = (iaxis == 0 ? a : b);
+        x[2] = (iaxis == 0 ? b : a);
+      }
+      x[1] = 0;
+
+      lrho[k * nperp + l] = model_rho (ndom, x);
+      speed[k * nperp + l] = model_velocity (ndom, x, v);
+
+      if (lrho[k * nperp + l] > rhomax)
+        rhomax = lrho[k * nperp + l];
+      if (speed[k * nperp + l] > vmax)
+        vmax = speed[k * nperp + l];
+    }
+  }
+
+  if (rhomax <= 0)
+  {
+    free (lrho);
+    free (speed);
+    free (g);
+    free (cum);
+    return (-1);
+  }
+
+  for (k = 0; k < (NREFINE + 1) * nperp; k++)
+  {
+    if (lrho[k] < REFINE_RHO_FLOOR * rhomax)
+      lrho[k] = REFINE_RHO_FLOOR * rhomax;
+    lrho[k] = log (lrho[k]);
+  }
+
+  /* Find the gradient in each interval and its mean */
+
+  gmean = 0;
+  for (k = 0; k < NREFINE; k++)
+  {
+    g[k] = 0;
+    for (l = 0; l < nperp; l++)
+    {
+      g[k] += fabs (lrho[(k + 1) * nperp + l] - lrho[k * nperp + l]);
+      if (vmax > 0)
+        g[k] += fabs (speed[(k + 1) * nperp + l] - speed[k * nperp + l]) / vmax;
+    }
+    gmean += g[k];
+  }
+  gmean /= NREFINE;
+
+  if (gmean == 0)
+  {
+    free (lrho);
+    free (speed);
+    free (g);
+    free (cum);
+    return (-1);
+  }
+
+  /* Integrate the monitor function and place the grid lines at equal intervals of it */
+
+  cum[0] = 0;
+  for (k = 0; k < NREFINE; k++)
+  {
+    g[k] /= gmean;
+    if (g[k] > REFINE_GMAX)
+      g[k] = REFINE_GMAX;
+    g[k] = 1. + zdom[ndom].refine * g[k];
+    cum[k + 1] = cum[k] + g[k];
+  }
+
+  k = 0;
+  for (i = ilo + 1; i < ihi; i++)
+  {
+    target = cum[NREFINE] * (i - ilo) / (ihi - ilo);
+    while (k < NREFINE - 1 && cum[k + 1] < target)
+      k++;
+    a = u0 + (k + (target - cum[k]) / g[k]) * du;
+    xx[i] = ilog ? exp (a) : a;
+  }
+
+  Log ("grid_refine_axis: Domain %d axis %d refined between %.3e and %.3e\n", ndom, iaxis, xx[ilo], xx[ihi]);
+
+  free (lrho);
+  free (speed);
+  free (g);
+  free (cum);
+
+  return (0);
+}
+
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -617,6 +809,135 @@ where_in_grid (ndom, x)
   return (wig_n);
 }
 
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+ 	where_in_grid_from locates the 1-d grid position of a photon,
+	starting from the cell it was last known to be in
+
+ Arguments:		
+ 	ndom		The domain number for the search
+	double x[];     The position
+	int nhint;	The cell in wmain the photon was last in
+ Returns:
+ 	The same as where_in_grid
+ Description:	
+	A photon travelling through the wind moves from a cell to
+	one of its neighbours, so rather than searching the whole
+	grid, the routine steps the indices i and j of nhint one cell
+	at a time toward the position, separately in each coordinate,
+	until the cell bounds contain it.  The test on the cell bounds 
+	is the same as in fraction, so the cell is the one that 
+	where_in_grid would find.
+		
+ Notes:
+	If the position is not found within WIG_MAXSTEP steps in
+	each direction, or nhint is not in domain ndom, or the
+	position is at or beyond the edge of the grid, then 
+	where_in_grid is called, so where_in_grid determines all 
+	of the return values for positions outside the grid.
+
+	Cylvar grids always use where_in_grid.
+
+ History:
+	1703	Coded
+ 
+**************************************************************/
+
+int
+where_in_grid_from (ndom, x, nhint)
+     int ndom;
+     double x[];
+     int nhint;
+{
+  int i, j, n, nstep;
+  int ndim, mdim;
+  double r, z;
+  double *xx, *zz;
+
+  if (wig_x == x[0] && wig_y == x[1] && wig_z == x[2])
+    return (wig_n);
+
+  if (nhint < zdom[ndom].nstart || nhint >= zdom[ndom].nstop)
+    return (where_in_grid (ndom, x));
+
+  ndim = zdom[ndom].ndim;
+  mdim = zdom[ndom].mdim;
+  xx = zdom[ndom].wind_x;
+  zz = zdom[ndom].wind_z;
+
+  if (zdom[ndom].coord_type == CYLIND)
+  {
+    r = sqrt (x[0] * x[0] + x[1] * x[1]);
+    z = fabs (x[2]);
+    if (z == 0)
+      z = 1.e4;                 // As in cylind_where_in_grid
+    wind_n_to_ij (ndom, nhint, &i, &j);
+  }
+  else if (zdom[ndom].coord_type == RTHETA)
+  {
+    r = length (x);
+    z = acos ((fabs (x[2] / r))) * RADIAN;
+    wind_n_to_ij (ndom, nhint, &i, &j);
+  }
+  else if (zdom[ndom].coord_type == SPHERICAL)
+  {
+    r = length (x);
+    z = 0;
+    i = nhint - zdom[ndom].nstart;
+    j = 0;
+  }
+  else
+    return (where_in_grid (ndom, x));
+
+  nstep = 0;
+  while (i >= 0 && i < ndim - 1 && nstep < WIG_MAXSTEP)
+  {
+    if (r <= xx[i])
+      i--;
+    else if (r > xx[i + 1])
+      i++;
+    else
+      break;
+    nstep++;
+  }
+
+  if (i < 0 || i >= ndim - 1 || r <= xx[i] || r > xx[i + 1])
+    return (where_in_grid (ndom, x));
+
+  if (zdom[ndom].coord_type == SPHERICAL)
+    n = zdom[ndom].nstart + i;
+  else
+  {
+    nstep = 0;
+    while (j >= 0 && j < mdim - 1 && nstep < WIG_MAXSTEP)
+    {
+      if (z <= zz[j])
+        j--;
+      else if (z > zz[j + 1])
+        j++;
+      else
+        break;
+      nstep++;
+    }
+
+    if (j < 0 || j >= mdim - 1 || z <= zz[j] || z > zz[j + 1])
+      return (where_in_grid (ndom, x));
+
+    n = zdom[ndom].nstart + i * mdim + j;
+  }
+
+  wig_x = x[0];
+  wig_y = x[1];
+  wig_z = x[2];
+  wig_n = n;
+
+  return (n);
+}
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -675,6 +996,8 @@ History:
 	06may	ksl	57+ -- Changed call to elimatnate passing the
 			Wind array.  Use wmain instead.
 	15aug	ksl	Added a variable for the domain
+	1703	Use the coefficients from wind_interp_init when the photon
+		is still in the cell given by p->grid
  
 **************************************************************/
 int ierr_vwind = 0;
@@ -691,6 +1014,7 @@ vwind_xyz (ndom, p, v)
   double ctheta, stheta;
   double x, frac[4];
   int nn, nnn[4], nelem;
+  int ifast;
 
 
 
@@ -699,16 +1023,26 @@ vwind_xyz (ndom, p, v)
     Error ("vwind_xyz: Received invalid domain  %d\n", ndom);
   }
 
-  coord_fraction (ndom, 0, p->x, nnn, frac, &nelem);
+  /* If the photon is still within the cell it is tagged with, use the coefficients for that cell,
+     otherwise locate the position in the grid */
 
-  for (i = 0; i < 3; i++)
+  ifast = 0;
+  if (wind_interp != NULL && p->grid >= 0 && p->grid < NDIM2 && wmain[p->grid].ndom == ndom)
+    ifast = (wind_interp_v (p->grid, p->x, vv) == 0);
+
+  if (ifast == 0)
   {
+    coord_fraction (ndom, 0, p->x, nnn, frac, &nelem);
 
-    x = 0;
-    for (nn = 0; nn < nelem; nn++)
-      x += wmain[nnn[nn]].v[i] * frac[nn];
+    for (i = 0; i < 3; i++)
+    {
+
+      x = 0;
+      for (nn = 0; nn < nelem; nn++)
+        x += wmain[nnn[nn]].v[i] * frac[nn];
 
-    vv[i] = x;
+      vv[i] = x;
+    }
   }
 
   rho = sqrt (p->x[0] * p->x[0] + p->x[1] * p->x[1]);
@@ -740,7 +1074,7 @@ vwind_xyz (ndom, p, v)
   v[1] = vv[0] * stheta + vv[1] * ctheta;
   v[2] = vv[2];
 
-  if (sane_check (v[0]) || sane_check (v[1]) || sane_check (v[2]))
+  if (ifast == 0 && (sane_check (v[0]) || sane_check (v[1]) || sane_check (v[2])))
   {
     Error ("vwind_xyz: %f %f %f\n", v[0], v[1], v[2]);
   }
@@ -750,6 +1084,274 @@ vwind_xyz (ndom, p, v)
 }
 
 
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	wind_interp_init calculates, for every cell in the wind, the coefficients 
+	which allow the velocity and the velocity gradient tensor to be evaluated
+	at a position within the cell without locating the position in the grid.
+ 
+ Arguments:		
+
+Returns:
+	The number of cells for which coefficients could be calculated
+ 
+Description:
+	vwind_xyz and dvwind_ds carry out a bilinear interpolation on the
+	vertices of the cell which contains a position.  Within any one cell, 
+	this is a polynomial a + b dr + c dz + d dr dz in the coordinates used
+	by coord_fraction, so the coefficients are calculated once here from
+	wmain[].v and wmain[].v_grad.  
+
+	Coefficients are not calculated for cylvar coordinates, whose 
+	fractional positions are not bilinear in any simple coordinates,
+	or for the outermost cells, which have no vertices beyond them. 
+	For these cells vwind_xyz and dvwind_ds use coord_fraction as before.
+	
+Notes:
+	This must be called whenever the velocities in wmain change, which at 
+	present means after the wind is defined or read in.  The vertices
+	are indexed as in coord_fraction.
+
+History:
+	1703	Coded
+ 
+**************************************************************/
+
+int
+wind_interp_init ()
+{
+  int n, ndom, i, j, k, kk, m, mdim, ngood;
+  int ii[4];
+  double dr, dz;
+  WindInterpPtr q;
+
+  if (wind_interp == NULL)
+    wind_interp = (WindInterpPtr) calloc (sizeof (wind_interp_dummy), NDIM2);
+
+  if (wind_interp == NULL)
+  {
+    Error ("wind_interp_init: Could not allocate memory for %d cells\n", NDIM2);
+    return (0);
+  }
+
+  ngood = 0;
+  for (n = 0; n < NDIM2; n++)
+  {
+    q = &wind_interp[n];
+    q->ok = 0;
+    ndom = wmain[n].ndom;
+    mdim = zdom[ndom].mdim;
+
+    if (zdom[ndom].coord_type == SPHERICAL)
+    {
+      i = n - zdom[ndom].nstart;
+      if (i >= zdom[ndom].ndim - 1)
+        continue;
+      ii[0] = ii[2] = i;
+      ii[1] = ii[3] = i + 1;
+      q->z0 = q->z1 = 0;
+      dz = 1;
+    }
+    else if (zdom[ndom].coord_type == CYLIND || zdom[ndom].coord_type == RTHETA)
+    {
+      wind_n_to_ij (ndom, n, &i, &j);
+      if (i >= zdom[ndom].ndim - 1 || j >= mdim - 1)
+        continue;
+      ii[0] = i * mdim + j;
+      ii[1] = (i + 1) * mdim + j;
+      ii[2] = i * mdim + j + 1;
+      ii[3] = (i + 1) * mdim + j + 1;
+      q->z0 = zdom[ndom].wind_z[j];
+      q->z1 = zdom[ndom].wind_z[j + 1];
+      dz = q->z1 - q->z0;
+    }
+    else
+      continue;
+
+    q->r0 = zdom[ndom].wind_x[i];
+    q->r1 = zdom[ndom].wind_x[i + 1];
+    dr = q->r1 - q->r0;
+
+    if (dr <= 0 || dz <= 0)
+      continue;
+
+    for (k = 0; k < 3; k++)
+    {
+      q->v[0][k] = wmain[ii[0]].v[k];
+      q->v[1][k] = (wmain[ii[1]].v[k] - wmain[ii[0]].v[k]) / dr;
+      q->v[2][k] = (wmain[ii[2]].v[k] - wmain[ii[0]].v[k]) / dz;
+      q->v[3][k] = (wmain[ii[3]].v[k] - wmain[ii[1]].v[k] - wmain[ii[2]].v[k] + wmain[ii[0]].v[k]) / (dr * dz);
+
+      for (kk = 0; kk < 3; kk++)
+      {
+        q->v_grad[0][k][kk] = wmain[ii[0]].v_grad[k][kk];
+        q->v_grad[1][k][kk] = (wmain[ii[1]].v_grad[k][kk] - wmain[ii[0]].v_grad[k][kk]) / dr;
+        q->v_grad[2][k][kk] = (wmain[ii[2]].v_grad[k][kk] - wmain[ii[0]].v_grad[k][kk]) / dz;
+        q->v_grad[3][k][kk] =
+          (wmain[ii[3]].v_grad[k][kk] - wmain[ii[1]].v_grad[k][kk] - wmain[ii[2]].v_grad[k][kk] +
+           wmain[ii[0]].v_grad[k][kk]) / (dr * dz);
+      }
+    }
+
+    /* Only use cells whose coefficients are all well behaved */
+
+    q->ok = 1;
+    for (m = 0; m < 4; m++)
+      for (k = 0; k < 3; k++)
+      {
+        if (sane_check (q->v[m][k]))
+          q->ok = 0;
+        for (kk = 0; kk < 3; kk++)
+          if (sane_check (q->v_grad[m][k][kk]))
+            q->ok = 0;
+      }
+
+    ngood += q->ok;
+  }
+
+  Log ("wind_interp_init: Interpolation coefficients for %d of %d cells\n", ngood, NDIM2);
+
+  return (ngood);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	wind_interp_where finds the offsets dr and dz of a position from
+	the inner vertex of cell n, in the coordinates used by wind_interp
+
+ Arguments:		
+	int n;			the cell
+	double x[];		the position
+
+Returns:
+	0 if the position is within (or on the boundary of) cell n and the cell 
+	has interpolation coefficients, -1 otherwise
+ 
+History:
+	1703	Coded
+ 
+**************************************************************/
+
+int
+wind_interp_where (n, x, dr, dz)
+     int n;
+     double x[];
+     double *dr, *dz;
+{
+  WindInterpPtr q;
+  double r, z;
+  int ctype;
+
+  q = &wind_interp[n];
+  if (q->ok == 0)
+    return (-1);
+
+  ctype = zdom[wmain[n].ndom].coord_type;
+
+  if (ctype == CYLIND)
+  {
+    r = sqrt (x[0] * x[0] + x[1] * x[1]);
+    z = fabs (x[2]);
+  }
+  else
+  {
+    r = sqrt (x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+    if (ctype == RTHETA)
+    {
+      if (r == 0)
+        return (-1);
+      z = acos (fabs (x[2]) / r) * RADIAN;
+    }
+    else
+      z = 0;
+  }
+
+  if (r < q->r0 || r > q->r1 || z < q->z0 || z > q->z1)
+    return (-1);
+
+  *dr = r - q->r0;
+  *dz = z - q->z0;
+
+  return (0);
+}
+
+
+
+/***********************************************************
+                                       Space Telescope Science Institute
+
+ Synopsis:
+	wind_interp_v and wind_interp_g evaluate the velocity and the
+	velocity gradient tensor at a position within cell n, using
+	the coefficients from wind_interp_init
+
+ Arguments:		
+	int n;			the cell
+	double x[];		the position
+
+Returns:
+	v[] or v_grad[][3], in the xz plane as they are stored in wmain
+
+	0 on success, -1 if the position is not in cell n, in which case
+	the caller must fall back to coord_fraction
+ 
+History:
+	1703	Coded
+ 
+**************************************************************/
+
+int
+wind_interp_v (n, x, v)
+     int n;
+     double x[];
+     double v[];
+{
+  double dr, dz, drz;
+  double (*c)[3];
+  int k;
+
+  if (wind_interp_where (n, x, &dr, &dz))
+    return (-1);
+
+  drz = dr * dz;
+  c = wind_interp[n].v;
+  for (k = 0; k < 3; k++)
+    v[k] = c[0][k] + c[1][k] * dr + c[2][k] * dz + c[3][k] * drz;
+
+  return (0);
+}
+
+
+int
+wind_interp_g (n, x, v_grad)
+     int n;
+     double x[];
+     double v_grad[][3];
+{
+  double dr, dz, drz;
+  double (*c)[3][3];
+  int j, k;
+
+  if (wind_interp_where (n, x, &dr, &dz))
+    return (-1);
+
+  drz = dr * dz;
+  c = wind_interp[n].v_grad;
+  for (j = 0; j < 3; j++)
+    for (k = 0; k < 3; k++)
+      v_grad[j][k] = c[0][j][k] + c[1][j][k] * dr + c[2][j][k] * dz + c[3][j][k] * drz;
+
+  return (0);
+}
+
+
 /***********************************************************
                                        Space Telescope Science Institute
 
@@ -151,7 +151,7 @@ xtemp_rad (w)
         nplasma = w[n].nplasma;
         if (plasmamain[nplasma].vol > 0.0)
         {
-          ntot = plasmamain[nplasma].ntot;
+          ntot = plasmamain[nplasma].est->ntot;
         }
         else
           ntot = 0;
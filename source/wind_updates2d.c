@@ -86,6 +86,7 @@ History:
 	14sept	nsh	78b: Changes to deal with the inclusion of direct recombination
 	14nov 	JM 78b: Changed volume to be the filled volume
 	15aug	ksl	Updated for domains
+	1703		Broadcast the radiation field estimators of each cell as one block
 
 
 **************************************************************/
@@ -134,9 +135,11 @@ WindPtr (w);
 
   /* the commbuffer needs to be larger enough to pack all variables in MPI_Pack and MPI_Unpack routines NSH 1407 - the 
      NIONS changed to nions for the 12 arrays in plasma that are now dynamically allocated 
-  NSH 1703 changed NLTE_LEVELS to nlte_levels  and NTOP_PHOT to nphot_tot since they are dynamically allocated now */
+  NSH 1703 changed NLTE_LEVELS to nlte_levels  and NTOP_PHOT to nphot_tot since they are dynamically allocated now 
+  1703 the radiation field estimators are packed as a single block */
   size_of_commbuffer =
-    8 * (12 * nions + nlte_levels + 2 * nphot_total + 12 * NXBANDS + 2 * LPDF + NAUGER + 107) * (floor (NPLASMA / np_mpi_global) + 1);
+    (8 * (12 * nions + nlte_levels + 2 * nphot_total + 12 * NXBANDS + NAUGER + 107) +
+     sizeof (plasma_est_dummy)) * (floor (NPLASMA / np_mpi_global) + 1);
   commbuffer = (char *) malloc (size_of_commbuffer * sizeof (char));
 
   /* JM 1409 -- Initialise parallel only variables */
@@ -212,47 +215,47 @@ WindPtr (w);
     t_e_old = plasmamain[n].t_e;
     iave++;
 
-    if (plasmamain[n].ntot < 100)
+    if (plasmamain[n].est->ntot < 100)
     {
       Log
         ("!!wind_update: Cell %4d Dom %d  Vol. %8.2e r %8.2e theta %8.2e has only %4d photons\n",
-         n, w[nwind].ndom, volume, w[nwind].rcen, w[nwind].thetacen, plasmamain[n].ntot);
+         n, w[nwind].ndom, volume, w[nwind].rcen, w[nwind].thetacen, plasmamain[n].est->ntot);
     }
 
-    if (plasmamain[n].ntot > 0)
+    if (plasmamain[n].est->ntot > 0)
     {
-      wtest = plasmamain[n].ave_freq;
-      plasmamain[n].ave_freq /= plasmamain[n].j;        /* Normalization to frequency moment */
-      if (sane_check (plasmamain[n].ave_freq))
+      wtest = plasmamain[n].est->ave_freq;
+      plasmamain[n].est->ave_freq /= plasmamain[n].est->j;        /* Normalization to frequency moment */
+      if (sane_check (plasmamain[n].est->ave_freq))
       {
-        Error ("wind_update:sane_check %d ave_freq %e j %e ntot %d\n", n, wtest, plasmamain[n].j, plasmamain[n].ntot);
+        Error ("wind_update:sane_check %d ave_freq %e j %e ntot %d\n", n, wtest, plasmamain[n].est->j, plasmamain[n].est->ntot);
       }
 
-      plasmamain[n].j /= (4. * PI * volume);    //Factor of 2 has been removed from this line (SS, May04)
-      plasmamain[n].j_direct /= (4. * PI * volume);
-      plasmamain[n].j_scatt /= (4. * PI * volume);
+      plasmamain[n].est->j /= (4. * PI * volume);    //Factor of 2 has been removed from this line (SS, May04)
+      plasmamain[n].est->j_direct /= (4. * PI * volume);
+      plasmamain[n].est->j_scatt /= (4. * PI * volume);
 
 
 
-      trad = plasmamain[n].t_r = H * plasmamain[n].ave_freq / (BOLTZMANN * 3.832);
-      plasmamain[n].w = PI * plasmamain[n].j / (STEFAN_BOLTZMANN * trad * trad * trad * trad);
+      trad = plasmamain[n].t_r = H * plasmamain[n].est->ave_freq / (BOLTZMANN * 3.832);
+      plasmamain[n].w = PI * plasmamain[n].est->j / (STEFAN_BOLTZMANN * trad * trad * trad * trad);
 
 
       if (plasmamain[n].w > 1e10)
       {
-        Error ("wind_update: Huge w %8.2e in cell %d trad %10.2e j %8.2e\n", plasmamain[n].w, n, trad, plasmamain[n].j);
+        Error ("wind_update: Huge w %8.2e in cell %d trad %10.2e j %8.2e\n", plasmamain[n].w, n, trad, plasmamain[n].est->j);
       }
       if (sane_check (trad) || sane_check (plasmamain[n].w))
       {
         Error ("wind_update:sane_check %d trad %8.2e w %8.2g\n", n, trad, plasmamain[n].w);
-        Error ("wind_update: ave_freq %8.2e j %8.2e\n", plasmamain[n].ave_freq, plasmamain[n].j);
+        Error ("wind_update: ave_freq %8.2e j %8.2e\n", plasmamain[n].est->ave_freq, plasmamain[n].est->j);
         exit (0);
       }
     }
     else
     {                           // It is not clear what to do with no photons in a cell
 
-      plasmamain[n].j = plasmamain[n].j_direct = plasmamain[n].j_scatt = 0;
+      plasmamain[n].est->j = plasmamain[n].est->j_direct = plasmamain[n].est->j_scatt = 0;
       trad = plasmamain[n].t_r;
       plasmamain[n].t_e *= 0.7;
       if (plasmamain[n].t_e < TMIN)
@@ -266,20 +269,20 @@ WindPtr (w);
     /* 71 - 111279 - ksl - Small modification to reflect the fact that nxfreq has been moved into the geo structure */
     for (i = 0; i < geo.nxfreq; i++)
     {                           /*loop over number of bands */
-      if (plasmamain[n].nxtot[i] > 0)
+      if (plasmamain[n].est->nxtot[i] > 0)
       {                         /*Check we actually have some photons in the cell in this band */
 
-        plasmamain[n].xave_freq[i] /= plasmamain[n].xj[i];      /*Normalise the average frequency */
-        plasmamain[n].xsd_freq[i] /= plasmamain[n].xj[i];       /*Normalise the mean square frequency */
-        plasmamain[n].xsd_freq[i] = sqrt (plasmamain[n].xsd_freq[i] - (plasmamain[n].xave_freq[i] * plasmamain[n].xave_freq[i]));       /*Compute standard deviation */
-        plasmamain[n].xj[i] /= (4 * PI * volume);       /*Convert to radiation density */
+        plasmamain[n].est->xave_freq[i] /= plasmamain[n].est->xj[i];      /*Normalise the average frequency */
+        plasmamain[n].est->xsd_freq[i] /= plasmamain[n].est->xj[i];       /*Normalise the mean square frequency */
+        plasmamain[n].est->xsd_freq[i] = sqrt (plasmamain[n].est->xsd_freq[i] - (plasmamain[n].est->xave_freq[i] * plasmamain[n].est->xave_freq[i]));       /*Compute standard deviation */
+        plasmamain[n].est->xj[i] /= (4 * PI * volume);       /*Convert to radiation density */
 
       }
       else
       {
-        plasmamain[n].xj[i] = 0;        /*If no photons, set both radiation estimators to zero */
-        plasmamain[n].xave_freq[i] = 0;
-        plasmamain[n].xsd_freq[i] = 0;  /*NSH 120815 and also the SD ???? */
+        plasmamain[n].est->xj[i] = 0;        /*If no photons, set both radiation estimators to zero */
+        plasmamain[n].est->xave_freq[i] = 0;
+        plasmamain[n].est->xsd_freq[i] = 0;  /*NSH 120815 and also the SD ???? */
       }
     }
 
@@ -291,14 +294,14 @@ WindPtr (w);
 
 /* 1110 NSH Normalise IP, which at this point should be the number of photons in a cell by dividing by volume and number density of hydrogen in the cell */
 
-    plasmamain[n].ip /= (C * volume * nh);
-    plasmamain[n].ip_direct /= (C * volume * nh);
-    plasmamain[n].ip_scatt /= (C * volume * nh);
+    plasmamain[n].est->ip /= (C * volume * nh);
+    plasmamain[n].est->ip_direct /= (C * volume * nh);
+    plasmamain[n].est->ip_scatt /= (C * volume * nh);
 
 /* 1510 NSH Normalise xi, which at this point should be the luminosity of ionizing photons in a cell (just the sum of photon weights) */
 
-    plasmamain[n].xi *= 4. * PI;
-    plasmamain[n].xi /= (volume * nh);
+    plasmamain[n].est->xi *= 4. * PI;
+    plasmamain[n].est->xi /= (volume * nh);
 
     /* If geo.adiabatic is true, then alculate the adiabatic cooling using the current, i.e 
      * previous value of t_e.  Note that this may not be  best way to determien the cooling. 
@@ -391,32 +394,15 @@ WindPtr (w);
         MPI_Pack (&plasmamain[n].heat_auger, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].heat_z, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].w, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot_star, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot_bl, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot_disk, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot_wind, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ntot_agn, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].mean_ds, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].n_ds, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (plasmamain[n].est, sizeof (plasma_est_dummy), MPI_BYTE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].nrad, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].nioniz, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].ioniz, nions, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].recomb, nions, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].scatters, nions, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].xscatters, nions, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].heat_ion, nions, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].lum_ion, nions, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].j, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].j_direct, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].j_scatt, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ave_freq, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].lum, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].xj, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].xave_freq, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].xsd_freq, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].nxtot, NXBANDS, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].max_freq, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].lum_lines, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].lum_ff, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].lum_adiabatic, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
@@ -439,9 +425,6 @@ WindPtr (w);
         MPI_Pack (&plasmamain[n].lum_z_ioniz, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].lum_rad_ioniz, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].dmo_dt, 3, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].npdf, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].pdf_x, LPDF, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (plasmamain[n].pdf_y, LPDF, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].gain, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].converge_t_r, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].converge_t_e, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
@@ -461,10 +444,6 @@ WindPtr (w);
         MPI_Pack (plasmamain[n].fmax_mod, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].sim_ip, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].ferland_ip, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ip, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ip_direct, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].ip_scatt, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
-        MPI_Pack (&plasmamain[n].xi, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&dt_e, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&dt_r, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&nmax_e, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
@@ -524,32 +503,15 @@ WindPtr (w);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].heat_auger, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].heat_z, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].w, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot_star, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot_bl, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot_disk, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot_wind, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ntot_agn, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].mean_ds, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].n_ds, 1, MPI_INT, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].est, sizeof (plasma_est_dummy), MPI_BYTE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].nrad, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].nioniz, 1, MPI_INT, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].ioniz, nions, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].recomb, nions, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].scatters, nions, MPI_INT, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].xscatters, nions, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].heat_ion, nions, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].lum_ion, nions, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].j, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].j_direct, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].j_scatt, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ave_freq, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].xj, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].xave_freq, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].xsd_freq, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].nxtot, NXBANDS, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].max_freq, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum_lines, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum_ff, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum_adiabatic, 1, MPI_DOUBLE, MPI_COMM_WORLD);
@@ -572,9 +534,6 @@ WindPtr (w);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum_z_ioniz, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].lum_rad_ioniz, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].dmo_dt, 3, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].npdf, 1, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].pdf_x, LPDF, MPI_INT, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].pdf_y, LPDF, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].gain, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].converge_t_r, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].converge_t_e, 1, MPI_DOUBLE, MPI_COMM_WORLD);
@@ -594,10 +553,6 @@ WindPtr (w);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].fmax_mod, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].sim_ip, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ferland_ip, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ip, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ip_direct, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ip_scatt, 1, MPI_DOUBLE, MPI_COMM_WORLD);
-        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].xi, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &dt_e_temp, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &dt_r_temp, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &nmax_e_temp, 1, MPI_INT, MPI_COMM_WORLD);
@@ -767,7 +722,7 @@ WindPtr (w);
       i = i - 1;                //There is a radial 'ghost zone' in python, we need to make our i,j agree with zeus
       vol = w[plasmamain[nplasma].nwind].vol;
       fprintf (fptr, "%d %d %e %e %e ", i, j, w[plasmamain[nplasma].nwind].rcen, w[plasmamain[nplasma].nwind].thetacen / RADIAN, vol);  //output geometric things
-      fprintf (fptr, "%e %e %e ", plasmamain[nplasma].t_e, plasmamain[nplasma].xi, plasmamain[nplasma].ne);     //output temp, xi and ne to ease plotting of heating rates
+      fprintf (fptr, "%e %e %e ", plasmamain[nplasma].t_e, plasmamain[nplasma].est->xi, plasmamain[nplasma].ne);     //output temp, xi and ne to ease plotting of heating rates
       fprintf (fptr, "%e ", (plasmamain[nplasma].heat_photo + plasmamain[nplasma].heat_auger) / vol);   //Xray heating - or photoionization
       fprintf (fptr, "%e ", (plasmamain[nplasma].heat_comp) / vol);     //Compton heating
       fprintf (fptr, "%e ", (plasmamain[nplasma].heat_lines) / vol);    //Line heating 28/10/15 - not currently used in zeus
@@ -846,6 +801,9 @@ WindPtr (w);
 
   check_convergence ();
 
+  /* The ionization state has changed, so the cdfs for fb photons must be regenerated */
+  fb_store_invalidate ();
+
   /* Summarize the radiative temperatures (ksl 04 mar) */
 
   xtemp_rad (w);
@@ -887,8 +845,8 @@ WindPtr (w);
         ("OUTPUT Lum_agn= %e T_e= %e N_h= %e N_e= %e alpha= %f IP(sim_2010)= %e Measured_IP(cloudy)= %e Measured_Xi= %e distance= %e volume= %e mean_ds=%e\n",
          geo.lum_agn, plasmamain[nstart].t_e,
          plasmamain[nstart].rho * rho2nh, plasmamain[nstart].ne,
-         geo.alpha_agn, agn_ip, plasmamain[nstart].ip,
-         plasmamain[nstart].xi, w[n].r, w[n].vol, plasmamain[nstart].mean_ds / plasmamain[nstart].n_ds);
+         geo.alpha_agn, agn_ip, plasmamain[nstart].est->ip,
+         plasmamain[nstart].est->xi, w[n].r, w[n].vol, plasmamain[nstart].est->mean_ds / plasmamain[nstart].est->n_ds);
 
       /* 1108 NSH Added commands to report compton heating */
       Log
@@ -1002,6 +960,7 @@ History:
 	06aug	ksl	57h -- Additional changes to allow for the fact that marcomain
 			is not created at all if no macro atoms.
 	13dec	nsh	77 zero various new plasma variables
+	1703		The radiation field estimators are now in estmain
 
 **************************************************************/
 
@@ -1015,21 +974,21 @@ wind_rad_init ()
 
   for (n = 0; n < NPLASMA; n++)
   {
-    plasmamain[n].j = plasmamain[n].ave_freq = plasmamain[n].ntot = 0;
-    plasmamain[n].j_direct = plasmamain[n].j_scatt = 0.0;       //NSH 1309 zero j banded by number of scatters
-    plasmamain[n].ip = 0.0;
-    plasmamain[n].xi = 0.0;
-    plasmamain[n].ip_direct = plasmamain[n].ip_scatt = 0.0;
-    plasmamain[n].mean_ds = 0.0;
-    plasmamain[n].n_ds = 0;
-    plasmamain[n].ntot_disk = plasmamain[n].ntot_agn = 0;       //NSH 15/4/11 counters to see where photons come from
-    plasmamain[n].ntot_star = plasmamain[n].ntot_bl = plasmamain[n].ntot_wind = 0;
+    plasmamain[n].est->j = plasmamain[n].est->ave_freq = plasmamain[n].est->ntot = 0;
+    plasmamain[n].est->j_direct = plasmamain[n].est->j_scatt = 0.0;       //NSH 1309 zero j banded by number of scatters
+    plasmamain[n].est->ip = 0.0;
+    plasmamain[n].est->xi = 0.0;
+    plasmamain[n].est->ip_direct = plasmamain[n].est->ip_scatt = 0.0;
+    plasmamain[n].est->mean_ds = 0.0;
+    plasmamain[n].est->n_ds = 0;
+    plasmamain[n].est->ntot_disk = plasmamain[n].est->ntot_agn = 0;       //NSH 15/4/11 counters to see where photons come from
+    plasmamain[n].est->ntot_star = plasmamain[n].est->ntot_bl = plasmamain[n].est->ntot_wind = 0;
     plasmamain[n].heat_tot = plasmamain[n].heat_ff = plasmamain[n].heat_photo = plasmamain[n].heat_lines = 0.0;
     plasmamain[n].heat_z = 0.0;
-    plasmamain[n].max_freq = 0.0;       //NSH 120814 Zero the counter which works out the maximum frequency seen in a cell and hence the maximum applicable frequency of the power law estimators.
+    plasmamain[n].est->max_freq = 0.0;       //NSH 120814 Zero the counter which works out the maximum frequency seen in a cell and hence the maximum applicable frequency of the power law estimators.
     plasmamain[n].lum = plasmamain[n].lum_rad = plasmamain[n].lum_lines = plasmamain[n].lum_ff = 0.0;
     plasmamain[n].lum_fb = plasmamain[n].lum_z = 0.0;
-    plasmamain[n].nrad = plasmamain[n].nioniz = 0;
+    plasmamain[n].nrad = plasmamain[n].est->nioniz = 0;
     plasmamain[n].comp_nujnu = -1e99;   //1701 NSH Zero the integrated specific intensity for the cell
     plasmamain[n].lum_comp = 0.0;       //1108 NSH Zero the compton luminosity for the cell
     plasmamain[n].heat_comp = 0.0;      //1108 NSH Zero the compton heating for the cell
@@ -1043,10 +1002,10 @@ wind_rad_init ()
 /* 71 - 111279 - ksl - Small modification to reflect the fact that nxfreq has been moved into the geo structure */
     for (i = 0; i < geo.nxfreq; i++)
     {
-      plasmamain[n].xj[i] = plasmamain[n].xave_freq[i] = plasmamain[n].nxtot[i] = 0;
-      plasmamain[n].xsd_freq[i] = 0.0;  /* NSH 120815 Zero the standard deviation counter */
-      plasmamain[n].fmin[i] = geo.xfreq[i + 1]; /* Set the minium frequency to the max frequency in the band */
-      plasmamain[n].fmax[i] = geo.xfreq[i];     /* Set the maximum frequency to the min frequency in the band */
+      plasmamain[n].est->xj[i] = plasmamain[n].est->xave_freq[i] = plasmamain[n].est->nxtot[i] = 0;
+      plasmamain[n].est->xsd_freq[i] = 0.0;  /* NSH 120815 Zero the standard deviation counter */
+      plasmamain[n].est->fmin[i] = geo.xfreq[i + 1]; /* Set the minium frequency to the max frequency in the band */
+      plasmamain[n].est->fmax[i] = geo.xfreq[i];     /* Set the maximum frequency to the min frequency in the band */
     }
 
 
@@ -1203,8 +1162,8 @@ wind_rad_summary (w, filename, mode)
     nplasma = w[n].nplasma;
     fprintf (fptr,
              "%-3d %8.3e %8.3e %8.3e %8d %8.3e %8.3e %8.3e %8.3e %8.3e\n",
-             n, w[n].x[0], w[n].x[2], plasmamain[n].j,
-             plasmamain[n].ntot, plasmamain[nplasma].ave_freq,
+             n, w[n].x[0], w[n].x[2], plasmamain[n].est->j,
+             plasmamain[n].est->ntot, plasmamain[nplasma].est->ave_freq,
              plasmamain[nplasma].t_r, plasmamain[nplasma].w, plasmamain[nplasma].lum, plasmamain[nplasma].heat_tot);
 
   }
@@ -47,6 +47,14 @@ History:
 	15aug	ksl	Modified to write domain stucture
 	15oct	ksl	Modified to write disk and qdisk structures which is
 			needed to properly handle restarts
+	1703		Write the grid arrays of each domain, which are now
+			allocated to the size of the domain, after zdom
+	1703		Write the radiation field estimators, which are no
+			longer part of the plasma structure
+	1703		Write the bins of the spectra after the spectrum
+			structures, since they are now allocated separately
+	1703		Write each of the variable length arrays of the plasma
+			and macro structures in one go, rather than cell by cell
  
 **************************************************************/
 
@@ -64,7 +72,7 @@ wind_save (filename)
 {
   FILE *fptr, *fopen ();
   char line[LINELENGTH];
-  int n, m;
+  int n, ndom;
 
   if ((fptr = fopen (filename, "w")) == NULL)
   {
@@ -89,64 +97,74 @@ wind_save (filename)
   //   n += fwrite( &geo.reverb_dump_z[m], sizeof(int), 1, fptr);
   // }
   n += fwrite (zdom, sizeof (domain_dummy), geo.ndomain, fptr);
+
+  /* The grid arrays of each domain are allocated to their actual size, so write them
+     separately after the domain structures */
+
+  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  {
+    n += fwrite (zdom[ndom].wind_x, sizeof (double), zdom[ndom].ndim, fptr);
+    n += fwrite (zdom[ndom].wind_midx, sizeof (double), zdom[ndom].ndim, fptr);
+    n += fwrite (zdom[ndom].wind_z, sizeof (double), zdom[ndom].mdim, fptr);
+    n += fwrite (zdom[ndom].wind_midz, sizeof (double), zdom[ndom].mdim, fptr);
+    if (zdom[ndom].coord_type == CYLVAR)
+    {
+      n += fwrite (zdom[ndom].wind_z_var[0], sizeof (double), zdom[ndom].ndim * zdom[ndom].mdim, fptr);
+      n += fwrite (zdom[ndom].wind_midz_var[0], sizeof (double), zdom[ndom].ndim * zdom[ndom].mdim, fptr);
+    }
+  }
+
   n += fwrite (wmain, sizeof (wind_dummy), NDIM2, fptr);
   n += fwrite (&disk, sizeof (disk), 1, fptr);
   n += fwrite (&qdisk, sizeof (disk), 1, fptr);
   n += fwrite (plasmamain, sizeof (plasma_dummy), NPLASMA, fptr);
+  n += fwrite (estmain, sizeof (plasma_est_dummy), NPLASMA, fptr);
 
-/* NSH 1407 - The following loop writes out the variable length arrays
-in the plasma structure */
+/* NSH 1407 - The following writes out the variable length arrays
+in the plasma structure.  Each is a single block for all the cells, see calloc_arena */
 
-  for (m = 0; m < NPLASMA; m++)
-  {
-    n += fwrite (plasmamain[m].density, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].partition, sizeof (double), nions, fptr);
-
-    n += fwrite (plasmamain[m].PWdenom, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].PWdtemp, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].PWnumer, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].PWntemp, sizeof (double), nions, fptr);
+  n += fwrite (plasmamain[0].density, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].partition, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fwrite (plasmamain[m].ioniz, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].recomb, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].inner_recomb, sizeof (double), nions, fptr);
+  n += fwrite (plasmamain[0].PWdenom, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].PWdtemp, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].PWnumer, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].PWntemp, sizeof (double), nions * NPLASMA, fptr);
 
+  n += fwrite (plasmamain[0].ioniz, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].recomb, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].inner_recomb, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fwrite (plasmamain[m].scatters, sizeof (int), nions, fptr);
-    n += fwrite (plasmamain[m].xscatters, sizeof (double), nions, fptr);
+  n += fwrite (plasmamain[0].scatters, sizeof (int), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].xscatters, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fwrite (plasmamain[m].heat_ion, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].lum_ion, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].lum_inner_ion, sizeof (double), nions, fptr);
+  n += fwrite (plasmamain[0].heat_ion, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].lum_ion, sizeof (double), nions * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].lum_inner_ion, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fwrite (plasmamain[m].levden, sizeof (double), nlte_levels, fptr);
-    n += fwrite (plasmamain[m].recomb_simple, sizeof (double), nphot_total, fptr);
-    n += fwrite (plasmamain[m].kbf_use, sizeof (double), nphot_total, fptr);
-  }
+  n += fwrite (plasmamain[0].levden, sizeof (double), nlte_levels * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].recomb_simple, sizeof (double), nphot_total * NPLASMA, fptr);
+  n += fwrite (plasmamain[0].kbf_use, sizeof (int), nphot_total * NPLASMA, fptr);
 
 /* Now write out the macro atom info */
 
   if (geo.nmacro)
   {
     n += fwrite (macromain, sizeof (macro_dummy), NPLASMA, fptr);
-    for (m = 0; m < NPLASMA; m++)
-    {
-      n += fwrite (macromain[m].jbar, sizeof (double), size_Jbar_est, fptr);
-      n += fwrite (macromain[m].jbar_old, sizeof (double), size_Jbar_est, fptr);
-      n += fwrite (macromain[m].gamma, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_e, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_e, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].recomb_sp, sizeof (double), size_alpha_est, fptr);
-      n += fwrite (macromain[m].recomb_sp_e, sizeof (double), size_alpha_est, fptr);
-      n += fwrite (macromain[m].matom_emiss, sizeof (double), nlevels_macro, fptr);
-      n += fwrite (macromain[m].matom_abs, sizeof (double), nlevels_macro, fptr);
-
-    }
+    n += fwrite (macromain[0].jbar, sizeof (double), size_Jbar_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].jbar_old, sizeof (double), size_Jbar_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].gamma, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].gamma_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].gamma_e, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].gamma_e_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].alpha_st, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].alpha_st_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].alpha_st_e, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].alpha_st_e_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].recomb_sp, sizeof (double), size_alpha_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].recomb_sp_e, sizeof (double), size_alpha_est * NPLASMA, fptr);
+    n += fwrite (macromain[0].matom_emiss, sizeof (double), nlevels_macro * NPLASMA, fptr);
+    n += fwrite (macromain[0].matom_abs, sizeof (double), nlevels_macro * NPLASMA, fptr);
 
   }
 
@@ -178,7 +196,7 @@ wind_read (filename)
      char filename[];
 {
   FILE *fptr, *fopen ();
-  int n, m;
+  int n, m, ndom;
   char line[LINELENGTH];
   char version[LINELENGTH];
 
@@ -228,6 +246,26 @@ wind_read (filename)
   zdom = (DomainPtr) calloc (sizeof (domain_dummy), MaxDom);
   n += fread (zdom, sizeof (domain_dummy), geo.ndomain, fptr);
 
+  /* The pointers to the grid arrays that were read are those of the program that wrote
+     the file, so reallocate the arrays before reading them */
+
+  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  {
+    zdom[ndom].wind_x = zdom[ndom].wind_midx = zdom[ndom].wind_z = zdom[ndom].wind_midz = NULL;
+    zdom[ndom].wind_z_var = zdom[ndom].wind_midz_var = NULL;
+    calloc_domain (ndom);
+
+    n += fread (zdom[ndom].wind_x, sizeof (double), zdom[ndom].ndim, fptr);
+    n += fread (zdom[ndom].wind_midx, sizeof (double), zdom[ndom].ndim, fptr);
+    n += fread (zdom[ndom].wind_z, sizeof (double), zdom[ndom].mdim, fptr);
+    n += fread (zdom[ndom].wind_midz, sizeof (double), zdom[ndom].mdim, fptr);
+    if (zdom[ndom].coord_type == CYLVAR)
+    {
+      n += fread (zdom[ndom].wind_z_var[0], sizeof (double), zdom[ndom].ndim * zdom[ndom].mdim, fptr);
+      n += fread (zdom[ndom].wind_midz_var[0], sizeof (double), zdom[ndom].ndim * zdom[ndom].mdim, fptr);
+    }
+  }
+
   calloc_wind (NDIM2);
   n += fread (wmain, sizeof (wind_dummy), NDIM2, fptr);
 
@@ -239,38 +277,35 @@ wind_read (filename)
   calloc_plasma (NPLASMA);
 
   n += fread (plasmamain, sizeof (plasma_dummy), NPLASMA, fptr);
+  n += fread (estmain, sizeof (plasma_est_dummy), NPLASMA, fptr);
 
   /*Allocate space for the dynamically allocated plasma arrays */
 
   calloc_dyn_plasma (NPLASMA);
 
 
-  for (m = 0; m < NPLASMA; m++)
-  {
-
-    n += fread (plasmamain[m].density, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].partition, sizeof (double), nions, fptr);
+  n += fread (plasmamain[0].density, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].partition, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fread (plasmamain[m].PWdenom, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].PWdtemp, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].PWnumer, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].PWntemp, sizeof (double), nions, fptr);
+  n += fread (plasmamain[0].PWdenom, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].PWdtemp, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].PWnumer, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].PWntemp, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fread (plasmamain[m].ioniz, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].recomb, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].inner_recomb, sizeof (double), nions, fptr);
+  n += fread (plasmamain[0].ioniz, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].recomb, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].inner_recomb, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fread (plasmamain[m].scatters, sizeof (int), nions, fptr);
-    n += fread (plasmamain[m].xscatters, sizeof (double), nions, fptr);
+  n += fread (plasmamain[0].scatters, sizeof (int), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].xscatters, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fread (plasmamain[m].heat_ion, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].lum_ion, sizeof (double), nions, fptr);
-    n += fread (plasmamain[m].lum_inner_ion, sizeof (double), nions, fptr);
+  n += fread (plasmamain[0].heat_ion, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].lum_ion, sizeof (double), nions * NPLASMA, fptr);
+  n += fread (plasmamain[0].lum_inner_ion, sizeof (double), nions * NPLASMA, fptr);
 
-    n += fread (plasmamain[m].levden, sizeof (double), nlte_levels, fptr);
-    n += fread (plasmamain[m].recomb_simple, sizeof (double), nphot_total, fptr);
-    n += fread (plasmamain[m].kbf_use, sizeof (double), nphot_total, fptr);
-  }
+  n += fread (plasmamain[0].levden, sizeof (double), nlte_levels * NPLASMA, fptr);
+  n += fread (plasmamain[0].recomb_simple, sizeof (double), nphot_total * NPLASMA, fptr);
+  n += fread (plasmamain[0].kbf_use, sizeof (int), nphot_total * NPLASMA, fptr);
 
 
   /*Allocate space for macro-atoms */
@@ -281,23 +316,23 @@ wind_read (filename)
     n += fread (macromain, sizeof (macro_dummy), NPLASMA, fptr);
     calloc_estimators (NPLASMA);
 
+    n += fread (macromain[0].jbar, sizeof (double), size_Jbar_est * NPLASMA, fptr);
+    n += fread (macromain[0].jbar_old, sizeof (double), size_Jbar_est * NPLASMA, fptr);
+    n += fread (macromain[0].gamma, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].gamma_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].gamma_e, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].gamma_e_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].alpha_st, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].alpha_st_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].alpha_st_e, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].alpha_st_e_old, sizeof (double), size_gamma_est * NPLASMA, fptr);
+    n += fread (macromain[0].recomb_sp, sizeof (double), size_alpha_est * NPLASMA, fptr);
+    n += fread (macromain[0].recomb_sp_e, sizeof (double), size_alpha_est * NPLASMA, fptr);
+    n += fread (macromain[0].matom_emiss, sizeof (double), nlevels_macro * NPLASMA, fptr);
+    n += fread (macromain[0].matom_abs, sizeof (double), nlevels_macro * NPLASMA, fptr);
+
     for (m = 0; m < NPLASMA; m++)
     {
-      n += fread (macromain[m].jbar, sizeof (double), size_Jbar_est, fptr);
-      n += fread (macromain[m].jbar_old, sizeof (double), size_Jbar_est, fptr);
-      n += fread (macromain[m].gamma, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].gamma_old, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].gamma_e, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].gamma_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].alpha_st, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].alpha_st_old, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].alpha_st_e, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].alpha_st_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fread (macromain[m].recomb_sp, sizeof (double), size_alpha_est, fptr);
-      n += fread (macromain[m].recomb_sp_e, sizeof (double), size_alpha_est, fptr);
-      n += fread (macromain[m].matom_emiss, sizeof (double), nlevels_macro, fptr);
-      n += fread (macromain[m].matom_abs, sizeof (double), nlevels_macro, fptr);
-
       /* Force recalculation of kpkt_rates */
 
       macromain[m].kpkt_rates_known = 0;
@@ -373,7 +408,7 @@ spec_save (filename)
 
   FILE *fptr, *fopen ();
   char line[LINELENGTH];
-  int n;
+  int n, m, nbins;
 
   if ((fptr = fopen (filename, "w")) == NULL)
   {
@@ -384,6 +419,12 @@ spec_save (filename)
   sprintf (line, "Version %s  nspectra %d\n", VERSION, nspectra);
   n = fwrite (line, sizeof (line), 1, fptr);
   n += fwrite (xxspec, sizeof (spectrum_dummy), nspectra, fptr);
+
+  /* The bins of all the spectra are one block, see spectrum_bins_allocate */
+  nbins = 0;
+  for (m = 0; m < nspectra; m++)
+    nbins += 4 * xxspec[m].nwave;
+  n += fwrite (xxspec[0].f, sizeof (double), nbins, fptr);
   fclose (fptr);
 
   return (n);
@@ -395,7 +436,7 @@ spec_read (filename)
      char filename[];
 {
   FILE *fptr, *fopen ();
-  int n;
+  int n, m, nbins;
 
   char line[LINELENGTH];
   char version[LINELENGTH];
@@ -417,14 +458,21 @@ spec_read (filename)
   xxspec = calloc (sizeof (spectrum_dummy), nspectra);
   if (xxspec == NULL)
   {
-    Error ("spectrum_init: Could not allocate memory for %d spectra with %d wavelengths\n", nspectra, NWAVE);
+    Error ("spec_read: Could not allocate memory for %d spectra\n", nspectra);
     exit (0);
   }
 
-/* Now read the rest of the file */
+/* Now read the rest of the file.  The spectra give the number of bins, which 
+ * can then be allocated and pointed to before they are read */
 
   n += fread (xxspec, sizeof (spectrum_dummy), nspectra, fptr);
 
+  spectrum_bins_allocate ();
+  nbins = 0;
+  for (m = 0; m < nspectra; m++)
+    nbins += 4 * xxspec[m].nwave;
+  n += fread (xxspec[0].f, sizeof (double), nbins, fptr);
+
   fclose (fptr);
 
   Log ("Read spec structures from specfile %s\n", filename);
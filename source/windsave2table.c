@@ -924,11 +924,11 @@ get_one (ndom, variable_name)
       }
       else if (strcmp (variable_name, "ntot") == 0)
       {
-        x[n] = plasmamain[nplasma].ntot;
+        x[n] = plasmamain[nplasma].est->ntot;
       }
       else if (strcmp (variable_name, "ip") == 0)
       {
-        x[n] = plasmamain[nplasma].ip;
+        x[n] = plasmamain[nplasma].est->ip;
       }
       else if (strcmp (variable_name, "heat_tot") == 0)
       {